@@ -0,0 +1,30 @@
+#pragma once
+
+/* Performance budgets for tests.
+ *
+ * Include this header in a test library to declare how much time
+ * and memory a test may use:
+ *
+ *   CHILI_BUDGET(test_copy, .wall_ns = 100000, .max_rss_kb = 8192);
+ *
+ * Chili looks up the budget next to the test when running 'all'
+ * or 'named'. A test that succeeds but uses more than its budget
+ * is reported as over budget. Limits left out or set to zero are
+ * not checked.
+ */
+#include <stdint.h>
+
+struct chili_budget {
+    /* Wall time of the test function */
+    uint64_t wall_ns;
+    /* Cpu time of the test function */
+    uint64_t cpu_ns;
+    /* Peak resident memory of the test process in kilobytes */
+    uint64_t max_rss_kb;
+};
+
+/* Prefix of the symbol holding the budget of a test */
+#define CHILI_BUDGET_PREFIX "chili_budget_"
+
+#define CHILI_BUDGET(test, ...) \
+    const struct chili_budget chili_budget_##test = { __VA_ARGS__ }
@@ -0,0 +1,84 @@
+#pragma once
+
+/* Latency recording for benchmarks.
+ *
+ * Include this header in a benchmark library to record the
+ * latency of individual operations. Chili points chili_latency
+ * to a histogram in shared memory before a benchmark is started
+ * and reports percentiles of the recorded values when the
+ * benchmark has finished. Outside of 'chili bench' the pointer
+ * is NULL and recording does nothing.
+ *
+ * The histogram is log-linear, each power of two range is split
+ * in CHILI_LATENCY_SUB_COUNT linear buckets, giving a relative
+ * error of about 3%. Recording is a handful of instructions and
+ * is not thread safe, record from one thread per process.
+ */
+#include <stdint.h>
+#include <time.h>
+
+#define CHILI_LATENCY_SUB_BITS  5
+#define CHILI_LATENCY_SUB_COUNT (1 << CHILI_LATENCY_SUB_BITS)
+#define CHILI_LATENCY_BUCKETS   \
+    ((65 - CHILI_LATENCY_SUB_BITS) * CHILI_LATENCY_SUB_COUNT)
+
+struct chili_latency {
+    /* Number of recorded values */
+    uint64_t count;
+    /* Largest recorded value */
+    uint64_t max;
+    /* Number of values in each bucket */
+    uint64_t buckets[CHILI_LATENCY_BUCKETS];
+};
+
+/* Looked up and set by chili, one definition per library
+ * regardless of how many files that includes this header. */
+__attribute__((weak)) struct chili_latency *chili_latency;
+
+
+/**
+ * @brief Returns index of bucket that holds value.
+ */
+static inline unsigned chili_latency_index(uint64_t value)
+{
+    unsigned shift;
+
+    if (value < CHILI_LATENCY_SUB_COUNT){
+        return value;
+    }
+
+    shift = 63 - __builtin_clzll(value) - CHILI_LATENCY_SUB_BITS;
+    return ((shift + 1) << CHILI_LATENCY_SUB_BITS) +
+           (value >> shift) - CHILI_LATENCY_SUB_COUNT;
+}
+
+/**
+ * @brief Returns current monotonic time in nanoseconds.
+ */
+static inline uint64_t chili_latency_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Records latency of one operation.
+ *
+ * @param nanoseconds Duration of the operation.
+ */
+static inline void chili_latency_record(uint64_t nanoseconds)
+{
+    struct chili_latency *latency = chili_latency;
+
+    if (latency == 0){
+        return;
+    }
+
+    latency->count++;
+    latency->buckets[chili_latency_index(nanoseconds)]++;
+    if (nanoseconds > latency->max){
+        latency->max = nanoseconds;
+    }
+}
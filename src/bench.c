@@ -0,0 +1,515 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "evict.h"
+#include "stats.h"
+#include "bench.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Types */
+
+/* Shared between chili and the benchmark process */
+struct samples {
+    /* Set by benchmark process when pinned to cpu */
+    bool     pinned;
+    bool     priority_raised;
+    int      count;
+    uint64_t ns[];
+};
+
+enum pass {
+    pass_warm,
+    pass_cold,
+    pass_count
+};
+
+struct instance {
+    /* Samples written by benchmark process */
+    struct samples       *samples;
+    size_t               samples_size;
+    /* Latencies recorded by benchmark process */
+    struct chili_latency *child_latency;
+    /* Latencies from all benchmark processes of each pass */
+    struct chili_latency merged[pass_count];
+    /* Sorted copy of samples */
+    uint64_t             *sorted;
+    /* Number of samples when convergence is checked next */
+    int                  next_check;
+    /* Created on first cold pass */
+    chili_handle         evict_handle;
+    /* Cpu that benchmark processes are pinned to, -1 if not
+     * pinned */
+    int                  cpu;
+};
+
+struct bench_context {
+    struct instance                  *instance;
+    const struct chili_bind_test     *bench;
+    const struct chili_bind_fixture  *fixture;
+    const struct chili_bench_options *options;
+    enum pass                        pass;
+    /* When pass started */
+    uint64_t                         start_ns;
+    /* Samples to take in this process, at most */
+    int                              first;
+    int                              count;
+};
+
+
+/* Locals */
+static uint64_t _now()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static enum fixture_result _evaluate_fixture(chili_func fixture)
+{
+    if (fixture){
+        return fixture() < 0 ?
+            fixture_error : fixture_success;
+    }
+    else{
+        return fixture_not_needed;
+    }
+}
+
+static enum test_result _evaluate(int returned)
+{
+    if (returned < 0){
+        return test_error;
+    }
+    return returned == 0 ?
+        test_failure : test_success;
+}
+
+static enum test_result _take_warm_sample(chili_func bench,
+                                          int iterations,
+                                          uint64_t *ns)
+{
+    int returned;
+    uint64_t start = _now();
+
+    for (int i = 0; i < iterations; i++){
+        returned = bench();
+        if (returned <= 0){
+            return _evaluate(returned);
+        }
+    }
+
+    *ns = (_now() - start) / iterations;
+    return test_success;
+}
+
+static enum test_result _take_cold_sample(chili_func bench,
+                                          chili_handle evict_handle,
+                                          uint64_t *ns)
+{
+    int returned;
+    uint64_t start;
+
+    chili_evict(evict_handle);
+
+    start = _now();
+    returned = bench();
+    *ns = _now() - start;
+
+    return _evaluate(returned);
+}
+
+static uint64_t _to_ns(const struct timespec *t)
+{
+    return (uint64_t)t->tv_sec * 1000000000 + t->tv_nsec;
+}
+
+static bool _converged(struct instance *instance,
+                       const struct chili_bench_options *options,
+                       int count)
+{
+    struct chili_stats stats;
+
+    memcpy(instance->sorted, instance->samples->ns,
+           count * sizeof(uint64_t));
+    chili_stats_sort(instance->sorted, count);
+    chili_stats_compute(instance->sorted, count, &stats);
+
+    return chili_stats_relative_width(&stats) <= options->ci_width;
+}
+
+/* Decides if enough samples have been taken in pass */
+static bool _pass_done(struct instance *instance,
+                       const struct bench_context *context,
+                       int count)
+{
+    const struct chili_bench_options *options = context->options;
+
+    if (count >= CHILI_BENCH_MAX_SAMPLES){
+        return true;
+    }
+    if (_now() - context->start_ns >= _to_ns(&options->max_time)){
+        return true;
+    }
+    if (count < options->samples || count < instance->next_check){
+        return false;
+    }
+
+    /* Sorting is costly, check less often as samples grow */
+    instance->next_check = count + count / 8 + 1;
+
+    return _converged(instance, options, count);
+}
+
+/* Executes in benchmark process */
+static void _bench_body(void *c, struct chili_result *result)
+{
+    struct bench_context *context = c;
+    struct instance *instance = context->instance;
+    struct samples *samples = instance->samples;
+    int last = context->first + context->count;
+
+    /* Only the measuring process is pinned and reniced */
+    if (instance->cpu >= 0){
+        samples->pinned = chili_noise_isolate(instance->cpu,
+                                              &samples->priority_raised) > 0;
+    }
+
+    result->before = _evaluate_fixture(context->fixture->each_before);
+    if (result->before == fixture_error){
+        return;
+    }
+
+    result->test = test_success;
+    for (int i = context->first; i < last; i++){
+        result->test = context->pass == pass_cold ?
+            _take_cold_sample(context->bench->func,
+                              instance->evict_handle,
+                              &samples->ns[i]) :
+            _take_warm_sample(context->bench->func,
+                              context->options->iterations,
+                              &samples->ns[i]);
+        if (result->test != test_success){
+            break;
+        }
+        samples->count = i + 1;
+
+        if (_pass_done(instance, context, samples->count)){
+            break;
+        }
+    }
+
+    result->after = _evaluate_fixture(context->fixture->each_after);
+}
+
+static bool _succeeded(const struct chili_result *result)
+{
+    return result->execution == execution_done &&
+           result->before != fixture_error &&
+           result->after != fixture_error &&
+           result->test == test_success;
+}
+
+static void _summarize(struct instance *instance,
+                       const struct chili_bench_options *options,
+                       enum pass pass,
+                       struct chili_bench_timing *timing)
+{
+    int count = instance->samples->count;
+    uint64_t sum = 0;
+    struct chili_stats stats;
+
+    memset(timing, 0, sizeof(*timing));
+    timing->samples = count;
+    timing->latency = instance->merged[pass].count > 0 ?
+        &instance->merged[pass] : NULL;
+    if (count == 0){
+        return;
+    }
+
+    memcpy(instance->sorted, instance->samples->ns,
+           count * sizeof(uint64_t));
+    chili_stats_sort(instance->sorted, count);
+    chili_stats_compute(instance->sorted, count, &stats);
+
+    for (int i = 0; i < count; i++){
+        sum += instance->sorted[i];
+    }
+
+    timing->min_ns = instance->sorted[0];
+    timing->median_ns = stats.median;
+    timing->mean_ns = sum / count;
+    timing->ci_low_ns = stats.ci_low;
+    timing->ci_high_ns = stats.ci_high;
+    timing->low_outliers = stats.low_outliers;
+    timing->high_outliers = stats.high_outliers;
+    timing->converged = count >= options->samples &&
+        chili_stats_relative_width(&stats) <= options->ci_width;
+}
+
+/* Runs samples of a pass in one process or, when fresh
+ * processes are requested, one process per sample. */
+static int _run_pass(struct bench_context *context,
+                     struct chili_result *result,
+                     chili_progress bench_progress)
+{
+    struct instance *instance = context->instance;
+    const struct chili_bench_options *options = context->options;
+    bool fresh = context->pass == pass_cold && options->fresh;
+    struct chili_aggregated ignored = { 0 };
+    int r;
+
+    instance->samples->count = 0;
+    instance->next_check = 0;
+    chili_latency_reset(&instance->merged[context->pass]);
+
+    context->start_ns = _now();
+    context->first = 0;
+    context->count = fresh ? 1 : CHILI_BENCH_MAX_SAMPLES;
+    do {
+        chili_latency_reset(instance->child_latency);
+
+        /* Aggregated once the benchmark is done */
+        r = chili_run_custom(result, &ignored, context->bench,
+                             &options->times, bench_progress,
+                             _bench_body, context);
+        if (r < 0){
+            return r;
+        }
+        chili_latency_merge(&instance->merged[context->pass],
+                            instance->child_latency);
+
+        /* Progress is reported once per benchmark */
+        bench_progress = NULL;
+        context->first = instance->samples->count;
+    } while (fresh && _succeeded(result) &&
+             !_pass_done(instance, context, context->first));
+
+    return 1;
+}
+
+/* Exports */
+int chili_bench_create(chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = malloc(sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate bench instance\n");
+        return -1;
+    }
+
+    instance->evict_handle = NULL;
+    instance->cpu = -1;
+    instance->samples_size = sizeof(struct samples) +
+                             CHILI_BENCH_MAX_SAMPLES * sizeof(uint64_t);
+    instance->samples = mmap(NULL, instance->samples_size,
+                             PROT_READ|PROT_WRITE,
+                             MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (instance->samples == MAP_FAILED){
+        printf("Failed to map samples: %s\n", strerror(errno));
+        goto on_samples_error;
+    }
+
+    instance->sorted = malloc(CHILI_BENCH_MAX_SAMPLES * sizeof(uint64_t));
+    if (instance->sorted == NULL){
+        printf("Unable to allocate samples\n");
+        goto on_sorted_error;
+    }
+
+    if (chili_latency_create(&instance->child_latency) < 0){
+        goto on_latency_error;
+    }
+
+    *handle = instance;
+    return 1;
+
+on_latency_error:
+    free(instance->sorted);
+on_sorted_error:
+    munmap(instance->samples, instance->samples_size);
+on_samples_error:
+    free(instance);
+    return -1;
+}
+
+int chili_bench_run(chili_handle handle,
+                    struct chili_bench_result *result,
+                    struct chili_aggregated *aggregated,
+                    const struct chili_bind_test *bench,
+                    const struct chili_bind_fixture *fixture,
+                    struct chili_latency **latency,
+                    const struct chili_bench_options *options,
+                    chili_progress bench_progress)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct bench_context context = {
+        .instance = instance,
+        .bench    = bench,
+        .fixture  = fixture,
+        .options  = options,
+        .pass     = pass_warm,
+    };
+    struct chili_noise_sample before;
+    struct chili_noise_sample after;
+    int r;
+
+    if (options->isolate && instance->cpu < 0){
+        r = chili_noise_pick_cpu();
+        if (r < 0){
+            return r;
+        }
+        instance->cpu = r;
+    }
+    instance->samples->pinned = false;
+    instance->samples->priority_raised = false;
+
+    if (options->cold && instance->evict_handle == NULL){
+        r = chili_evict_create(&instance->evict_handle);
+        if (r < 0){
+            return r;
+        }
+    }
+
+    /* Benchmark process records through this pointer */
+    if (latency){
+        *latency = instance->child_latency;
+    }
+
+    result->iterations = options->iterations;
+    result->has_cold = false;
+
+    chili_noise_sample(instance->cpu, &before);
+
+    debug_print("Running benchmark %s\n", bench->name);
+    r = _run_pass(&context, &result->result, bench_progress);
+    if (r > 0){
+        _summarize(instance, options, pass_warm, &result->warm);
+    }
+
+    if (r > 0 && options->cold && _succeeded(&result->result)){
+        debug_print("Running benchmark %s with cold caches\n",
+                    bench->name);
+        context.pass = pass_cold;
+        r = _run_pass(&context, &result->result, NULL);
+        if (r > 0){
+            _summarize(instance, options, pass_cold, &result->cold);
+            result->has_cold = true;
+        }
+    }
+
+    if (latency){
+        *latency = NULL;
+    }
+    if (r < 0){
+        return r;
+    }
+
+    chili_noise_sample(instance->cpu, &after);
+    result->noise.cpu = instance->samples->pinned ? instance->cpu : -1;
+    result->noise.priority_raised = instance->samples->priority_raised;
+    chili_noise_evaluate(&before, &after, &result->noise);
+
+    chili_run_aggregate(&result->result, aggregated);
+
+    return 1;
+}
+
+static void _export_latency(FILE *f,
+                            const struct chili_bench_result *result,
+                            const char *prefix,
+                            const struct chili_latency *latency)
+{
+    const char *library = result->result.library;
+    const char *name = result->result.name;
+
+    if (latency == NULL){
+        return;
+    }
+
+    fprintf(f, "%slatency %s:%s count=%" PRIu64 " p50=%" PRIu64
+            " p90=%" PRIu64 " p99=%" PRIu64 " p99.9=%" PRIu64
+            " max=%" PRIu64 "\n",
+            prefix, library, name, latency->count,
+            chili_latency_percentile(latency, 50),
+            chili_latency_percentile(latency, 90),
+            chili_latency_percentile(latency, 99),
+            chili_latency_percentile(latency, 99.9),
+            latency->max);
+
+    for (int i = 0; i < CHILI_LATENCY_BUCKETS; i++){
+        if (latency->buckets[i] > 0){
+            fprintf(f, "%sbucket %s:%s %" PRIu64 " %" PRIu64 "\n",
+                    prefix, library, name,
+                    chili_latency_bucket_value(i),
+                    latency->buckets[i]);
+        }
+    }
+}
+
+static void _export_timing(FILE *f,
+                           const char *prefix,
+                           const struct chili_bench_timing *timing)
+{
+    fprintf(f, " %ssamples=%d %smin_ns=%" PRIu64 " %smedian_ns=%" PRIu64
+            " %smean_ns=%" PRIu64 " %sci_low_ns=%" PRIu64
+            " %sci_high_ns=%" PRIu64 " %sconverged=%d"
+            " %slow_outliers=%d %shigh_outliers=%d",
+            prefix, timing->samples, prefix, timing->min_ns,
+            prefix, timing->median_ns, prefix, timing->mean_ns,
+            prefix, timing->ci_low_ns, prefix, timing->ci_high_ns,
+            prefix, timing->converged ? 1 : 0,
+            prefix, timing->low_outliers, prefix, timing->high_outliers);
+}
+
+static void _export_noise(FILE *f, const struct chili_noise *noise)
+{
+    fprintf(f, " cpu=%d governor=%s turbo=%d load=%.2f"
+            " steal_pct=%.2f priority_raised=%d noisy=%d",
+            noise->cpu,
+            noise->governor[0] ? noise->governor : "unknown",
+            noise->turbo, noise->load, 100.0 * noise->steal,
+            noise->priority_raised ? 1 : 0, noise->noisy ? 1 : 0);
+}
+
+void chili_bench_export(FILE *f, const struct chili_bench_result *result)
+{
+    const struct chili_bench_timing *warm = &result->warm;
+    const struct chili_bench_timing *cold = &result->cold;
+
+    fprintf(f, "bench %s:%s iterations=%d",
+            result->result.library, result->result.name,
+            result->iterations);
+    _export_timing(f, "", warm);
+    if (result->has_cold){
+        _export_timing(f, "cold_", cold);
+    }
+    _export_noise(f, &result->noise);
+    fprintf(f, "\n");
+
+    _export_latency(f, result, "", warm->latency);
+    if (result->has_cold){
+        _export_latency(f, result, "cold_", cold->latency);
+    }
+}
+
+void chili_bench_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    if (instance->evict_handle){
+        chili_evict_destroy(instance->evict_handle);
+    }
+    chili_latency_destroy(instance->child_latency);
+    munmap(instance->samples, instance->samples_size);
+    free(instance->sorted);
+    free(instance);
+}
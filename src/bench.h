@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "handle.h"
+#include "run.h"
+#include "latency.h"
+#include "noise.h"
+
+/* Max number of samples taken of a benchmark in one pass */
+#define CHILI_BENCH_MAX_SAMPLES 10000
+
+struct chili_bench_options {
+    /* Minimum number of samples taken of each benchmark */
+    int samples;
+    /* Sampling continues until the 95% confidence interval of
+     * the median is narrower than this fraction of the median */
+    double ci_width;
+    /* or until this much time has been spent on one pass */
+    struct timespec max_time;
+    /* Number of calls to benchmark function in each sample */
+    int iterations;
+    /* Also run with caches evicted before each sample */
+    bool cold;
+    /* Take each cold sample in a new process */
+    bool fresh;
+    /* Pin benchmark processes to one cpu and raise priority */
+    bool isolate;
+    /* Timeout for all samples of one benchmark in one process */
+    struct chili_times times;
+};
+
+/**
+ * @brief Timings of one pass over a benchmark.
+ *
+ * Times are per call to the benchmark function.
+ */
+struct chili_bench_timing {
+    /* Number of completed samples */
+    int                        samples;
+    uint64_t                   min_ns;
+    uint64_t                   median_ns;
+    uint64_t                   mean_ns;
+    /* 95% confidence interval of the median */
+    uint64_t                   ci_low_ns;
+    uint64_t                   ci_high_ns;
+    /* False when time or samples ran out before the interval
+     * was narrow enough */
+    bool                       converged;
+    /* Samples far from the rest, kept in all of the above */
+    int                        low_outliers;
+    int                        high_outliers;
+    /* Latencies recorded by the benchmark itself merged from all
+     * processes of the pass, NULL if nothing was recorded. */
+    const struct chili_latency *latency;
+};
+
+/**
+ * @brief Result of running a benchmark.
+ */
+struct chili_bench_result {
+    /* Outcome of fixtures and benchmark function, a benchmark
+     * function returns like a test does. */
+    struct chili_result       result;
+    int                       iterations;
+    /* Samples taken one after another with warm caches */
+    struct chili_bench_timing warm;
+    /* Samples taken with caches evicted, only when cold is set */
+    bool                      has_cold;
+    struct chili_bench_timing cold;
+    /* Machine state while benchmark ran */
+    struct chili_noise        noise;
+};
+
+/**
+ * @brief Creates a benchmark runner.
+ *
+ * @param handle      Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_bench_create(chili_handle *handle);
+
+/**
+ * @brief Runs a benchmark.
+ *
+ * Benchmark is executed in a child process. Samples are taken
+ * until the median is known with the precision asked for in
+ * options or until time runs out. When a cold pass
+ * is requested a cold sample is a single call made right after
+ * caches have been evicted. State of the machine is sampled
+ * before and after and the result is flagged when it was noisy.
+ * When isolation is requested chili itself is pinned on first
+ * run. Result is valid until next call to run or destroy.
+ *
+ * @param latency  Latency pointer in library containing benchmark,
+ *                 NULL if library doesn't record latencies.
+ *
+ * @return Negative on error, positive on success.
+ *         Success doesnt mean that the benchmark succeeded only
+ *         that no errors occured.
+ */
+int chili_bench_run(chili_handle handle,
+                    struct chili_bench_result *result,
+                    struct chili_aggregated *aggregated,
+                    const struct chili_bind_test *bench,
+                    const struct chili_bind_fixture *fixture,
+                    struct chili_latency **latency,
+                    const struct chili_bench_options *options,
+                    chili_progress bench_progress);
+
+/**
+ * @brief Writes result on a machine readable format.
+ *
+ * Writes one line with timings, and for each pass that recorded
+ * latencies one line with percentiles and one line per non empty
+ * histogram bucket.
+ */
+void chili_bench_export(FILE *f, const struct chili_bench_result *result);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_bench_destroy(chili_handle handle);
@@ -109,21 +109,21 @@ int chili_bind_fixture(chili_handle handle,
     return r;
 }
 
-int chili_bind_test(chili_handle handle,
-                    int index,
-                    struct chili_bind_test *bind_test)
+static int _bind_named(struct instance *instance,
+                       char **names,
+                       int count,
+                       int index,
+                       struct chili_bind_test *bind_test)
 {
-    struct instance *instance = (struct instance*)handle;
     const char *name;
     int r;
-    const struct chili_suite *suite = instance->suite;
 
-    if (index >= suite->count || index < 0){
+    if (index >= count || index < 0){
         /* Invalid index */
         return -1;
     }
 
-    name = suite->tests[index];
+    name = names[index];
     if (name == NULL){
         return -1;
     }
@@ -133,10 +133,59 @@ int chili_bind_test(chili_handle handle,
     }
     bind_test->name = name;
     bind_test->library = instance->lib_path;
+    bind_test->budget = NULL;
 
     return 1;
 }
 
+static const struct chili_budget *_bind_budget(struct instance *instance,
+                                               const char *name)
+{
+    char symbol[256];
+
+    snprintf(symbol, sizeof(symbol), CHILI_BUDGET_PREFIX "%s", name);
+
+    /* Optional, most tests have no budget */
+    return dlsym(instance->lib_handle, symbol);
+}
+
+int chili_bind_test(chili_handle handle,
+                    int index,
+                    struct chili_bind_test *bind_test)
+{
+    struct instance *instance = (struct instance*)handle;
+    const struct chili_suite *suite = instance->suite;
+
+    int r;
+
+    r = _bind_named(instance, suite->tests, suite->count,
+                    index, bind_test);
+    if (r > 0){
+        bind_test->budget = _bind_budget(instance, bind_test->name);
+    }
+
+    return r;
+}
+
+int chili_bind_bench(chili_handle handle,
+                     int index,
+                     struct chili_bind_test *bind_bench)
+{
+    struct instance *instance = (struct instance*)handle;
+    const struct chili_suite *suite = instance->suite;
+
+    return _bind_named(instance, suite->benchmarks, suite->bench_count,
+                       index, bind_bench);
+}
+
+struct chili_latency **chili_bind_latency(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    /* Optional, only present when library uses the latency API */
+    return dlsym(instance->lib_handle, "chili_latency");
+}
+
 void chili_bind_destroy(chili_handle handle)
 {
     struct instance *instance = (struct instance*)handle;
@@ -2,6 +2,8 @@
 
 #include "handle.h"
 #include "suite.h"
+#include "latency.h"
+#include "chili/budget.h"
 
 typedef int (*chili_func)(void);
 
@@ -30,6 +32,9 @@ struct chili_bind_test
     /* Name and path to library
      * containing test */
     const char *library;
+    /* Declared budget of test, NULL
+     * if there is none */
+    const struct chili_budget *budget;
 };
 
 
@@ -61,6 +66,23 @@ int chili_bind_test(chili_handle handle,
                     int index,
                     struct chili_bind_test *bind_test);
 
+/**
+ * @brief Binds benchmark in suite.
+ *
+ * @return Negative on error, positive on success.
+ */
+int chili_bind_bench(chili_handle handle,
+                     int index,
+                     struct chili_bind_test *bind_bench);
+
+/**
+ * @brief Returns the latency histogram pointer of the library.
+ *
+ * @return Address of the pointer that the latency API records
+ *         through or NULL if library doesn't use the API.
+ */
+struct chili_latency **chili_bind_latency(chili_handle handle);
+
 /**
  * @brief Releases all resources held by the module.
  *
@@ -0,0 +1,1017 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <link.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "hash.h"
+#include "symbols.h"
+#include "named.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+/* Chunk of file read at a time when hashing */
+#define READ_SIZE 65536
+
+/* Executable whose results are cached */
+#define EXECUTABLE "/proc/self/exe"
+
+/* Tests that passed, stored in cache directory */
+#define TESTS "tests"
+#define INITIAL_CAPACITY 256
+#define MAX_LINE 1024
+
+/* Code that runs along with each test */
+static const char *_fixtures[] = {
+    "once_before",
+    "once_after",
+    "each_before",
+    "each_after",
+    NULL,
+};
+
+/* Prefix of budget declared for test, see chili/budget.h */
+#define BUDGET_PREFIX "chili_budget_"
+
+/* Environment that changes how libraries are loaded and run */
+static const char *_environment[] = {
+    "LD_LIBRARY_PATH",
+    "LD_PRELOAD",
+    "LD_BIND_NOW",
+    "GLIBC_TUNABLES",
+    "MALLOC_CHECK_",
+    "MALLOC_PERTURB_",
+    "LANG",
+    "LC_ALL",
+    "TZ",
+    NULL,
+};
+
+/* Searched by the dynamic linker when nothing else matches */
+static const char *_default_dirs[] = {
+    "/lib64",
+    "/usr/lib64",
+    "/lib",
+    "/usr/lib",
+    NULL,
+};
+
+/* Types */
+
+/* Hashed file, each file is only hashed once */
+struct file {
+    char     *path;
+    uint64_t hash;
+};
+
+/* Library that has been looked up */
+struct pending {
+    char         *library;
+    /* Hash of resolved path, names stored results */
+    uint64_t     name;
+    uint64_t     key;
+    /* Log of added results, NULL until first result */
+    chili_handle results;
+    /* Any added result didn't succeed */
+    bool         failed;
+};
+
+/* Paths of a library and everything it needs */
+struct closure {
+    char **paths;
+    int  count;
+    int  capacity;
+};
+
+/* Test that passed with code of given fingerprint */
+struct test {
+    /* Library and name separated by terminator */
+    char     *key;
+    uint64_t fingerprint;
+    bool     passed;
+};
+
+struct instance {
+    char           path[PATH_MAX];
+    struct file    *files;
+    int            num_files;
+    /* Directories of libraries loaded by chili, like where the
+     * dynamic linker found libc */
+    char           **dirs;
+    int            num_dirs;
+    /* Hash of environment and executable */
+    uint64_t       environment;
+    struct pending *pending;
+    int            num_pending;
+    /* Tests that passed, loaded when first needed */
+    struct test    *tests;
+    int            tests_capacity;
+    int            num_tests;
+    /* Index of test by library and name */
+    chili_handle   tests_index;
+    bool           tests_loaded;
+    bool           tests_changed;
+    /* Library whose code is fingerprinted */
+    char           *code_library;
+    chili_handle   code;
+    /* Fingerprint of fixtures of library */
+    uint64_t       fixtures;
+};
+
+
+/* Locals */
+static int _hash_contents(const char *path, uint64_t *hash)
+{
+    char *buffer;
+    ssize_t length;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0){
+        debug_print("Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    buffer = malloc(READ_SIZE);
+    if (buffer == NULL){
+        printf("Unable to allocate read buffer\n");
+        close(fd);
+        return -1;
+    }
+
+    *hash = CHILI_HASH_FNV_OFFSET;
+    while ((length = read(fd, buffer, READ_SIZE)) > 0){
+        *hash = chili_hash_fnv64(*hash, buffer, length);
+    }
+
+    free(buffer);
+    close(fd);
+    return length < 0 ? -1 : 1;
+}
+
+/* Libraries like libc are needed by most, hash them once */
+static int _hash_file(struct instance *instance,
+                      const char *path,
+                      uint64_t *hash)
+{
+    struct file *files;
+
+    for (int i = 0; i < instance->num_files; i++){
+        if (strcmp(instance->files[i].path, path) == 0){
+            *hash = instance->files[i].hash;
+            return 1;
+        }
+    }
+
+    if (_hash_contents(path, hash) < 0){
+        return -1;
+    }
+
+    files = realloc(instance->files,
+                    (instance->num_files + 1) * sizeof(*files));
+    if (files == NULL){
+        printf("Unable to allocate hashed files\n");
+        return -1;
+    }
+    instance->files = files;
+    files[instance->num_files].path = strdup(path);
+    if (files[instance->num_files].path == NULL){
+        return -1;
+    }
+    files[instance->num_files].hash = *hash;
+    instance->num_files++;
+
+    return 1;
+}
+
+static int _add_dir(struct instance *instance, const char *dir, int length)
+{
+    char **dirs;
+
+    for (int i = 0; i < instance->num_dirs; i++){
+        if (strncmp(instance->dirs[i], dir, length) == 0 &&
+            instance->dirs[i][length] == 0){
+            return 1;
+        }
+    }
+
+    dirs = realloc(instance->dirs,
+                   (instance->num_dirs + 1) * sizeof(*dirs));
+    if (dirs == NULL){
+        return -1;
+    }
+    instance->dirs = dirs;
+    dirs[instance->num_dirs] = strndup(dir, length);
+    if (dirs[instance->num_dirs] == NULL){
+        return -1;
+    }
+    instance->num_dirs++;
+
+    return 1;
+}
+
+static int _add_loaded_dir(struct dl_phdr_info *info,
+                           size_t size,
+                           void *context)
+{
+    const char *name = info->dlpi_name;
+    const char *slash = strrchr(name, '/');
+
+    /* Executable and vdso have no path */
+    if (slash == NULL || slash == name){
+        return 0;
+    }
+
+    return _add_dir(context, name, slash - name) < 0 ? -1 : 0;
+}
+
+static int _add_search_dirs(struct instance *instance)
+{
+    if (dl_iterate_phdr(_add_loaded_dir, instance) < 0){
+        printf("Unable to allocate library directories\n");
+        return -1;
+    }
+
+    for (int i = 0; _default_dirs[i]; i++){
+        if (_add_dir(instance, _default_dirs[i],
+                     strlen(_default_dirs[i])) < 0){
+            printf("Unable to allocate library directories\n");
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+static uint64_t _hash_environment(struct instance *instance)
+{
+    uint64_t hash = CHILI_HASH_FNV_OFFSET;
+    uint64_t executable;
+    const char *value;
+
+    for (int i = 0; _environment[i]; i++){
+        value = getenv(_environment[i]);
+        hash = chili_hash_fnv64(hash, _environment[i],
+                                strlen(_environment[i]) + 1);
+        /* Unset and empty differs */
+        if (value){
+            hash = chili_hash_fnv64(hash, value, strlen(value) + 1);
+        }
+    }
+
+    /* A new chili may run tests differently */
+    if (_hash_contents(EXECUTABLE, &executable) > 0){
+        hash = chili_hash_fnv64(hash, &executable, sizeof(executable));
+    }
+
+    return hash;
+}
+
+/* Tries name in each directory of colon separated list, with
+ * $ORIGIN replaced by directory of library that needs it */
+static bool _search(const char *list,
+                    const char *origin,
+                    const char *name,
+                    char *resolved)
+{
+    const char *dir = list;
+    const char *end;
+    const char *rest;
+    char path[PATH_MAX];
+    int length;
+
+    while (dir && *dir){
+        end = strchr(dir, ':');
+        length = end ? end - dir : (int)strlen(dir);
+
+        if (strncmp(dir, "$ORIGIN", 7) == 0 ||
+            strncmp(dir, "${ORIGIN}", 9) == 0){
+            rest = dir + (dir[1] == '{' ? 9 : 7);
+            snprintf(path, sizeof(path), "%s%.*s/%s", origin,
+                     (int)(length - (rest - dir)), rest, name);
+        }
+        else {
+            snprintf(path, sizeof(path), "%.*s/%s", length, dir, name);
+        }
+
+        if (length > 0 && realpath(path, resolved) != NULL){
+            return true;
+        }
+        dir = end ? end + 1 : NULL;
+    }
+
+    return false;
+}
+
+/* Resolves needed library the way the dynamic linker does,
+ * except for its cache of where libraries are installed */
+static bool _resolve(struct instance *instance,
+                     const char *name,
+                     const char *origin,
+                     const char *rpath,
+                     const char *runpath,
+                     char *resolved)
+{
+    if (strchr(name, '/')){
+        return realpath(name, resolved) != NULL;
+    }
+
+    if (rpath && !runpath && _search(rpath, origin, name, resolved)){
+        return true;
+    }
+    if (_search(getenv("LD_LIBRARY_PATH"), origin, name, resolved)){
+        return true;
+    }
+    if (runpath && _search(runpath, origin, name, resolved)){
+        return true;
+    }
+
+    for (int i = 0; i < instance->num_dirs; i++){
+        if (_search(instance->dirs[i], origin, name, resolved)){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int _closure_add(struct closure *closure, const char *path)
+{
+    char **paths;
+
+    for (int i = 0; i < closure->count; i++){
+        if (strcmp(closure->paths[i], path) == 0){
+            return 0;
+        }
+    }
+
+    if (closure->count == closure->capacity){
+        closure->capacity = closure->capacity ? closure->capacity * 2 : 16;
+        paths = realloc(closure->paths,
+                        closure->capacity * sizeof(*paths));
+        if (paths == NULL){
+            printf("Unable to allocate needed libraries\n");
+            return -1;
+        }
+        closure->paths = paths;
+    }
+
+    closure->paths[closure->count] = strdup(path);
+    if (closure->paths[closure->count] == NULL){
+        return -1;
+    }
+    closure->count++;
+
+    return 1;
+}
+
+static void _closure_free(struct closure *closure)
+{
+    for (int i = 0; i < closure->count; i++){
+        free(closure->paths[i]);
+    }
+    free(closure->paths);
+}
+
+/* Adds libraries needed by library at index of closure, names
+ * that can't be resolved are hashed instead */
+static int _add_needed(struct instance *instance,
+                       struct closure *closure,
+                       int index,
+                       uint64_t *key)
+{
+    char origin[PATH_MAX];
+    char resolved[PATH_MAX];
+    char *rpath = NULL;
+    char *runpath = NULL;
+    char *name;
+    char *slash;
+    chili_handle handle;
+    int next = 0;
+    int r;
+
+    if (chili_sym_create(closure->paths[index], NULL, &handle) < 0){
+        return -1;
+    }
+
+    snprintf(origin, sizeof(origin), "%s", closure->paths[index]);
+    slash = strrchr(origin, '/');
+    if (slash){
+        *slash = 0;
+    }
+
+    chili_sym_next_dynamic(handle, CHILI_SYM_RPATH, &next, &rpath);
+    next = 0;
+    chili_sym_next_dynamic(handle, CHILI_SYM_RUNPATH, &next, &runpath);
+
+    next = 0;
+    while ((r = chili_sym_next_dynamic(handle, CHILI_SYM_NEEDED,
+                                       &next, &name)) > 0){
+        if (!_resolve(instance, name, origin, rpath, runpath, resolved)){
+            debug_print("Unable to resolve %s\n", name);
+            *key = chili_hash_fnv64(*key, name, strlen(name) + 1);
+            continue;
+        }
+        if (_closure_add(closure, resolved) < 0){
+            r = -1;
+            break;
+        }
+    }
+
+    chili_sym_destroy(handle);
+    return r;
+}
+
+/* Hashes library, everything it needs and the environment */
+static int _key(struct instance *instance,
+                const char *path,
+                uint64_t *key)
+{
+    struct closure closure = { 0 };
+    uint64_t hash;
+    int r = 1;
+
+    *key = instance->environment;
+
+    r = _closure_add(&closure, path);
+    for (int i = 0; r >= 0 && i < closure.count; i++){
+        r = _hash_file(instance, closure.paths[i], &hash);
+        if (r < 0){
+            break;
+        }
+        *key = chili_hash_fnv64(*key, &hash, sizeof(hash));
+
+        r = _add_needed(instance, &closure, i, key);
+        /* A needed file that isn't ELF is still hashed */
+        if (r < 0 && i > 0){
+            r = 1;
+        }
+    }
+
+    debug_print("%s and %d needed libraries has key %016" PRIx64 "\n",
+                path, closure.count - 1, *key);
+    _closure_free(&closure);
+    return r < 0 ? -1 : 1;
+}
+
+static struct pending *_find(struct instance *instance,
+                             const char *library)
+{
+    for (int i = 0; i < instance->num_pending; i++){
+        if (strcmp(instance->pending[i].library, library) == 0){
+            return &instance->pending[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void _stored_path(struct instance *instance,
+                         const struct pending *pending,
+                         char *path,
+                         size_t size)
+{
+    snprintf(path, size, "%s/%016" PRIx64 ".%016" PRIx64,
+             instance->path, pending->name, pending->key);
+}
+
+static void _added_path(struct instance *instance,
+                        const struct pending *pending,
+                        char *path,
+                        size_t size)
+{
+    snprintf(path, size, "%s/.%016" PRIx64, instance->path,
+             pending->name);
+}
+
+static int _begin_results(struct instance *instance,
+                          struct pending *pending)
+{
+    char path[PATH_MAX + 40];
+
+    if (mkdir(instance->path, S_IRWXU) < 0 && errno != EEXIST){
+        printf("Failed to create cache %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    _added_path(instance, pending, path, sizeof(path));
+    return chili_results_create(path, 1, 1, &pending->results);
+}
+
+static void _discard_results(struct instance *instance,
+                             struct pending *pending)
+{
+    char path[PATH_MAX + 40];
+
+    if (pending->results == NULL){
+        return;
+    }
+
+    chili_results_destroy(pending->results);
+    pending->results = NULL;
+    _added_path(instance, pending, path, sizeof(path));
+    unlink(path);
+}
+
+/* Removes results stored for earlier versions of library */
+static void _remove_stored(struct instance *instance,
+                           const struct pending *pending)
+{
+    char prefix[24];
+    char path[PATH_MAX + 300];
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir(instance->path);
+    if (dir == NULL){
+        return;
+    }
+
+    snprintf(prefix, sizeof(prefix), "%016" PRIx64 ".", pending->name);
+    while ((entry = readdir(dir)) != NULL){
+        if (strncmp(entry->d_name, prefix, strlen(prefix)) == 0){
+            snprintf(path, sizeof(path), "%s/%s", instance->path,
+                     entry->d_name);
+            unlink(path);
+        }
+    }
+
+    closedir(dir);
+}
+
+static const char *_test_name(const struct test *test)
+{
+    return test->key + strlen(test->key) + 1;
+}
+
+/* Returns test, NULL if not cached */
+static struct test *_find_test(struct instance *instance,
+                               const char *library,
+                               const char *name)
+{
+    int i = chili_hash_find(instance->tests_index, library, name);
+
+    return i < 0 ? NULL : &instance->tests[i];
+}
+
+static int _grow_tests(struct instance *instance)
+{
+    int capacity = instance->tests_capacity ?
+                   instance->tests_capacity * 2 : INITIAL_CAPACITY;
+    struct test *tests = realloc(instance->tests,
+                                 capacity * sizeof(*tests));
+
+    if (tests == NULL){
+        printf("Unable to grow cached tests\n");
+        return -1;
+    }
+    instance->tests = tests;
+    instance->tests_capacity = capacity;
+
+    return 1;
+}
+
+static int _set_test(struct instance *instance,
+                     const char *library,
+                     const char *name,
+                     uint64_t fingerprint,
+                     bool passed)
+{
+    size_t length = strlen(library);
+    struct test *test;
+
+    test = _find_test(instance, library, name);
+    if (test == NULL){
+        if (instance->num_tests == instance->tests_capacity &&
+            _grow_tests(instance) < 0){
+            return -1;
+        }
+        test = &instance->tests[instance->num_tests];
+        test->key = malloc(length + strlen(name) + 2);
+        if (test->key == NULL){
+            printf("Unable to allocate cached test\n");
+            return -1;
+        }
+        strcpy(test->key, library);
+        strcpy(test->key + length + 1, name);
+        if (chili_hash_add(instance->tests_index, test->key,
+                           _test_name(test), instance->num_tests) < 0){
+            free(test->key);
+            return -1;
+        }
+        instance->num_tests++;
+    }
+    test->fingerprint = fingerprint;
+    test->passed = passed;
+
+    return 1;
+}
+
+static int _load_tests(struct instance *instance)
+{
+    char path[PATH_MAX + 16];
+    char line[MAX_LINE];
+    uint64_t fingerprint;
+    int consumed;
+    char *library;
+    char *name;
+    FILE *f;
+    int r = 1;
+
+    if (instance->tests_loaded){
+        return 1;
+    }
+    instance->tests_loaded = true;
+
+    if (chili_hash_create(&instance->tests_index) < 0){
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "%s/" TESTS, instance->path);
+    f = fopen(path, "r");
+    if (f == NULL){
+        debug_print("No cached tests in %s\n", path);
+        return 1;
+    }
+
+    /* Lines look like: fingerprint library:name */
+    while (r > 0 && fgets(line, sizeof(line), f)){
+        if (sscanf(line, "%" SCNx64 " %n", &fingerprint, &consumed) < 1 ||
+            chili_named_parse(line + consumed, &library, &name) < 0){
+            continue;
+        }
+        r = _set_test(instance, library, name, fingerprint, true);
+    }
+
+    fclose(f);
+    return r;
+}
+
+static int _save_tests(struct instance *instance)
+{
+    char path[PATH_MAX + 16];
+    char temp_path[PATH_MAX + 16];
+    struct test *test;
+    FILE *f;
+
+    if (!instance->tests_changed){
+        return 1;
+    }
+
+    if (mkdir(instance->path, S_IRWXU) < 0 && errno != EEXIST){
+        printf("Failed to create cache %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    /* Write whole file before replacing the old one */
+    snprintf(path, sizeof(path), "%s/" TESTS, instance->path);
+    snprintf(temp_path, sizeof(temp_path), "%s/." TESTS, instance->path);
+    f = fopen(temp_path, "w");
+    if (f == NULL){
+        printf("Failed to save cached tests to %s: %s\n",
+               temp_path, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < instance->num_tests; i++){
+        test = &instance->tests[i];
+        if (test->passed){
+            fprintf(f, "%016" PRIx64 " %s:%s\n", test->fingerprint,
+                    test->key, _test_name(test));
+        }
+    }
+
+    if (fclose(f) != 0 || rename(temp_path, path) < 0){
+        printf("Failed to save cached tests to %s: %s\n",
+               path, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+static uint64_t _hash_code(uint64_t hash,
+                           chili_handle code,
+                           const char *name)
+{
+    const char *bytes;
+    uint64_t size;
+
+    /* Symbols that aren't defined are hashed by name alone */
+    hash = chili_hash_fnv64(hash, name, strlen(name) + 1);
+    if (chili_sym_code(code, name, &bytes, &size) > 0){
+        hash = chili_hash_fnv64(hash, &size, sizeof(size));
+        hash = chili_hash_fnv64(hash, bytes, size);
+    }
+
+    return hash;
+}
+
+static void _close_code(struct instance *instance)
+{
+    if (instance->code){
+        chili_sym_destroy(instance->code);
+        instance->code = NULL;
+    }
+    free(instance->code_library);
+    instance->code_library = NULL;
+}
+
+/* Opens library to fingerprint, libraries are mostly done one
+ * at a time so only the last one is kept open */
+static int _open_code(struct instance *instance, const char *library)
+{
+    if (instance->code_library &&
+        strcmp(instance->code_library, library) == 0){
+        return instance->code ? 1 : -1;
+    }
+
+    _close_code(instance);
+    instance->code_library = strdup(library);
+    if (instance->code_library == NULL){
+        return -1;
+    }
+    if (chili_sym_create(library, NULL, &instance->code) < 0){
+        instance->code = NULL;
+        return -1;
+    }
+
+    instance->fixtures = instance->environment;
+    for (int i = 0; _fixtures[i]; i++){
+        instance->fixtures = _hash_code(instance->fixtures,
+                                        instance->code, _fixtures[i]);
+    }
+
+    return 1;
+}
+
+/* Hashes machine code of test, fixtures and budget of test */
+static int _fingerprint(struct instance *instance,
+                        const char *library,
+                        const char *name,
+                        uint64_t *fingerprint)
+{
+    char budget[MAX_LINE];
+    const char *bytes;
+    uint64_t size;
+
+    if (_open_code(instance, library) < 0){
+        return -1;
+    }
+
+    if (chili_sym_code(instance->code, name, &bytes, &size) <= 0){
+        return -1;
+    }
+    *fingerprint = _hash_code(instance->fixtures, instance->code, name);
+
+    snprintf(budget, sizeof(budget), BUDGET_PREFIX "%s", name);
+    *fingerprint = _hash_code(*fingerprint, instance->code, budget);
+
+    return 1;
+}
+
+
+/* Exports */
+int chili_cache_create(const char *path, chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate cache instance\n");
+        return -1;
+    }
+
+    snprintf(instance->path, sizeof(instance->path), "%s", path);
+    if (_add_search_dirs(instance) < 0){
+        chili_cache_destroy(instance);
+        return -1;
+    }
+    instance->environment = _hash_environment(instance);
+
+    /* Before supervisors are forked, so they don't each load them */
+    if (_load_tests(instance) < 0){
+        chili_cache_destroy(instance);
+        return -1;
+    }
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_cache_lookup(chili_handle handle, const char *library)
+{
+    struct instance *instance = (struct instance*)handle;
+    char resolved[PATH_MAX];
+    char path[PATH_MAX + 40];
+    struct pending *pending;
+    uint64_t key;
+
+    if (realpath(library, resolved) == NULL){
+        printf("Failed to resolve %s: %s\n", library, strerror(errno));
+        return -1;
+    }
+
+    if (_key(instance, resolved, &key) < 0){
+        return -1;
+    }
+
+    pending = _find(instance, library);
+    if (pending == NULL){
+        pending = realloc(instance->pending,
+                          (instance->num_pending + 1) * sizeof(*pending));
+        if (pending == NULL){
+            printf("Unable to allocate cached library\n");
+            return -1;
+        }
+        instance->pending = pending;
+        pending = &instance->pending[instance->num_pending];
+        memset(pending, 0, sizeof(*pending));
+        pending->library = strdup(library);
+        if (pending->library == NULL){
+            return -1;
+        }
+        instance->num_pending++;
+    }
+    pending->name = chili_hash_fnv64(CHILI_HASH_FNV_OFFSET, resolved,
+                                     strlen(resolved));
+    pending->key = key;
+
+    _stored_path(instance, pending, path, sizeof(path));
+    return access(path, R_OK) == 0 ? 1 : 0;
+}
+
+int chili_cache_read(chili_handle handle,
+                     const char *library,
+                     chili_results_visit visit,
+                     void *context)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct pending *pending = _find(instance, library);
+    char path[PATH_MAX + 40];
+    int shard;
+    int num_shards;
+
+    if (pending == NULL){
+        printf("%s has not been looked up in cache\n", library);
+        return -1;
+    }
+
+    _stored_path(instance, pending, path, sizeof(path));
+    return chili_results_read(path, &shard, &num_shards, visit, context);
+}
+
+int chili_cache_add(chili_handle handle,
+                    const struct chili_result *result,
+                    bool succeeded)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct pending *pending = _find(instance, result->library);
+
+    if (pending == NULL){
+        return 0;
+    }
+
+    /* Nothing more is needed once anything failed */
+    if (!succeeded){
+        pending->failed = true;
+        _discard_results(instance, pending);
+    }
+    if (pending->failed){
+        return 1;
+    }
+
+    if (pending->results == NULL &&
+        _begin_results(instance, pending) < 0){
+        pending->failed = true;
+        return -1;
+    }
+
+    return chili_results_add(pending->results, result);
+}
+
+int chili_cache_done(chili_handle handle,
+                     const char *library,
+                     bool succeeded)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct pending *pending = _find(instance, library);
+    char added[PATH_MAX + 40];
+    char stored[PATH_MAX + 40];
+
+    if (pending == NULL){
+        return 0;
+    }
+
+    if (!succeeded || pending->failed){
+        _discard_results(instance, pending);
+        pending->failed = false;
+        return 0;
+    }
+
+    /* Library without tests */
+    if (pending->results == NULL &&
+        _begin_results(instance, pending) < 0){
+        return -1;
+    }
+    chili_results_destroy(pending->results);
+    pending->results = NULL;
+
+    _remove_stored(instance, pending);
+    _added_path(instance, pending, added, sizeof(added));
+    _stored_path(instance, pending, stored, sizeof(stored));
+    if (rename(added, stored) < 0){
+        printf("Failed to store results of %s: %s\n", library,
+               strerror(errno));
+        unlink(added);
+        return -1;
+    }
+
+    return 1;
+}
+
+bool chili_cache_test_passed(chili_handle handle,
+                             const char *library,
+                             const char *name)
+{
+    struct instance *instance = (struct instance*)handle;
+    uint64_t fingerprint;
+    struct test *test;
+
+    if (_load_tests(instance) < 0 ||
+        _fingerprint(instance, library, name, &fingerprint) < 0){
+        return false;
+    }
+
+    test = _find_test(instance, library, name);
+
+    return test && test->passed &&
+           test->fingerprint == fingerprint;
+}
+
+int chili_cache_test_set(chili_handle handle,
+                         const char *library,
+                         const char *name,
+                         bool succeeded)
+{
+    struct instance *instance = (struct instance*)handle;
+    uint64_t fingerprint = 0;
+
+    if (_load_tests(instance) < 0){
+        return -1;
+    }
+
+    /* A test that can't be fingerprinted is never cached */
+    if (succeeded &&
+        _fingerprint(instance, library, name, &fingerprint) < 0){
+        succeeded = false;
+    }
+
+    instance->tests_changed = true;
+    return _set_test(instance, library, name, fingerprint, succeeded);
+}
+
+void chili_cache_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    _save_tests(instance);
+    _close_code(instance);
+    for (int i = 0; i < instance->num_tests; i++){
+        free(instance->tests[i].key);
+    }
+    free(instance->tests);
+    if (instance->tests_index){
+        chili_hash_destroy(instance->tests_index);
+    }
+
+    for (int i = 0; i < instance->num_pending; i++){
+        _discard_results(instance, &instance->pending[i]);
+        free(instance->pending[i].library);
+    }
+    for (int i = 0; i < instance->num_files; i++){
+        free(instance->files[i].path);
+    }
+    for (int i = 0; i < instance->num_dirs; i++){
+        free(instance->dirs[i]);
+    }
+    free(instance->pending);
+    free(instance->files);
+    free(instance->dirs);
+    free(instance);
+}
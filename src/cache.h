@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "handle.h"
+#include "run.h"
+#include "results.h"
+
+
+/**
+ * @brief Creates cache of results of libraries that succeeded.
+ *
+ * A library is identified by a key hashed from the library
+ * file, the files of all libraries it needs, as resolved by
+ * the dynamic linker, environment variables that affect
+ * loading and running it and the chili executable itself.
+ * Results are stored in a directory, one result log per
+ * library, and only when all tests of the library succeeded.
+ *
+ * @param path   Directory that results are stored in, created
+ *               when results are first stored.
+ * @param handle Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_cache_create(const char *path, chili_handle *handle);
+
+/**
+ * @brief Checks if results of library are cached.
+ *
+ * Key of library is hashed and remembered for results added
+ * later on.
+ *
+ * @return Negative on error, like when library isn't ELF.
+ *         Zero when library isn't cached.
+ *         Positive when it is.
+ */
+int chili_cache_lookup(chili_handle handle, const char *library);
+
+/**
+ * @brief Reads cached results of library.
+ *
+ * Library and name of results are only valid during the call.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_cache_read(chili_handle handle,
+                     const char *library,
+                     chili_results_visit visit,
+                     void *context);
+
+/**
+ * @brief Adds result of test in library that has been looked up.
+ *
+ * @param succeeded True if test succeeded.
+ *
+ * @return Negative on error.
+ *         Zero when library hasn't been looked up.
+ *         Positive on success.
+ */
+int chili_cache_add(chili_handle handle,
+                    const struct chili_result *result,
+                    bool succeeded);
+
+/**
+ * @brief Marks library as done, no more results will be added.
+ *
+ * Added results are stored, replacing results stored for an
+ * earlier version of library, when all tests succeeded.
+ *
+ * @param succeeded True if suite setup and teardown succeeded.
+ *
+ * @return Negative on error.
+ *         Zero when results weren't stored.
+ *         Positive when they were.
+ */
+int chili_cache_done(chili_handle handle,
+                     const char *library,
+                     bool succeeded);
+
+/**
+ * @brief Checks if test passed when last run with the same code.
+ *
+ * Code of a test is the machine code of the test function,
+ * of the suite and test fixtures of its library and the
+ * budget of the test. Code of functions that the test calls
+ * is not, so a test that passed might fail with a changed
+ * callee.
+ *
+ * @return True if test passed with the same code.
+ */
+bool chili_cache_test_passed(chili_handle handle,
+                             const char *library,
+                             const char *name);
+
+/**
+ * @brief Records outcome of test, with the current code.
+ *
+ * @param succeeded True if test succeeded.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_cache_test_set(chili_handle handle,
+                         const char *library,
+                         const char *name,
+                         bool succeeded);
+
+/**
+ * @brief Saves outcome of tests and frees allocated resources.
+ *
+ * Results of libraries not done are not stored.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_cache_destroy(chili_handle handle);
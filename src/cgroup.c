@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cgroup.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Where the cgroup v2 hierarchy is mounted */
+#define CGROUP_ROOT "/sys/fs/cgroup"
+/* Limit files are short */
+#define MAX_CONTENT 512
+
+
+/* Locals */
+
+/* Reads path of this process in the cgroup v2 hierarchy */
+static int _own_cgroup(char *path, int size)
+{
+    char line[PATH_MAX];
+    char *newline;
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    int r = 0;
+
+    if (f == NULL){
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f) != NULL){
+        /* Unified hierarchy has id 0 and no controllers */
+        if (strncmp(line, "0::", 3) != 0){
+            continue;
+        }
+        newline = strchr(line, '\n');
+        if (newline){
+            *newline = '\0';
+        }
+        r = snprintf(path, size, "%s%s", CGROUP_ROOT, line + 3) < size ?
+            1 : -1;
+        break;
+    }
+    fclose(f);
+
+    return r;
+}
+
+
+/* Exports */
+int chili_cgroup_read(const char *path,
+                      const char *file,
+                      char *content,
+                      int size)
+{
+    char file_path[PATH_MAX + 64];
+    FILE *f;
+    size_t n;
+
+    snprintf(file_path, sizeof(file_path), "%s/%s", path, file);
+    f = fopen(file_path, "r");
+    if (f == NULL){
+        return -1;
+    }
+    n = fread(content, 1, size - 1, f);
+    fclose(f);
+    content[n] = '\0';
+
+    return 1;
+}
+
+int chili_cgroup_walk(const char *file,
+                      chili_cgroup_visit visit,
+                      void *context)
+{
+    char path[PATH_MAX];
+    char content[MAX_CONTENT];
+    char *slash;
+    int r;
+
+    r = _own_cgroup(path, sizeof(path));
+    if (r <= 0){
+        return r;
+    }
+
+    while (strlen(path) >= strlen(CGROUP_ROOT)){
+        if (chili_cgroup_read(path, file, content, sizeof(content)) > 0){
+            debug_print("Visiting %s/%s\n", path, file);
+            visit(context, path, content);
+        }
+        slash = strrchr(path, '/');
+        if (slash == NULL){
+            break;
+        }
+        *slash = '\0';
+    }
+
+    return 1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+
+/**
+ * @brief Called with content of a cgroup file.
+ *
+ * @param context Context given when walking.
+ * @param path    Path of cgroup directory the file is in.
+ * @param content Content of file.
+ */
+typedef void (*chili_cgroup_visit)(void *context,
+                                   const char *path,
+                                   const char *content);
+
+/**
+ * @brief Reads a file in the cgroup v2 hierarchy of this process.
+ *
+ * Visits the file in the cgroup of this process and then in each
+ * of its parents, limits are enforced by all of them. Cgroups
+ * without the file are skipped.
+ *
+ * @param file    Name of file, like cpu.max.
+ * @param visit   Called for each cgroup with the file.
+ * @param context Passed to visit.
+ *
+ * @return Negative on error.
+ *         Zero when process isn't in a cgroup v2 hierarchy.
+ *         Positive on success.
+ */
+int chili_cgroup_walk(const char *file,
+                      chili_cgroup_visit visit,
+                      void *context);
+
+/**
+ * @brief Reads a file in a cgroup directory.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_cgroup_read(const char *path,
+                      const char *file,
+                      char *content,
+                      int size);
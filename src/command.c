@@ -1,7 +1,13 @@
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "report.h"
 #include "library.h"
@@ -9,12 +15,144 @@
 #include "registry.h"
 #include "named.h"
 #include "debugger.h"
+#include "supervisor.h"
+#include "history.h"
+#include "schedule.h"
+#include "latency.h"
+#include "cpus.h"
+#include "memory.h"
+#include "select.h"
+#include "shard.h"
+#include "results.h"
+#include "worker.h"
+#include "reorder.h"
+#include "cache.h"
+#include "dwarf.h"
+#include "coverage.h"
+#include "symbols.h"
+#include "watch.h"
+#include "server.h"
+#include "journal.h"
+#include "compare.h"
 
 /* Debugging */
 #define DEBUG_PRINTS 0
 #include "debug.h"
 
 
+/* Constants */
+
+/* How often throttling is checked when adapting number of jobs */
+#define ADAPT_INTERVAL_NS 1000000000ULL
+
+/* Times a test is run again when its worker dies */
+#define WORKER_RETRIES 2
+
+/* Results kept in memory while waiting for their turn to be
+ * reported, more are spilled to disk */
+#define REORDER_CAPACITY 1024
+
+/* Most cpus whose topology is read when pinning */
+#define MAX_CPUS 1024
+
+/* Longest path of a changed file */
+#define MAX_CHANGED_PATH 1024
+
+/* How often a run is checked for being done while watching */
+#define WATCH_TICK_MS 100
+
+
+/* Types */
+struct named_test {
+    /* Parsed line, library and name points into it */
+    char *line;
+    char *library;
+    char *name;
+    /* Lower runs first */
+    int  priority;
+    /* Position in given order */
+    int  position;
+};
+
+/* Reported results of all shards */
+struct merge {
+    struct chili_aggregated aggregated;
+    chili_handle            history;
+    int                     num_skipped;
+};
+
+/* Reports results of tests run concurrently in the order they
+ * were given */
+struct ordered {
+    struct chili_aggregated *aggregated;
+    chili_handle            history;
+    const char              *redirect_path;
+    chili_handle            reorder;
+    /* Identity of next released result */
+    int                     next_identity;
+    /* Group of suite teardown messages from workers */
+    int                     teardown_group;
+};
+
+/* Cached results of a library, reported at once or in turn */
+struct cached {
+    chili_handle            cache;
+    chili_handle            history;
+    struct chili_aggregated *aggregated;
+    /* Reports in turn when set */
+    struct ordered          *ordered;
+    const char              *library;
+    int                     group;
+};
+
+/* Reports what 'chili serve' streams back */
+struct served {
+    const char              **libraries;
+    struct chili_aggregated *aggregated;
+    chili_handle            history;
+};
+
+/* Reports results of tests completed by an interrupted run as
+ * if they were run again */
+struct replay {
+    chili_handle            history;
+    chili_handle            cache;
+    bool                    cache_tests;
+    struct chili_aggregated *aggregated;
+    /* Set when a replayed result stopped testing of library */
+    bool                    stopped;
+};
+
+/* Predicted duration of tests never run */
+#define UNKNOWN_DURATION_NS 1000000ULL
+
+/* Keeps running libraries within memory budget */
+struct admission {
+    /* Memory for all running libraries, zero if unlimited */
+    uint64_t budget_kb;
+    /* Predicted peak memory of running libraries */
+    uint64_t in_use_kb;
+    /* Predicted peak memory of each library */
+    uint64_t *expected_kb;
+    bool     *started;
+};
+
+/* Globals */
+
+/* Set by SIGINT or SIGTERM while watching */
+static volatile sig_atomic_t _watch_stopped;
+
+/* Journal of run in this process, NULL when not running */
+static chili_handle _journal;
+/* Result log of run in this process, NULL when not running */
+static chili_handle _results;
+/* Process that keeps journal, tests forked from it share the
+ * signal handler */
+static pid_t _journal_pid;
+/* Handlers of SIGINT and SIGTERM before run */
+static struct sigaction _journal_actions[2];
+
+
 static bool _continue_testing(struct chili_result *result,
                               struct chili_aggregated *aggregated)
 {
@@ -26,7 +164,168 @@ static bool _continue_testing(struct chili_result *result,
     return error_occured ? false : true;
 }
 
+static bool _succeeded(const struct chili_result *result)
+{
+    return result->execution == execution_done &&
+           result->before != fixture_error &&
+           result->after != fixture_error &&
+           result->test == test_success &&
+           !result->over_budget;
+}
+
+static void _record(chili_handle history,
+                    const char *library_path,
+                    const struct chili_result *result)
+{
+    uint64_t max_rss_kb = result->usage.max_rss_kb;
+
+    if (_journal){
+        chili_journal_add(_journal, result);
+    }
+    if (_results){
+        chili_results_add(_results, result);
+    }
+    /* Cached test wasn't run, what was recorded when it was
+     * still holds */
+    if (result->cached){
+        chili_history_keep(history, library_path, result->name);
+        return;
+    }
+
+    /* Declared peak counts when test hasn't reached it */
+    if (result->budget.max_rss_kb > max_rss_kb){
+        max_rss_kb = result->budget.max_rss_kb;
+    }
+
+    chili_history_set(history, library_path, result->name,
+                      result->usage.elapsed_ns, !_succeeded(result));
+    chili_history_set_rss(history, library_path, result->name,
+                          max_rss_kb);
+}
+
+/* Identities are given in the same order as in the interrupted
+ * run, output of test is still in place */
+static void _replay_result(struct replay *replay,
+                           const char *library_path,
+                           const struct chili_result *completed)
+{
+    struct chili_result result = *completed;
+
+    result.library = library_path;
+    result.identity = chili_run_identity();
+    chili_report_test_begin(library_path, result.name);
+    chili_run_aggregate(&result, replay->aggregated);
+    chili_report_test(&result, replay->aggregated);
+    _record(replay->history, library_path, &result);
+    if (replay->cache){
+        chili_cache_add(replay->cache, &result, _succeeded(&result));
+    }
+    if (replay->cache_tests){
+        chili_cache_test_set(replay->cache, library_path, result.name,
+                             _succeeded(&result));
+    }
+    if (!_continue_testing(&result, replay->aggregated)){
+        replay->stopped = true;
+    }
+}
+
+/* Leaves out and reports tests completed by interrupted run,
+ * and those that it never got to after an error */
+static bool _skip_completed(void *context,
+                            const char *library_path,
+                            const char *test_name)
+{
+    struct replay *replay = context;
+    struct chili_result result;
+
+    if (replay->stopped){
+        return true;
+    }
+    if (chili_journal_find(_journal, library_path, test_name,
+                           &result) == 0){
+        return false;
+    }
+
+    _replay_result(replay, library_path, &result);
+    return true;
+}
+
+static bool _completed(const char *library_path)
+{
+    return _journal && chili_journal_is_done(_journal, library_path);
+}
+
+struct replay_library {
+    struct replay *replay;
+    const char    *library;
+};
+
+static int _replay_completed(void *context,
+                             const struct chili_result *result)
+{
+    struct replay_library *replay_library = context;
+
+    _replay_result(replay_library->replay, replay_library->library,
+                   result);
+    return 1;
+}
+
+/* Reports all tests of library completed by interrupted run */
+static int _replay_library(const char *library_path,
+                           struct replay *replay)
+{
+    struct replay_library replay_library = { replay, library_path };
+
+    chili_journal_replay(_journal, library_path, _replay_completed,
+                         &replay_library);
+    chili_cache_done(replay->cache, library_path, true);
+
+    return 1;
+}
+
+/* Runs tests that didn't succeed last time first */
+static bool _failed_last_run(void *history,
+                             const char *library_path,
+                             const char *test_name)
+{
+    return chili_history_failed(history, library_path, test_name);
+}
+
+static bool _passed_unchanged(void *cache,
+                              const char *library_path,
+                              const char *test_name)
+{
+    return chili_cache_test_passed(cache, library_path, test_name);
+}
+
+/* Leaves out and reports tests that passed with the same code */
+static bool _skip_passed(void *context,
+                         const char *library_path,
+                         const char *test_name)
+{
+    struct cached *cached = context;
+    struct chili_result result;
+
+    if (!_passed_unchanged(cached->cache, library_path, test_name)){
+        return false;
+    }
+
+    chili_run_cached(&result, library_path, test_name);
+    result.identity = chili_run_identity();
+    chili_report_test_begin(library_path, test_name);
+    chili_run_aggregate(&result, cached->aggregated);
+    chili_report_test(&result, cached->aggregated);
+    chili_cache_add(cached->cache, &result, true);
+    chili_history_keep(cached->history, library_path, test_name);
+
+    return true;
+}
+
 static int _run_suite(chili_handle lib_handle,
+                      const char *library_path,
+                      chili_handle history,
+                      chili_handle cache,
+                      chili_handle coverage,
                       const struct chili_test_options *options,
                       struct chili_aggregated *aggregated)
 {
@@ -34,11 +333,50 @@ static int _run_suite(chili_handle lib_handle,
     struct chili_result result;
     struct chili_times times;
     int index = 0;
+    uint64_t setup_ns;
+    struct cached cached = {
+        .cache      = cache,
+        .history    = history,
+        .aggregated = aggregated,
+    };
+    struct replay replay = {
+        .history     = history,
+        .cache       = cache,
+        .cache_tests = options->cache_tests,
+        .aggregated  = aggregated,
+    };
 
     times.timeout.tv_nsec = 0;
     times.timeout.tv_sec = 10;
 
+    chili_history_forget(history, library_path);
+
+    r = chili_lib_run_first(lib_handle, _failed_last_run, history);
+    if (r < 0){
+        return r;
+    }
+
+    if (options->cache_tests){
+        r = chili_lib_skip(lib_handle, _skip_passed, &cached);
+        if (r < 0){
+            return r;
+        }
+    }
+
+    /* After cached tests, they were reported first when
+     * interrupted too */
+    if (_journal){
+        r = chili_lib_skip(lib_handle, _skip_completed, &replay);
+        if (r < 0){
+            return r;
+        }
+    }
+
+    setup_ns = chili_latency_now();
     r = chili_lib_before_fixture(lib_handle);
+    setup_ns = chili_latency_now() - setup_ns;
+    chili_history_set(history, library_path, CHILI_HISTORY_SETUP,
+                      setup_ns, r < 0);
     if (r < 0){
         /* Tests arent safe to run when
          * initialization failed */
@@ -61,6 +399,15 @@ static int _run_suite(chili_handle lib_handle,
             break;
         }
         chili_report_test(&result, aggregated);
+        _record(history, library_path, &result);
+        chili_cache_add(cache, &result, _succeeded(&result));
+        if (options->cache_tests){
+            chili_cache_test_set(cache, library_path, result.name,
+                                 _succeeded(&result));
+        }
+        if (coverage){
+            chili_coverage_record(coverage, library_path, result.name);
+        }
 
         if (!_continue_testing(&result, aggregated)){
             break;
@@ -81,318 +428,2938 @@ static int _run_suite(chili_handle lib_handle,
     return r;
 }
 
-static const char *_bool_str(bool b)
+static int _run_benchmarks(chili_handle lib_handle,
+                           chili_handle bench_handle,
+                           const struct chili_bench_options *options,
+                           FILE *export,
+                           struct chili_aggregated *aggregated)
 {
-    return b ? "true" : "false";
+    int r;
+    struct chili_bench_result result;
+    int index = 0;
+
+    r = chili_lib_before_fixture(lib_handle);
+    if (r < 0){
+        chili_report_suite_begin_fail(r);
+        return r;
+    }
+
+    do {
+        r = chili_lib_next_bench(lib_handle, bench_handle, &index,
+                                 options, &result, aggregated);
+        if (r <= 0){
+            break;
+        }
+        chili_report_bench(&result, aggregated);
+        if (export){
+            chili_bench_export(export, &result);
+        }
+
+        if (!_continue_testing(&result.result, aggregated)){
+            break;
+        }
+    } while (true); /* Stop executing on error */
+
+    /* Preserve error from above */
+    if (r < 0){
+        chili_lib_after_fixture(lib_handle);
+    }
+    else {
+        r = chili_lib_after_fixture(lib_handle);
+        if (r < 0){
+            chili_report_suite_end_fail(r);
+        }
+    }
+
+    return r;
 }
 
-static void _option_print(const char *intro,
-                          const struct chili_test_options *options)
+/* Lowers number of running libraries while the cgroup is
+ * throttled and raises it again when it no longer is */
+static void _adapt_jobs(int max_jobs,
+                        int *jobs,
+                        struct chili_cpus_throttling *last,
+                        uint64_t *last_ns)
 {
-    debug_print("%s\n"
-                "\tuse_color: %s\n"
-                "\tuse_cursor: %s\n"
-                "\tuse_redirect: %s\n"
-                "\tnice_stats: %s\n"
-                "\tredirect_path: %s\n",
-                intro,
-                _bool_str(options->use_color),
-                _bool_str(options->use_cursor),
-                _bool_str(options->use_redirect),
-                _bool_str(options->nice_stats),
-                options->redirect_path);
+    struct chili_cpus_throttling now;
+    uint64_t now_ns = chili_latency_now();
+    int adapted;
+
+    if (now_ns - *last_ns < ADAPT_INTERVAL_NS ||
+        chili_cpus_throttling(&now) <= 0){
+        return;
+    }
+
+    adapted = chili_cpus_adapt(last, &now, *jobs, max_jobs);
+    if (adapted != *jobs){
+        debug_print("Throttled %llu of %llu periods, %d jobs\n",
+                    (unsigned long long)(now.throttled - last->throttled),
+                    (unsigned long long)(now.periods - last->periods),
+                    adapted);
+    }
+    *jobs = adapted;
+    *last = now;
+    *last_ns = now_ns;
 }
 
-static void _aggregated_print(const char *intro,
-                              const struct chili_aggregated *agg)
+static int _admission_create(const char **library_paths,
+                             int num_libraries,
+                             chili_handle history,
+                             const struct chili_test_options *options,
+                             struct admission *admission)
 {
-    debug_print("%s\n"
-                "\tnum_succeeded: %d\n"
-                "\tnum_failed: %d\n"
-                "\tnum_errors: %d\n",
-                intro,
-                agg->num_succeeded,
-                agg->num_failed,
-                agg->num_errors);
+    uint64_t largest_kb = 0;
+    int num_unknown = 0;
+
+    admission->budget_kb = options->memory_kb;
+    if (admission->budget_kb == 0){
+        chili_memory_limit(&admission->budget_kb);
+    }
+    admission->in_use_kb = 0;
+    admission->expected_kb = calloc(num_libraries, sizeof(uint64_t));
+    admission->started = calloc(num_libraries, sizeof(bool));
+    if (admission->expected_kb == NULL || admission->started == NULL){
+        printf("Unable to allocate admission\n");
+        return -1;
+    }
+
+    for (int i = 0; i < num_libraries; i++){
+        chili_history_library_rss(history, library_paths[i],
+                                  &admission->expected_kb[i]);
+        if (admission->expected_kb[i] > largest_kb){
+            largest_kb = admission->expected_kb[i];
+        }
+    }
+    for (int i = 0; i < num_libraries; i++){
+        if (admission->expected_kb[i] == 0){
+            admission->expected_kb[i] =
+                chili_memory_unknown(admission->budget_kb, largest_kb);
+            num_unknown++;
+        }
+    }
+    debug_print("Memory budget %llu kB, %d libraries without peak\n",
+                (unsigned long long)admission->budget_kb, num_unknown);
+
+    return 1;
 }
 
-static int _ensure_library(chili_handle registry,
-                           const char *library_path,
-                           chili_handle *lib_handle)
+static void _admission_destroy(struct admission *admission)
 {
-    int r;
-    chili_handle lib = chili_reg_find(registry, library_path);
+    free(admission->expected_kb);
+    free(admission->started);
+}
 
-    if (lib == NULL){
-        debug_print("Library %s not loaded, loading it\n",
-                    library_path);
-        r = chili_lib_create(library_path,
-                             chili_report_test_begin,
-                             &lib);
-        if (r < 0){
-            printf("Failed to load library: %s\n",
-                   library_path);
-            return r;
+/* Returns first library not started that fits in budget,
+ * negative if there is none */
+static int _admit(struct admission *admission,
+                  int num_libraries,
+                  int running)
+{
+    for (int i = 0; i < num_libraries; i++){
+        if (admission->started[i]){
+            continue;
         }
-        debug_print("Succesfully loaded library %s\n",
-                    library_path);
+        if (admission->budget_kb == 0 ||
+            chili_memory_admit(admission->budget_kb,
+                               admission->in_use_kb,
+                               admission->expected_kb[i], running)){
+            admission->started[i] = true;
+            admission->in_use_kb += admission->expected_kb[i];
+            return i;
+        }
+    }
 
-        r = chili_lib_before_fixture(lib);
-        if (r < 0){
-            printf("Fixture failed for library: %s\n",
-                   library_path);
-            chili_lib_destroy(lib);
-            return r;
+    return -1;
+}
+
+static void _release(struct admission *admission,
+                     const char **library_paths,
+                     int num_libraries,
+                     const char *library_path)
+{
+    for (int i = 0; i < num_libraries; i++){
+        if (library_paths[i] == library_path){
+            admission->in_use_kb -= admission->expected_kb[i];
+            return;
         }
+    }
+}
 
-        r = chili_reg_add(registry, library_path, lib);
-        if (r < 0){
-            printf("Failed to register library: %s\n",
-                   library_path);
-            chili_lib_after_fixture(lib);
-            chili_lib_destroy(lib);
-            return r;
+/* Output of a result waiting for its turn is moved out of the
+ * way of the identities given when results are released */
+static void _stage_output(const char *redirect_path, int identity)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 32];
+    char name[32];
+
+    snprintf(path, sizeof(path), "%s/%d", redirect_path, identity);
+    snprintf(name, sizeof(name), ".reorder%d", identity);
+    if (access(path, F_OK) == 0){
+        chili_redirect_adopt(path, name);
+    }
+}
+
+static void _unstage_output(const char *redirect_path,
+                            int identity,
+                            int released_identity)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 32];
+    char name[32];
+
+    snprintf(path, sizeof(path), "%s/.reorder%d", redirect_path, identity);
+    snprintf(name, sizeof(name), "%d", released_identity);
+    if (access(path, F_OK) == 0){
+        chili_redirect_adopt(path, name);
+    }
+}
+
+static void _release_ordered(void *context,
+                             struct chili_wire_message *message)
+{
+    struct ordered *ordered = context;
+    struct chili_result *result = &message->result;
+
+    switch (message->type){
+        case chili_wire_result:
+            _unstage_output(ordered->redirect_path, result->identity,
+                            ordered->next_identity);
+            result->identity = ordered->next_identity++;
+            chili_run_aggregate(result, ordered->aggregated);
+            chili_report_test(result, ordered->aggregated);
+            _record(ordered->history, result->library, result);
+            break;
+        case chili_wire_begin_fail:
+            chili_report_suite_begin_fail(message->r);
+            break;
+        case chili_wire_end_fail:
+            chili_report_suite_end_fail(message->r);
+            break;
+        case chili_wire_done:
+            /* All results of library are released before it */
+            if (_journal && message->r >= 0){
+                chili_journal_done(_journal, result->library);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int _ordered_create(int num_groups,
+                           chili_handle history,
+                           const struct chili_test_options *options,
+                           struct chili_aggregated *aggregated,
+                           struct ordered *ordered)
+{
+    memset(ordered, 0, sizeof(*ordered));
+    ordered->aggregated = aggregated;
+    ordered->history = history;
+    ordered->redirect_path = options->redirect_path;
+
+    return chili_reorder_create(num_groups, REORDER_CAPACITY,
+                                options->redirect_path,
+                                _release_ordered, ordered,
+                                &ordered->reorder);
+}
+
+/* Reports what is left, when stopped before all is done */
+static void _ordered_destroy(struct ordered *ordered)
+{
+    chili_reorder_flush(ordered->reorder);
+    debug_print("Spilled %d results while reordering\n",
+                chili_reorder_spilled(ordered->reorder));
+    chili_reorder_destroy(ordered->reorder);
+}
+
+static int _given_index(const char **library_paths,
+                        int num_libraries,
+                        const char *library_path)
+{
+    for (int i = 0; i < num_libraries; i++){
+        if (library_paths[i] == library_path){
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static int _report_cached(void *context,
+                          const struct chili_result *result,
+                          bool skipped)
+{
+    struct cached *cached = context;
+    struct chili_wire_message message;
+    struct chili_result copy = *result;
+
+    copy.library = cached->library;
+    copy.cached = true;
+
+    if (cached->ordered){
+        memset(&message, 0, sizeof(message));
+        message.type = chili_wire_result;
+        message.result = copy;
+        /* There is no output to move into place */
+        message.result.identity = -1;
+        return chili_reorder_add(cached->ordered->reorder, cached->group,
+                                 &message);
+    }
+
+    copy.identity = chili_run_identity();
+    chili_report_test_begin(copy.library, copy.name);
+    chili_run_aggregate(&copy, cached->aggregated);
+    chili_report_test(&copy, cached->aggregated);
+    if (_results){
+        chili_results_add(_results, &copy);
+    }
+
+    return 1;
+}
+
+/* Reports cached results of library, when ordered in turn with
+ * libraries that are run */
+static int _run_cached(chili_handle cache,
+                       const char *library_path,
+                       struct ordered *ordered,
+                       int group,
+                       struct chili_aggregated *aggregated)
+{
+    struct cached cached = {
+        .cache      = cache,
+        .aggregated = aggregated,
+        .ordered    = ordered,
+        .library    = library_path,
+        .group      = group,
+    };
+    int r;
+
+    r = chili_cache_read(cache, library_path, _report_cached, &cached);
+    if (ordered){
+        chili_reorder_done(ordered->reorder, group);
+    }
+
+    return r;
+}
+
+struct replay_ordered {
+    struct ordered *ordered;
+    const char     *library;
+    int            group;
+    chili_handle   cache;
+};
+
+/* Output is moved out of the way of the identities given by
+ * supervisors, under a negative identity of its own */
+static int _add_completed(void *context,
+                          const struct chili_result *result)
+{
+    struct replay_ordered *replay = context;
+    struct chili_wire_message message;
+    char path[CHILI_REDIRECT_MAX_PATH + 32];
+    char name[32];
+    int identity = -(result->identity + 2);
+
+    snprintf(path, sizeof(path), "%s/%d",
+             replay->ordered->redirect_path, result->identity);
+    snprintf(name, sizeof(name), ".reorder%d", identity);
+    if (result->identity >= 0 && access(path, F_OK) == 0){
+        chili_redirect_adopt(path, name);
+    }
+
+    memset(&message, 0, sizeof(message));
+    message.type = chili_wire_result;
+    message.result = *result;
+    message.result.library = replay->library;
+    message.result.identity = identity;
+    chili_cache_add(replay->cache, &message.result,
+                    _succeeded(&message.result));
+
+    return chili_reorder_add(replay->ordered->reorder, replay->group,
+                             &message);
+}
+
+/* Reports all tests of library completed by interrupted run, in
+ * turn with libraries that are run */
+static int _replay_ordered(chili_handle cache,
+                           const char *library_path,
+                           struct ordered *ordered,
+                           int group)
+{
+    struct replay_ordered replay = {
+        .ordered = ordered,
+        .library = library_path,
+        .group   = group,
+        .cache   = cache,
+    };
+    int r;
+
+    r = chili_journal_replay(_journal, library_path, _add_completed,
+                             &replay);
+    chili_reorder_done(ordered->reorder, group);
+    chili_cache_done(cache, library_path, r >= 0);
+
+    return r;
+}
+
+/* Looks up all libraries, also forced ones so that their results
+ * are cached when they succeed */
+static void _lookup_cached(chili_handle cache,
+                           const char **library_paths,
+                           int num_libraries,
+                           bool force,
+                           bool *cached)
+{
+    for (int i = 0; i < num_libraries; i++){
+        cached[i] = chili_cache_lookup(cache, library_paths[i]) > 0 &&
+                    !force;
+    }
+}
+
+/* Cpus to pin supervisors or workers to, in the order they
+ * should be used. No cpus when not pinning. */
+static int _placement(const struct chili_test_options *options,
+                      int **cpus,
+                      int *num_cpus)
+{
+    struct chili_cpus_topology *topology;
+    int count;
+
+    *cpus = NULL;
+    *num_cpus = 0;
+    if (!options->pin){
+        return 1;
+    }
+
+    topology = malloc(MAX_CPUS * sizeof(*topology));
+    if (topology == NULL){
+        printf("Unable to allocate cpu topology\n");
+        return -1;
+    }
+
+    count = chili_cpus_topology(topology, MAX_CPUS);
+    if (count <= 0){
+        free(topology);
+        return -1;
+    }
+    chili_cpus_place(topology, count);
+
+    *cpus = malloc(count * sizeof(int));
+    if (*cpus == NULL){
+        printf("Unable to allocate cpus\n");
+        free(topology);
+        return -1;
+    }
+    for (int i = 0; i < count; i++){
+        (*cpus)[i] = topology[i].cpu;
+        debug_print("Slot %d on cpu %d, socket %d core %d thread %d\n",
+                    i, topology[i].cpu, topology[i].package,
+                    topology[i].core, topology[i].thread);
+    }
+    *num_cpus = count;
+
+    free(topology);
+    return 1;
+}
+
+/* Runs libraries in planned order, reports them in given order
+ * along with the cached ones */
+static int _run_concurrently(const char **library_paths,
+                             int num_libraries,
+                             const char **ordered_paths,
+                             int num_ordered,
+                             const bool *cached,
+                             chili_handle history,
+                             chili_handle cache,
+                             int max_jobs,
+                             bool adapt,
+                             const struct chili_test_options *options,
+                             struct chili_aggregated *aggregated)
+{
+    int r;
+    int error = 0;
+    int next;
+    int group;
+    int *cpus;
+    struct ordered ordered;
+    int jobs = max_jobs;
+    struct admission admission;
+    struct chili_cpus_throttling throttling = { 0 };
+    uint64_t throttling_ns = chili_latency_now();
+    chili_handle handle;
+    struct chili_wire_message message;
+    struct chili_supervisor_options supervisor_options = {
+        .use_redirect      = options->use_redirect,
+        .run_first         = _failed_last_run,
+        .run_first_context = history,
+        .cached            = options->cache_tests ?
+                             _passed_unchanged : NULL,
+        .cached_context    = cache,
+    };
+
+    supervisor_options.times.timeout.tv_nsec = 0;
+    supervisor_options.times.timeout.tv_sec = 10;
+    strcpy(supervisor_options.redirect_path, options->redirect_path);
+
+    r = _placement(options, &cpus, &supervisor_options.num_cpus);
+    if (r < 0){
+        return r;
+    }
+    supervisor_options.cpus = cpus;
+
+    r = _admission_create(ordered_paths, num_ordered, history,
+                          options, &admission);
+    if (r < 0){
+        _admission_destroy(&admission);
+        free(cpus);
+        return r;
+    }
+
+    r = _ordered_create(num_libraries, history, options,
+                        aggregated, &ordered);
+    if (r < 0){
+        _admission_destroy(&admission);
+        free(cpus);
+        return r;
+    }
+
+    /* Before any supervisor moves output into place */
+    for (int i = 0; i < num_libraries; i++){
+        if (cached[i]){
+            _run_cached(cache, library_paths[i], &ordered, i, aggregated);
+        }
+        else if (_completed(library_paths[i])){
+            _replay_ordered(cache, library_paths[i], &ordered, i);
+        }
+    }
+
+    r = chili_supervisor_create(max_jobs, &supervisor_options,
+                                &handle);
+    if (r < 0){
+        _ordered_destroy(&ordered);
+        _admission_destroy(&admission);
+        free(cpus);
+        return r;
+    }
+
+    adapt = adapt && chili_cpus_throttling(&throttling) > 0;
+
+    while (true){
+        if (adapt){
+            _adapt_jobs(max_jobs, &jobs, &throttling, &throttling_ns);
+        }
+
+        /* Keep all slots busy until an error occurs or
+         * nothing more fits in memory */
+        while (error == 0 &&
+               chili_supervisor_running(handle) < jobs &&
+               (next = _admit(&admission, num_ordered,
+                              chili_supervisor_running(handle))) >= 0){
+            chili_history_forget(history, ordered_paths[next]);
+            r = chili_supervisor_start(handle, ordered_paths[next]);
+            if (r < 0){
+                error = r;
+            }
+        }
+
+        r = chili_supervisor_next(handle, &message);
+        if (r <= 0){
+            break;
+        }
+
+        group = _given_index(library_paths, num_libraries,
+                             message.result.library);
+
+        switch (message.type){
+            case chili_wire_result:
+                _stage_output(options->redirect_path,
+                              message.result.identity);
+                chili_cache_add(cache, &message.result,
+                                _succeeded(&message.result));
+                if (options->cache_tests && !message.result.cached){
+                    chili_cache_test_set(cache, message.result.library,
+                                         message.result.name,
+                                         _succeeded(&message.result));
+                }
+                chili_reorder_add(ordered.reorder, group, &message);
+                break;
+            case chili_wire_begin_fail:
+            case chili_wire_end_fail:
+                chili_reorder_add(ordered.reorder, group, &message);
+                break;
+            case chili_wire_done:
+                chili_reorder_add(ordered.reorder, group, &message);
+                chili_reorder_done(ordered.reorder, group);
+                chili_cache_done(cache, message.result.library,
+                                 message.r >= 0);
+                _release(&admission, ordered_paths, num_ordered,
+                         message.result.library);
+                chili_history_set(history, message.result.library,
+                                  CHILI_HISTORY_SETUP, message.setup_ns,
+                                  message.r < 0);
+                /* Errors triumphs, stop everything */
+                if (message.r < 0 && error == 0){
+                    error = message.r;
+                    chili_supervisor_stop(handle);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    chili_supervisor_destroy(handle);
+    _ordered_destroy(&ordered);
+    _admission_destroy(&admission);
+    free(cpus);
+
+    return error < 0 ? error : r;
+}
+
+static const char *_bool_str(bool b)
+{
+    return b ? "true" : "false";
+}
+
+static void _option_print(const char *intro,
+                          const struct chili_test_options *options)
+{
+    debug_print("%s\n"
+                "\tuse_color: %s\n"
+                "\tuse_cursor: %s\n"
+                "\tuse_redirect: %s\n"
+                "\tnice_stats: %s\n"
+                "\tjobs: %d\n"
+                "\tredirect_path: %s\n",
+                intro,
+                _bool_str(options->use_color),
+                _bool_str(options->use_cursor),
+                _bool_str(options->use_redirect),
+                _bool_str(options->nice_stats),
+                options->jobs,
+                options->redirect_path);
+}
+
+static void _aggregated_print(const char *intro,
+                              const struct chili_aggregated *agg)
+{
+    debug_print("%s\n"
+                "\tnum_succeeded: %d\n"
+                "\tnum_failed: %d\n"
+                "\tnum_errors: %d\n"
+                "\tnum_over_budget: %d\n",
+                intro,
+                agg->num_succeeded,
+                agg->num_failed,
+                agg->num_errors,
+                agg->num_over_budget);
+}
+
+/* Result of a run, tests that failed, errored or went over budget
+ * fail it wherever they were run and when shards are merged */
+static int _run_result(const struct chili_aggregated *agg)
+{
+    return agg->num_failed > 0 ||
+           agg->num_errors > 0 ||
+           agg->num_over_budget > 0 ? 0 : 1;
+}
+
+/* Coverage of tests, kept next to the test output of the last run */
+static int _coverage_create(const struct chili_test_options *options,
+                            chili_handle *coverage)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+
+    snprintf(path, sizeof(path), "%s/coverage", options->redirect_path);
+
+    return chili_coverage_create(path, coverage);
+}
+
+/* Starts recording coverage of tests when asked to, coverage is
+ * set to NULL when not */
+static int _coverage_begin(const struct chili_test_options *options,
+                           chili_handle *coverage)
+{
+    *coverage = NULL;
+    if (!options->coverage){
+        return 1;
+    }
+
+    if (chili_coverage_begin() < 0){
+        return -1;
+    }
+    return _coverage_create(options, coverage);
+}
+
+static int _history_create(const struct chili_test_options *options,
+                           chili_handle *history)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+
+    /* Kept next to the test output of the last run */
+    snprintf(path, sizeof(path), "%s/history", options->redirect_path);
+
+    return chili_history_create(path, history);
+}
+
+static void _failed_path(const struct chili_test_options *options,
+                         char *path,
+                         int size)
+{
+    snprintf(path, size, "%s/failed", options->redirect_path);
+}
+
+/* Creates log directory for what is written before any test
+ * is run, it is otherwise created when test output is
+ * redirected */
+static int _log_dir(const struct chili_test_options *options)
+{
+    if (mkdir(options->redirect_path, 0777) < 0 && errno != EEXIST){
+        printf("Failed to create %s: %s\n",
+               options->redirect_path, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+/* Saves history along with the tests that didn't succeed in
+ * this run, to be run again by 'rerun-failed' */
+static void _history_save(chili_handle history,
+                          const struct chili_test_options *options)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+
+    _failed_path(options, path, sizeof(path));
+    chili_history_save(history);
+    chili_history_save_failed(history, path);
+}
+
+/* Makes journal durable and kills tests in flight before dying
+ * from signal, so that the run can be resumed */
+static void _interrupted(int number)
+{
+    if (getpid() == _journal_pid){
+        chili_journal_sync(_journal);
+        chili_run_kill();
+        chili_supervisor_kill();
+        chili_worker_kill();
+    }
+    signal(number, SIG_DFL);
+    raise(number);
+}
+
+/* Options that change which tests are run, or the order they
+ * are reported in, are inputs of the run along with libraries
+ * and tests */
+static void _journal_options(const char *command,
+                             const struct chili_test_options *options,
+                             char *text,
+                             int size)
+{
+    snprintf(text, size,
+             "%s jobs %d shard %d/%d budget %" PRIu64 " cache %d "
+             "workers %d server %s", command, options->jobs,
+             options->shard_index, options->shard_count,
+             options->time_budget_ns, options->cache_tests,
+             options->workers, options->server_path);
+}
+
+/* Journals completed tests of run, so that it can be resumed
+ * when interrupted */
+static int _journal_begin(const char **inputs,
+                          int num_inputs,
+                          const struct chili_test_options *options)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+    struct sigaction action;
+    int r;
+
+    if (options->plan){
+        return 1;
+    }
+
+    if (_log_dir(options) < 0){
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/journal", options->redirect_path);
+    r = chili_journal_create(path, inputs, num_inputs, options->resume,
+                             &_journal);
+    if (r < 0){
+        _journal = NULL;
+        return r;
+    }
+
+    if (options->resume){
+        r = chili_journal_resumed(_journal);
+        if (r > 0){
+            printf("Resuming interrupted run, %d tests already "
+                   "completed\n", r);
+        }
+        else {
+            printf("No interrupted run of the same tests to resume\n");
+        }
+    }
+
+    _journal_pid = getpid();
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _interrupted;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &_journal_actions[0]);
+    sigaction(SIGTERM, &action, &_journal_actions[1]);
+
+    return 1;
+}
+
+/* Journal is kept when run stopped on an error */
+static void _journal_end(int r)
+{
+    if (_journal == NULL){
+        return;
+    }
+
+    sigaction(SIGINT, &_journal_actions[0], NULL);
+    sigaction(SIGTERM, &_journal_actions[1], NULL);
+    chili_journal_destroy(_journal, r >= 0);
+    _journal = NULL;
+}
+
+/* Logs results of run, to be merged with other shards by
+ * 'merge' or compared with earlier runs by 'compare' */
+static int _results_begin(const struct chili_test_options *options)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+    int r;
+
+    if (options->plan){
+        return 1;
+    }
+
+    if (_log_dir(options) < 0){
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/results", options->redirect_path);
+    /* Unsharded run is the only shard there is */
+    r = options->shard_count > 0 ?
+        chili_results_create(path, options->shard_index,
+                             options->shard_count, &_results) :
+        chili_results_create(path, 1, 1, &_results);
+    if (r < 0){
+        _results = NULL;
+    }
+
+    return r;
+}
+
+static void _results_end(void)
+{
+    if (_results){
+        chili_results_destroy(_results);
+        _results = NULL;
+    }
+}
+
+/* Libraries take their suites from manifests in log directory,
+ * only commands that run tests, and 'index', write manifests and
+ * create the log directory for them */
+static void _use_manifests(const struct chili_test_options *options,
+                           bool write)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+
+    /* Manifests are only read without it */
+    if (write && _log_dir(options) < 0){
+        write = false;
+    }
+    snprintf(path, sizeof(path), "%s/manifests", options->redirect_path);
+    chili_lib_manifests(path, write);
+}
+
+static int _cache_create(const struct chili_test_options *options,
+                         chili_handle *cache)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+
+    snprintf(path, sizeof(path), "%s/cache", options->redirect_path);
+
+    return chili_cache_create(path, cache);
+}
+
+static int _ensure_library(chili_handle registry,
+                           const char *library_path,
+                           chili_handle *lib_handle)
+{
+    int r;
+    chili_handle lib = chili_reg_find(registry, library_path);
+
+    if (lib == NULL){
+        debug_print("Library %s not loaded, loading it\n",
+                    library_path);
+        r = chili_lib_create(library_path,
+                             chili_report_test_begin,
+                             &lib);
+        if (r < 0){
+            printf("Failed to load library: %s\n",
+                   library_path);
+            return r;
+        }
+        debug_print("Succesfully loaded library %s\n",
+                    library_path);
+
+        r = chili_lib_before_fixture(lib);
+        if (r < 0){
+            printf("Fixture failed for library: %s\n",
+                   library_path);
+            chili_lib_destroy(lib);
+            return r;
+        }
+
+        r = chili_reg_add(registry, library_path, lib);
+        if (r < 0){
+            printf("Failed to register library: %s\n",
+                   library_path);
+            chili_lib_after_fixture(lib);
+            chili_lib_destroy(lib);
+            return r;
+        }
+    }
+
+    *lib_handle = lib;
+    return 1;
+}
+
+static int _invoke_named_test(struct chili_aggregated *aggregated,
+                              chili_handle registry,
+                              chili_handle history,
+                              chili_handle coverage,
+                              const char *library_path,
+                              const char *test_name,
+                              struct chili_times *times)
+{
+    int r;
+    chili_handle lib_handle;
+    struct chili_result result;
+
+    debug_print("Running named test: %s:%s\n",
+                library_path, test_name);
+
+    r = _ensure_library(registry, library_path,
+                        &lib_handle);
+    if (r < 0){
+        uint64_t setup_ns = 0;
+
+        /* Left for 'rerun-failed', none of the tests ran */
+        chili_history_get(history, library_path, CHILI_HISTORY_SETUP,
+                          &setup_ns);
+        chili_history_set(history, library_path, CHILI_HISTORY_SETUP,
+                          setup_ns, true);
+        aggregated->num_errors++;
+        return r;
+    }
+
+    r = chili_lib_named_test(lib_handle,
+                             test_name,
+                             times,
+                             &result,
+                             aggregated);
+    debug_print("Executed named test: %s:%s returned: %d\n",
+                library_path, test_name, r);
+    if (r < 0){
+        printf("Fatal error while running test %s:%s.\n",
+               library_path, test_name);
+        return r;
+    }
+
+    chili_report_test(&result, aggregated);
+    _record(history, library_path, &result);
+    if (coverage){
+        chili_coverage_record(coverage, library_path, test_name);
+    }
+
+    return r;
+}
+
+static int _by_priority(const void *a, const void *b)
+{
+    const struct named_test *x = a;
+    const struct named_test *y = b;
+
+    if (x->priority != y->priority){
+        return x->priority - y->priority;
+    }
+    return x->position - y->position;
+}
+
+/* Parses line and appends test, lines that can't be parsed
+ * are skipped */
+static int _add_named(struct named_test **tests,
+                      int *count,
+                      int *capacity,
+                      const char *line,
+                      chili_handle history)
+{
+    struct named_test *grown;
+    struct named_test *test;
+
+    if (*count == *capacity){
+        *capacity = *capacity ? *capacity * 2 : 64;
+        grown = realloc(*tests, *capacity * sizeof(**tests));
+        if (grown == NULL){
+            printf("Unable to allocate named tests\n");
+            return -1;
+        }
+        *tests = grown;
+    }
+
+    test = &(*tests)[*count];
+    test->line = strdup(line);
+    if (test->line == NULL){
+        printf("Unable to allocate named tests\n");
+        return -1;
+    }
+    if (chili_named_parse(test->line, &test->library,
+                          &test->name) < 0){
+        debug_print("Failed to parse: %s\n", line);
+        free(test->line);
+        return 0;
+    }
+
+    test->position = *count;
+    test->priority =
+        chili_history_failed(history, test->library, test->name) ?
+            0 :
+        chili_history_changed(history, test->library) ?
+            1 : 2;
+    (*count)++;
+
+    return 1;
+}
+
+static void _free_named(struct named_test *tests, int count)
+{
+    for (int i = 0; i < count; i++){
+        free(tests[i].line);
+    }
+    free(tests);
+}
+
+/* Reads all named tests, tests that failed last run first,
+ * then tests in changed libraries and then the rest. */
+static int _read_named(FILE *f,
+                       chili_handle history,
+                       struct named_test **tests,
+                       int *count)
+{
+    char buffer[1024];
+    int capacity = 0;
+
+    *tests = NULL;
+    *count = 0;
+
+    while (fgets(buffer, sizeof(buffer), f)){
+        if (_add_named(tests, count, &capacity, buffer, history) < 0){
+            return -1;
+        }
+    }
+    debug_print("End of file\n");
+
+    qsort(*tests, *count, sizeof(**tests), _by_priority);
+
+    return 1;
+}
+
+/* Lists all tests in libraries as if they were named */
+static int _list_named(const char **library_paths,
+                       int num_libraries,
+                       chili_handle history,
+                       struct named_test **tests,
+                       int *count)
+{
+    char line[1024];
+    char **names;
+    int num_names;
+    int capacity = 0;
+    chili_handle lib_handle;
+    int r;
+
+    *tests = NULL;
+    *count = 0;
+
+    for (int i = 0; i < num_libraries; i++){
+        r = chili_lib_create(library_paths[i], NULL, &lib_handle);
+        if (r < 0){
+            return r;
+        }
+        names = chili_lib_tests(lib_handle, &num_names);
+        for (int j = 0; r >= 0 && j < num_names; j++){
+            snprintf(line, sizeof(line), "%s:%s",
+                     library_paths[i], names[j]);
+            r = _add_named(tests, count, &capacity, line, history);
+        }
+        chili_lib_destroy(lib_handle);
+        if (r < 0){
+            return r;
+        }
+    }
+
+    qsort(*tests, *count, sizeof(**tests), _by_priority);
+
+    return 1;
+}
+
+/* Replaces failed suite setup saved by last run with all tests
+ * of its library, none of them were run */
+static int _expand_setup(chili_handle history,
+                         struct named_test **tests,
+                         int *count)
+{
+    struct named_test *given = *tests;
+    int num_given = *count;
+    char line[1024];
+    char **names;
+    int num_names;
+    int capacity = 0;
+    chili_handle lib_handle;
+    int r = 1;
+
+    *tests = NULL;
+    *count = 0;
+
+    for (int i = 0; r >= 0 && i < num_given; i++){
+        if (strcmp(given[i].name, CHILI_HISTORY_SETUP) != 0){
+            snprintf(line, sizeof(line), "%s:%s",
+                     given[i].library, given[i].name);
+            r = _add_named(tests, count, &capacity, line, history);
+            continue;
+        }
+        r = chili_lib_create(given[i].library, NULL, &lib_handle);
+        if (r < 0){
+            break;
+        }
+        names = chili_lib_tests(lib_handle, &num_names);
+        for (int j = 0; r >= 0 && j < num_names; j++){
+            snprintf(line, sizeof(line), "%s:%s",
+                     given[i].library, names[j]);
+            r = _add_named(tests, count, &capacity, line, history);
+        }
+        chili_lib_destroy(lib_handle);
+    }
+    _free_named(given, num_given);
+    if (r < 0){
+        return r;
+    }
+
+    qsort(*tests, *count, sizeof(**tests), _by_priority);
+
+    return 1;
+}
+
+/* Changed files that tests are affected by */
+struct changed {
+    char **paths;
+    int  count;
+    /* Set when a visited file is changed */
+    bool found;
+};
+
+/* Same file when one path ends with the other, at a directory
+ * boundary, as paths of changed files are usually relative to
+ * the root of a repository and compilers record them as given
+ * on their command line. */
+static bool _same_file(const char *a, const char *b)
+{
+    size_t length_a;
+    size_t length_b;
+
+    while (strncmp(a, "./", 2) == 0){
+        a += 2;
+    }
+    while (strncmp(b, "./", 2) == 0){
+        b += 2;
+    }
+    length_a = strlen(a);
+    length_b = strlen(b);
+    if (length_a < length_b){
+        const char *t = a;
+        a = b;
+        b = t;
+        length_a = length_b;
+        length_b = strlen(b);
+    }
+    if (length_b == 0 || strcmp(a + length_a - length_b, b) != 0){
+        return false;
+    }
+
+    return length_a == length_b || a[length_a - length_b - 1] == '/';
+}
+
+static bool _is_changed(const struct changed *changed, const char *path)
+{
+    for (int i = 0; i < changed->count; i++){
+        if (_same_file(path, changed->paths[i])){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int _visit_changed(void *context, const char *path)
+{
+    struct changed *changed = context;
+
+    if (_is_changed(changed, path)){
+        debug_print("Changed: %s\n", path);
+        changed->found = true;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Reads changed files, one per line */
+static int _read_changed(const char *path, struct changed *changed)
+{
+    char buffer[MAX_CHANGED_PATH];
+    FILE *f;
+    char **grown;
+    int capacity = 0;
+    int r = 1;
+
+    f = strcmp(path, "-") == 0 ?
+        stdin :
+        fopen(path, "r");
+    if (f == NULL){
+        printf("Failed to open file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    while (r > 0 && fgets(buffer, sizeof(buffer), f)){
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        if (buffer[0] == '\0'){
+            continue;
+        }
+        if (changed->count == capacity){
+            capacity = capacity ? capacity * 2 : 64;
+            grown = realloc(changed->paths, capacity * sizeof(char*));
+            if (grown == NULL){
+                printf("Unable to allocate changed files\n");
+                r = -1;
+                break;
+            }
+            changed->paths = grown;
+        }
+        changed->paths[changed->count] = strdup(buffer);
+        if (changed->paths[changed->count] == NULL){
+            printf("Unable to allocate changed files\n");
+            r = -1;
+            break;
+        }
+        changed->count++;
+    }
+    if (f != stdin){
+        fclose(f);
+    }
+
+    return r;
+}
+
+static void _free_changed(struct changed *changed)
+{
+    for (int i = 0; i < changed->count; i++){
+        free(changed->paths[i]);
+    }
+    free(changed->paths);
+}
+
+/* All tests of a library are affected when the library itself
+ * or a library it needs is changed */
+static int _library_changed(const char *library,
+                            const struct changed *changed)
+{
+    chili_handle symbols;
+    char *needed;
+    int index = 0;
+    bool found = _is_changed(changed, library);
+
+    if (chili_sym_create(library, NULL, &symbols) < 0){
+        return -1;
+    }
+    while (!found && chili_sym_next_dynamic(symbols, CHILI_SYM_NEEDED,
+                                            &index, &needed) > 0){
+        found = _is_changed(changed, needed);
+    }
+    chili_sym_destroy(symbols);
+
+    return found ? 1 : 0;
+}
+
+/* Checks if test reached any changed function when its coverage
+ * was recorded, tests without coverage are always affected */
+static bool _reaches_changed(chili_handle coverage,
+                             const struct changed *symbols,
+                             const char *library,
+                             const char *name)
+{
+    if (!chili_coverage_recorded(coverage, library, name)){
+        return true;
+    }
+
+    for (int i = 0; i < symbols->count; i++){
+        if (strcmp(symbols->paths[i], name) == 0 ||
+            chili_coverage_reaches(coverage, library, name,
+                                   symbols->paths[i])){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Lists tests in libraries affected by changed files or changed
+ * functions as if they were named, in given order. Either may be
+ * NULL. Tests that can't be mapped to their sources, like in
+ * libraries built without -g, are always affected. */
+static int _list_affected(const char **library_paths,
+                          int num_libraries,
+                          struct changed *files,
+                          const struct changed *symbols,
+                          chili_handle coverage,
+                          chili_handle history,
+                          struct named_test **tests,
+                          int *count)
+{
+    char line[1024];
+    char **names;
+    int num_names;
+    int capacity = 0;
+    chili_handle lib_handle;
+    chili_handle dwarf;
+    bool affected;
+    int all;
+    int r;
+
+    *tests = NULL;
+    *count = 0;
+
+    for (int i = 0; i < num_libraries; i++){
+        all = 0;
+        dwarf = NULL;
+        if (files){
+            all = _library_changed(library_paths[i], files);
+            if (all < 0){
+                return all;
+            }
+        }
+        if (files && !all){
+            r = chili_dwarf_create(library_paths[i], &dwarf);
+            if (r < 0){
+                return r;
+            }
+            if (r == 0){
+                /* Kept out of listed tests, which are piped to
+                 * 'named' as they are */
+                fprintf(stderr,"No line number information in %s, "
+                        "all of its tests are affected\n",
+                        library_paths[i]);
+                all = 1;
+            }
+        }
+
+        r = chili_lib_create(library_paths[i], NULL, &lib_handle);
+        if (r < 0){
+            if (dwarf){
+                chili_dwarf_destroy(dwarf);
+            }
+            return r;
+        }
+        names = chili_lib_tests(lib_handle, &num_names);
+        for (int j = 0; r >= 0 && j < num_names; j++){
+            affected = false;
+            if (files){
+                files->found = all;
+                if (!all){
+                    r = chili_dwarf_files(dwarf, names[j], _visit_changed,
+                                          files);
+                    /* Not in any unit with line number information */
+                    files->found = files->found || r == 0;
+                }
+                affected = files->found;
+            }
+            if (r >= 0 && !affected && symbols){
+                affected = _reaches_changed(coverage, symbols,
+                                            library_paths[i], names[j]);
+            }
+            if (r >= 0 && affected){
+                snprintf(line, sizeof(line), "%s:%s",
+                         library_paths[i], names[j]);
+                r = _add_named(tests, count, &capacity, line, history);
+            }
+        }
+        chili_lib_destroy(lib_handle);
+        if (dwarf){
+            chili_dwarf_destroy(dwarf);
+        }
+        if (r < 0){
+            return r;
+        }
+    }
+
+    return 1;
+}
+
+static int _debug_test(chili_handle registry,
+                       chili_handle debugger,
+                       const char *library_path,
+                       const char *test_name)
+{
+    int r;
+    chili_handle lib_handle;
+
+    debug_print("Debugging test: %s:%s\n",
+                library_path, test_name);
+
+    r = _ensure_library(registry, library_path, &lib_handle);
+    if (r < 0){
+        return r;
+    }
+
+    r = chili_lib_debug_test(lib_handle, debugger, test_name);
+    debug_print("Debug named test: %s:%s returned: %d\n",
+                library_path, test_name, r);
+    if (r < 0){
+        printf("Fatal error while debugging test %s:%s.\n",
+               library_path, test_name);
+        return r;
+    }
+
+    return r;
+}
+
+int _close_libraries(chili_handle registry)
+{
+    int token = 0;
+    int r = 0;
+    chili_handle lib_handle;
+
+    lib_handle = chili_reg_next(registry, &token);
+    while (lib_handle != NULL) {
+        /* Preserve error */
+        if (r < 0){
+            chili_lib_after_fixture(lib_handle);
+        }
+        else {
+            r = chili_lib_after_fixture(lib_handle);
+            if (r < 0){
+                chili_report_suite_end_fail(r);
+            }
+        }
+
+        lib_handle = chili_reg_next(registry, &token);
+    }
+    return r;
+}
+
+static int _library_index(const char **libraries,
+                          int *num_libraries,
+                          const char *library)
+{
+    for (int i = 0; i < *num_libraries; i++){
+        if (strcmp(libraries[i], library) == 0){
+            return i;
+        }
+    }
+    libraries[*num_libraries] = library;
+    return (*num_libraries)++;
+}
+
+/* Moves tests to run within time budget first, in the order
+ * they should run. Tests never run before are predicted to take
+ * as long as the average test. Returns number of tests to run. */
+static int _select_named(struct named_test *tests,
+                         int count,
+                         chili_handle history,
+                         uint64_t budget_ns,
+                         uint64_t *predicted_ns)
+{
+    struct chili_select_candidate *candidates;
+    struct named_test *ordered;
+    const char **libraries;
+    uint64_t *setup_ns;
+    uint64_t known_ns = 0;
+    int num_known = 0;
+    int num_libraries = 0;
+    bool known;
+    int r = -1;
+
+    candidates = malloc(count * sizeof(*candidates));
+    ordered = malloc(count * sizeof(*ordered));
+    libraries = malloc(count * sizeof(*libraries));
+    setup_ns = calloc(count, sizeof(*setup_ns));
+    if (candidates == NULL || ordered == NULL ||
+        libraries == NULL || setup_ns == NULL){
+        printf("Unable to allocate selection\n");
+        goto on_exit;
+    }
+
+    for (int i = 0; i < count; i++){
+        candidates[i].index = i;
+        candidates[i].library = _library_index(libraries, &num_libraries,
+                                               tests[i].library);
+        known = chili_history_get(history, tests[i].library,
+                                  tests[i].name,
+                                  &candidates[i].duration_ns) > 0;
+        if (known){
+            known_ns += candidates[i].duration_ns;
+            num_known++;
+        }
+        else {
+            candidates[i].duration_ns = 0;
+        }
+        candidates[i].failure =
+            chili_select_failure(
+                chili_history_failed(history, tests[i].library,
+                                     tests[i].name),
+                chili_history_changed(history, tests[i].library),
+                known);
+    }
+    for (int i = 0; i < count; i++){
+        if (candidates[i].duration_ns == 0){
+            candidates[i].duration_ns = num_known ?
+                known_ns / num_known : UNKNOWN_DURATION_NS;
+        }
+    }
+    for (int i = 0; i < num_libraries; i++){
+        chili_history_get(history, libraries[i], CHILI_HISTORY_SETUP,
+                          &setup_ns[i]);
+    }
+
+    r = chili_select_within(candidates, count, setup_ns, num_libraries,
+                            budget_ns, predicted_ns);
+    if (r < 0){
+        goto on_exit;
+    }
+
+    for (int i = 0; i < count; i++){
+        ordered[i] = tests[candidates[i].index];
+    }
+    memcpy(tests, ordered, count * sizeof(*tests));
+
+on_exit:
+    free(candidates);
+    free(ordered);
+    free(libraries);
+    free(setup_ns);
+
+    return r;
+}
+
+/* Lists skipped tests so they can be run later with 'named' */
+static void _report_skipped(const struct named_test *tests,
+                            int count,
+                            const struct chili_test_options *options)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+    FILE *f;
+
+    for (int i = 0; _results && i < count; i++){
+        chili_results_skip(_results, tests[i].library, tests[i].name);
+    }
+    if (count == 0){
+        return;
+    }
+
+    /* Listed next to test output only when it is redirected */
+    if (!options->use_redirect){
+        printf("Skipped %d tests to stay within time budget:\n", count);
+        for (int i = 0; i < count; i++){
+            printf("%s:%s\n", tests[i].library, tests[i].name);
+        }
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s/skipped", options->redirect_path);
+    f = fopen(path, "w");
+    if (f == NULL){
+        printf("Skipped %d tests, unable to list them in %s: %s\n",
+               count, path, strerror(errno));
+        return;
+    }
+    for (int i = 0; i < count; i++){
+        fprintf(f, "%s:%s\n", tests[i].library, tests[i].name);
+    }
+    fclose(f);
+
+    printf("Skipped %d tests to stay within time budget, "
+           "listed in %s\n", count, path);
+}
+
+/* Runs named tests one at a time, loading libraries as needed */
+static int _run_named(const struct named_test *tests,
+                      int count,
+                      chili_handle history,
+                      const struct chili_test_options *test_options)
+{
+    int r;
+    struct chili_report report;
+    struct chili_aggregated aggregated = { 0 };
+    chili_handle registry;
+    chili_handle coverage;
+    struct chili_times times;
+    struct chili_result result;
+    struct replay replay = {
+        .history    = history,
+        .aggregated = &aggregated,
+    };
+
+    times.timeout.tv_nsec = 0;
+    times.timeout.tv_sec = 10;
+
+    r = chili_reg_create(10, &registry);
+    if (r < 0){
+        return r;
+    }
+
+    report.use_color = test_options->use_color;
+    report.use_cursor = test_options->use_cursor;
+    report.nice_stats = test_options->nice_stats;
+
+    r = chili_redirect_begin(test_options->use_redirect,
+                             test_options->redirect_path);
+    if (r < 0){
+        chili_reg_destroy(registry);
+        return r;
+    }
+
+    r = chili_report_begin(&report);
+    if (r < 0){
+        chili_redirect_end();
+        chili_reg_destroy(registry);
+        return r;
+    }
+
+    r = _coverage_begin(test_options, &coverage);
+    for (int i = 0; r >= 0 && i < count; i++){
+        if (_journal && chili_journal_find(_journal, tests[i].library,
+                                           tests[i].name, &result) > 0){
+            _replay_result(&replay, tests[i].library, &result);
+            continue;
+        }
+        r = _invoke_named_test(&aggregated, registry, history, coverage,
+                               tests[i].library, tests[i].name,
+                               &times);
+    }
+    _aggregated_print("Named tests ended:\n", &aggregated);
+
+    /* Preserve error on failure */
+    if (r < 0){
+        _close_libraries(registry);
+    }
+    else {
+        r = _close_libraries(registry);
+    }
+
+    /* Preserve error on failure */
+    if (r >= 0) {
+        r = _run_result(&aggregated);
+    }
+
+    chili_report_end(&aggregated);
+    chili_redirect_end();
+    chili_reg_destroy(registry);
+    if (coverage){
+        chili_coverage_destroy(coverage);
+    }
+
+    return r;
+}
+
+static void _report_coordinated(void *context,
+                                int test,
+                                struct chili_wire_message *message)
+{
+    struct ordered *ordered = context;
+
+    switch (message->type){
+        case chili_wire_result:
+            _stage_output(ordered->redirect_path, message->result.identity);
+            chili_reorder_add(ordered->reorder, test, message);
+            chili_reorder_done(ordered->reorder, test);
+            break;
+        case chili_wire_begin_fail:
+            ordered->aggregated->num_errors++;
+            chili_reorder_add(ordered->reorder, test, message);
+            chili_reorder_done(ordered->reorder, test);
+            break;
+        case chili_wire_end_fail:
+            chili_reorder_add(ordered->reorder, ordered->teardown_group,
+                              message);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Predicts peak memory of each test, so that tests run by
+ * workers at the same time stay within memory budget */
+static int _expect_named(const struct named_test *tests,
+                         int count,
+                         chili_handle history,
+                         const struct chili_test_options *options,
+                         uint64_t *budget_kb,
+                         uint64_t **expected)
+{
+    uint64_t *expected_kb;
+    uint64_t largest_kb = 0;
+    int num_unknown = 0;
+
+    *expected = NULL;
+    *budget_kb = options->memory_kb;
+    if (*budget_kb == 0){
+        chili_memory_limit(budget_kb);
+    }
+    if (*budget_kb == 0){
+        return 1;
+    }
+
+    expected_kb = calloc(count, sizeof(*expected_kb));
+    if (expected_kb == NULL){
+        printf("Unable to allocate admission\n");
+        return -1;
+    }
+    for (int i = 0; i < count; i++){
+        chili_history_get_rss(history, tests[i].library, tests[i].name,
+                              &expected_kb[i]);
+        if (expected_kb[i] > largest_kb){
+            largest_kb = expected_kb[i];
+        }
+    }
+    for (int i = 0; i < count; i++){
+        if (expected_kb[i] == 0){
+            expected_kb[i] = chili_memory_unknown(*budget_kb, largest_kb);
+            num_unknown++;
+        }
+    }
+    debug_print("Memory budget %llu kB, %d tests without peak\n",
+                (unsigned long long)*budget_kb, num_unknown);
+    *expected = expected_kb;
+
+    return 1;
+}
+
+/* Runs named tests in worker processes, handing out each test
+ * to the first worker that is free */
+static int _coordinate_named(const struct named_test *tests,
+                             int count,
+                             chili_handle history,
+                             const struct chili_test_options *test_options)
+{
+    int r;
+    struct chili_report report;
+    struct chili_worker_options worker_options;
+    struct chili_aggregated aggregated = { 0 };
+    struct ordered ordered;
+    const char **libraries;
+    const char **names;
+    uint64_t *expected_kb;
+    int *cpus;
+
+    r = _placement(test_options, &cpus, &worker_options.num_cpus);
+    if (r < 0){
+        return r;
+    }
+    worker_options.cpus = cpus;
+
+    r = _expect_named(tests, count, history, test_options,
+                      &worker_options.budget_kb, &expected_kb);
+    if (r < 0){
+        free(cpus);
+        return r;
+    }
+    worker_options.expected_kb = expected_kb;
+
+    libraries = malloc(count * sizeof(*libraries));
+    names = malloc(count * sizeof(*names));
+    if (libraries == NULL || names == NULL){
+        printf("Unable to allocate named tests\n");
+        free(libraries);
+        free(names);
+        free(expected_kb);
+        free(cpus);
+        return -1;
+    }
+    for (int i = 0; i < count; i++){
+        libraries[i] = tests[i].library;
+        names[i] = tests[i].name;
+    }
+
+    worker_options.use_redirect = test_options->use_redirect;
+    strcpy(worker_options.redirect_path, test_options->redirect_path);
+    worker_options.retries = WORKER_RETRIES;
+
+    /* Tests are run by several workers at once, there is no
+     * single running test to show */
+    report.use_color = test_options->use_color;
+    report.use_cursor = false;
+    report.nice_stats = test_options->nice_stats;
+
+    r = chili_redirect_begin(test_options->use_redirect,
+                             test_options->redirect_path);
+    if (r >= 0){
+        r = chili_report_begin(&report);
+        if (r < 0){
+            chili_redirect_end();
+        }
+    }
+    /* Teardown is reported after all tests */
+    if (r >= 0){
+        r = _ordered_create(count + 1, history, test_options,
+                            &aggregated, &ordered);
+        if (r < 0){
+            chili_redirect_end();
+        }
+    }
+    if (r < 0){
+        free(libraries);
+        free(names);
+        free(expected_kb);
+        free(cpus);
+        return r;
+    }
+    ordered.teardown_group = count;
+
+    r = chili_worker_coordinate(test_options->workers, &worker_options,
+                                libraries, names, count,
+                                _report_coordinated, &ordered);
+    _ordered_destroy(&ordered);
+    _aggregated_print("Named tests ended:\n", &aggregated);
+
+    /* Preserve error on failure, tests that killed their
+     * workers are errors */
+    if (r >= 0) {
+        r = _run_result(&aggregated);
+    }
+
+    chili_report_end(&aggregated);
+    chili_redirect_end();
+    free(libraries);
+    free(names);
+    free(expected_kb);
+    free(cpus);
+
+    return r;
+}
+
+static void _report_served(void *context,
+                           int index,
+                           struct chili_wire_message *message)
+{
+    struct served *served = context;
+    struct chili_result *result = &message->result;
+
+    switch (message->type){
+        case chili_wire_result:
+            result->library = served->libraries[index];
+            chili_run_aggregate(result, served->aggregated);
+            chili_report_test(result, served->aggregated);
+            _record(served->history, result->library, result);
+            break;
+        case chili_wire_begin_fail:
+            served->aggregated->num_errors++;
+            chili_report_suite_begin_fail(message->r);
+            break;
+        case chili_wire_test:
+            printf("%s:%s\n", served->libraries[index], message->name);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Runs tests in 'chili serve', test output is redirected by
+ * the server to the same directory as when run here */
+static int _request_served(enum chili_server_command command,
+                           const char **libraries,
+                           const char **names,
+                           int count,
+                           chili_handle history,
+                           const struct chili_test_options *test_options)
+{
+    int r;
+    struct chili_report report;
+    struct chili_aggregated aggregated = { 0 };
+    struct served served = {
+        .libraries = libraries,
+        .aggregated = &aggregated,
+        .history = history,
+    };
+
+    report.use_color = test_options->use_color;
+    report.use_cursor = test_options->use_cursor;
+    report.nice_stats = test_options->nice_stats;
+
+    /* Creates directory for server to redirect to */
+    r = chili_redirect_begin(test_options->use_redirect,
+                             test_options->redirect_path);
+    if (r < 0){
+        return r;
+    }
+
+    r = chili_report_begin(&report);
+    if (r < 0){
+        chili_redirect_end();
+        return r;
+    }
+
+    r = chili_server_request(test_options->server_path, command,
+                             test_options->use_redirect ?
+                             test_options->redirect_path : NULL,
+                             libraries, names, count,
+                             _report_served, &served);
+    _aggregated_print("Served tests ended:\n", &aggregated);
+
+    /* Preserve error on failure */
+    if (r >= 0) {
+        r = _run_result(&aggregated);
+    }
+
+    chili_report_end(&aggregated);
+    chili_redirect_end();
+
+    return r;
+}
+
+/* Runs named tests in 'chili serve' */
+static int _request_named(const struct named_test *tests,
+                          int count,
+                          chili_handle history,
+                          const struct chili_test_options *test_options)
+{
+    const char **libraries;
+    const char **names;
+    int r;
+
+    libraries = malloc(count * sizeof(*libraries));
+    names = malloc(count * sizeof(*names));
+    if (libraries == NULL || names == NULL){
+        printf("Unable to allocate named tests\n");
+        free(libraries);
+        free(names);
+        return -1;
+    }
+    for (int i = 0; i < count; i++){
+        libraries[i] = tests[i].library;
+        names[i] = tests[i].name;
+    }
+
+    r = _request_served(chili_server_named, libraries, names, count,
+                        history, test_options);
+
+    free(libraries);
+    free(names);
+
+    return r;
+}
+
+/* Keeps only tests of the shard that is run */
+static int _shard_named(struct named_test *tests,
+                        int *count,
+                        chili_handle history,
+                        const struct chili_test_options *options)
+{
+    struct chili_shard_test *shard_tests;
+    int kept = 0;
+
+    shard_tests = malloc(*count * sizeof(*shard_tests));
+    if (shard_tests == NULL){
+        printf("Unable to allocate shards\n");
+        return -1;
+    }
+
+    for (int i = 0; i < *count; i++){
+        shard_tests[i].library = tests[i].library;
+        shard_tests[i].name = tests[i].name;
+        if (chili_history_get(history, tests[i].library, tests[i].name,
+                              &shard_tests[i].duration_ns) <= 0){
+            shard_tests[i].duration_ns = 0;
+        }
+    }
+
+    if (chili_shard_assign(shard_tests, *count,
+                           options->shard_count) < 0){
+        free(shard_tests);
+        return -1;
+    }
+
+    for (int i = 0; i < *count; i++){
+        if (shard_tests[i].shard == options->shard_index){
+            tests[kept++] = tests[i];
+        }
+        else {
+            free(tests[i].line);
+        }
+    }
+    printf("Shard %d/%d: %d of %d tests\n",
+           options->shard_index, options->shard_count, kept, *count);
+    *count = kept;
+
+    free(shard_tests);
+    return 1;
+}
+
+/* Runs tests of shard within time budget, when asked for,
+ * one at a time */
+static int _run_tests(struct named_test *tests,
+                      int *count,
+                      chili_handle history,
+                      const struct chili_test_options *options)
+{
+    int selected = *count;
+    uint64_t predicted_ns;
+    int r;
+
+    if (options->shard_count > 0){
+        r = _shard_named(tests, count, history, options);
+        if (r < 0){
+            return r;
+        }
+        selected = *count;
+    }
+
+    if (options->time_budget_ns > 0){
+        selected = _select_named(tests, *count, history,
+                                 options->time_budget_ns, &predicted_ns);
+        if (selected < 0){
+            return selected;
+        }
+        printf("Time budget %.3fs: running %d of %d tests, "
+               "predicted to take %.3fs\n",
+               options->time_budget_ns / 1e9, selected, *count,
+               predicted_ns / 1e9);
+    }
+
+    if (options->plan){
+        for (int i = 0; i < *count; i++){
+            printf("  %s %s:%s\n", i < selected ? "run " : "skip",
+                   tests[i].library, tests[i].name);
+        }
+        return 1;
+    }
+
+    if (options->resume &&
+        (options->server_path[0] != '\0' || options->workers > 0)){
+        printf("Completed tests are only left out when tests are "
+               "run one at a time here\n");
+    }
+
+    if (options->server_path[0] != '\0'){
+        r = _request_named(tests, selected, history, options);
+    }
+    else if (options->workers > 0){
+        /* Edges are recorded in memory shared by test processes of
+         * this chili */
+        if (options->coverage){
+            printf("Coverage is only recorded when running without "
+                   "workers\n");
+        }
+        r = _coordinate_named(tests, selected, history, options);
+    }
+    else {
+        r = _run_named(tests, selected, history, options);
+    }
+    _report_skipped(tests + selected, *count - selected, options);
+
+    /* Every shard must split by the same history, durations are
+     * recorded when results of all shards are merged instead */
+    if (options->shard_count == 0){
+        _history_save(history, options);
+    }
+
+    return r;
+}
+
+static int _run_all(const char **library_paths,
+                    int num_libraries,
+                    const struct chili_test_options *test_options)
+{
+    int r;
+    struct chili_report report;
+    struct chili_aggregated aggregated = { 0 };
+    chili_handle lib_handle;
+    chili_handle history;
+    chili_handle cache = NULL;
+    chili_handle coverage = NULL;
+    struct chili_schedule_entry *plan;
+    const char **ordered;
+    const char **uncached;
+    bool *cached;
+    int num_uncached = 0;
+    int given;
+    uint64_t makespan_ns;
+    int jobs = test_options->jobs;
+    struct named_test *tests;
+    int count;
+    struct replay replay;
+
+    _option_print("Running 'all' command with options:", test_options);
+
+    if (jobs == CHILI_JOBS_AUTO){
+        jobs = chili_cpus_available();
+        if (jobs < 0){
+            printf("Unable to determine number of cpus\n");
+            return jobs;
+        }
+        debug_print("Using %d jobs\n", jobs);
+    }
+
+    report.use_color = test_options->use_color;
+    report.use_cursor = test_options->use_cursor;
+    report.nice_stats = test_options->nice_stats;
+
+    r = _history_create(test_options, &history);
+    if (r < 0){
+        return r;
+    }
+
+    /* Picks among all tests, one at a time */
+    if (test_options->time_budget_ns > 0 || test_options->shard_count > 0){
+        r = _list_named(library_paths, num_libraries, history,
+                        &tests, &count);
+        if (r >= 0){
+            r = _run_tests(tests, &count, history, test_options);
+        }
+        _free_named(tests, count);
+        chili_history_destroy(history);
+        return r;
+    }
+
+    /* Libraries are kept loaded by the server */
+    if (test_options->server_path[0] != '\0'){
+        if (test_options->resume){
+            printf("Completed tests are only left out when tests are "
+                   "run here\n");
+        }
+        r = _request_served(chili_server_all, library_paths, NULL,
+                            num_libraries, history, test_options);
+        _history_save(history, test_options);
+        chili_history_destroy(history);
+        return r;
+    }
+
+    plan = malloc(num_libraries * sizeof(*plan));
+    ordered = malloc(num_libraries * sizeof(*ordered));
+    uncached = malloc(num_libraries * sizeof(*uncached));
+    cached = malloc(num_libraries * sizeof(*cached));
+    if (plan == NULL || ordered == NULL ||
+        uncached == NULL || cached == NULL){
+        printf("Unable to allocate plan\n");
+        r = -1;
+        goto on_plan_exit;
+    }
+
+    r = chili_schedule_plan(history, library_paths, num_libraries,
+                            jobs, plan, &makespan_ns);
+    if (r < 0){
+        goto on_plan_exit;
+    }
+    for (int i = 0; i < num_libraries; i++){
+        ordered[i] = plan[i].library;
+    }
+
+    if (test_options->plan){
+        chili_schedule_print(plan, num_libraries, jobs,
+                             makespan_ns);
+        goto on_plan_exit;
+    }
+
+    r = _cache_create(test_options, &cache);
+    if (r < 0){
+        goto on_plan_exit;
+    }
+    replay = (struct replay){
+        .history     = history,
+        .cache       = cache,
+        .cache_tests = test_options->cache_tests,
+        .aggregated  = &aggregated,
+    };
+    _lookup_cached(cache, library_paths, num_libraries,
+                   test_options->force, cached);
+    for (int i = 0; i < num_libraries; i++){
+        given = _given_index(library_paths, num_libraries, ordered[i]);
+        if (!cached[given] && !_completed(ordered[i])){
+            uncached[num_uncached++] = ordered[i];
+        }
+    }
+
+    /* Edges are recorded in memory shared by all test processes */
+    if (jobs > 1 && test_options->coverage){
+        printf("Coverage is only recorded when running one job\n");
+    }
+    else {
+        r = _coverage_begin(test_options, &coverage);
+        if (r < 0){
+            goto on_plan_exit;
+        }
+    }
+
+    r = chili_redirect_begin(test_options->use_redirect,
+                             test_options->redirect_path);
+    if (r < 0){
+        goto on_plan_exit;
+    }
+
+    /* Libraries are run at the same time, there is no single
+     * running test to show */
+    if (jobs > 1){
+        report.use_cursor = false;
+    }
+
+    r = chili_report_begin(&report);
+    if (r < 0){
+        chili_redirect_end();
+        goto on_plan_exit;
+    }
+
+    if (jobs > 1){
+        r = _run_concurrently(library_paths, num_libraries,
+                              uncached, num_uncached, cached,
+                              history, cache, jobs,
+                              test_options->jobs == CHILI_JOBS_AUTO,
+                              test_options, &aggregated);
+        if (r < 0){
+            goto on_exit;
+        }
+    }
+
+    for (int i = 0; jobs <= 1 && i < num_libraries; i++){
+        given = _given_index(library_paths, num_libraries, ordered[i]);
+        if (cached[given]){
+            r = _run_cached(cache, ordered[i], NULL, given, &aggregated);
+            if (r < 0){
+                goto on_exit;
+            }
+            continue;
+        }
+        if (_completed(ordered[i])){
+            _replay_library(ordered[i], &replay);
+            continue;
+        }
+
+        r = chili_lib_create(ordered[i],
+                             chili_report_test_begin,
+                             &lib_handle);
+        if (r < 0){
+            goto on_exit;
+        }
+
+        r = _run_suite(lib_handle, ordered[i], history, cache, coverage,
+                       test_options, &aggregated);
+        chili_lib_destroy(lib_handle);
+        chili_cache_done(cache, ordered[i], r >= 0);
+        if (_journal && r >= 0){
+            chili_journal_done(_journal, ordered[i]);
+        }
+
+        /* Errors triumphs */
+        if (r < 0){
+            goto on_exit;
+        }
+    }
+
+    _aggregated_print("'All' command ended:\n", &aggregated);
+
+    r = _run_result(&aggregated);
+
+on_exit:
+    chili_report_end(&aggregated);
+    chili_redirect_end();
+    _history_save(history, test_options);
+on_plan_exit:
+    if (cache){
+        chili_cache_destroy(cache);
+    }
+    if (coverage){
+        chili_coverage_destroy(coverage);
+    }
+    free(plan);
+    free(ordered);
+    free(uncached);
+    free(cached);
+    chili_history_destroy(history);
+
+    return r;
+}
+
+int chili_command_all(const char **library_paths,
+                      int num_libraries,
+                      const struct chili_test_options *test_options)
+{
+    char options[CHILI_SERVER_MAX_PATH + 128];
+    const char **inputs;
+    int r;
+
+    inputs = malloc((num_libraries + 1) * sizeof(*inputs));
+    if (inputs == NULL){
+        printf("Unable to allocate inputs of run\n");
+        return -1;
+    }
+    _journal_options("all", test_options, options, sizeof(options));
+    inputs[0] = options;
+    memcpy(&inputs[1], library_paths, num_libraries * sizeof(*inputs));
+
+    r = _journal_begin(inputs, num_libraries + 1, test_options);
+    free(inputs);
+    if (r < 0){
+        return r;
+    }
+    r = _results_begin(test_options);
+    if (r < 0){
+        _journal_end(r);
+        return r;
+    }
+    _use_manifests(test_options, !test_options->plan);
+
+    r = _run_all(library_paths, num_libraries, test_options);
+    _results_end();
+    _journal_end(r);
+
+    return r;
+}
+
+/* Journals run of named tests, they are inputs of the run along
+ * with their libraries */
+static int _journal_named(const char *command,
+                          const struct named_test *tests,
+                          int count,
+                          const struct chili_test_options *test_options)
+{
+    char options[CHILI_SERVER_MAX_PATH + 128];
+    const char **inputs;
+    int r;
+
+    inputs = malloc((2 * count + 1) * sizeof(*inputs));
+    if (inputs == NULL){
+        printf("Unable to allocate inputs of run\n");
+        return -1;
+    }
+    _journal_options(command, test_options, options, sizeof(options));
+    inputs[0] = options;
+    for (int i = 0; i < count; i++){
+        inputs[2 * i + 1] = tests[i].library;
+        inputs[2 * i + 2] = tests[i].name;
+    }
+
+    r = _journal_begin(inputs, 2 * count + 1, test_options);
+    free(inputs);
+
+    return r;
+}
+
+/* Runs named tests like any run, journaled to be resumed and
+ * with results logged */
+static int _run_logged(const char *command,
+                       struct named_test *tests,
+                       int *count,
+                       chili_handle history,
+                       const struct chili_test_options *test_options)
+{
+    int r;
+
+    r = _journal_named(command, tests, *count, test_options);
+    if (r < 0){
+        return r;
+    }
+    r = _results_begin(test_options);
+    if (r >= 0){
+        r = _run_tests(tests, count, history, test_options);
+        _results_end();
+    }
+    _journal_end(r);
+
+    return r;
+}
+
+static int _named(const char *names_path,
+                  bool expand_setup,
+                  const struct chili_test_options *test_options)
+{
+    int r;
+    FILE *f;
+    chili_handle history;
+    struct named_test *tests;
+    int count;
+
+    /* When no input file specified, use stdin */
+    f = names_path == NULL ?
+        stdin :
+        fopen(names_path, "r");
+    if (f == NULL){
+        printf("Failed to open file %s: %s\n",
+               names_path, strerror(errno));
+        return -1;
+    }
+
+    r = _history_create(test_options, &history);
+    if (r < 0){
+        if (f != stdin){
+            fclose(f);
+        }
+        return r;
+    }
+    _use_manifests(test_options, true);
+
+    r = _read_named(f, history, &tests, &count);
+    if (f != stdin){
+        fclose(f);
+    }
+    if (r > 0 && expand_setup){
+        r = _expand_setup(history, &tests, &count);
+    }
+    if (r > 0 && count == 0){
+        printf("No named tests specified\n");
+        r = -1;
+    }
+    if (r < 0){
+        goto on_exit;
+    }
+
+    _option_print("Running 'named' command with options:", test_options);
+
+    r = _run_logged("named", tests, &count, history, test_options);
+
+on_exit:
+    _free_named(tests, count);
+    chili_history_destroy(history);
+
+    return r;
+}
+
+int chili_command_named(const char *names_path,
+                        const struct chili_test_options *test_options)
+{
+    return _named(names_path, false, test_options);
+}
+
+int chili_command_rerun_failed(const struct chili_test_options *test_options)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 16];
+    struct stat path_stat;
+
+    _failed_path(test_options, path, sizeof(path));
+    if (stat(path, &path_stat) < 0){
+        printf("No earlier run to rerun, %s is missing\n", path);
+        return -1;
+    }
+    if (path_stat.st_size == 0){
+        printf("No failed tests to rerun\n");
+        return 1;
+    }
+
+    /* Read before running, replaced by tests that fail again */
+    return _named(path, true, test_options);
+}
+
+int chili_command_affected(const char *files_path,
+                           const char *symbols_path,
+                           const char **library_paths,
+                           int num_libraries,
+                           bool run,
+                           const struct chili_test_options *test_options)
+{
+    struct changed files;
+    struct changed symbols;
+    chili_handle coverage = NULL;
+    chili_handle history;
+    struct named_test *tests = NULL;
+    int count = 0;
+    int r = 1;
+
+    memset(&files, 0, sizeof(files));
+    memset(&symbols, 0, sizeof(symbols));
+    if (files_path){
+        r = _read_changed(files_path, &files);
+    }
+    if (r >= 0 && symbols_path){
+        r = _read_changed(symbols_path, &symbols);
+    }
+    if (r >= 0 && symbols_path){
+        r = _coverage_create(test_options, &coverage);
+    }
+    if (r >= 0){
+        r = _history_create(test_options, &history);
+    }
+    if (r < 0){
+        _free_changed(&files);
+        _free_changed(&symbols);
+        if (coverage){
+            chili_coverage_destroy(coverage);
+        }
+        return r;
+    }
+
+    _use_manifests(test_options, run);
+    r = _list_affected(library_paths, num_libraries,
+                       files_path ? &files : NULL,
+                       symbols_path ? &symbols : NULL,
+                       coverage, history, &tests, &count);
+    _free_changed(&files);
+    _free_changed(&symbols);
+    if (coverage){
+        chili_coverage_destroy(coverage);
+    }
+    if (r < 0){
+        _free_named(tests, count);
+        chili_history_destroy(history);
+        return r;
+    }
+
+    if (!run){
+        /* Ready to be run with 'named' */
+        for (int i = 0; i < count; i++){
+            printf("%s:%s\n", tests[i].library, tests[i].name);
+        }
+    }
+    else if (count == 0){
+        printf("No tests affected by changed files\n");
+    }
+    else {
+        _option_print("Running 'affected' command with options:",
+                      test_options);
+        qsort(tests, count, sizeof(*tests), _by_priority);
+        r = _run_logged("affected", tests, &count, history,
+                        test_options);
+    }
+
+    chili_history_destroy(history);
+    _free_named(tests, count);
+
+    return r;
+}
+
+int chili_command_serve(const char *socket_path)
+{
+    return chili_server_serve(socket_path);
+}
+
+static void _stop_watching(int signal)
+{
+    _watch_stopped = 1;
+}
+
+/* Runs libraries in a process of their own, in a process group
+ * along with their tests so that all of them can be killed when
+ * a newer build lands. */
+static pid_t _start_watched(const char **library_paths,
+                            int num_libraries,
+                            const bool *pending,
+                            const struct chili_test_options *test_options)
+{
+    const char **paths;
+    int num_paths = 0;
+    pid_t pid;
+    int r = -1;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0){
+        printf("Failed to fork run: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0){
+        setpgid(0, 0);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+
+        paths = malloc(num_libraries * sizeof(*paths));
+        for (int i = 0; paths && i < num_libraries; i++){
+            if (pending[i]){
+                paths[num_paths++] = library_paths[i];
+            }
+        }
+        if (paths){
+            r = chili_command_all(paths, num_paths, test_options);
         }
+        fflush(stdout);
+        _exit(r > 0 ? 0 : 1);
     }
+    /* Also done by child, whichever runs first */
+    setpgid(pid, pid);
 
-    *lib_handle = lib;
-    return 1;
+    return pid;
 }
 
-static int _invoke_named_test(struct chili_aggregated *aggregated,
-                              chili_handle registry,
-                              const char *library_path,
-                              const char *test_name,
-                              struct chili_times *times)
+static void _cancel_watched(pid_t pid)
+{
+    kill(-pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+int chili_command_watch(const char **library_paths,
+                        int num_libraries,
+                        const struct chili_test_options *test_options)
 {
+    struct sigaction action = { .sa_handler = _stop_watching };
+    struct sigaction old_int;
+    struct sigaction old_term;
+    chili_handle watch;
+    enum chili_watch_state *states;
+    bool *pending;
+    bool *running;
+    bool changing;
+    bool cancel;
+    pid_t pid = 0;
     int r;
-    chili_handle lib_handle;
-    struct chili_result result;
 
-    debug_print("Running named test: %s:%s\n",
-                library_path, test_name);
+    states = malloc(num_libraries * sizeof(*states));
+    pending = malloc(num_libraries * sizeof(*pending));
+    running = calloc(num_libraries, sizeof(*running));
+    if (states == NULL || pending == NULL || running == NULL){
+        printf("Unable to allocate watched libraries\n");
+        r = -1;
+        goto on_alloc_exit;
+    }
 
-    r = _ensure_library(registry, library_path,
-                        &lib_handle);
+    r = chili_watch_create(library_paths, num_libraries, &watch);
     if (r < 0){
-        aggregated->num_errors++;
-        return r;
+        goto on_alloc_exit;
     }
 
-    r = chili_lib_named_test(lib_handle,
-                             test_name,
-                             times,
-                             &result,
-                             aggregated);
-    debug_print("Executed named test: %s:%s returned: %d\n",
-                library_path, test_name, r);
-    if (r < 0){
-        printf("Fatal error while running test %s:%s.\n",
-               library_path, test_name);
-        return r;
+    /* Not restarted, waiting is interrupted to stop at once */
+    _watch_stopped = 0;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+
+    /* All libraries are run once before any has changed */
+    for (int i = 0; i < num_libraries; i++){
+        pending[i] = true;
     }
+    changing = false;
 
-    chili_report_test(&result, aggregated);
+    while (!_watch_stopped){
+        /* Waits for rebuilds to settle, to run them together */
+        if (pid == 0 && !changing){
+            int num_pending = 0;
 
-    return r;
+            for (int i = 0; i < num_libraries; i++){
+                num_pending += pending[i];
+            }
+            if (num_pending > 0){
+                pid = _start_watched(library_paths, num_libraries,
+                                     pending, test_options);
+                if (pid < 0){
+                    r = -1;
+                    break;
+                }
+                memcpy(running, pending, num_libraries * sizeof(*running));
+                memset(pending, 0, num_libraries * sizeof(*pending));
+            }
+        }
+
+        r = chili_watch_wait(watch, WATCH_TICK_MS, states);
+        if (r < 0){
+            break;
+        }
+
+        changing = false;
+        cancel = false;
+        for (int i = 0; i < num_libraries; i++){
+            if (states[i] == chili_watch_changed){
+                pending[i] = true;
+            }
+            if (states[i] == chili_watch_changing){
+                changing = true;
+            }
+            if (pid > 0 && running[i] &&
+                states[i] != chili_watch_unchanged){
+                if (!cancel){
+                    printf("\nCancelled run, %s was rebuilt\n",
+                           library_paths[i]);
+                }
+                cancel = true;
+            }
+        }
+
+        if (pid > 0 && cancel){
+            _cancel_watched(pid);
+            pid = 0;
+            /* Rest of cancelled run is run along with rebuilds */
+            for (int i = 0; i < num_libraries; i++){
+                pending[i] = pending[i] || running[i];
+            }
+        }
+        else if (pid > 0 && waitpid(pid, NULL, WNOHANG) == pid){
+            pid = 0;
+            printf("\nWatching %d libraries for changes, "
+                   "stop with Ctrl-C\n", num_libraries);
+        }
+        if (pid == 0){
+            memset(running, 0, num_libraries * sizeof(*running));
+        }
+    }
+
+    if (pid > 0){
+        _cancel_watched(pid);
+    }
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    chili_watch_destroy(watch);
+
+on_alloc_exit:
+    free(states);
+    free(pending);
+    free(running);
+
+    return r < 0 ? r : 1;
 }
 
-static int _debug_test(chili_handle registry,
-                       chili_handle debugger,
-                       const char *library_path,
-                       const char *test_name)
+int chili_command_worker(const struct chili_test_options *test_options)
 {
-    int r;
-    chili_handle lib_handle;
+    return chili_worker_serve(test_options->use_redirect ?
+                              test_options->redirect_path : NULL);
+}
 
-    debug_print("Debugging test: %s:%s\n",
-                library_path, test_name);
+static int _ignore_result(void *context,
+                          const struct chili_result *result,
+                          bool skipped)
+{
+    return 1;
+}
 
-    r = _ensure_library(registry, library_path, &lib_handle);
-    if (r < 0){
-        return r;
-    }
+static int _merge_result(void *context,
+                         const struct chili_result *result,
+                         bool skipped)
+{
+    struct merge *merge = context;
+    struct chili_result copy = *result;
 
-    r = chili_lib_debug_test(lib_handle, debugger, test_name);
-    debug_print("Debug named test: %s:%s returned: %d\n",
-                library_path, test_name, r);
-    if (r < 0){
-        printf("Fatal error while debugging test %s:%s.\n",
-               library_path, test_name);
-        return r;
+    if (skipped){
+        merge->num_skipped++;
+        return 1;
     }
 
-    return r;
+    chili_run_aggregate(&copy, &merge->aggregated);
+    chili_report_test(&copy, &merge->aggregated);
+    _record(merge->history, copy.library, &copy);
+
+    return 1;
 }
 
-int _close_libraries(chili_handle registry)
+/* Checks that there is exactly one log of each shard */
+static int _check_shards(const char **results_paths, int num_results)
 {
-    int token = 0;
-    int r = 0;
-    chili_handle lib_handle;
+    int shard;
+    int num_shards;
+    int first_num_shards = 0;
+    bool *seen = NULL;
+    int r = 1;
+
+    if (num_results == 0){
+        printf("No result logs to merge\n");
+        return -1;
+    }
 
-    lib_handle = chili_reg_next(registry, &token);
-    while (lib_handle != NULL) {
-        /* Preserve error */
+    for (int i = 0; r > 0 && i < num_results; i++){
+        r = chili_results_read(results_paths[i], &shard, &num_shards,
+                               _ignore_result, NULL);
         if (r < 0){
-            chili_lib_after_fixture(lib_handle);
+            break;
         }
-        else {
-            r = chili_lib_after_fixture(lib_handle);
-            if (r < 0){
-                chili_report_suite_end_fail(r);
+        if (seen == NULL){
+            first_num_shards = num_shards;
+            seen = calloc(num_shards, sizeof(bool));
+            if (seen == NULL){
+                printf("Unable to allocate shards\n");
+                return -1;
             }
         }
+        if (num_shards != first_num_shards ||
+            shard < 1 || shard > num_shards){
+            printf("%s is shard %d/%d, expected shard of %d\n",
+                   results_paths[i], shard, num_shards, first_num_shards);
+            r = -1;
+        }
+        else if (seen[shard - 1]){
+            printf("Shard %d/%d given more than once\n",
+                   shard, num_shards);
+            r = -1;
+        }
+        else {
+            seen[shard - 1] = true;
+        }
+    }
 
-        lib_handle = chili_reg_next(registry, &token);
+    for (int i = 0; r > 0 && i < first_num_shards; i++){
+        if (!seen[i]){
+            printf("Shard %d/%d is missing\n", i + 1, first_num_shards);
+            r = -1;
+        }
     }
+
+    free(seen);
     return r;
 }
 
-int chili_command_all(const char **library_paths,
-                      int num_libraries,
-                      const struct chili_test_options *test_options)
+int chili_command_merge(const char **results_paths,
+                        int num_results,
+                        const struct chili_test_options *options)
 {
     int r;
+    int shard;
+    int num_shards;
     struct chili_report report;
-    struct chili_aggregated aggregated = { 0 };
-    chili_handle lib_handle;
-
-    _option_print("Running 'all' command with options:", test_options);
+    struct merge merge = { { 0 } };
 
-    report.use_color = test_options->use_color;
-    report.use_cursor = test_options->use_cursor;
-    report.nice_stats = test_options->nice_stats;
+    r = _check_shards(results_paths, num_results);
+    if (r < 0){
+        return r;
+    }
 
-    r = chili_redirect_begin(test_options->use_redirect,
-                             test_options->redirect_path);
+    /* History is saved next to where test output would be */
+    if (_log_dir(options) < 0){
+        return -1;
+    }
+    r = _history_create(options, &merge.history);
     if (r < 0){
         return r;
     }
 
+    report.use_color = options->use_color;
+    report.use_cursor = false;
+    report.nice_stats = options->nice_stats;
     r = chili_report_begin(&report);
     if (r < 0){
-        chili_redirect_end();
+        chili_history_destroy(merge.history);
         return r;
     }
 
-    for (int i = 0; i < num_libraries; i++){
-        r = chili_lib_create(library_paths[i],
-                             chili_report_test_begin,
-                             &lib_handle);
-        if (r < 0){
-            goto on_exit;
-        }
-
-        r = _run_suite(lib_handle, test_options, &aggregated);
-        chili_lib_destroy(lib_handle);
-
-        /* Errors triumphs */
-        if (r < 0){
-            goto on_exit;
-        }
+    for (int i = 0; r > 0 && i < num_results; i++){
+        r = chili_results_read(results_paths[i], &shard, &num_shards,
+                               _merge_result, &merge);
     }
 
-    _aggregated_print("'All' command ended:\n", &aggregated);
-
-    r = aggregated.num_failed > 0 ? 0 : 1;
+    chili_report_end(&merge.aggregated);
+    if (merge.num_skipped > 0){
+        printf("Skipped %d tests\n", merge.num_skipped);
+    }
+    _aggregated_print("'Merge' command ended:\n", &merge.aggregated);
 
-on_exit:
-    chili_report_end(&aggregated);
-    chili_redirect_end();
+    _history_save(merge.history, options);
+    chili_history_destroy(merge.history);
 
-    return r;
+    if (r < 0){
+        return r;
+    }
+    return _run_result(&merge.aggregated);
 }
 
-int chili_command_named(const char *names_path,
-                        const struct chili_test_options *test_options)
+int chili_command_compare(const char **results_paths,
+                          int num_results,
+                          int threshold_percent)
 {
+    struct chili_compare_counts counts;
+    chili_handle compare;
     int r;
-    struct chili_report report;
-    struct chili_aggregated aggregated = { 0 };
-    char buffer[1024];
-    char *line;
-    FILE *f;
-    char *library_path;
-    char *test_name;
-    chili_handle registry;
-    struct chili_times times;
 
-    times.timeout.tv_nsec = 0;
-    times.timeout.tv_sec = 10;
+    r = chili_compare_create(threshold_percent, &compare);
+    if (r < 0){
+        return r;
+    }
 
-    /* When no input file specified, use stdin */
-    f = names_path == NULL ?
-        stdin :
-        fopen(names_path, "r");
-    if (f == NULL){
-        printf("Failed to open file %s: %s\n",
-               names_path, strerror(errno));
-        return -1;
+    for (int i = 0; r > 0 && i < num_results; i++){
+        r = chili_compare_add(compare, results_paths[i]);
+    }
+    if (r > 0){
+        r = chili_compare_print(compare, &counts);
     }
+    chili_compare_destroy(compare);
 
-    r = chili_reg_create(10, &registry);
     if (r < 0){
         return r;
     }
+    printf("\nNewly failing: %d, newly passing: %d, flaky: %d, "
+           "regressed: %d\n", counts.newly_failing, counts.newly_passing,
+           counts.flaky, counts.regressed);
 
-    _option_print("Running 'named' command with options:", test_options);
+    return counts.newly_failing > 0 || counts.regressed > 0 ? 0 : 1;
+}
+
+int chili_command_bench(const char **library_paths,
+                        int num_libraries,
+                        const struct chili_test_options *test_options,
+                        const struct chili_bench_options *bench_options,
+                        const char *export_path)
+{
+    int r;
+    struct chili_report report;
+    struct chili_aggregated aggregated = { 0 };
+    chili_handle lib_handle;
+    chili_handle bench_handle;
+    FILE *export = NULL;
+
+    _option_print("Running 'bench' command with options:", test_options);
+    _use_manifests(test_options, true);
 
     report.use_color = test_options->use_color;
     report.use_cursor = test_options->use_cursor;
     report.nice_stats = test_options->nice_stats;
 
+    if (export_path){
+        export = fopen(export_path, "w");
+        if (export == NULL){
+            printf("Failed to open file %s: %s\n",
+                   export_path, strerror(errno));
+            return -1;
+        }
+    }
+
+    r = chili_bench_create(&bench_handle);
+    if (r < 0){
+        goto on_bench_error;
+    }
+
     r = chili_redirect_begin(test_options->use_redirect,
                              test_options->redirect_path);
     if (r < 0){
-        return r;
+        goto on_redirect_error;
     }
 
     r = chili_report_begin(&report);
     if (r < 0){
         chili_redirect_end();
-        return r;
+        goto on_redirect_error;
     }
 
-    while (true) {
-        line = fgets(buffer, 1024, f);
-        if (line != NULL){
-            r = chili_named_parse(line, &library_path, &test_name);
-            if (r > 0){
-                r = _invoke_named_test(&aggregated, registry,
-                                       library_path, test_name,
-                                       &times);
-                if (r < 0){
-                    break;
-                }
-            }
-            else{
-                debug_print("Failed to parse: %s\n", line);
-            }
+    for (int i = 0; i < num_libraries; i++){
+        r = chili_lib_create(library_paths[i],
+                             chili_report_test_begin,
+                             &lib_handle);
+        if (r < 0){
+            goto on_exit;
         }
-        else {
-            debug_print("End of file\n");
-            break;
+
+        r = _run_benchmarks(lib_handle, bench_handle, bench_options,
+                            export, &aggregated);
+        chili_lib_destroy(lib_handle);
+
+        /* Errors triumphs */
+        if (r < 0){
+            goto on_exit;
         }
     }
-    _aggregated_print("'Named' command ended:\n", &aggregated);
 
-    /* Preserve error on failure */
-    if (r < 0){
-        _close_libraries(registry);
-    }
-    else {
-        r = _close_libraries(registry);
-    }
+    _aggregated_print("'Bench' command ended:\n", &aggregated);
 
-    /* Preserve error on failure */
-    if (r >= 0) {
-        r = aggregated.num_failed > 0 ? 0 : 1;
-    }
+    r = _run_result(&aggregated);
 
+on_exit:
     chili_report_end(&aggregated);
     chili_redirect_end();
-    chili_reg_destroy(registry);
+on_redirect_error:
+    chili_bench_destroy(bench_handle);
+on_bench_error:
+    if (export){
+        fclose(export);
+    }
 
     return r;
 }
@@ -434,12 +3401,45 @@ int chili_command_debug(const char *chili_path,
     return r;
 }
 
+static int _print_redundant(void *context,
+                            const char *library,
+                            const char *name)
+{
+    printf("%s:%s\n", library, name);
+    return 1;
+}
+
 int chili_command_list(const char **library_paths,
-                       int num_libraries)
+                       int num_libraries,
+                       bool redundant,
+                       const struct chili_test_options *options)
 {
     int r = 0;
     chili_handle lib_handle;
+    chili_handle coverage;
+    struct served served = { .libraries = library_paths };
+
+    if (redundant){
+        r = _coverage_create(options, &coverage);
+        if (r < 0){
+            return r;
+        }
+        r = chili_coverage_redundant(coverage, library_paths,
+                                     num_libraries, _print_redundant,
+                                     NULL);
+        chili_coverage_destroy(coverage);
+        return r;
+    }
+
+    /* Libraries are kept loaded by the server */
+    if (options->server_path[0] != '\0'){
+        return chili_server_request(options->server_path,
+                                    chili_server_list, NULL,
+                                    library_paths, NULL, num_libraries,
+                                    _report_served, &served);
+    }
 
+    _use_manifests(options, false);
     for (int i = 0; i < num_libraries; i++){
         r = chili_lib_create(library_paths[i], NULL, &lib_handle);
         if (r < 0){
@@ -451,3 +3451,27 @@ int chili_command_list(const char **library_paths,
 
     return r;
 }
+
+int chili_command_index(const char **library_paths,
+                        int num_libraries,
+                        const struct chili_test_options *options)
+{
+    int num_written = 0;
+    int num_tests;
+    int r;
+
+    _use_manifests(options, true);
+    for (int i = 0; i < num_libraries; i++){
+        r = chili_lib_index(library_paths[i], &num_tests);
+        if (r < 0){
+            printf("Failed to index library: %s\n", library_paths[i]);
+            return r;
+        }
+        printf("%s: %d tests, %s\n", library_paths[i], num_tests,
+               r > 0 ? "indexed" : "up to date");
+        num_written += r;
+    }
+    printf("Indexed %d of %d libraries\n", num_written, num_libraries);
+
+    return 1;
+}
@@ -1,8 +1,13 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "redirect.h"
+#include "bench.h"
+#include "server.h"
 
+/* Number of jobs is chosen from cpus available */
+#define CHILI_JOBS_AUTO 0
 
 struct chili_test_options {
     /* Colorized output */
@@ -17,8 +22,52 @@ struct chili_test_options {
     /* Print stats that is harder to parse but nicer
      * to read. */
     bool nice_stats;
+    /* Number of libraries to run at the same time,
+     * each in a supervisor process of its own.
+     * CHILI_JOBS_AUTO to use as many as there are cpus
+     * available and adapt to cpu throttling. */
+    int jobs;
+    /* Memory that concurrently run libraries may use
+     * together, zero to use cgroup memory limit. */
+    uint64_t memory_kb;
+    /* Only run tests predicted to find most failures
+     * within this time, zero to run all. */
+    uint64_t time_budget_ns;
+    /* Only run tests of shard, numbered from 1, out of
+     * shard_count. Zero count to run all tests. */
+    int shard_index;
+    int shard_count;
+    /* Number of worker processes that run named tests, each
+     * test handed out to the first worker that is free. Zero
+     * to run tests one at a time in this process. */
+    int workers;
+    /* Pin each supervisor or worker to a cpu of its own, one
+     * physical core at a time and socket by socket, SMT
+     * siblings last. */
+    bool pin;
+    /* Run libraries whose results are cached from an earlier
+     * run where all of their tests succeeded. */
+    bool force;
+    /* Leave out tests that passed when last run with the same
+     * machine code of test, fixtures and budget. Code that
+     * tests call is not compared. */
+    bool cache_tests;
+    /* Record edges reached by each test in libraries built
+     * with -fsanitize-coverage, when tests are run one at a
+     * time. */
+    bool coverage;
+    /* Only print in which order libraries would be run and
+     * how long it is predicted to take. */
+    bool plan;
+    /* Leave out tests completed by an interrupted run of the
+     * same libraries, tests and options, reporting their
+     * results from its journal as if they were run again. */
+    bool resume;
     /* Path to directory where test stdout will be put */
     char redirect_path[CHILI_REDIRECT_MAX_PATH];
+    /* Socket of 'chili serve' that runs the tests with its
+     * libraries kept loaded, empty to run them here. */
+    char server_path[CHILI_SERVER_MAX_PATH];
 };
 
 /**
@@ -58,6 +107,173 @@ int chili_command_all(const char **library_paths,
 int chili_command_named(const char *names_path,
                         const struct chili_test_options *options);
 
+/**
+ * @brief Runs tests that didn't succeed in the last run
+ *
+ * Every run saves the tests that failed, errored, crashed, timed
+ * out or went over budget in failed in the log directory. These
+ * are run again like 'named' and replaced by those that still
+ * don't succeed.
+ *
+ * @param options Options to use when running tests.
+ *
+ * @return Negative on error.
+ *         Zero when a test failed again.
+ *         Positive when all tests succeeded or none had failed.
+ */
+int chili_command_rerun_failed(const struct chili_test_options *test_options);
+
+/**
+ * @brief Serves 'all', 'named' and 'list' run by other chilis
+ *
+ * Keeps libraries loaded and set up between runs, see
+ * chili_server_serve.
+ *
+ * @param socket_path Path to create Unix socket at.
+ *
+ * @return Negative on error.
+ *         Positive when stopped by SIGINT or SIGTERM.
+ */
+int chili_command_serve(const char *socket_path);
+
+/**
+ * @brief Runs all tests again when libraries are rebuilt
+ *
+ * Runs all tests in specified shared libraries, then waits
+ * for libraries to be rebuilt and runs the tests of rebuilt
+ * libraries like 'all'. Rebuilds that land close together are
+ * run together. A run is cancelled when a library in it is
+ * rebuilt again, the rest of it is run along with the rebuild.
+ * Libraries are only loaded by the runs, libraries that are not
+ * rebuilt are not run again.
+ *
+ * @param library_paths Array of paths to shared library containing
+ *                      tests.
+ * @param num_libraries Number of entries in array.
+ * @param options       Options to use when running tests.
+ *
+ * @return Negative on error.
+ *         Positive when stopped by SIGINT or SIGTERM.
+ */
+int chili_command_watch(const char **library_paths,
+                        int num_libraries,
+                        const struct chili_test_options *test_options);
+
+/**
+ * @brief Lists or runs tests affected by changed files or
+ *        changed functions
+ *
+ * Maps each test to the source files, including headers,
+ * of the compilation unit it is in, read from line number
+ * information of libraries built with -g. A test is affected
+ * when any of those files is changed. All tests of a library
+ * are affected when the library, a library it needs or, for
+ * libraries built without -g, anything is changed.
+ * A test is also affected when its recorded coverage reaches
+ * a changed function, or when it has no coverage recorded.
+ *
+ * @param files_path    Path to file with one changed file per
+ *                      line, "-" for stdin. Paths are matched
+ *                      by their ending, relative paths work.
+ *                      NULL when not given.
+ * @param symbols_path  Path to file with one changed function
+ *                      per line, "-" for stdin. NULL when not
+ *                      given.
+ * @param library_paths Array of paths to shared library containing
+ *                      tests.
+ * @param num_libraries Number of entries in array.
+ * @param run           Run affected tests like 'named' instead of
+ *                      printing them.
+ * @param options       Options to use when running tests.
+ *
+ * @return Negative on error.
+ *         Zero when all tests succeeded.
+ *         Positive on test error/failure.
+ */
+int chili_command_affected(const char *files_path,
+                           const char *symbols_path,
+                           const char **library_paths,
+                           int num_libraries,
+                           bool run,
+                           const struct chili_test_options *options);
+
+/**
+ * @brief Serves as worker for a coordinating chili
+ *
+ * Runs tests read from stdin, one named test per line, and
+ * writes framed results to stdout until stdin is closed.
+ * Started by chili named when running with workers, but
+ * anything that connects stdin and stdout to the coordinator,
+ * like ssh, works.
+ *
+ * @param options       Options to use when running tests,
+ *                      only redirection is used.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_command_worker(const struct chili_test_options *options);
+
+/**
+ * @brief Reports how a run differs from earlier runs
+ *
+ * @param results_paths     Array of paths to result logs, one
+ *                          per run, oldest first.
+ * @param num_results       Number of entries in array, at least
+ *                          two.
+ * @param threshold_percent How much more a test may use before
+ *                          it has regressed.
+ *
+ * @return Negative on error.
+ *         Zero when a test is newly failing or has regressed.
+ *         Positive otherwise.
+ */
+int chili_command_compare(const char **results_paths,
+                          int num_results,
+                          int threshold_percent);
+
+/**
+ * @brief Reports results of shards as one run
+ *
+ * Reads result logs written by each shard of a run, reports
+ * all results and records durations in history.
+ *
+ * @param results_paths Array of paths to result logs, one per
+ *                      shard.
+ * @param num_results   Number of entries in array.
+ * @param options       Options to use when reporting.
+ *
+ * @return Negative on error, like a missing shard.
+ *         Zero on test error/failure in any shard.
+ *         Positive when all tests succeeded.
+ */
+int chili_command_merge(const char **results_paths,
+                        int num_results,
+                        const struct chili_test_options *options);
+
+/**
+ * @brief Runs all benchmarks
+ *
+ * Runs all benchmarks in specified shared libraries.
+ *
+ * @param library_paths Array of paths to shared library containing
+ *                      benchmarks.
+ * @param num_libraries Number of entries in array.
+ * @param options       Options to use when reporting.
+ * @param bench_options Options to use when running benchmarks.
+ * @param export_path   Path to file where results are exported,
+ *                      NULL to not export.
+ *
+ * @return Negative on error.
+ *         Zero when all benchmarks succeeded.
+ *         Positive on benchmark error/failure.
+ */
+int chili_command_bench(const char **library_paths,
+                        int num_libraries,
+                        const struct chili_test_options *options,
+                        const struct chili_bench_options *bench_options,
+                        const char *export_path);
+
 /**
  * @brief Debugs the named test
  *
@@ -84,9 +300,33 @@ int chili_command_debug(const char *chili_path,
  * @param library_paths Array of paths to shared library containing
  *                      tests.
  * @param num_libraries Number of entries in array.
+ * @param redundant     Only print tests whose recorded coverage
+ *                      adds nothing to the other tests, libraries
+ *                      are named as when coverage was recorded.
+ * @param options       Options, where coverage is kept.
  *
  * @return Negative on error.
  */
 int chili_command_list(const char **library_paths,
-                       int num_libraries);
+                       int num_libraries,
+                       bool redundant,
+                       const struct chili_test_options *options);
+
+/**
+ * @brief Writes manifests of libraries ahead of runs.
+ *
+ * Libraries aren't loaded. Runs and listings of libraries with
+ * an up to date manifest skip parsing their symbols.
+ *
+ * @param library_paths Array of paths to shared library containing
+ *                      tests.
+ * @param num_libraries Number of entries in array.
+ * @param options       Options, where manifests are kept.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_command_index(const char **library_paths,
+                        int num_libraries,
+                        const struct chili_test_options *options);
 
@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "compare.h"
+#include "hash.h"
+#include "results.h"
+#include "run.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Smaller changes are noise whatever the threshold */
+#define MIN_CHANGE_NS     1000000ULL
+#define MIN_CHANGE_RSS_KB 1024ULL
+
+/* Outcome changes before test is flaky, one change is a test
+ * that started or stopped failing */
+#define FLAKY_CHANGES 2
+
+/* Types */
+
+/* Test in one of the runs */
+struct outcome {
+    /* Index of run, negative when not in any run */
+    int                run;
+    bool               failed;
+    /* Reported from cache, without usage */
+    bool               cached;
+    struct chili_usage usage;
+};
+
+struct entry {
+    char           *library;
+    char           *name;
+    /* Two latest runs that test was in */
+    struct outcome previous;
+    struct outcome latest;
+    /* Number of times outcome changed between runs */
+    int            changes;
+};
+
+struct library {
+    const char *path;
+    /* Of tests run in both runs */
+    uint64_t   older_ns;
+    uint64_t   newer_ns;
+    /* Tests only in newer or only in older run */
+    int        added;
+    int        removed;
+};
+
+struct instance {
+    int          threshold_percent;
+    /* Number of runs added */
+    int          num_runs;
+    /* Entries in the order tests were first seen */
+    struct entry *entries;
+    int          num_entries;
+    int          capacity;
+    /* Index of entry by test */
+    chili_handle tests;
+};
+
+
+/* Locals */
+static struct entry *_lookup(const struct instance *instance,
+                             const char *library,
+                             const char *name)
+{
+    int i = chili_hash_find(instance->tests, library, name);
+
+    return i < 0 ? NULL : &instance->entries[i];
+}
+
+static int _grow(struct instance *instance)
+{
+    struct entry *entries;
+    int capacity = instance->capacity ? instance->capacity * 2 : 64;
+
+    entries = realloc(instance->entries, capacity * sizeof(*entries));
+    if (entries == NULL){
+        printf("Unable to allocate compared tests\n");
+        return -1;
+    }
+    instance->entries = entries;
+    instance->capacity = capacity;
+
+    return 1;
+}
+
+static struct entry *_insert(struct instance *instance,
+                             const struct chili_result *result)
+{
+    struct entry *entry;
+
+    if (instance->num_entries == instance->capacity &&
+        _grow(instance) < 0){
+        return NULL;
+    }
+
+    entry = &instance->entries[instance->num_entries];
+    memset(entry, 0, sizeof(*entry));
+    entry->library = strdup(result->library);
+    entry->name = strdup(result->name);
+    if (entry->library == NULL || entry->name == NULL ||
+        chili_hash_add(instance->tests, entry->library, entry->name,
+                       instance->num_entries) < 0){
+        printf("Unable to allocate compared test\n");
+        free(entry->library);
+        free(entry->name);
+        return NULL;
+    }
+    entry->previous.run = -1;
+    entry->latest.run = -1;
+    instance->num_entries++;
+
+    return entry;
+}
+
+static bool _failed(const struct chili_result *result)
+{
+    return result->execution != execution_done ||
+           result->before == fixture_error ||
+           result->after == fixture_error ||
+           result->test != test_success ||
+           result->over_budget;
+}
+
+static int _add_result(void *context,
+                       const struct chili_result *result,
+                       bool skipped)
+{
+    struct instance *instance = context;
+    struct entry *entry;
+    bool failed;
+
+    if (skipped){
+        return 1;
+    }
+
+    entry = _lookup(instance, result->library, result->name);
+    if (entry == NULL){
+        entry = _insert(instance, result);
+        if (entry == NULL){
+            return -1;
+        }
+    }
+    if (entry->latest.run == instance->num_runs){
+        /* Given twice in same run, first one counts */
+        return 1;
+    }
+
+    failed = _failed(result);
+    if (entry->latest.run >= 0 && entry->latest.failed != failed){
+        entry->changes++;
+    }
+    entry->previous = entry->latest;
+    entry->latest.run = instance->num_runs;
+    entry->latest.failed = failed;
+    entry->latest.cached = result->cached;
+    entry->latest.usage = result->usage;
+
+    return 1;
+}
+
+/* Test was in both of the compared runs */
+static bool _compared(const struct instance *instance,
+                      const struct entry *entry)
+{
+    return entry->latest.run == instance->num_runs - 1 &&
+           entry->previous.run == instance->num_runs - 2;
+}
+
+/* Usage of test is known in both of the compared runs */
+static bool _measured(const struct instance *instance,
+                      const struct entry *entry)
+{
+    return _compared(instance, entry) &&
+           !entry->previous.cached && !entry->latest.cached;
+}
+
+static bool _is_flaky(const struct entry *entry)
+{
+    return entry->changes >= FLAKY_CHANGES;
+}
+
+static int _percent(uint64_t older, uint64_t newer)
+{
+    return (int)(((double)newer - (double)older) * 100.0 / older);
+}
+
+static bool _regressed(const struct instance *instance,
+                       uint64_t older,
+                       uint64_t newer,
+                       uint64_t min_change)
+{
+    return newer > older + min_change &&
+           (older == 0 || _percent(older, newer) >
+                          instance->threshold_percent);
+}
+
+static void _print_usage(const char *what,
+                         uint64_t older,
+                         uint64_t newer,
+                         const char *unit)
+{
+    printf("    %s: %" PRIu64 " %s -> %" PRIu64 " %s",
+           what, older, unit, newer, unit);
+    if (older > 0){
+        printf(", %+d%%", _percent(older, newer));
+    }
+    printf("\n");
+}
+
+/* Checks what test used more of in newer run than in older */
+static bool _find_regressions(const struct instance *instance,
+                              const struct entry *entry,
+                              bool *wall,
+                              bool *cpu,
+                              bool *rss)
+{
+    const struct chili_usage *older = &entry->previous.usage;
+    const struct chili_usage *newer = &entry->latest.usage;
+
+    /* Failing tests stop early or time out */
+    if (!_measured(instance, entry) ||
+        entry->previous.failed || entry->latest.failed){
+        return false;
+    }
+
+    *wall = _regressed(instance, older->wall_ns, newer->wall_ns,
+                       MIN_CHANGE_NS);
+    *cpu = _regressed(instance, older->cpu_ns, newer->cpu_ns,
+                      MIN_CHANGE_NS);
+    *rss = _regressed(instance, older->max_rss_kb, newer->max_rss_kb,
+                      MIN_CHANGE_RSS_KB);
+
+    return *wall || *cpu || *rss;
+}
+
+static bool _newly_failing(const struct instance *instance,
+                           const struct entry *entry)
+{
+    return _compared(instance, entry) && !_is_flaky(entry) &&
+           !entry->previous.failed && entry->latest.failed;
+}
+
+static bool _newly_passing(const struct instance *instance,
+                           const struct entry *entry)
+{
+    return _compared(instance, entry) && !_is_flaky(entry) &&
+           entry->previous.failed && !entry->latest.failed;
+}
+
+/* Prints tests matching check under title, returns how many */
+static int _print_tests(const struct instance *instance,
+                        const char *title,
+                        bool (*check)(const struct instance*,
+                                      const struct entry*))
+{
+    const struct entry *entry;
+    int count = 0;
+
+    for (int i = 0; i < instance->num_entries; i++){
+        entry = &instance->entries[i];
+        if (!check(instance, entry)){
+            continue;
+        }
+        if (count++ == 0){
+            printf("%s\n", title);
+        }
+        printf("%s:%s\n", entry->library, entry->name);
+    }
+    if (count > 0){
+        printf("\n");
+    }
+
+    return count;
+}
+
+static int _print_flaky(const struct instance *instance)
+{
+    const struct entry *entry;
+    int count = 0;
+
+    for (int i = 0; i < instance->num_entries; i++){
+        entry = &instance->entries[i];
+        if (!_is_flaky(entry)){
+            continue;
+        }
+        if (count++ == 0){
+            printf("Flaky tests:\n");
+        }
+        printf("%s:%s\n", entry->library, entry->name);
+        printf("    outcome changed %d times in %d runs\n",
+               entry->changes, instance->num_runs);
+    }
+    if (count > 0){
+        printf("\n");
+    }
+
+    return count;
+}
+
+static int _print_regressions(const struct instance *instance)
+{
+    const struct entry *entry;
+    const struct chili_usage *older;
+    const struct chili_usage *newer;
+    bool wall;
+    bool cpu;
+    bool rss;
+    int count = 0;
+
+    for (int i = 0; i < instance->num_entries; i++){
+        entry = &instance->entries[i];
+        if (!_find_regressions(instance, entry, &wall, &cpu, &rss)){
+            continue;
+        }
+        if (count++ == 0){
+            printf("Regressed tests, more than %d%% over older run:\n",
+                   instance->threshold_percent);
+        }
+
+        older = &entry->previous.usage;
+        newer = &entry->latest.usage;
+        printf("%s:%s\n", entry->library, entry->name);
+        if (wall){
+            _print_usage("duration", older->wall_ns, newer->wall_ns, "ns");
+        }
+        if (cpu){
+            _print_usage("cpu time", older->cpu_ns, newer->cpu_ns, "ns");
+        }
+        if (rss){
+            _print_usage("max rss", older->max_rss_kb, newer->max_rss_kb,
+                         "kB");
+        }
+    }
+    if (count > 0){
+        printf("\n");
+    }
+
+    return count;
+}
+
+/* Time tests run in both of the compared runs took in each
+ * library, libraries in the order they were first seen */
+static int _print_libraries(const struct instance *instance)
+{
+    struct library *libraries;
+    struct library *library;
+    const struct entry *entry;
+    int num_libraries = 0;
+
+    libraries = calloc(instance->num_entries + 1, sizeof(*libraries));
+    if (libraries == NULL){
+        printf("Unable to allocate compared libraries\n");
+        return -1;
+    }
+
+    for (int i = 0; i < instance->num_entries; i++){
+        entry = &instance->entries[i];
+        library = NULL;
+        for (int j = num_libraries - 1; j >= 0; j--){
+            if (strcmp(libraries[j].path, entry->library) == 0){
+                library = &libraries[j];
+                break;
+            }
+        }
+        if (library == NULL){
+            library = &libraries[num_libraries++];
+            library->path = entry->library;
+        }
+        if (_measured(instance, entry)){
+            library->older_ns += entry->previous.usage.elapsed_ns;
+            library->newer_ns += entry->latest.usage.elapsed_ns;
+        }
+        else if (_compared(instance, entry)){
+            continue;
+        }
+        else if (entry->latest.run == instance->num_runs - 1){
+            library->added++;
+        }
+        else if (entry->latest.run == instance->num_runs - 2){
+            library->removed++;
+        }
+    }
+
+    printf("Libraries:\n");
+    for (int i = 0; i < num_libraries; i++){
+        library = &libraries[i];
+        printf("%s\n", library->path);
+        _print_usage("duration", library->older_ns, library->newer_ns,
+                     "ns");
+        if (library->added > 0 || library->removed > 0){
+            printf("    tests: %d added, %d removed\n",
+                   library->added, library->removed);
+        }
+    }
+
+    free(libraries);
+    return 1;
+}
+
+
+/* Exports */
+int chili_compare_create(int threshold_percent, chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate compare instance\n");
+        return -1;
+    }
+    instance->threshold_percent = threshold_percent;
+    if (chili_hash_create(&instance->tests) < 0){
+        free(instance);
+        return -1;
+    }
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_compare_add(chili_handle handle, const char *results_path)
+{
+    struct instance *instance = handle;
+    int shard;
+    int num_shards;
+    int r;
+
+    r = chili_results_read(results_path, &shard, &num_shards,
+                           _add_result, instance);
+    if (r < 0){
+        return r;
+    }
+    debug_print("Added run %d from %s\n", instance->num_runs,
+                results_path);
+    instance->num_runs++;
+
+    return 1;
+}
+
+int chili_compare_print(chili_handle handle,
+                        struct chili_compare_counts *counts)
+{
+    struct instance *instance = handle;
+
+    if (instance->num_runs < 2){
+        printf("Need results of at least two runs to compare\n");
+        return -1;
+    }
+
+    counts->newly_failing = _print_tests(instance, "Newly failing tests:",
+                                         _newly_failing);
+    counts->newly_passing = _print_tests(instance, "Newly passing tests:",
+                                         _newly_passing);
+    counts->flaky = _print_flaky(instance);
+    counts->regressed = _print_regressions(instance);
+
+    return _print_libraries(instance);
+}
+
+void chili_compare_destroy(chili_handle handle)
+{
+    struct instance *instance = handle;
+
+    for (int i = 0; i < instance->num_entries; i++){
+        free(instance->entries[i].library);
+        free(instance->entries[i].name);
+    }
+    free(instance->entries);
+    chili_hash_destroy(instance->tests);
+    free(instance);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "handle.h"
+
+
+/* Number of tests in each part of comparison */
+struct chili_compare_counts {
+    /* Succeeded in older run, didn't in newer */
+    int newly_failing;
+    /* Didn't succeed in older run, did in newer */
+    int newly_passing;
+    /* Outcome changed more than once over all runs */
+    int flaky;
+    /* Took longer, used more cpu or more memory in newer run */
+    int regressed;
+};
+
+/**
+ * @brief Creates comparison of runs.
+ *
+ * @param threshold_percent How much more a test may use in the
+ *                          newer run before it has regressed.
+ * @param handle            Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_compare_create(int threshold_percent, chili_handle *handle);
+
+/**
+ * @brief Adds result log of a run to comparison.
+ *
+ * Logs are added oldest first. The last two are compared,
+ * earlier logs only tell which tests are flaky.
+ *
+ * @param results_path Path to result log written by a run.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_compare_add(chili_handle handle, const char *results_path);
+
+/**
+ * @brief Prints how the newest run differs from the one before.
+ *
+ * Prints tests that are newly failing, newly passing, flaky or
+ * have regressed, followed by the time tests run in both runs
+ * took in each library. Cached results aren't compared.
+ *
+ * @param counts Set to number of tests in each part.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_compare_print(chili_handle handle,
+                        struct chili_compare_counts *counts);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_compare_destroy(chili_handle handle);
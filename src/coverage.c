@@ -0,0 +1,730 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <limits.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+
+#include "coverage.h"
+#include "hash.h"
+#include "symbols.h"
+#include "named.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+/* Edges recorded per test, more are dropped */
+#define SLOT_BITS 16
+#define SLOTS     (1 << SLOT_BITS)
+#define MAX_USED  (SLOTS / 4 * 3)
+
+#define INITIAL_CAPACITY 256
+
+/* Types */
+
+/* Shared with test processes, a set of addresses of edges */
+struct recorded {
+    int       used;
+    /* Edges were dropped */
+    bool      full;
+    uintptr_t slots[SLOTS];
+};
+
+struct function {
+    uint64_t address;
+    uint64_t size;
+    char     *name;
+};
+
+/* Loaded library that edges are in */
+struct object {
+    char            *path;
+    chili_handle    symbols;
+    /* Sorted by address */
+    struct function *functions;
+    int             num_functions;
+};
+
+struct test {
+    /* Library and name separated by terminator */
+    char *key;
+    /* Function and offset, like main+0x1f */
+    char **edges;
+    int  num_edges;
+};
+
+/* Edge of tests compared for redundancy */
+struct edge {
+    const char *edge;
+    int        count;
+};
+
+struct instance {
+    char          path[PATH_MAX];
+    struct object *objects;
+    int           num_objects;
+    struct test   *tests;
+    int           num_tests;
+    int           capacity;
+    /* Index of test by library and name */
+    chili_handle  tests_index;
+    bool          changed;
+};
+
+/* Globals */
+static struct recorded *_recorded = NULL;
+
+/* Locals */
+static void _hit(uintptr_t pc)
+{
+    struct recorded *recorded = _recorded;
+    uint64_t i;
+
+    if (recorded == NULL){
+        return;
+    }
+
+    i = (pc * 0x9e3779b97f4a7c15ULL) >> (64 - SLOT_BITS);
+    while (recorded->slots[i] != 0){
+        if (recorded->slots[i] == pc){
+            return;
+        }
+        i = (i + 1) & (SLOTS - 1);
+    }
+
+    if (recorded->used >= MAX_USED){
+        recorded->full = true;
+        return;
+    }
+    recorded->slots[i] = pc;
+    recorded->used++;
+}
+
+static const char *_test_name(const struct test *test)
+{
+    return test->key + strlen(test->key) + 1;
+}
+
+/* Returns test, NULL if not recorded */
+static struct test *_find_test(struct instance *instance,
+                               const char *library,
+                               const char *name)
+{
+    int i = chili_hash_find(instance->tests_index, library, name);
+
+    return i < 0 ? NULL : &instance->tests[i];
+}
+
+static int _grow_tests(struct instance *instance)
+{
+    int capacity = instance->capacity ?
+                   instance->capacity * 2 : INITIAL_CAPACITY;
+    struct test *tests = realloc(instance->tests,
+                                 capacity * sizeof(*tests));
+
+    if (tests == NULL){
+        printf("Unable to grow coverage of tests\n");
+        return -1;
+    }
+    instance->tests = tests;
+    instance->capacity = capacity;
+
+    return 1;
+}
+
+static void _free_edges(struct test *test)
+{
+    for (int i = 0; i < test->num_edges; i++){
+        free(test->edges[i]);
+    }
+    free(test->edges);
+    test->edges = NULL;
+    test->num_edges = 0;
+}
+
+/* Returns test with edges cleared, added if missing */
+static struct test *_set_test(struct instance *instance,
+                              const char *library,
+                              const char *name)
+{
+    size_t length = strlen(library);
+    struct test *test;
+
+    test = _find_test(instance, library, name);
+    if (test == NULL){
+        if (instance->num_tests == instance->capacity &&
+            _grow_tests(instance) < 0){
+            return NULL;
+        }
+        test = &instance->tests[instance->num_tests];
+        memset(test, 0, sizeof(*test));
+        test->key = malloc(length + strlen(name) + 2);
+        if (test->key == NULL){
+            printf("Unable to allocate coverage of test\n");
+            return NULL;
+        }
+        strcpy(test->key, library);
+        strcpy(test->key + length + 1, name);
+        if (chili_hash_add(instance->tests_index, test->key,
+                           _test_name(test), instance->num_tests) < 0){
+            free(test->key);
+            return NULL;
+        }
+        instance->num_tests++;
+    }
+    _free_edges(test);
+
+    return test;
+}
+
+static int _add_edge(struct test *test, int *capacity, const char *edge)
+{
+    char **grown;
+
+    if (test->num_edges == *capacity){
+        *capacity = *capacity ? *capacity * 2 : 64;
+        grown = realloc(test->edges, *capacity * sizeof(char*));
+        if (grown == NULL){
+            printf("Unable to allocate edges\n");
+            return -1;
+        }
+        test->edges = grown;
+    }
+
+    test->edges[test->num_edges] = strdup(edge);
+    if (test->edges[test->num_edges] == NULL){
+        printf("Unable to allocate edges\n");
+        return -1;
+    }
+    test->num_edges++;
+
+    return 1;
+}
+
+static int _by_address(const void *a, const void *b)
+{
+    const struct function *x = a;
+    const struct function *y = b;
+
+    return x->address < y->address ? -1 : x->address > y->address;
+}
+
+static int _by_string(const void *a, const void *b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* Reads functions of loaded library once */
+static struct object *_open_object(struct instance *instance,
+                                   const char *path)
+{
+    struct object *grown;
+    struct object *object;
+    struct function function;
+    int capacity = 0;
+    int index = 0;
+    void *more;
+
+    for (int i = 0; i < instance->num_objects; i++){
+        if (strcmp(instance->objects[i].path, path) == 0){
+            return &instance->objects[i];
+        }
+    }
+
+    grown = realloc(instance->objects,
+                    (instance->num_objects + 1) * sizeof(*grown));
+    if (grown == NULL){
+        printf("Unable to allocate library\n");
+        return NULL;
+    }
+    instance->objects = grown;
+    object = &instance->objects[instance->num_objects];
+    memset(object, 0, sizeof(*object));
+
+    object->path = strdup(path);
+    if (object->path == NULL ||
+        chili_sym_create(path, NULL, &object->symbols) < 0){
+        free(object->path);
+        return NULL;
+    }
+    instance->num_objects++;
+
+    while (chili_sym_next_function(object->symbols, &index,
+                                   &function.name, &function.address,
+                                   &function.size) > 0){
+        if (object->num_functions == capacity){
+            capacity = capacity ? capacity * 2 : 256;
+            more = realloc(object->functions,
+                           capacity * sizeof(function));
+            if (more == NULL){
+                printf("Unable to allocate functions\n");
+                break;
+            }
+            object->functions = more;
+        }
+        object->functions[object->num_functions++] = function;
+    }
+    qsort(object->functions, object->num_functions,
+          sizeof(*object->functions), _by_address);
+
+    return object;
+}
+
+static const struct function *_find_function(const struct object *object,
+                                             uint64_t address)
+{
+    int low = 0;
+    int high = object->num_functions - 1;
+    int middle;
+    const struct function *function;
+
+    /* Last function that starts at or before address */
+    while (low <= high){
+        middle = (low + high) / 2;
+        if (object->functions[middle].address <= address){
+            low = middle + 1;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+    if (high < 0){
+        return NULL;
+    }
+
+    function = &object->functions[high];
+    return address < function->address + function->size ?
+        function : NULL;
+}
+
+/* Names edge by function and offset within it, or by library and
+ * offset within it when function isn't known */
+static int _name_edge(struct instance *instance,
+                      uintptr_t pc,
+                      char *edge,
+                      size_t size)
+{
+    Dl_info info;
+    struct object *object;
+    const struct function *function;
+    uint64_t address;
+    const char *base;
+
+    if (dladdr((void*)pc, &info) == 0 || info.dli_fname == NULL){
+        return 0;
+    }
+    address = pc - (uintptr_t)info.dli_fbase;
+
+    object = _open_object(instance, info.dli_fname);
+    function = object ? _find_function(object, address) : NULL;
+    if (function){
+        snprintf(edge, size, "%s+0x%" PRIx64, function->name,
+                 address - function->address);
+    }
+    else {
+        base = strrchr(info.dli_fname, '/');
+        snprintf(edge, size, "%s+0x%" PRIx64,
+                 base ? base + 1 : info.dli_fname, address);
+    }
+
+    return 1;
+}
+
+static int _load(struct instance *instance)
+{
+    char *line = NULL;
+    size_t length = 0;
+    char *library;
+    char *name;
+    char *edge;
+    char *next;
+    struct test *test;
+    int capacity;
+    int r = 1;
+    FILE *f;
+
+    f = fopen(instance->path, "r");
+    if (f == NULL){
+        debug_print("No coverage in %s\n", instance->path);
+        return 1;
+    }
+
+    /* Lines look like: library:name edge edge... */
+    while (r > 0 && getline(&line, &length, f) > 0){
+        line[strcspn(line, "\n")] = '\0';
+        next = strchr(line, ' ');
+        if (next){
+            *next++ = '\0';
+        }
+        if (chili_named_parse(line, &library, &name) < 0){
+            continue;
+        }
+        test = _set_test(instance, library, name);
+        if (test == NULL){
+            r = -1;
+            break;
+        }
+
+        capacity = 0;
+        while (r > 0 && next && *next){
+            edge = next;
+            next = strchr(next, ' ');
+            if (next){
+                *next++ = '\0';
+            }
+            r = _add_edge(test, &capacity, edge);
+        }
+    }
+
+    free(line);
+    fclose(f);
+    return r;
+}
+
+static int _save(struct instance *instance)
+{
+    char temp_path[PATH_MAX + 16];
+    struct test *test;
+    FILE *f;
+
+    /* Write whole file before replacing the old one */
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", instance->path);
+    f = fopen(temp_path, "w");
+    if (f == NULL){
+        printf("Failed to save coverage to %s: %s\n",
+               temp_path, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < instance->num_tests; i++){
+        test = &instance->tests[i];
+        fprintf(f, "%s:%s", test->key, _test_name(test));
+        for (int j = 0; j < test->num_edges; j++){
+            fprintf(f, " %s", test->edges[j]);
+        }
+        fprintf(f, "\n");
+    }
+
+    if (fclose(f) != 0 || rename(temp_path, instance->path) < 0){
+        printf("Failed to save coverage to %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+/* Returns entry of edge or the free entry where it belongs */
+static struct edge *_find_edge(struct edge *edges,
+                               int capacity,
+                               const char *edge)
+{
+    int mask = capacity - 1;
+    int i = chili_hash_fnv64(CHILI_HASH_FNV_OFFSET, edge,
+                             strlen(edge)) & mask;
+
+    while (edges[i].edge && strcmp(edges[i].edge, edge) != 0){
+        i = (i + 1) & mask;
+    }
+
+    return &edges[i];
+}
+
+static bool _in(const char *library, const char **libraries, int count)
+{
+    for (int i = 0; i < count; i++){
+        if (strcmp(library, libraries[i]) == 0){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int _by_edges(const void *a, const void *b)
+{
+    const struct test *x = *(const struct test* const*)a;
+    const struct test *y = *(const struct test* const*)b;
+    int r = x->num_edges - y->num_edges;
+
+    if (r == 0){
+        r = strcmp(x->key, y->key);
+    }
+    if (r == 0){
+        r = strcmp(_test_name(x), _test_name(y));
+    }
+
+    return r;
+}
+
+/* Exports */
+
+/* Called by code built with -fsanitize-coverage=trace-pc-guard when
+ * it is loaded, guards are non-zero until edges are left out */
+void __sanitizer_cov_trace_pc_guard_init(uint32_t *start, uint32_t *stop)
+{
+    if (start == stop || *start){
+        return;
+    }
+
+    for (uint32_t *guard = start; guard < stop; guard++){
+        *guard = 1;
+    }
+}
+
+/* Called on every edge by code built with trace-pc-guard */
+void __sanitizer_cov_trace_pc_guard(uint32_t *guard)
+{
+    if (*guard){
+        _hit((uintptr_t)__builtin_return_address(0));
+    }
+}
+
+/* Called on every edge by code built with trace-pc, like gcc does */
+void __sanitizer_cov_trace_pc(void)
+{
+    _hit((uintptr_t)__builtin_return_address(0));
+}
+
+int chili_coverage_begin(void)
+{
+    void *shared;
+
+    if (_recorded){
+        return 1;
+    }
+
+    shared = mmap(NULL, sizeof(*_recorded), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED){
+        printf("Failed to map coverage: %s\n", strerror(errno));
+        return -1;
+    }
+    _recorded = shared;
+
+    return 1;
+}
+
+void chili_coverage_reset(void)
+{
+    if (_recorded == NULL || _recorded->used == 0){
+        return;
+    }
+
+    memset(_recorded->slots, 0, sizeof(_recorded->slots));
+    _recorded->used = 0;
+    _recorded->full = false;
+}
+
+void chili_coverage_hit(uintptr_t pc)
+{
+    _hit(pc);
+}
+
+int chili_coverage_create(const char *path, chili_handle *handle)
+{
+    struct instance *instance;
+
+    if (strlen(path) >= sizeof(instance->path)){
+        printf("Path to coverage is too long\n");
+        return -1;
+    }
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL){
+        printf("Failed to allocate instance\n");
+        return -1;
+    }
+    strcpy(instance->path, path);
+
+    if (chili_hash_create(&instance->tests_index) < 0 ||
+        _load(instance) < 0){
+        chili_coverage_destroy(instance);
+        return -1;
+    }
+    /* Nothing to save unless recorded */
+    instance->changed = false;
+
+    *handle = instance;
+
+    return 1;
+}
+
+int chili_coverage_record(chili_handle handle,
+                          const char *library,
+                          const char *name)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct test *test;
+    char edge[512];
+    size_t length = strlen(name);
+    int capacity = 0;
+    int r = 1;
+
+    if (_recorded == NULL){
+        return 1;
+    }
+    if (_recorded->full){
+        printf("Coverage of %s:%s is incomplete, more than %d edges\n",
+               library, name, MAX_USED);
+    }
+
+    test = _set_test(instance, library, name);
+    if (test == NULL){
+        return -1;
+    }
+    instance->changed = true;
+
+    for (int i = 0; r > 0 && i < SLOTS; i++){
+        if (_recorded->slots[i] == 0 ||
+            _name_edge(instance, _recorded->slots[i],
+                       edge, sizeof(edge)) <= 0){
+            continue;
+        }
+        /* Only the test itself reaches its own code */
+        if (strncmp(edge, name, length) == 0 && edge[length] == '+'){
+            continue;
+        }
+        r = _add_edge(test, &capacity, edge);
+    }
+    qsort(test->edges, test->num_edges, sizeof(char*), _by_string);
+    debug_print("Recorded %d edges of %s:%s\n", test->num_edges,
+                library, name);
+
+    chili_coverage_reset();
+
+    return r;
+}
+
+bool chili_coverage_recorded(chili_handle handle,
+                             const char *library,
+                             const char *name)
+{
+    const struct test *test = _find_test(handle, library, name);
+
+    /* Library wasn't built with coverage */
+    return test != NULL && test->num_edges > 0;
+}
+
+bool chili_coverage_reaches(chili_handle handle,
+                            const char *library,
+                            const char *name,
+                            const char *function)
+{
+    const struct test *test = _find_test(handle, library, name);
+    size_t length = strlen(function);
+
+    for (int i = 0; test && i < test->num_edges; i++){
+        if (strncmp(test->edges[i], function, length) == 0 &&
+            test->edges[i][length] == '+'){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int chili_coverage_redundant(chili_handle handle,
+                             const char **libraries,
+                             int num_libraries,
+                             chili_coverage_visit visit,
+                             void *context)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct test **tests;
+    struct edge *edges = NULL;
+    struct edge *edge;
+    int num_tests = 0;
+    int num_edges = 0;
+    int capacity = 1;
+    bool redundant;
+    int r = 1;
+
+    tests = malloc((instance->num_tests + 1) * sizeof(*tests));
+    if (tests == NULL){
+        printf("Unable to allocate tests\n");
+        return -1;
+    }
+    for (int i = 0; i < instance->num_tests; i++){
+        if (instance->tests[i].num_edges > 0 &&
+            _in(instance->tests[i].key, libraries, num_libraries)){
+            tests[num_tests++] = &instance->tests[i];
+            num_edges += instance->tests[i].num_edges;
+        }
+    }
+    qsort(tests, num_tests, sizeof(*tests), _by_edges);
+
+    /* Kept at most half full */
+    while (capacity < num_edges * 2){
+        capacity *= 2;
+    }
+    edges = calloc(capacity, sizeof(*edges));
+    if (edges == NULL){
+        printf("Unable to allocate edges\n");
+        free(tests);
+        return -1;
+    }
+
+    /* Number of tests that reach each edge */
+    for (int i = 0; i < num_tests; i++){
+        for (int j = 0; j < tests[i]->num_edges; j++){
+            edge = _find_edge(edges, capacity, tests[i]->edges[j]);
+            edge->edge = tests[i]->edges[j];
+            edge->count++;
+        }
+    }
+
+    for (int i = 0; r > 0 && i < num_tests; i++){
+        redundant = true;
+        for (int j = 0; redundant && j < tests[i]->num_edges; j++){
+            edge = _find_edge(edges, capacity, tests[i]->edges[j]);
+            redundant = edge->count > 1;
+        }
+        if (!redundant){
+            continue;
+        }
+
+        /* Left out when looking at the rest */
+        for (int j = 0; j < tests[i]->num_edges; j++){
+            _find_edge(edges, capacity, tests[i]->edges[j])->count--;
+        }
+        r = visit(context, tests[i]->key, _test_name(tests[i]));
+    }
+
+    free(edges);
+    free(tests);
+
+    return r < 0 ? r : 1;
+}
+
+void chili_coverage_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    if (instance->changed){
+        _save(instance);
+    }
+
+    for (int i = 0; i < instance->num_tests; i++){
+        _free_edges(&instance->tests[i]);
+        free(instance->tests[i].key);
+    }
+    free(instance->tests);
+    if (instance->tests_index){
+        chili_hash_destroy(instance->tests_index);
+    }
+    for (int i = 0; i < instance->num_objects; i++){
+        chili_sym_destroy(instance->objects[i].symbols);
+        free(instance->objects[i].functions);
+        free(instance->objects[i].path);
+    }
+    free(instance->objects);
+    free(instance);
+}
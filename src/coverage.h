@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "handle.h"
+
+/**
+ * @brief Called for each redundant test.
+ *
+ * @return Negative to stop with error.
+ *         Positive to continue.
+ */
+typedef int (*chili_coverage_visit)(void *context,
+                                    const char *library,
+                                    const char *name);
+
+/**
+ * @brief Starts recording coverage of code built with
+ *        -fsanitize-coverage=trace-pc-guard or trace-pc.
+ *
+ * Chili exports the callbacks that instrumented code calls.
+ * Edges are recorded in memory shared with test processes
+ * forked after this call, until then callbacks do nothing.
+ * Tests must be run one at a time.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_coverage_begin(void);
+
+/**
+ * @brief Forgets recorded edges, done before each test.
+ */
+void chili_coverage_reset(void);
+
+/**
+ * @brief Records edge, like the callbacks do.
+ *
+ * @param pc Address of code in a loaded library.
+ */
+void chili_coverage_hit(uintptr_t pc);
+
+/**
+ * @brief Creates store of coverage of tests.
+ *
+ * Edges are stored by function and offset within it, so
+ * coverage of a test is valid until its library is rebuilt
+ * and tests can be selected by the functions they reach.
+ *
+ * @param path   File that coverage is loaded from and saved
+ *               to.
+ * @param handle Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_coverage_create(const char *path, chili_handle *handle);
+
+/**
+ * @brief Stores edges recorded since last reset as coverage of
+ *        test, replacing coverage of an earlier run.
+ *
+ * Edges in the test function itself are left out, no other
+ * test reaches them.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_coverage_record(chili_handle handle,
+                          const char *library,
+                          const char *name);
+
+/**
+ * @brief Checks if coverage of test is stored, tests that
+ *        reached no instrumented code have none.
+ */
+bool chili_coverage_recorded(chili_handle handle,
+                             const char *library,
+                             const char *name);
+
+/**
+ * @brief Checks if test reached function when its coverage was
+ *        recorded.
+ */
+bool chili_coverage_reaches(chili_handle handle,
+                            const char *library,
+                            const char *name,
+                            const char *function);
+
+/**
+ * @brief Visits tests that add no edges to the coverage of the
+ *        other tests in libraries.
+ *
+ * Tests without coverage are never visited. Tests with the
+ * fewest edges are visited first and are left out when looking
+ * at the rest, so of two tests with the same coverage only one
+ * is visited.
+ *
+ * @param libraries     Libraries whose tests are compared.
+ * @param num_libraries Number of entries in array.
+ *
+ * @return Negative on error or when visit returns negative.
+ *         Positive on success.
+ */
+int chili_coverage_redundant(chili_handle handle,
+                             const char **libraries,
+                             int num_libraries,
+                             chili_coverage_visit visit,
+                             void *context);
+
+/**
+ * @brief Saves coverage of tests and frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_coverage_destroy(chili_handle handle);
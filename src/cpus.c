@@ -0,0 +1,259 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+
+#include "cpus.h"
+#include "cgroup.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Throttled in more than this fraction of periods is too much */
+#define THROTTLED_LIMIT 0.1
+
+#define TOPOLOGY_PATH "/sys/devices/system/cpu/cpu%d/topology/%s"
+
+/* Types */
+struct lowest_quota {
+    int  cpus;
+    char path[PATH_MAX];
+};
+
+
+/* Locals */
+static void _visit_max(void *context, const char *path, const char *content)
+{
+    struct lowest_quota *lowest = context;
+    int cpus = chili_cpus_parse_max(content);
+
+    if (cpus > 0 && (lowest->cpus == 0 || cpus < lowest->cpus)){
+        lowest->cpus = cpus;
+        snprintf(lowest->path, sizeof(lowest->path), "%s", path);
+    }
+}
+
+/* Finds the cgroup, among this process cgroup and its parents,
+ * with the lowest cpu quota. Number of cpus is zero if there
+ * is none. */
+static void _limiting_cgroup(struct lowest_quota *lowest)
+{
+    lowest->cpus = 0;
+    chili_cgroup_walk("cpu.max", _visit_max, lowest);
+}
+
+/* Reads a number from topology of cpu, -1 if unknown */
+static int _read_topology(int cpu, const char *file)
+{
+    char path[128];
+    FILE *f;
+    int value;
+
+    snprintf(path, sizeof(path), TOPOLOGY_PATH, cpu, file);
+    f = fopen(path, "r");
+    if (f == NULL){
+        return -1;
+    }
+    if (fscanf(f, "%d", &value) != 1){
+        value = -1;
+    }
+    fclose(f);
+
+    return value;
+}
+
+static int _by_placement(const void *a, const void *b)
+{
+    const struct chili_cpus_topology *x = a;
+    const struct chili_cpus_topology *y = b;
+
+    if (x->thread != y->thread){
+        return x->thread - y->thread;
+    }
+    if (x->package != y->package){
+        return x->package - y->package;
+    }
+    if (x->core != y->core){
+        return x->core - y->core;
+    }
+    return x->cpu - y->cpu;
+}
+
+
+/* Exports */
+int chili_cpus_parse_max(const char *content)
+{
+    unsigned long long quota;
+    unsigned long long period;
+    char max[4];
+
+    if (sscanf(content, "%3s %llu", max, &period) == 2 &&
+        strcmp(max, "max") == 0){
+        return 0;
+    }
+    if (sscanf(content, "%llu %llu", &quota, &period) != 2 ||
+        period == 0){
+        return -1;
+    }
+
+    /* Half a cpu still needs one */
+    return (int)((quota + period - 1) / period);
+}
+
+int chili_cpus_parse_stat(const char *content,
+                          struct chili_cpus_throttling *throttling)
+{
+    const char *periods = strstr(content, "nr_periods ");
+    const char *throttled = strstr(content, "nr_throttled ");
+
+    if (periods == NULL || throttled == NULL){
+        return -1;
+    }
+
+    throttling->periods = strtoull(periods + strlen("nr_periods "),
+                                   NULL, 10);
+    throttling->throttled = strtoull(throttled + strlen("nr_throttled "),
+                                     NULL, 10);
+
+    return 1;
+}
+
+int chili_cpus_available()
+{
+    cpu_set_t set;
+    struct lowest_quota lowest;
+    int cpus;
+
+    if (sched_getaffinity(0, sizeof(set), &set) < 0){
+        debug_print("Unable to get affinity\n");
+        return -1;
+    }
+    cpus = CPU_COUNT(&set);
+
+    _limiting_cgroup(&lowest);
+    if (lowest.cpus > 0 && lowest.cpus < cpus){
+        debug_print("Limited to %d cpus by %s\n", lowest.cpus, lowest.path);
+        cpus = lowest.cpus;
+    }
+
+    return cpus > 0 ? cpus : 1;
+}
+
+int chili_cpus_throttling(struct chili_cpus_throttling *throttling)
+{
+    struct lowest_quota lowest;
+    char content[512];
+
+    _limiting_cgroup(&lowest);
+    if (lowest.cpus == 0 ||
+        chili_cgroup_read(lowest.path, "cpu.stat",
+                          content, sizeof(content)) < 0){
+        return 0;
+    }
+
+    return chili_cpus_parse_stat(content, throttling);
+}
+
+int chili_cpus_adapt(const struct chili_cpus_throttling *before,
+                     const struct chili_cpus_throttling *after,
+                     int jobs,
+                     int max_jobs)
+{
+    uint64_t periods = after->periods - before->periods;
+    uint64_t throttled = after->throttled - before->throttled;
+
+    if (periods > 0 && throttled > periods * THROTTLED_LIMIT){
+        jobs--;
+    }
+    else if (throttled == 0){
+        jobs++;
+    }
+
+    if (jobs > max_jobs){
+        jobs = max_jobs;
+    }
+    return jobs < 1 ? 1 : jobs;
+}
+
+int chili_cpus_topology(struct chili_cpus_topology *cpus, int max)
+{
+    cpu_set_t set;
+    int count = 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) < 0){
+        printf("Failed to get cpu affinity: %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++){
+        if (!CPU_ISSET(cpu, &set)){
+            continue;
+        }
+        cpus[count].cpu = cpu;
+        cpus[count].package = _read_topology(cpu, "physical_package_id");
+        cpus[count].core = _read_topology(cpu, "core_id");
+        cpus[count].thread = 0;
+        /* Not known to share its core with any other cpu */
+        if (cpus[count].core < 0){
+            cpus[count].core = cpu;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+void chili_cpus_place(struct chili_cpus_topology *cpus, int count)
+{
+    for (int i = 0; i < count; i++){
+        cpus[i].thread = 0;
+        for (int j = 0; cpus[i].core >= 0 && j < count; j++){
+            if (cpus[j].package == cpus[i].package &&
+                cpus[j].core == cpus[i].core &&
+                cpus[j].cpu < cpus[i].cpu){
+                cpus[i].thread++;
+            }
+        }
+    }
+
+    qsort(cpus, count, sizeof(*cpus), _by_placement);
+}
+
+int chili_cpus_pin(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0){
+        printf("Failed to pin to cpu %d: %s\n", cpu, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+int chili_cpus_pinned()
+{
+    cpu_set_t set;
+
+    if (sched_getaffinity(0, sizeof(set), &set) < 0 ||
+        CPU_COUNT(&set) != 1){
+        return -1;
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+        if (CPU_ISSET(cpu, &set)){
+            return cpu;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+
+
+/**
+ * @brief Cfs throttling counters of a cgroup.
+ */
+struct chili_cpus_throttling {
+    /* Number of enforcement periods that has elapsed */
+    uint64_t periods;
+    /* Number of those periods the cgroup was throttled in */
+    uint64_t throttled;
+};
+
+/**
+ * @brief Where a cpu is in the machine.
+ */
+struct chili_cpus_topology {
+    int cpu;
+    /* Socket */
+    int package;
+    /* Physical core within socket */
+    int core;
+    /* Order among SMT siblings of core, 0 for the first */
+    int thread;
+};
+
+/**
+ * @brief Number of cpus this process can make use of.
+ *
+ * Smallest of the number of cpus in the affinity mask and
+ * the cgroup v2 cpu.max quota of this process and its parent
+ * cgroups, rounded up. A container limited to four cpus on a
+ * large machine gets four.
+ *
+ * @return Negative on error, otherwise number of cpus.
+ */
+int chili_cpus_available();
+
+/**
+ * @brief Parses content of a cgroup v2 cpu.max file.
+ *
+ * @param content Content like "400000 100000" or "max 100000".
+ *
+ * @return Negative on error.
+ *         Zero when there is no quota.
+ *         Otherwise number of cpus the quota allows, rounded up.
+ */
+int chili_cpus_parse_max(const char *content);
+
+/**
+ * @brief Parses content of a cgroup v2 cpu.stat file.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_cpus_parse_stat(const char *content,
+                          struct chili_cpus_throttling *throttling);
+
+/**
+ * @brief Reads throttling counters of the cgroup that limits cpu.
+ *
+ * @return Negative on error.
+ *         Zero when there is no cpu.stat to read.
+ *         Positive on success.
+ */
+int chili_cpus_throttling(struct chili_cpus_throttling *throttling);
+
+/**
+ * @brief Adapts number of jobs to throttling since last sample.
+ *
+ * Lowers number of jobs by one when throttled in more than a
+ * tenth of the periods, raises it by one when not throttled at
+ * all.
+ *
+ * @param before   Counters at last sample.
+ * @param after    Counters now.
+ * @param jobs     Current number of jobs.
+ * @param max_jobs Never more jobs than this.
+ *
+ * @return New number of jobs, at least one.
+ */
+int chili_cpus_adapt(const struct chili_cpus_throttling *before,
+                     const struct chili_cpus_throttling *after,
+                     int jobs,
+                     int max_jobs);
+
+/**
+ * @brief Reads topology of the cpus this process may run on.
+ *
+ * Reads socket and core of each cpu in the affinity mask from
+ * /sys/devices/system/cpu. Thread is not set. Socket is -1 when
+ * unknown, a cpu whose core is unknown gets its number as core.
+ *
+ * @param cpus Set to topology of each cpu.
+ * @param max  Max number of cpus to read.
+ *
+ * @return Negative on error, otherwise number of cpus read.
+ */
+int chili_cpus_topology(struct chili_cpus_topology *cpus, int max);
+
+/**
+ * @brief Orders cpus in the order they should be used.
+ *
+ * One cpu of each physical core comes first, filling one
+ * socket before the next. SMT siblings of those come last,
+ * in the same order. Sets thread of each cpu, a cpu whose core
+ * is negative has no siblings.
+ */
+void chili_cpus_place(struct chili_cpus_topology *cpus, int count);
+
+/**
+ * @brief Pins this process to one cpu.
+ *
+ * Processes forked after this call, and programs executed,
+ * are pinned as well.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_cpus_pin(int cpu);
+
+/**
+ * @brief Returns the cpu this process is pinned to.
+ *
+ * @return Negative when this process may run on more than one
+ *         cpu, otherwise the cpu.
+ */
+int chili_cpus_pinned();
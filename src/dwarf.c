@@ -0,0 +1,718 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dwarf.h"
+#include "symbols.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Standard opcodes of line number program */
+#define DW_LNS_copy             1
+#define DW_LNS_advance_pc       2
+#define DW_LNS_advance_line     3
+#define DW_LNS_const_add_pc     8
+#define DW_LNS_fixed_advance_pc 9
+
+/* Extended opcodes of line number program */
+#define DW_LNE_end_sequence 1
+#define DW_LNE_set_address  2
+
+/* Content of directory and file entries, DWARF 5 */
+#define DW_LNCT_path            1
+#define DW_LNCT_directory_index 2
+
+/* Forms of directory and file entries, DWARF 5 */
+#define DW_FORM_data2     0x05
+#define DW_FORM_data4     0x06
+#define DW_FORM_data8     0x07
+#define DW_FORM_string    0x08
+#define DW_FORM_block     0x09
+#define DW_FORM_data1     0x0b
+#define DW_FORM_strp      0x0e
+#define DW_FORM_udata     0x0f
+#define DW_FORM_data16    0x1e
+#define DW_FORM_line_strp 0x1f
+
+/* Directory and file entry formats, DWARF 5 */
+#define MAX_FORMATS 16
+
+/* Types */
+
+/* Position in a section, little endian only like symbols.c */
+struct cursor {
+    const unsigned char *at;
+    const unsigned char *end;
+    /* Read past end or unsupported content */
+    bool                bad;
+};
+
+struct section {
+    const char *contents;
+    uint64_t   size;
+};
+
+/* Compilation unit, as seen by .debug_line */
+struct unit {
+    char **files;
+    int  num_files;
+};
+
+/* Addresses of a sequence of code in unit */
+struct range {
+    uint64_t low;
+    uint64_t high;
+    int      unit;
+};
+
+struct format {
+    uint64_t content;
+    uint64_t form;
+};
+
+struct instance {
+    chili_handle   symbols;
+    struct section line_str;
+    struct section str;
+    struct unit    *units;
+    int            num_units;
+    struct range   *ranges;
+    int            num_ranges;
+    int            capacity;
+};
+
+/* Locals */
+static uint64_t _read(struct cursor *c, int size)
+{
+    uint64_t value = 0;
+
+    if (c->end - c->at < size){
+        c->bad = true;
+        c->at = c->end;
+        return 0;
+    }
+    for (int i = 0; i < size; i++){
+        value |= (uint64_t)c->at[i] << (8 * i);
+    }
+    c->at += size;
+
+    return value;
+}
+
+static uint64_t _uleb(struct cursor *c)
+{
+    uint64_t value = 0;
+    int shift = 0;
+    unsigned char byte;
+
+    do {
+        if (c->at >= c->end){
+            c->bad = true;
+            return 0;
+        }
+        byte = *c->at++;
+        if (shift < 64){
+            value |= (uint64_t)(byte & 0x7f) << shift;
+        }
+        shift += 7;
+    } while (byte & 0x80);
+
+    return value;
+}
+
+static int64_t _sleb(struct cursor *c)
+{
+    int64_t value = 0;
+    int shift = 0;
+    unsigned char byte;
+
+    do {
+        if (c->at >= c->end){
+            c->bad = true;
+            return 0;
+        }
+        byte = *c->at++;
+        if (shift < 64){
+            value |= (int64_t)(byte & 0x7f) << shift;
+        }
+        shift += 7;
+    } while (byte & 0x80);
+
+    if (shift < 64 && (byte & 0x40)){
+        value |= -((int64_t)1 << shift);
+    }
+
+    return value;
+}
+
+static void _skip(struct cursor *c, uint64_t size)
+{
+    if ((uint64_t)(c->end - c->at) < size){
+        c->bad = true;
+        c->at = c->end;
+        return;
+    }
+    c->at += size;
+}
+
+/* Terminated string at cursor */
+static const char *_string(struct cursor *c)
+{
+    const char *string = (const char*)c->at;
+    const unsigned char *terminator = memchr(c->at, 0, c->end - c->at);
+
+    if (terminator == NULL){
+        c->bad = true;
+        c->at = c->end;
+        return "";
+    }
+    c->at = terminator + 1;
+
+    return string;
+}
+
+/* Terminated string at offset in string section */
+static const char *_string_at(struct cursor *c,
+                              const struct section *section,
+                              uint64_t offset)
+{
+    if (offset >= section->size ||
+        memchr(section->contents + offset, 0,
+               section->size - offset) == NULL){
+        c->bad = true;
+        return "";
+    }
+
+    return section->contents + offset;
+}
+
+/* Joins directory and path unless path is absolute */
+static char *_join(const char *dir, const char *path)
+{
+    char *joined;
+
+    if (path[0] == '/' || dir[0] == '\0'){
+        return strdup(path);
+    }
+
+    joined = malloc(strlen(dir) + strlen(path) + 2);
+    if (joined != NULL){
+        sprintf(joined, "%s/%s", dir, path);
+    }
+
+    return joined;
+}
+
+static int _add_file(struct unit *unit, char *path)
+{
+    char **grown;
+
+    if (path == NULL){
+        printf("Unable to allocate source file\n");
+        return -1;
+    }
+
+    grown = realloc(unit->files, (unit->num_files + 1) * sizeof(char*));
+    if (grown == NULL){
+        printf("Unable to allocate source file\n");
+        free(path);
+        return -1;
+    }
+    unit->files = grown;
+    unit->files[unit->num_files++] = path;
+
+    return 1;
+}
+
+static int _add_range(struct instance *instance,
+                      uint64_t low, uint64_t high)
+{
+    struct range *grown;
+    int capacity;
+
+    /* Code that the linker discarded */
+    if (low == 0 || high <= low){
+        return 1;
+    }
+
+    if (instance->num_ranges == instance->capacity){
+        capacity = instance->capacity ? instance->capacity * 2 : 64;
+        grown = realloc(instance->ranges, capacity * sizeof(*grown));
+        if (grown == NULL){
+            printf("Unable to allocate address ranges\n");
+            return -1;
+        }
+        instance->ranges = grown;
+        instance->capacity = capacity;
+    }
+
+    instance->ranges[instance->num_ranges++] = (struct range){
+        .low = low,
+        .high = high,
+        .unit = instance->num_units - 1,
+    };
+
+    return 1;
+}
+
+/* Reads entry formats of directory or file table, DWARF 5 */
+static int _read_formats(struct cursor *c, struct format *formats)
+{
+    int count = _read(c, 1);
+
+    if (count > MAX_FORMATS){
+        c->bad = true;
+        return 0;
+    }
+    for (int i = 0; i < count; i++){
+        formats[i].content = _uleb(c);
+        formats[i].form = _uleb(c);
+    }
+
+    return count;
+}
+
+/* Reads path and directory index of directory or file entry,
+ * DWARF 5 */
+static void _read_entry(struct instance *instance,
+                        struct cursor *c,
+                        const struct format *formats,
+                        int num_formats,
+                        int offset_size,
+                        const char **path,
+                        uint64_t *dir)
+{
+    const char *string = NULL;
+    uint64_t value = 0;
+
+    *path = "";
+    *dir = 0;
+
+    for (int i = 0; i < num_formats; i++){
+        switch (formats[i].form){
+        case DW_FORM_string:
+            string = _string(c);
+            break;
+        case DW_FORM_line_strp:
+            string = _string_at(c, &instance->line_str,
+                                _read(c, offset_size));
+            break;
+        case DW_FORM_strp:
+            string = _string_at(c, &instance->str,
+                                _read(c, offset_size));
+            break;
+        case DW_FORM_udata:
+            value = _uleb(c);
+            break;
+        case DW_FORM_data1:
+            value = _read(c, 1);
+            break;
+        case DW_FORM_data2:
+            value = _read(c, 2);
+            break;
+        case DW_FORM_data4:
+            value = _read(c, 4);
+            break;
+        case DW_FORM_data8:
+            value = _read(c, 8);
+            break;
+        case DW_FORM_data16:
+            _skip(c, 16);
+            break;
+        case DW_FORM_block:
+            _skip(c, _uleb(c));
+            break;
+        default:
+            debug_print("Unsupported form: %lu\n", formats[i].form);
+            c->bad = true;
+            return;
+        }
+
+        if (formats[i].content == DW_LNCT_path && string != NULL){
+            *path = string;
+        }
+        else if (formats[i].content == DW_LNCT_directory_index){
+            *dir = value;
+        }
+        string = NULL;
+    }
+}
+
+/* Reads directory and file tables, DWARF 5 */
+static int _read_tables_5(struct instance *instance,
+                          struct cursor *c,
+                          int offset_size,
+                          struct unit *unit)
+{
+    struct format formats[MAX_FORMATS];
+    int num_formats;
+    const char **dirs;
+    uint64_t num_dirs;
+    uint64_t num_files;
+    const char *path;
+    uint64_t dir;
+    int r = 1;
+
+    num_formats = _read_formats(c, formats);
+    num_dirs = _uleb(c);
+    if (c->bad || num_dirs > (uint64_t)(c->end - c->at)){
+        return -1;
+    }
+    dirs = calloc(num_dirs + 1, sizeof(*dirs));
+    if (dirs == NULL){
+        printf("Unable to allocate directories\n");
+        return -1;
+    }
+    for (uint64_t i = 0; i < num_dirs; i++){
+        _read_entry(instance, c, formats, num_formats, offset_size,
+                    &dirs[i], &dir);
+    }
+
+    num_formats = _read_formats(c, formats);
+    num_files = _uleb(c);
+    for (uint64_t i = 0; r > 0 && !c->bad && i < num_files; i++){
+        char *dir_path;
+
+        _read_entry(instance, c, formats, num_formats, offset_size,
+                    &path, &dir);
+        /* Directories after the first are relative to it, the
+         * directory of compilation */
+        dir_path = _join(dir > 0 && dir < num_dirs ? dirs[0] : "",
+                         dir < num_dirs ? dirs[dir] : "");
+        if (dir_path == NULL){
+            printf("Unable to allocate source file\n");
+            r = -1;
+            break;
+        }
+        r = _add_file(unit, _join(dir_path, path));
+        free(dir_path);
+    }
+    free(dirs);
+
+    return c->bad ? -1 : r;
+}
+
+/* Reads include directory and file name tables, DWARF 2 to 4.
+ * Directory of compilation is not in .debug_line, files in it
+ * are left relative. */
+static int _read_tables(struct cursor *c, struct unit *unit)
+{
+    const char *dirs[256];
+    int num_dirs = 0;
+    const char *path;
+    uint64_t dir;
+    int r = 1;
+
+    dirs[num_dirs++] = "";
+    while (!c->bad && *(path = _string(c)) != '\0'){
+        if (num_dirs < (int)(sizeof(dirs) / sizeof(dirs[0]))){
+            dirs[num_dirs++] = path;
+        }
+    }
+
+    while (r > 0 && !c->bad && *(path = _string(c)) != '\0'){
+        dir = _uleb(c);
+        /* Modification time and length */
+        _uleb(c);
+        _uleb(c);
+        r = _add_file(unit, _join(dir < (uint64_t)num_dirs ?
+                                  dirs[dir] : "", path));
+    }
+
+    return c->bad ? -1 : r;
+}
+
+/* Runs line number program only to find which addresses the
+ * unit has code at, one range per sequence */
+static int _run_program(struct instance *instance,
+                        struct cursor *c,
+                        int min_length,
+                        int line_range,
+                        int opcode_base,
+                        const unsigned char *lengths)
+{
+    uint64_t address = 0;
+    uint64_t low = 0;
+    bool in_sequence = false;
+    unsigned char opcode;
+    uint64_t length;
+    const unsigned char *next;
+    int r = 1;
+
+    while (r > 0 && !c->bad && c->at < c->end){
+        opcode = _read(c, 1);
+
+        if (opcode >= opcode_base){
+            /* Special opcode, appends a row */
+            address += ((opcode - opcode_base) / line_range) * min_length;
+        }
+        else if (opcode == 0){
+            length = _uleb(c);
+            if (length == 0 || length > (uint64_t)(c->end - c->at)){
+                c->bad = true;
+                break;
+            }
+            next = c->at + length;
+            opcode = _read(c, 1);
+            if (opcode == DW_LNE_end_sequence){
+                if (in_sequence){
+                    r = _add_range(instance, low, address);
+                }
+                in_sequence = false;
+                address = 0;
+            }
+            else if (opcode == DW_LNE_set_address){
+                address = _read(c, length - 1 > 8 ? 8 : length - 1);
+            }
+            c->at = next;
+            /* Only rows mark code of sequence */
+            continue;
+        }
+        else {
+            switch (opcode){
+            case DW_LNS_copy:
+                break;
+            case DW_LNS_advance_pc:
+                address += _uleb(c) * min_length;
+                continue;
+            case DW_LNS_advance_line:
+                _sleb(c);
+                continue;
+            case DW_LNS_const_add_pc:
+                address += ((255 - opcode_base) / line_range) * min_length;
+                continue;
+            case DW_LNS_fixed_advance_pc:
+                address += _read(c, 2);
+                continue;
+            default:
+                /* Operands of any other opcode are skipped */
+                for (int i = 0; i < lengths[opcode - 1]; i++){
+                    _uleb(c);
+                }
+                continue;
+            }
+        }
+
+        /* A row was appended */
+        if (!in_sequence){
+            low = address;
+            in_sequence = true;
+        }
+    }
+
+    return c->bad ? -1 : r;
+}
+
+/* Reads one unit of .debug_line, cursor is moved to the next */
+static int _read_unit(struct instance *instance, struct cursor *c)
+{
+    struct cursor program;
+    struct cursor header;
+    struct unit *grown;
+    struct unit *unit;
+    uint64_t length;
+    uint64_t header_length;
+    int offset_size = 4;
+    int version;
+    int min_length;
+    int line_range;
+    int opcode_base;
+    const unsigned char *lengths;
+    int r;
+
+    length = _read(c, 4);
+    if (length == 0xffffffff){
+        length = _read(c, 8);
+        offset_size = 8;
+    }
+    if (c->bad || length > (uint64_t)(c->end - c->at)){
+        printf("Line number information is truncated\n");
+        return -1;
+    }
+    program.at = c->at + length;
+    program.end = program.at;
+    program.bad = false;
+    header = (struct cursor){ .at = c->at, .end = program.at };
+    c->at = program.at;
+
+    version = _read(&header, 2);
+    if (version < 2 || version > 5){
+        printf("Unsupported line number version %d\n", version);
+        return -1;
+    }
+    if (version >= 5){
+        /* Address and segment selector size */
+        _skip(&header, 2);
+    }
+    header_length = _read(&header, offset_size);
+    if (header_length > (uint64_t)(header.end - header.at)){
+        printf("Line number header is truncated\n");
+        return -1;
+    }
+    program.at = header.at + header_length;
+    header.end = program.at;
+
+    min_length = _read(&header, 1);
+    if (version >= 4){
+        /* Maximum operations per instruction, VLIW only */
+        _skip(&header, 1);
+    }
+    /* Default is statement */
+    _skip(&header, 1);
+    /* Line base, lines are not tracked */
+    _skip(&header, 1);
+    line_range = _read(&header, 1);
+    opcode_base = _read(&header, 1);
+    lengths = header.at;
+    _skip(&header, opcode_base > 0 ? opcode_base - 1 : 0);
+    if (header.bad || line_range == 0 || opcode_base == 0){
+        printf("Line number header is malformed\n");
+        return -1;
+    }
+
+    grown = realloc(instance->units,
+                    (instance->num_units + 1) * sizeof(*grown));
+    if (grown == NULL){
+        printf("Unable to allocate compilation unit\n");
+        return -1;
+    }
+    instance->units = grown;
+    unit = &instance->units[instance->num_units++];
+    unit->files = NULL;
+    unit->num_files = 0;
+
+    r = version >= 5 ?
+        _read_tables_5(instance, &header, offset_size, unit) :
+        _read_tables(&header, unit);
+    if (r < 0){
+        printf("Line number file table is malformed\n");
+        return -1;
+    }
+
+    r = _run_program(instance, &program, min_length, line_range,
+                     opcode_base, lengths);
+    if (r < 0){
+        printf("Line number program is malformed\n");
+        return -1;
+    }
+    debug_print("Unit %d: %d files\n", instance->num_units - 1,
+                unit->num_files);
+
+    return 1;
+}
+
+static void _optional_section(struct instance *instance,
+                              const char *name,
+                              struct section *section)
+{
+    if (chili_sym_section(instance->symbols, name, &section->contents,
+                          &section->size) <= 0){
+        section->contents = NULL;
+        section->size = 0;
+    }
+}
+
+/* Exports */
+int chili_dwarf_create(const char *path, chili_handle *handle)
+{
+    struct instance *instance;
+    struct cursor c;
+    const char *line;
+    uint64_t size;
+    int r;
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL){
+        printf("Failed to allocate instance\n");
+        return -1;
+    }
+
+    r = chili_sym_create(path, NULL, &instance->symbols);
+    if (r < 0){
+        free(instance);
+        return r;
+    }
+
+    r = chili_sym_section(instance->symbols, ".debug_line", &line, &size);
+    if (r <= 0){
+        chili_sym_destroy(instance->symbols);
+        free(instance);
+        return r;
+    }
+    _optional_section(instance, ".debug_line_str", &instance->line_str);
+    _optional_section(instance, ".debug_str", &instance->str);
+
+    c = (struct cursor){
+        .at = (const unsigned char*)line,
+        .end = (const unsigned char*)line + size,
+    };
+    while (r > 0 && c.at < c.end){
+        r = _read_unit(instance, &c);
+    }
+    if (r < 0){
+        printf("Failed to read line number information of %s\n", path);
+        chili_dwarf_destroy(instance);
+        return r;
+    }
+
+    *handle = instance;
+
+    return 1;
+}
+
+int chili_dwarf_files(chili_handle handle,
+                      const char *function,
+                      chili_dwarf_visit visit,
+                      void *context)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct unit *unit;
+    uint64_t address;
+    uint64_t size;
+    int r;
+
+    if (chili_sym_address(instance->symbols, function,
+                          &address, &size) <= 0){
+        return 0;
+    }
+
+    for (int i = 0; i < instance->num_ranges; i++){
+        if (address < instance->ranges[i].low ||
+            address >= instance->ranges[i].high){
+            continue;
+        }
+
+        unit = &instance->units[instance->ranges[i].unit];
+        for (int j = 0; j < unit->num_files; j++){
+            r = visit(context, unit->files[j]);
+            if (r <= 0){
+                return r < 0 ? r : 1;
+            }
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+void chili_dwarf_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    for (int i = 0; i < instance->num_units; i++){
+        for (int j = 0; j < instance->units[i].num_files; j++){
+            free(instance->units[i].files[j]);
+        }
+        free(instance->units[i].files);
+    }
+    free(instance->units);
+    free(instance->ranges);
+    chili_sym_destroy(instance->symbols);
+    free(instance);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "handle.h"
+
+/**
+ * @brief Called for each source file of a compilation unit.
+ *
+ * @param context Context passed along with callback.
+ * @param path    Path of source file as recorded by compiler,
+ *                relative when the compiler didn't know the
+ *                directory it was compiled in.
+ *
+ * @return Negative to stop with error.
+ *         Zero to stop.
+ *         Positive to continue with next file.
+ */
+typedef int (*chili_dwarf_visit)(void *context, const char *path);
+
+/**
+ * @brief Creates a reader of debug information in shared
+ *        library built with -g.
+ *
+ * Only line number information in .debug_line is read, the
+ * addresses each compilation unit has code at and the source
+ * files, including headers, that the unit is built from.
+ *
+ * @param path   Path to shared library.
+ * @param handle Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Zero when library has no line number information,
+ *         handle is not set.
+ *         Positive on success.
+ */
+int chili_dwarf_create(const char *path, chili_handle *handle);
+
+/**
+ * @brief Visits source files of compilation unit that has
+ *        the code of a function.
+ *
+ * @param handle   Valid module handle.
+ * @param function Name of function defined in library.
+ * @param visit    Called for each source file.
+ * @param context  Passed along to visit.
+ *
+ * @return Negative on error or when visit returns negative.
+ *         Zero when function isn't in any unit with line
+ *         number information.
+ *         Positive on success.
+ */
+int chili_dwarf_files(chili_handle handle,
+                      const char *function,
+                      chili_dwarf_visit visit,
+                      void *context);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_dwarf_destroy(chili_handle handle);
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "evict.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+#define MAX_CACHE_INDEX 16
+#define CACHE_LINE_SIZE 64
+/* Used when cache size can't be read */
+#define DEFAULT_CACHE_SIZE (64L * 1024 * 1024)
+
+/* Types */
+struct instance {
+    char *buffer;
+    long size;
+};
+
+
+/* Locals */
+static int _read_line(const char *path, char *line, int size)
+{
+    FILE *f = fopen(path, "r");
+
+    if (f == NULL){
+        return -1;
+    }
+    if (fgets(line, size, f) == NULL){
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    return 1;
+}
+
+/* Parses sizes like 48K, 2048K or 32M */
+static long _parse_size(const char *size)
+{
+    char *unit;
+    long parsed = strtol(size, &unit, 10);
+
+    switch (*unit){
+    case 'K':
+        return parsed * 1024;
+    case 'M':
+        return parsed * 1024 * 1024;
+    case 'G':
+        return parsed * 1024 * 1024 * 1024;
+    default:
+        return parsed;
+    }
+}
+
+static long _last_level_cache_size()
+{
+    char path[128];
+    char line[64];
+    long largest = 0;
+    long size;
+
+    for (int i = 0; i < MAX_CACHE_INDEX; i++){
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        if (_read_line(path, line, sizeof(line)) < 0){
+            break;
+        }
+        if (strncmp(line, "Instruction", 11) == 0){
+            continue;
+        }
+
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        if (_read_line(path, line, sizeof(line)) < 0){
+            continue;
+        }
+        size = _parse_size(line);
+        largest = size > largest ? size : largest;
+    }
+
+    return largest > 0 ? largest : DEFAULT_CACHE_SIZE;
+}
+
+/* Exports */
+int chili_evict_create(chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = malloc(sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate evict instance\n");
+        return -1;
+    }
+
+    /* Twice the cache to defeat replacement policies that
+     * keep some of the old lines. Shared to not copy pages on
+     * write in benchmark processes. */
+    instance->size = 2 * _last_level_cache_size();
+    instance->buffer = mmap(NULL, instance->size,
+                            PROT_READ|PROT_WRITE,
+                            MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (instance->buffer == MAP_FAILED){
+        printf("Failed to map %ld bytes to evict caches: %s\n",
+               instance->size, strerror(errno));
+        free(instance);
+        return -1;
+    }
+    debug_print("Evicting caches with %ld bytes\n", instance->size);
+
+    *handle = instance;
+    return 1;
+}
+
+void chili_evict(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+    volatile char *buffer = instance->buffer;
+
+    /* Write to get lines in exclusive state, dirty lines
+     * of the code under test are written back */
+    for (long i = 0; i < instance->size; i += CACHE_LINE_SIZE){
+        buffer[i]++;
+    }
+}
+
+long chili_evict_size(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    return instance->size;
+}
+
+void chili_evict_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    munmap(instance->buffer, instance->size);
+    free(instance);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "handle.h"
+
+
+/**
+ * @brief Creates a cache evicter.
+ *
+ * Allocates a buffer larger than the last level cache of
+ * the machine. Size of the cache is read from sysfs.
+ *
+ * @param handle Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_evict_create(chili_handle *handle);
+
+/**
+ * @brief Evicts caches.
+ *
+ * Streams through the buffer, touching every cache line
+ * and every page. Leaves caches and TLB filled with
+ * data that isn't used by the code under test.
+ */
+void chili_evict(chili_handle handle);
+
+/**
+ * @brief Returns size of buffer used to evict caches.
+ */
+long chili_evict_size(chili_handle handle);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_evict_destroy(chili_handle handle);
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+
+/* Constants */
+#define FNV_PRIME 1099511628211ULL
+#define INITIAL_CAPACITY 64
+
+/* Types */
+struct slot {
+    /* NULL if free */
+    const char *library;
+    const char *name;
+    int        index;
+};
+
+struct instance {
+    struct slot *slots;
+    int         capacity;
+    int         count;
+};
+
+
+/* Locals */
+
+/* Returns slot of test or the free slot where it belongs */
+static struct slot *_find(struct slot *slots,
+                          int capacity,
+                          const char *library,
+                          const char *name)
+{
+    uint64_t mask = capacity - 1;
+    uint64_t i = chili_hash_test(library, name) & mask;
+
+    while (slots[i].library &&
+           (strcmp(slots[i].library, library) != 0 ||
+            strcmp(slots[i].name, name) != 0)){
+        i = (i + 1) & mask;
+    }
+
+    return &slots[i];
+}
+
+static int _grow(struct instance *instance)
+{
+    int capacity = instance->capacity * 2;
+    struct slot *slots = calloc(capacity, sizeof(*slots));
+    struct slot *old;
+
+    if (slots == NULL){
+        printf("Unable to grow table of tests\n");
+        return -1;
+    }
+
+    for (int i = 0; i < instance->capacity; i++){
+        old = &instance->slots[i];
+        if (old->library){
+            *_find(slots, capacity, old->library, old->name) = *old;
+        }
+    }
+    free(instance->slots);
+    instance->slots = slots;
+    instance->capacity = capacity;
+
+    return 1;
+}
+
+
+/* Exports */
+uint64_t chili_hash_fnv64(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+
+    for (size_t i = 0; i < size; i++){
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+uint64_t chili_hash_test(const char *library, const char *name)
+{
+    /* Terminator separates library from name */
+    uint64_t hash = chili_hash_fnv64(CHILI_HASH_FNV_OFFSET, library,
+                                     strlen(library) + 1);
+
+    return chili_hash_fnv64(hash, name, strlen(name));
+}
+
+int chili_hash_create(chili_handle *handle)
+{
+    struct instance *instance = malloc(sizeof(*instance));
+
+    if (instance == NULL){
+        printf("Unable to allocate table of tests\n");
+        return -1;
+    }
+    instance->slots = calloc(INITIAL_CAPACITY, sizeof(*instance->slots));
+    if (instance->slots == NULL){
+        printf("Unable to allocate table of tests\n");
+        free(instance);
+        return -1;
+    }
+    instance->capacity = INITIAL_CAPACITY;
+    instance->count = 0;
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_hash_add(chili_handle handle,
+                   const char *library,
+                   const char *name,
+                   int index)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct slot *slot;
+
+    /* Kept at most half full */
+    if ((instance->count + 1) * 2 > instance->capacity &&
+        _grow(instance) < 0){
+        return -1;
+    }
+
+    slot = _find(instance->slots, instance->capacity, library, name);
+    if (slot->library == NULL){
+        instance->count++;
+    }
+    slot->library = library;
+    slot->name = name;
+    slot->index = index;
+
+    return 1;
+}
+
+int chili_hash_find(chili_handle handle,
+                    const char *library,
+                    const char *name)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct slot *slot = _find(instance->slots, instance->capacity,
+                              library, name);
+
+    return slot->library ? slot->index : -1;
+}
+
+void chili_hash_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    free(instance->slots);
+    free(instance);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "handle.h"
+
+/* Hash of no data, where hashing starts */
+#define CHILI_HASH_FNV_OFFSET 14695981039346656037ULL
+
+
+/**
+ * @brief Continues 64 bit FNV-1a hash over data.
+ *
+ * Hashes are stable between runs and may be stored, like in names
+ * of files.
+ *
+ * @param hash Hash so far, CHILI_HASH_FNV_OFFSET to start.
+ * @param data Data to hash.
+ * @param size Size of data in bytes.
+ *
+ * @return Hash including data.
+ */
+uint64_t chili_hash_fnv64(uint64_t hash, const void *data, size_t size);
+
+/**
+ * @brief Hashes test by library and name.
+ */
+uint64_t chili_hash_test(const char *library, const char *name);
+
+/**
+ * @brief Creates table of tests.
+ *
+ * Maps tests by library and name to index of an entry kept by
+ * caller, like in an array of tests in the order they were added.
+ *
+ * @param handle Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_hash_create(chili_handle *handle);
+
+/**
+ * @brief Adds test to table.
+ *
+ * Library and name are not copied, they must be kept until the
+ * table is destroyed. A test is only added once.
+ *
+ * @param index Index of entry of test.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_hash_add(chili_handle handle,
+                   const char *library,
+                   const char *name,
+                   int index);
+
+/**
+ * @brief Finds test in table.
+ *
+ * @return Index of entry of test.
+ *         Negative if test has not been added.
+ */
+int chili_hash_find(chili_handle handle,
+                    const char *library,
+                    const char *name);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_hash_destroy(chili_handle handle);
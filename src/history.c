@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "named.h"
+#include "hash.h"
+#include "history.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+#define INITIAL_CAPACITY 256
+#define MAX_LINE 1024
+
+/* Types */
+struct entry {
+    /* Library and name separated by terminator */
+    char     *key;
+    uint64_t duration_ns;
+    bool     failed;
+    /* Peak memory, zero if unknown */
+    uint64_t max_rss_kb;
+    /* Forgotten and not recorded again */
+    bool     stale;
+    /* Recorded in this run, in order, zero if not */
+    int      run;
+};
+
+struct instance {
+    char         *path;
+    /* Entries in the order tests were first recorded */
+    struct entry *entries;
+    int          capacity;
+    int          count;
+    /* Index of entry by test */
+    chili_handle tests;
+    /* When history was saved, zero if there was none */
+    time_t       saved;
+    /* Number of tests recorded in this run */
+    int          num_run;
+};
+
+
+/* Locals */
+static const char *_entry_name(const struct entry *entry)
+{
+    return entry->key + strlen(entry->key) + 1;
+}
+
+/* Returns entry of test, NULL if not recorded */
+static struct entry *_find(struct instance *instance,
+                           const char *library,
+                           const char *name)
+{
+    int i = chili_hash_find(instance->tests, library, name);
+
+    return i < 0 ? NULL : &instance->entries[i];
+}
+
+static int _grow(struct instance *instance)
+{
+    struct entry *entries;
+
+    entries = realloc(instance->entries,
+                      instance->capacity * 2 * sizeof(*entries));
+    if (entries == NULL){
+        printf("Unable to grow history\n");
+        return -1;
+    }
+    instance->entries = entries;
+    instance->capacity *= 2;
+
+    return 1;
+}
+
+static int _load(struct instance *instance)
+{
+    char line[MAX_LINE];
+    FILE *f;
+    uint64_t duration_ns;
+    uint64_t max_rss_kb;
+    int consumed;
+    int failed;
+    char *library;
+    char *name;
+    struct stat st;
+    int r = 1;
+
+    f = fopen(instance->path, "r");
+    if (f == NULL){
+        debug_print("No history in %s\n", instance->path);
+        return 1;
+    }
+    if (fstat(fileno(f), &st) == 0){
+        instance->saved = st.st_mtime;
+    }
+
+    /* Lines look like: duration_ns failed max_rss_kb library:name,
+     * history saved before peak memory was recorded lacks it */
+    while (r > 0 && fgets(line, sizeof(line), f)){
+        max_rss_kb = 0;
+        if (sscanf(line, "%" SCNu64 " %d %" SCNu64 " %n",
+                   &duration_ns, &failed, &max_rss_kb, &consumed) < 3 &&
+            sscanf(line, "%" SCNu64 " %d %n",
+                   &duration_ns, &failed, &consumed) < 2){
+            continue;
+        }
+        if (chili_named_parse(line + consumed, &library, &name) < 0){
+            continue;
+        }
+        r = chili_history_set(instance, library, name, duration_ns,
+                              failed != 0);
+        if (r > 0){
+            chili_history_set_rss(instance, library, name, max_rss_kb);
+        }
+    }
+
+    fclose(f);
+
+    /* Nothing loaded was recorded in this run */
+    for (int i = 0; i < instance->count; i++){
+        instance->entries[i].run = 0;
+    }
+    instance->num_run = 0;
+
+    return r;
+}
+
+static int _by_run(const void *a, const void *b)
+{
+    const struct entry *x = *(const struct entry**)a;
+    const struct entry *y = *(const struct entry**)b;
+
+    return x->run - y->run;
+}
+
+/* Exports */
+int chili_history_create(const char *path, chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = malloc(sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate history instance\n");
+        return -1;
+    }
+
+    instance->path = strdup(path);
+    instance->entries = malloc(INITIAL_CAPACITY * sizeof(struct entry));
+    instance->capacity = INITIAL_CAPACITY;
+    instance->count = 0;
+    instance->tests = NULL;
+    instance->saved = 0;
+    instance->num_run = 0;
+    if (instance->path == NULL || instance->entries == NULL){
+        printf("Unable to allocate history\n");
+        chili_history_destroy(instance);
+        return -1;
+    }
+    if (chili_hash_create(&instance->tests) < 0){
+        chili_history_destroy(instance);
+        return -1;
+    }
+
+    if (_load(instance) < 0){
+        chili_history_destroy(instance);
+        return -1;
+    }
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_history_get(chili_handle handle,
+                      const char *library,
+                      const char *name,
+                      uint64_t *duration_ns)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct entry *entry = _find(instance, library, name);
+
+    if (entry == NULL){
+        return 0;
+    }
+
+    *duration_ns = entry->duration_ns;
+    return 1;
+}
+
+bool chili_history_failed(chili_handle handle,
+                          const char *library,
+                          const char *name)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct entry *entry = _find(instance, library, name);
+
+    return entry != NULL && entry->failed;
+}
+
+bool chili_history_library_failed(chili_handle handle,
+                                  const char *library)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    for (int i = 0; i < instance->count; i++){
+        if (instance->entries[i].failed &&
+            strcmp(instance->entries[i].key, library) == 0){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool chili_history_changed(chili_handle handle, const char *library)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct stat st;
+
+    if (instance->saved == 0 || stat(library, &st) < 0){
+        return false;
+    }
+
+    return st.st_mtime >= instance->saved;
+}
+
+int chili_history_set(chili_handle handle,
+                      const char *library,
+                      const char *name,
+                      uint64_t duration_ns,
+                      bool failed)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct entry *entry;
+    int library_length = strlen(library) + 1;
+    int name_length = strlen(name) + 1;
+
+    entry = _find(instance, library, name);
+    if (entry == NULL){
+        if (instance->count == instance->capacity &&
+            _grow(instance) < 0){
+            return -1;
+        }
+        entry = &instance->entries[instance->count];
+        memset(entry, 0, sizeof(*entry));
+        entry->key = malloc(library_length + name_length);
+        if (entry->key == NULL){
+            printf("Unable to allocate history entry\n");
+            return -1;
+        }
+        memcpy(entry->key, library, library_length);
+        memcpy(entry->key + library_length, name, name_length);
+        if (chili_hash_add(instance->tests, entry->key,
+                           _entry_name(entry), instance->count) < 0){
+            free(entry->key);
+            return -1;
+        }
+        instance->count++;
+    }
+
+    entry->duration_ns = duration_ns;
+    entry->failed = failed;
+    entry->stale = false;
+    entry->run = ++instance->num_run;
+
+    return 1;
+}
+
+int chili_history_keep(chili_handle handle,
+                       const char *library,
+                       const char *name)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct entry *entry = _find(instance, library, name);
+
+    if (entry == NULL){
+        return 0;
+    }
+
+    entry->stale = false;
+    return 1;
+}
+
+int chili_history_set_rss(chili_handle handle,
+                          const char *library,
+                          const char *name,
+                          uint64_t max_rss_kb)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct entry *entry = _find(instance, library, name);
+
+    if (entry == NULL){
+        return 0;
+    }
+
+    entry->max_rss_kb = max_rss_kb;
+    return 1;
+}
+
+int chili_history_get_rss(chili_handle handle,
+                          const char *library,
+                          const char *name,
+                          uint64_t *max_rss_kb)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct entry *entry = _find(instance, library, name);
+
+    *max_rss_kb = entry == NULL ? 0 : entry->max_rss_kb;
+    return *max_rss_kb > 0 ? 1 : 0;
+}
+
+int chili_history_library_rss(chili_handle handle,
+                              const char *library,
+                              uint64_t *max_rss_kb)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct entry *entry;
+
+    /* Tests are run one at a time, peak of library is the
+     * peak of its hungriest test */
+    *max_rss_kb = 0;
+    for (int i = 0; i < instance->count; i++){
+        entry = &instance->entries[i];
+        if (strcmp(entry->key, library) == 0 &&
+            entry->max_rss_kb > *max_rss_kb){
+            *max_rss_kb = entry->max_rss_kb;
+        }
+    }
+
+    return *max_rss_kb > 0 ? 1 : 0;
+}
+
+int chili_history_library(chili_handle handle,
+                          const char *library,
+                          uint64_t *duration_ns)
+{
+    struct instance *instance = (struct instance*)handle;
+    int found = 0;
+
+    *duration_ns = 0;
+    for (int i = 0; i < instance->count; i++){
+        if (strcmp(instance->entries[i].key, library) == 0){
+            *duration_ns += instance->entries[i].duration_ns;
+            found = 1;
+        }
+    }
+
+    return found;
+}
+
+void chili_history_forget(chili_handle handle, const char *library)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    for (int i = 0; i < instance->count; i++){
+        if (strcmp(instance->entries[i].key, library) == 0){
+            instance->entries[i].stale = true;
+        }
+    }
+}
+
+int chili_history_save(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+    char temp_path[MAX_LINE];
+    struct entry *entry;
+    FILE *f;
+
+    /* Write whole file before replacing old history */
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", instance->path);
+    f = fopen(temp_path, "w");
+    if (f == NULL){
+        printf("Failed to save history to %s: %s\n",
+               temp_path, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < instance->count; i++){
+        entry = &instance->entries[i];
+        if (!entry->stale){
+            fprintf(f, "%" PRIu64 " %d %" PRIu64 " %s:%s\n",
+                    entry->duration_ns, entry->failed ? 1 : 0,
+                    entry->max_rss_kb, entry->key, _entry_name(entry));
+        }
+    }
+
+    if (fclose(f) != 0 || rename(temp_path, instance->path) < 0){
+        printf("Failed to save history to %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+int chili_history_save_failed(chili_handle handle, const char *path)
+{
+    struct instance *instance = (struct instance*)handle;
+    char temp_path[MAX_LINE];
+    struct entry **failed;
+    struct entry *entry;
+    int count = 0;
+    FILE *f;
+
+    failed = malloc((instance->num_run + 1) * sizeof(*failed));
+    if (failed == NULL){
+        printf("Unable to allocate failed tests\n");
+        return -1;
+    }
+    for (int i = 0; i < instance->count; i++){
+        entry = &instance->entries[i];
+        /* Failed suite setup is kept for 'rerun-failed' to expand
+         * into tests of its library */
+        if (entry->run && entry->failed){
+            failed[count++] = entry;
+        }
+    }
+    qsort(failed, count, sizeof(*failed), _by_run);
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    f = fopen(temp_path, "w");
+    if (f == NULL){
+        printf("Failed to save failed tests to %s: %s\n",
+               temp_path, strerror(errno));
+        free(failed);
+        return -1;
+    }
+    for (int i = 0; i < count; i++){
+        fprintf(f, "%s:%s\n", failed[i]->key, _entry_name(failed[i]));
+    }
+    free(failed);
+
+    if (fclose(f) != 0 || rename(temp_path, path) < 0){
+        printf("Failed to save failed tests to %s: %s\n",
+               path, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+void chili_history_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    if (instance->entries){
+        for (int i = 0; i < instance->count; i++){
+            free(instance->entries[i].key);
+        }
+    }
+    if (instance->tests){
+        chili_hash_destroy(instance->tests);
+    }
+    free(instance->entries);
+    free(instance->path);
+    free(instance);
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "handle.h"
+
+/* Name that suite setup time is recorded under */
+#define CHILI_HISTORY_SETUP "once_before"
+
+/**
+ * @brief Creates history of earlier runs.
+ *
+ * History is read from file if it exists, otherwise history
+ * starts out empty.
+ *
+ * @param path   Path to file that history is read from and
+ *               saved to.
+ * @param handle Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_history_create(const char *path, chili_handle *handle);
+
+/**
+ * @brief Gets recorded duration of a test.
+ *
+ * @return Zero if test hasn't been recorded.
+ *         Positive if duration is set.
+ */
+int chili_history_get(chili_handle handle,
+                      const char *library,
+                      const char *name,
+                      uint64_t *duration_ns);
+
+/**
+ * @brief Checks if test didn't succeed when last run.
+ */
+bool chili_history_failed(chili_handle handle,
+                          const char *library,
+                          const char *name);
+
+/**
+ * @brief Checks if any test in library didn't succeed when
+ *        last run.
+ */
+bool chili_history_library_failed(chili_handle handle,
+                                  const char *library);
+
+/**
+ * @brief Checks if library has changed since history was
+ *        last saved.
+ *
+ * Nothing is considered changed when there is no history.
+ */
+bool chili_history_changed(chili_handle handle, const char *library);
+
+/**
+ * @brief Records outcome of a test.
+ *
+ * @param failed True unless test succeeded.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_history_set(chili_handle handle,
+                      const char *library,
+                      const char *name,
+                      uint64_t duration_ns,
+                      bool failed);
+
+/**
+ * @brief Keeps what was recorded about a test in earlier runs.
+ *
+ * For tests that weren't run in this run, like cached tests,
+ * in a library that has been forgotten.
+ *
+ * @return Zero if test hasn't been recorded.
+ *         Positive on success.
+ */
+int chili_history_keep(chili_handle handle,
+                       const char *library,
+                       const char *name);
+
+/**
+ * @brief Records peak memory of a test recorded with
+ *        chili_history_set.
+ *
+ * @return Zero if test hasn't been recorded.
+ *         Positive on success.
+ */
+int chili_history_set_rss(chili_handle handle,
+                          const char *library,
+                          const char *name,
+                          uint64_t max_rss_kb);
+
+/**
+ * @brief Gets recorded peak memory of a test.
+ *
+ * @param max_rss_kb Set to peak, zero when not recorded.
+ *
+ * @return Zero if no peak has been recorded for test.
+ *         Positive if peak is set.
+ */
+int chili_history_get_rss(chili_handle handle,
+                          const char *library,
+                          const char *name,
+                          uint64_t *max_rss_kb);
+
+/**
+ * @brief Predicts peak memory of running a library.
+ *
+ * @return Zero if no peak has been recorded for library.
+ *         Positive if peak is set.
+ */
+int chili_history_library_rss(chili_handle handle,
+                              const char *library,
+                              uint64_t *max_rss_kb);
+
+/**
+ * @brief Predicts how long it takes to run all of a library.
+ *
+ * Sum of suite setup and all tests recorded for the library.
+ *
+ * @return Zero if nothing has been recorded for library.
+ *         Positive if duration is set.
+ */
+int chili_history_library(chili_handle handle,
+                          const char *library,
+                          uint64_t *duration_ns);
+
+/**
+ * @brief Forgets everything recorded about a library in earlier
+ *        runs.
+ *
+ * Called before a library is run in full to drop tests that no
+ * longer exist. Predictions are not affected until saved.
+ */
+void chili_history_forget(chili_handle handle, const char *library);
+
+/**
+ * @brief Saves history to file.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_history_save(chili_handle handle);
+
+/**
+ * @brief Saves tests that didn't succeed in this run.
+ *
+ * Tests are saved in the order they were recorded, one per line
+ * on the form library:name read by 'named'. Tests loaded from
+ * an earlier run are left out. Failed suite setup is saved as
+ * library:CHILI_HISTORY_SETUP, none of the library's tests ran.
+ *
+ * @param path Path to file, replaced when saved.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_history_save_failed(chili_handle handle, const char *path);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_history_destroy(chili_handle handle);
@@ -0,0 +1,484 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "hash.h"
+#include "journal.h"
+#include "results.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+#define HEADER "chili journal"
+#define DONE "done "
+
+/* Room for longest path of library and name of test */
+#define MAX_LINE 8192
+
+/* Results written before journal is synced to disk, syncing
+ * after each test would cost more than most tests take */
+#define SYNC_RESULTS 64
+/* Longest time results are left unsynced */
+#define SYNC_NS 1000000000ULL
+
+/* Types */
+struct entry {
+    char                *library;
+    char                *name;
+    struct chili_result result;
+};
+
+struct instance {
+    char         *path;
+    int          fd;
+    struct entry *entries;
+    int          num_entries;
+    int          capacity;
+    /* Index of entry by test */
+    chili_handle tests;
+    /* Entries read from journal of interrupted run */
+    int          num_resumed;
+    char         **done;
+    int          num_done;
+    /* Results written since last sync */
+    int          num_unsynced;
+    uint64_t     synced_ns;
+};
+
+
+/* Locals */
+static uint64_t _now_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/* Files are identified without reading them, a rebuilt library
+ * gets a new inode or modification time */
+static uint64_t _hash_inputs(const char **inputs, int num_inputs)
+{
+    uint64_t hash = CHILI_HASH_FNV_OFFSET;
+    struct stat input_stat;
+
+    for (int i = 0; i < num_inputs; i++){
+        hash = chili_hash_fnv64(hash, inputs[i], strlen(inputs[i]) + 1);
+        if (stat(inputs[i], &input_stat) < 0 ||
+            !S_ISREG(input_stat.st_mode)){
+            continue;
+        }
+        hash = chili_hash_fnv64(hash, &input_stat.st_dev,
+                                sizeof(input_stat.st_dev));
+        hash = chili_hash_fnv64(hash, &input_stat.st_ino,
+                                sizeof(input_stat.st_ino));
+        hash = chili_hash_fnv64(hash, &input_stat.st_size,
+                                sizeof(input_stat.st_size));
+        hash = chili_hash_fnv64(hash, &input_stat.st_mtim,
+                                sizeof(input_stat.st_mtim));
+    }
+
+    return hash;
+}
+
+static int _lookup(const struct instance *instance,
+                   const char *library,
+                   const char *name)
+{
+    return chili_hash_find(instance->tests, library, name);
+}
+
+static int _grow(struct instance *instance)
+{
+    struct entry *entries;
+    int capacity = instance->capacity ? instance->capacity * 2 : 64;
+
+    entries = realloc(instance->entries, capacity * sizeof(*entries));
+    if (entries == NULL){
+        printf("Unable to allocate journal entries\n");
+        return -1;
+    }
+    instance->entries = entries;
+    instance->capacity = capacity;
+
+    return 1;
+}
+
+static int _insert(struct instance *instance,
+                   const struct chili_result *result)
+{
+    struct entry *entry;
+
+    if (instance->num_entries == instance->capacity &&
+        _grow(instance) < 0){
+        return -1;
+    }
+
+    entry = &instance->entries[instance->num_entries];
+    entry->library = strdup(result->library);
+    entry->name = strdup(result->name);
+    if (entry->library == NULL || entry->name == NULL ||
+        chili_hash_add(instance->tests, entry->library, entry->name,
+                       instance->num_entries) < 0){
+        printf("Unable to allocate journal entry\n");
+        free(entry->library);
+        free(entry->name);
+        return -1;
+    }
+    entry->result = *result;
+    entry->result.library = entry->library;
+    entry->result.name = entry->name;
+    instance->num_entries++;
+
+    return 1;
+}
+
+static int _insert_done(struct instance *instance, const char *library)
+{
+    char **done;
+
+    done = realloc(instance->done,
+                   (instance->num_done + 1) * sizeof(*done));
+    if (done == NULL){
+        printf("Unable to allocate journal entry\n");
+        return -1;
+    }
+    instance->done = done;
+
+    done[instance->num_done] = strdup(library);
+    if (done[instance->num_done] == NULL){
+        printf("Unable to allocate journal entry\n");
+        return -1;
+    }
+    instance->num_done++;
+
+    return 1;
+}
+
+/* Reads journal of interrupted run. Sets length to where the
+ * last complete line ends, a line may be cut short when the
+ * machine crashed. */
+static int _load(struct instance *instance,
+                 FILE *f,
+                 off_t *length)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t read;
+    struct chili_result result;
+    bool skipped;
+    int r = 1;
+
+    while (r >= 0 && (read = getline(&line, &size, f)) > 0){
+        if (line[read - 1] != '\n'){
+            debug_print("Ignoring incomplete line: %s\n", line);
+            break;
+        }
+        *length += read;
+
+        if (strncmp(line, DONE, strlen(DONE)) == 0){
+            line[read - 1] = '\0';
+            if (!chili_journal_is_done(instance, line + strlen(DONE))){
+                r = _insert_done(instance, line + strlen(DONE));
+            }
+            continue;
+        }
+        if (chili_results_parse(line, &result, &skipped) < 0 ||
+            skipped ||
+            _lookup(instance, result.library, result.name) >= 0){
+            continue;
+        }
+        r = _insert(instance, &result);
+    }
+
+    free(line);
+    instance->num_resumed = instance->num_entries;
+
+    return r;
+}
+
+/* Opens journal of interrupted run when it is of the same
+ * inputs */
+static int _resume(struct instance *instance, uint64_t key)
+{
+    FILE *f;
+    char header[64];
+    uint64_t resumed_key;
+    off_t length;
+    int r;
+
+    f = fopen(instance->path, "r");
+    if (f == NULL){
+        return 0;
+    }
+
+    if (fgets(header, sizeof(header), f) == NULL ||
+        sscanf(header, HEADER " %" SCNx64, &resumed_key) != 1 ||
+        resumed_key != key){
+        fclose(f);
+        return 0;
+    }
+
+    length = strlen(header);
+    r = _load(instance, f, &length);
+    fclose(f);
+    if (r < 0){
+        return r;
+    }
+
+    instance->fd = open(instance->path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (instance->fd < 0 || ftruncate(instance->fd, length) < 0){
+        printf("Failed to open journal %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+static int _start(struct instance *instance, uint64_t key)
+{
+    char header[64];
+    int length;
+
+    instance->fd = open(instance->path,
+                        O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                        0644);
+    if (instance->fd < 0){
+        printf("Failed to create journal %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    length = snprintf(header, sizeof(header), HEADER " %016" PRIx64 "\n",
+                      key);
+    if (write(instance->fd, header, length) != length ||
+        fdatasync(instance->fd) < 0){
+        printf("Failed to write journal %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+static int _write(struct instance *instance, const char *line, int length)
+{
+    uint64_t now_ns;
+
+    /* One write per line, a chili that crashes leaves whole
+     * lines behind */
+    if (write(instance->fd, line, length) != length){
+        printf("Failed to write journal %s: %s\n",
+               instance->path, strerror(errno));
+        return -1;
+    }
+
+    instance->num_unsynced++;
+    now_ns = _now_ns();
+    if (instance->num_unsynced >= SYNC_RESULTS ||
+        now_ns - instance->synced_ns >= SYNC_NS){
+        instance->num_unsynced = 0;
+        instance->synced_ns = now_ns;
+        return chili_journal_sync(instance);
+    }
+
+    return 1;
+}
+
+/* Exports */
+int chili_journal_create(const char *path,
+                         const char **inputs,
+                         int num_inputs,
+                         bool resume,
+                         chili_handle *handle)
+{
+    struct instance *instance;
+    uint64_t key = _hash_inputs(inputs, num_inputs);
+    int r = 0;
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate journal instance\n");
+        return -1;
+    }
+    instance->fd = -1;
+    instance->synced_ns = _now_ns();
+
+    instance->path = strdup(path);
+    if (instance->path == NULL){
+        printf("Unable to allocate journal instance\n");
+        free(instance);
+        return -1;
+    }
+    if (chili_hash_create(&instance->tests) < 0){
+        free(instance->path);
+        free(instance);
+        return -1;
+    }
+
+    if (resume){
+        r = _resume(instance, key);
+    }
+    if (r == 0){
+        r = _start(instance, key);
+    }
+    if (r < 0){
+        chili_journal_destroy(instance, false);
+        return r;
+    }
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_journal_resumed(chili_handle handle)
+{
+    struct instance *instance = handle;
+
+    return instance->num_resumed;
+}
+
+int chili_journal_add(chili_handle handle,
+                      const struct chili_result *result)
+{
+    struct instance *instance = handle;
+    char line[MAX_LINE];
+    int length;
+
+    if (_lookup(instance, result->library, result->name) >= 0){
+        return 1;
+    }
+
+    length = chili_results_format(line, sizeof(line), result);
+    if (length >= (int)sizeof(line)){
+        printf("Too long name to journal %s:%s\n",
+               result->library, result->name);
+        return -1;
+    }
+
+    if (_insert(instance, result) < 0){
+        return -1;
+    }
+
+    return _write(instance, line, length);
+}
+
+int chili_journal_done(chili_handle handle, const char *library)
+{
+    struct instance *instance = handle;
+    char line[MAX_LINE];
+    int length;
+
+    if (chili_journal_is_done(instance, library)){
+        return 1;
+    }
+
+    length = snprintf(line, sizeof(line), DONE "%s\n", library);
+    if (length >= (int)sizeof(line)){
+        printf("Too long path to journal %s\n", library);
+        return -1;
+    }
+
+    if (_insert_done(instance, library) < 0){
+        return -1;
+    }
+
+    return _write(instance, line, length);
+}
+
+bool chili_journal_is_done(chili_handle handle, const char *library)
+{
+    struct instance *instance = handle;
+
+    for (int i = 0; i < instance->num_done; i++){
+        if (strcmp(instance->done[i], library) == 0){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int chili_journal_find(chili_handle handle,
+                       const char *library,
+                       const char *name,
+                       struct chili_result *result)
+{
+    struct instance *instance = handle;
+    int index = _lookup(instance, library, name);
+
+    if (index < 0){
+        return 0;
+    }
+
+    *result = instance->entries[index].result;
+    return 1;
+}
+
+int chili_journal_replay(chili_handle handle,
+                         const char *library,
+                         chili_journal_visit visit,
+                         void *context)
+{
+    struct instance *instance = handle;
+    int r;
+
+    for (int i = 0; i < instance->num_entries; i++){
+        if (strcmp(instance->entries[i].library, library) != 0){
+            continue;
+        }
+        r = visit(context, &instance->entries[i].result);
+        if (r < 0){
+            return r;
+        }
+    }
+
+    return 1;
+}
+
+int chili_journal_sync(chili_handle handle)
+{
+    struct instance *instance = handle;
+
+    return fdatasync(instance->fd) == 0 ? 1 : -1;
+}
+
+void chili_journal_destroy(chili_handle handle, bool finished)
+{
+    struct instance *instance = handle;
+
+    if (instance->fd >= 0){
+        if (finished){
+            unlink(instance->path);
+        }
+        else {
+            fdatasync(instance->fd);
+        }
+        close(instance->fd);
+    }
+
+    for (int i = 0; i < instance->num_entries; i++){
+        free(instance->entries[i].library);
+        free(instance->entries[i].name);
+    }
+    for (int i = 0; i < instance->num_done; i++){
+        free(instance->done[i]);
+    }
+    free(instance->entries);
+    chili_hash_destroy(instance->tests);
+    free(instance->done);
+    free(instance->path);
+    free(instance);
+}
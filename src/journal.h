@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "handle.h"
+#include "run.h"
+
+/**
+ * @brief Called for each result of a library in journal.
+ *
+ * @return Negative to stop visiting.
+ */
+typedef int (*chili_journal_visit)(void *context,
+                                   const struct chili_result *result);
+
+/**
+ * @brief Creates journal of completed tests in a run.
+ *
+ * The journal is kept so that a run that is interrupted can be
+ * resumed. A journal left by an interrupted run is resumed when
+ * asked to and it was of the same inputs, otherwise it is
+ * replaced.
+ *
+ * Inputs are what the run is of, like paths of libraries, names
+ * of tests and options. An input that is a path of a file is
+ * identified by the file, so that a rebuilt library is not the
+ * same input.
+ *
+ * @param path       Path to journal.
+ * @param inputs     Array of inputs of run.
+ * @param num_inputs Number of entries in array.
+ * @param resume     Resume journal of interrupted run.
+ * @param handle     Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_journal_create(const char *path,
+                         const char **inputs,
+                         int num_inputs,
+                         bool resume,
+                         chili_handle *handle);
+
+/**
+ * @brief Returns number of completed tests that was resumed.
+ */
+int chili_journal_resumed(chili_handle handle);
+
+/**
+ * @brief Adds result of a completed test.
+ *
+ * Results are written at once, so they survive chili crashing,
+ * and synced to disk in batches, so they survive the machine
+ * crashing. Tests that are already in journal are not added
+ * again.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_journal_add(chili_handle handle,
+                      const struct chili_result *result);
+
+/**
+ * @brief Adds that all tests of library were completed.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_journal_done(chili_handle handle, const char *library);
+
+/**
+ * @brief Checks if all tests of library were completed.
+ */
+bool chili_journal_is_done(chili_handle handle, const char *library);
+
+/**
+ * @brief Finds result of completed test.
+ *
+ * Library and name of result point into journal.
+ *
+ * @return Zero if test isn't completed.
+ *         Positive if result is set.
+ */
+int chili_journal_find(chili_handle handle,
+                       const char *library,
+                       const char *name,
+                       struct chili_result *result);
+
+/**
+ * @brief Visits results of library in the order they were
+ *        completed.
+ *
+ * @return Negative on error or when stopped by visit.
+ *         Positive on success.
+ */
+int chili_journal_replay(chili_handle handle,
+                         const char *library,
+                         chili_journal_visit visit,
+                         void *context);
+
+/**
+ * @brief Syncs journal to disk.
+ *
+ * Safe to call from a signal handler.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_journal_sync(chili_handle handle);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle   Valid module handle.
+ * @param finished Run was not interrupted, journal is removed
+ *                 since there is nothing to resume.
+ */
+void chili_journal_destroy(chili_handle handle, bool finished);
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "latency.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+
+/* Exports */
+int chili_latency_create(struct chili_latency **latency)
+{
+    struct chili_latency *mapped;
+
+    mapped = mmap(NULL, sizeof(*mapped),
+                  PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS,
+                  -1, 0);
+    if (mapped == MAP_FAILED){
+        printf("Failed to map latency histogram: %s\n",
+               strerror(errno));
+        return -1;
+    }
+
+    chili_latency_reset(mapped);
+    *latency = mapped;
+
+    return 1;
+}
+
+void chili_latency_reset(struct chili_latency *latency)
+{
+    memset(latency, 0, sizeof(*latency));
+}
+
+void chili_latency_merge(struct chili_latency *to,
+                         const struct chili_latency *from)
+{
+    for (int i = 0; i < CHILI_LATENCY_BUCKETS; i++){
+        to->buckets[i] += from->buckets[i];
+    }
+    to->count += from->count;
+    if (from->max > to->max){
+        to->max = from->max;
+    }
+}
+
+uint64_t chili_latency_bucket_value(unsigned index)
+{
+    unsigned shift;
+
+    if (index < CHILI_LATENCY_SUB_COUNT){
+        return index;
+    }
+
+    shift = (index >> CHILI_LATENCY_SUB_BITS) - 1;
+    return (uint64_t)((index & (CHILI_LATENCY_SUB_COUNT - 1)) +
+                      CHILI_LATENCY_SUB_COUNT) << shift;
+}
+
+uint64_t chili_latency_percentile(const struct chili_latency *latency,
+                                  double percentile)
+{
+    uint64_t wanted;
+    uint64_t seen = 0;
+    uint64_t highest;
+
+    if (latency->count == 0){
+        return 0;
+    }
+
+    /* Number of values at or below the percentile, at least one */
+    wanted = (uint64_t)(percentile / 100.0 * latency->count + 0.5);
+    wanted = wanted == 0 ? 1 : wanted;
+
+    for (int i = 0; i < CHILI_LATENCY_BUCKETS; i++){
+        seen += latency->buckets[i];
+        if (seen >= wanted){
+            highest = i + 1 < CHILI_LATENCY_BUCKETS ?
+                chili_latency_bucket_value(i + 1) - 1 :
+                UINT64_MAX;
+            return highest < latency->max ? highest : latency->max;
+        }
+    }
+
+    return latency->max;
+}
+
+void chili_latency_destroy(struct chili_latency *latency)
+{
+    munmap(latency, sizeof(*latency));
+}
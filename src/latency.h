@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "chili/latency.h"
+
+
+/**
+ * @brief Allocates a histogram in shared memory.
+ *
+ * The histogram is shared with child processes forked
+ * after this call.
+ *
+ * @param latency Set to allocated and cleared histogram on
+ *                success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_latency_create(struct chili_latency **latency);
+
+/**
+ * @brief Clears all recorded values.
+ */
+void chili_latency_reset(struct chili_latency *latency);
+
+/**
+ * @brief Adds all values recorded in one histogram to another.
+ *
+ * @param to   Histogram to add values to.
+ * @param from Histogram to add values from.
+ */
+void chili_latency_merge(struct chili_latency *to,
+                         const struct chili_latency *from);
+
+/**
+ * @brief Returns lowest value that is counted in bucket.
+ */
+uint64_t chili_latency_bucket_value(unsigned index);
+
+/**
+ * @brief Returns value at percentile.
+ *
+ * Value returned is the highest value that is equivalent
+ * to the recorded values in the same bucket, but never higher
+ * than the max recorded value.
+ *
+ * @param percentile Percentile between 0 and 100.
+ *
+ * @return Value at percentile or zero when nothing has been
+ *         recorded.
+ */
+uint64_t chili_latency_percentile(const struct chili_latency *latency,
+                                  double percentile);
+
+/**
+ * @brief Frees histogram allocated by create.
+ */
+void chili_latency_destroy(struct chili_latency *latency);
@@ -2,18 +2,27 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
 
 #include "symbols.h"
+#include "manifest.h"
 #include "suite.h"
 #include "run.h"
 #include "bind.h"
+#include "bench.h"
 #include "library.h"
 
 struct instance {
     /* Path to library */
     const char *path;
-    /* Symbol parser handle */
+    /* Symbol parser handle, NULL when suite is from manifest */
     chili_handle sym_handle;
+    /* Manifest handle, NULL when suite is from symbols */
+    chili_handle manifest_handle;
+    /* Library as it was before symbols were parsed */
+    struct stat library_stat;
+    bool identified;
     /* Suite handle */
     chili_handle suite_handle;
     /* Binder handle */
@@ -24,8 +33,19 @@ struct instance {
     struct chili_bind_fixture fixture;
     /* Progress callback */
     chili_progress report_progress;
+    /* Latency pointer in library, NULL if not used */
+    struct chili_latency **latency;
+    /* Order to run tests in, indexes into suite */
+    int *order;
+    /* Number of tests in order, skipped tests are left out */
+    int count;
 };
 
+/* Directory of manifests, empty when not used */
+static char _manifests[PATH_MAX];
+/* Manifests of parsed libraries are written */
+static bool _write_manifests;
+
 static int _build_suite(chili_handle sym_handle,
                         chili_handle suite)
 {
@@ -98,24 +118,52 @@ static int _debug_test(struct instance *instance,
     return chili_run_debug(debugger, &test, &instance->fixture);
 }
 
-int chili_lib_create(const char *path,
-                     chili_progress report_progress,
-                     chili_handle *handle)
+/* Builds suite from manifest, zero when there is none to use */
+static int _suite_from_manifest(struct instance *instance)
 {
     int r;
-    int symbol_count;
-    struct instance *instance;
+    int count;
 
-    instance = malloc(sizeof(*instance));
-    if (instance == NULL){
-        printf("Unable to allocate lib instance\n");
-        return -1;
+    if (_manifests[0] == '\0'){
+        return 0;
+    }
+    r = chili_manifest_open(_manifests, instance->path,
+                            &instance->manifest_handle);
+    if (r <= 0){
+        return r;
     }
 
-    instance->path = path;
+    count = chili_manifest_count(instance->manifest_handle);
+    r = chili_suite_create(count, &instance->suite_handle);
+    if (r < 0){
+        goto on_suite_error;
+    }
+    for (int i = 0; i < count; i++){
+        r = chili_suite_eval(instance->suite_handle,
+                             chili_manifest_name(instance->manifest_handle,
+                                                 i));
+        if (r < 0){
+            goto on_eval_error;
+        }
+    }
+
+    return 1;
+
+on_eval_error:
+    chili_suite_destroy(instance->suite_handle);
+on_suite_error:
+    chili_manifest_destroy(instance->manifest_handle);
+    instance->manifest_handle = NULL;
+    return r;
+}
+
+static int _suite_from_symbols(struct instance *instance)
+{
+    int r;
+    int symbol_count;
 
     /* Create symbol parser */
-    r = chili_sym_create(path, &symbol_count,
+    r = chili_sym_create(instance->path, &symbol_count,
                          &instance->sym_handle);
     if (r < 0){
         goto on_sym_error;
@@ -133,35 +181,154 @@ int chili_lib_create(const char *path,
         goto on_build_error;
     }
 
+    return 1;
+
+on_build_error:
+    chili_suite_destroy(instance->suite_handle);
+on_suite_error:
+    chili_sym_destroy(instance->sym_handle);
+on_sym_error:
+    instance->sym_handle = NULL;
+    return r;
+}
+
+/* Finds suite in manifest or else in symbols of library */
+static int _find_suite(struct instance *instance, bool *parsed)
+{
+    int r;
+
+    instance->sym_handle = NULL;
+    instance->manifest_handle = NULL;
+    instance->identified = false;
+
+    r = _suite_from_manifest(instance);
+    if (r != 0){
+        *parsed = false;
+        return r;
+    }
+    *parsed = true;
+
+    /* A library rebuilt while parsed gets a manifest that is
+     * already stale, rather than one of the wrong symbols */
+    instance->identified = _write_manifests &&
+                           stat(instance->path,
+                                &instance->library_stat) == 0;
+
+    return _suite_from_symbols(instance);
+}
+
+static void _release_suite(struct instance *instance)
+{
+    chili_suite_destroy(instance->suite_handle);
+    if (instance->manifest_handle){
+        chili_manifest_destroy(instance->manifest_handle);
+    }
+    if (instance->sym_handle){
+        chili_sym_destroy(instance->sym_handle);
+    }
+}
+
+void chili_lib_manifests(const char *directory, bool write)
+{
+    if (directory == NULL){
+        _manifests[0] = '\0';
+        _write_manifests = false;
+        return;
+    }
+    snprintf(_manifests, sizeof(_manifests), "%s", directory);
+    _write_manifests = write;
+}
+
+int chili_lib_create(const char *path,
+                     chili_progress report_progress,
+                     chili_handle *handle)
+{
+    int r;
+    bool parsed;
+    struct instance *instance;
+
+    instance = malloc(sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate lib instance\n");
+        return -1;
+    }
+
+    instance->path = path;
+
+    r = _find_suite(instance, &parsed);
+    if (r < 0){
+        goto on_suite_error;
+    }
+
     /* Create binder used to bind functions in suite */
     r = chili_suite_get(instance->suite_handle, &instance->suite);
     if (r < 0){
         goto on_build_error;
     }
+    /* Next run of unchanged library skips parsing, a manifest
+     * that can't be written is parsed again */
+    if (parsed && instance->identified){
+        chili_manifest_write(_manifests, path, &instance->library_stat,
+                             instance->suite);
+    }
     r = chili_bind_create(path, instance->suite,
                           &instance->bind_handle);
     if (r < 0){
         goto on_bind_error;
     }
 
+    instance->order = malloc(instance->suite->count * sizeof(int) + 1);
+    if (instance->order == NULL){
+        printf("Unable to allocate test order\n");
+        r = -1;
+        goto on_order_error;
+    }
+    for (int i = 0; i < instance->suite->count; i++){
+        instance->order[i] = i;
+    }
+    instance->count = instance->suite->count;
+
     chili_bind_fixture(instance->bind_handle,
                        &instance->fixture);
+    instance->latency = chili_bind_latency(instance->bind_handle);
 
     instance->report_progress = report_progress;
 
     *handle = instance;
     return 1;
 
+on_order_error:
+    chili_bind_destroy(instance->bind_handle);
 on_bind_error:
 on_build_error:
-    chili_suite_destroy(instance->suite_handle);
+    _release_suite(instance);
 on_suite_error:
-    chili_sym_destroy(instance->sym_handle);
-on_sym_error:
     free(instance);
     return r;
 }
 
+int chili_lib_index(const char *path, int *num_tests)
+{
+    struct instance instance = { .path = path };
+    bool parsed;
+    int r;
+
+    r = _find_suite(&instance, &parsed);
+    if (r < 0){
+        return r;
+    }
+    r = chili_suite_get(instance.suite_handle, &instance.suite);
+    if (r > 0){
+        *num_tests = instance.suite->count;
+        r = parsed && instance.identified ?
+            chili_manifest_write(_manifests, path, &instance.library_stat,
+                                 instance.suite) : 0;
+    }
+    _release_suite(&instance);
+
+    return r;
+}
+
 int chili_lib_before_fixture(chili_handle handle)
 {
     struct instance *instance = (struct instance*)handle;
@@ -169,6 +336,59 @@ int chili_lib_before_fixture(chili_handle handle)
     return chili_run_before(&instance->fixture);
 }
 
+int chili_lib_run_first(chili_handle handle,
+                        chili_lib_select select,
+                        void *context)
+{
+    struct instance *instance = (struct instance*)handle;
+    const struct chili_suite *suite = instance->suite;
+    int *rest;
+    int index;
+    int first = 0;
+    int others = 0;
+
+    rest = malloc(suite->count * sizeof(int) + 1);
+    if (rest == NULL){
+        printf("Unable to allocate test order\n");
+        return -1;
+    }
+
+    /* Stable partition of current order */
+    for (int i = 0; i < instance->count; i++){
+        index = instance->order[i];
+        if (select(context, instance->path, suite->tests[index])){
+            instance->order[first++] = index;
+        }
+        else{
+            rest[others++] = index;
+        }
+    }
+    memcpy(&instance->order[first], rest, others * sizeof(int));
+
+    free(rest);
+    return 1;
+}
+
+int chili_lib_skip(chili_handle handle,
+                   chili_lib_select select,
+                   void *context)
+{
+    struct instance *instance = (struct instance*)handle;
+    const struct chili_suite *suite = instance->suite;
+    int index;
+    int kept = 0;
+
+    for (int i = 0; i < instance->count; i++){
+        index = instance->order[i];
+        if (!select(context, instance->path, suite->tests[index])){
+            instance->order[kept++] = index;
+        }
+    }
+    instance->count = kept;
+
+    return kept;
+}
+
 int chili_lib_next_test(chili_handle handle,
                         int *pindex,
                         struct chili_times *times,
@@ -179,12 +399,12 @@ int chili_lib_next_test(chili_handle handle,
     int r;
     int index = *pindex;
 
-    if (index >= instance->suite->count){
+    if (index >= instance->count){
         /* No more tests */
         return 0;
     }
 
-    r = _run_test(instance, index,
+    r = _run_test(instance, instance->order[index],
                   times, result, aggregated);
     if (r > 0){
         *pindex = index + 1;
@@ -193,6 +413,38 @@ int chili_lib_next_test(chili_handle handle,
     return r;
 }
 
+int chili_lib_next_bench(chili_handle handle,
+                         chili_handle bench_handle,
+                         int *pindex,
+                         const struct chili_bench_options *options,
+                         struct chili_bench_result *result,
+                         struct chili_aggregated *aggregated)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct chili_bind_test bench;
+    int r;
+    int index = *pindex;
+
+    if (index >= instance->suite->bench_count){
+        /* No more benchmarks */
+        return 0;
+    }
+
+    r = chili_bind_bench(instance->bind_handle, index, &bench);
+    if (r <= 0){
+        return r;
+    }
+
+    r = chili_bench_run(bench_handle, result, aggregated, &bench,
+                        &instance->fixture, instance->latency,
+                        options, instance->report_progress);
+    if (r > 0){
+        *pindex = index + 1;
+    }
+
+    return r;
+}
+
 int chili_lib_named_test(chili_handle handle,
                          const char *name,
                          struct chili_times *times,
@@ -240,6 +492,14 @@ int chili_lib_after_fixture(chili_handle handle)
     return chili_run_after(&instance->fixture);
 }
 
+char **chili_lib_tests(chili_handle handle, int *count)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    *count = instance->suite->count;
+    return instance->suite->tests;
+}
+
 int chili_lib_print_tests(chili_handle handle)
 {
     struct instance *instance = (struct instance*)handle;
@@ -255,8 +515,8 @@ void chili_lib_destroy(chili_handle handle)
     struct instance *instance = (struct instance*)handle;
 
     chili_bind_destroy(instance->bind_handle);
-    chili_suite_destroy(instance->suite_handle);
-    chili_sym_destroy(instance->sym_handle);
+    _release_suite(instance);
 
+    free(instance->order);
     free(instance);
 }
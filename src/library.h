@@ -1,8 +1,42 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "handle.h"
 #include "run.h"
+#include "bench.h"
+
 
+/**
+ * @brief Sets directory of manifests used by libraries.
+ *
+ * Libraries created after this call take their suite from
+ * a manifest when there is one for the library as it is,
+ * otherwise symbols are parsed and, when writing, a manifest
+ * is written.
+ *
+ * @param directory Directory of manifests, NULL to parse
+ *                  symbols of every library.
+ * @param write     Write manifests of parsed libraries,
+ *                  creating directory if missing.
+ */
+void chili_lib_manifests(const char *directory, bool write);
+
+/**
+ * @brief Writes manifest of library unless it is up to date.
+ *
+ * Library is not loaded. Needs a directory of manifests
+ * that are written.
+ *
+ * @param library_path Path to shared library containing
+ *                     tests.
+ * @param num_tests    Set to number of tests in library.
+ *
+ * @return Negative on error.
+ *         Zero when manifest was up to date.
+ *         Positive when manifest was written.
+ */
+int chili_lib_index(const char *library_path, int *num_tests);
 
 /**
  * @brief Initializes a library containing tests.
@@ -34,6 +68,36 @@ int chili_lib_create(const char *library_path,
  */
 int chili_lib_before_fixture(chili_handle handle);
 
+/* Selects tests to run before the others */
+typedef bool (*chili_lib_select)(void *context,
+                                 const char *library_path,
+                                 const char *test_name);
+
+/**
+ * @brief Moves selected tests ahead of the others.
+ *
+ * Order among selected tests and among the rest is kept.
+ * Affects following calls to next test.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_lib_run_first(chili_handle handle,
+                        chili_lib_select select,
+                        void *context);
+
+/**
+ * @brief Leaves selected tests out.
+ *
+ * Affects following calls to next test.
+ *
+ * @return Negative on error.
+ *         Otherwise number of tests left to run.
+ */
+int chili_lib_skip(chili_handle handle,
+                   chili_lib_select select,
+                   void *context);
+
 /**
  * @brief Runs next test in library.
  *
@@ -50,6 +114,21 @@ int chili_lib_next_test(chili_handle handle,
                         struct chili_result *result,
                         struct chili_aggregated *aggregated);
 
+/**
+ * @brief Runs next benchmark in library.
+ *
+ * @param bench_handle Benchmark runner instance.
+ *
+ * @return Negative on error, positive on success, zero if
+ *         no more benchmarks exists in suite.
+ */
+int chili_lib_next_bench(chili_handle handle,
+                         chili_handle bench_handle,
+                         int *index,
+                         const struct chili_bench_options *options,
+                         struct chili_bench_result *result,
+                         struct chili_aggregated *aggregated);
+
 /**
  * @brief Runs test in library by name.
  *
@@ -87,6 +166,15 @@ int chili_lib_debug_test(chili_handle handle,
  */
 int chili_lib_after_fixture(chili_handle handle);
 
+/**
+ * @brief Gets names of all tests in library.
+ *
+ * @param count Set to number of tests.
+ *
+ * @return Names valid until library is destroyed.
+ */
+char **chili_lib_tests(chili_handle handle, int *count);
+
 /**
  * @brief Prints all tests in library to stdout.
  *
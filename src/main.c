@@ -1,10 +1,14 @@
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <getopt.h>
 #include <stdbool.h>
 #include <signal.h>
 
 #include "command.h"
+#include "memory.h"
+#include "select.h"
+#include "shard.h"
 
 /* Debugging */
 #define DEBUG_PRINTS 0
@@ -20,6 +24,30 @@ static const char *_option_named_path =
       "  <path>...\n"
       "    Path to file containing names of tests to run.\n";
 
+static const char *_option_changed_files =
+      "  -F, --changed-files <path>\n"
+      "    File with paths of changed files, one per line, like\n"
+      "    the output of 'git diff --name-only'. Use - to read\n"
+      "    them from stdin. Paths are matched by their ending,\n"
+      "    so paths relative to the root of a repository work.\n";
+
+static const char *_option_changed_symbols =
+      "  -S, --changed-symbols <path>\n"
+      "    File with names of changed functions, one per line.\n"
+      "    Tests whose coverage, recorded with --coverage, reaches\n"
+      "    any of them are affected, and so are tests without\n"
+      "    recorded coverage. Use - to read them from stdin.\n";
+
+static const char *_option_redundant =
+      "  -r, --redundant\n"
+      "    Only list tests whose coverage, recorded with\n"
+      "    --coverage, adds nothing to the other tests.\n";
+
+static const char *_option_run =
+      "  -r, --run\n"
+      "    Run affected tests like 'named' instead of listing\n"
+      "    them.\n";
+
 static const char *_option_color =
       "  -c, --color\n"
       "    Enable colored output.\n";
@@ -40,6 +68,189 @@ static const char *_option_interactive =
       "    Turns on cursor movements, colored output and\n"
       "    nice output.\n";
 
+static const char *_option_jobs =
+      "  -j, --jobs <count> | auto\n"
+      "    Number of libraries to run at the same time. Each\n"
+      "    library is run by a process of its own that does\n"
+      "    suite setup, all tests and suite teardown. Tests are\n"
+      "    reported in the order the libraries are given, tests\n"
+      "    of a library are held back until the libraries before\n"
+      "    it are done. Defaults to 1.\n"
+      "    With auto, as many as there are cpus available to\n"
+      "    chili, limited by affinity and cgroup cpu quota.\n"
+      "    Fewer libraries are run while the cgroup is throttled.\n";
+
+static const char *_option_plan =
+      "  -p, --plan\n"
+      "    Print in which order and job libraries would be run\n"
+      "    and the predicted duration of the run, without running\n"
+      "    anything. Predictions are based on durations recorded\n"
+      "    in earlier runs. With more than one job the longest\n"
+      "    libraries are started first.\n";
+
+static const char *_option_resume =
+      "  -R, --resume\n"
+      "    Leave out tests completed by an interrupted run of the\n"
+      "    same libraries, tests and options, and report their\n"
+      "    results from its journal in chili_log/journal as if they\n"
+      "    were run again. Every run keeps the journal until it\n"
+      "    completes. Only when tests are run here, one at a time\n"
+      "    or with jobs.\n";
+
+static const char *_option_memory =
+      "  -M, --memory <size>\n"
+      "    Memory that libraries run at the same time may use\n"
+      "    together, like 512M or 4G. A library is only started\n"
+      "    when the peak memory recorded for its tests in earlier\n"
+      "    runs fits. Libraries without recorded peak are assumed\n"
+      "    to need at least half. Defaults to the cgroup memory\n"
+      "    limit, if any.\n";
+
+static const char *_option_memory_workers =
+      "  -M, --memory <size>\n"
+      "    Memory that tests run by workers at the same time may\n"
+      "    use together, like 512M or 4G. A test is only handed\n"
+      "    out when the peak memory recorded for it in earlier\n"
+      "    runs fits. Tests without recorded peak are assumed to\n"
+      "    need at least half. Defaults to the cgroup memory\n"
+      "    limit, if any.\n";
+
+static const char *_option_time_budget =
+      "  -t, --time-budget <duration>\n"
+      "    Only run the tests predicted to find most failures\n"
+      "    within duration, like 90s or 5m. Tests that failed\n"
+      "    last run, tests in changed libraries and cheap tests\n"
+      "    are preferred, based on earlier runs. Tests are run\n"
+      "    one at a time and skipped tests are listed in\n"
+      "    chili_log/skipped.\n";
+
+static const char *_option_shard =
+      "  -s, --shard <index>/<count>\n"
+      "    Only run the tests of one of count shards, numbered\n"
+      "    from 1. Every shard run with the same tests and\n"
+      "    history gets the same tests. Tests are balanced over\n"
+      "    the shards by recorded duration, tests never run are\n"
+      "    spread by hash of their name. Combine the results of\n"
+      "    all shards, written to chili_log/results, with\n"
+      "    'chili merge'.\n";
+
+static const char *_option_workers =
+      "  -w, --workers <count>\n"
+      "    Number of worker processes that run tests at the same\n"
+      "    time. Each test is handed out to the first worker that\n"
+      "    is free, a worker sets up a library the first time it\n"
+      "    runs a test in it. Tests are reported in the order\n"
+      "    they would run one at a time and run again by another\n"
+      "    worker when their worker dies. Defaults to run tests\n"
+      "    one at a time.\n";
+
+static const char *_option_pin =
+      "  -P, --pin\n"
+      "    Pin each concurrently run library or worker, and its\n"
+      "    tests, to a cpu of its own. One cpu of each physical\n"
+      "    core is used first, filling one socket before the\n"
+      "    next, SMT siblings last. The cpu is recorded in the\n"
+      "    result log of each test. Needs --jobs or --workers.\n";
+
+static const char *_option_force =
+      "  -f, --force\n"
+      "    Run libraries whose results are cached as well. A\n"
+      "    library is cached when all of its tests succeeded and\n"
+      "    neither it, the libraries it needs, the environment\n"
+      "    they are loaded in nor chili has changed since.\n";
+
+static const char *_option_cache_tests =
+      "  -T, --cache-tests\n"
+      "    Don't run tests that passed last time and whose machine\n"
+      "    code, code of suite and test fixtures and budget are\n"
+      "    the same. Functions that tests call are not compared,\n"
+      "    a test may pass from cache even if a function it calls\n"
+      "    has changed.\n";
+
+static const char *_option_coverage =
+      "  -C, --coverage\n"
+      "    Record the edges each test reaches in libraries built\n"
+      "    with -fsanitize-coverage=trace-pc-guard or trace-pc,\n"
+      "    in chili_log/coverage. Only when tests are run one at\n"
+      "    a time.\n";
+
+static const char *_option_server =
+      "  -u, --server <path>\n"
+      "    Unix socket of a 'chili serve' to run tests in instead,\n"
+      "    with libraries kept loaded and set up between runs.\n"
+      "    Test output is redirected by the server to the same\n"
+      "    directory as when run here.\n";
+
+static const char *_option_serve_socket =
+      "  -u, --server <path>\n"
+      "    Unix socket to serve at, defaults to ./chili.sock.\n";
+
+static const char *_option_log =
+      "  -l, --log <path>\n"
+      "    Directory to redirect test output to. Output is not\n"
+      "    redirected if not specified.\n";
+
+static const char *_option_results_path =
+      "  <path>...\n"
+      "    Path to result logs written by shards. All shards\n"
+      "    must be given.\n";
+
+static const char *_option_compared_path =
+      "  <path>...\n"
+      "    Path to result logs of runs, oldest first. The last\n"
+      "    two are compared, earlier ones tell which tests are\n"
+      "    flaky.\n";
+
+static const char *_option_threshold =
+      "  -t, --threshold <percent>\n"
+      "    How much longer a test may take, or how much more\n"
+      "    cpu time or memory it may use, before it has\n"
+      "    regressed. Defaults to 10.\n";
+
+static const char *_option_samples =
+      "  -s, --samples <count>\n"
+      "    Minimum number of samples to take of each benchmark.\n"
+      "    Defaults to 10.\n";
+
+static const char *_option_ci_width =
+      "  -w, --ci-width <percent>\n"
+      "    Keep sampling until the 95% confidence interval of\n"
+      "    the median is narrower than this percentage of the\n"
+      "    median. Defaults to 5.\n";
+
+static const char *_option_max_time =
+      "  -x, --max-time <seconds>\n"
+      "    Stop sampling a benchmark after this many seconds\n"
+      "    even if the interval is still too wide. Applies to\n"
+      "    warm and cold samples separately. Defaults to 10.\n";
+
+static const char *_option_iterations =
+      "  -t, --iterations <count>\n"
+      "    Number of calls to benchmark function in each\n"
+      "    sample. Defaults to 100.\n";
+
+static const char *_option_cold =
+      "  -C, --cold\n"
+      "    Also take samples with caches evicted. Before each\n"
+      "    cold sample a buffer larger than the last level\n"
+      "    cache is streamed through, then the benchmark is\n"
+      "    called once. Reported next to the warm samples.\n";
+
+static const char *_option_fresh =
+      "  -F, --fresh\n"
+      "    Take each cold sample in a new process to also start\n"
+      "    with cold page tables and TLB. Implies --cold.\n";
+
+static const char *_option_isolate =
+      "  -p, --isolate\n"
+      "    Pin benchmarks to one cpu, an isolated one if the\n"
+      "    kernel has any, and raise priority if permitted.\n";
+
+static const char *_option_export =
+      "  -e, --export <path>\n"
+      "    Export benchmark results and latency histograms\n"
+      "    to file.\n";
+
 static void _display_usage()
 {
     printf(
@@ -50,11 +261,22 @@ static void _display_usage()
       "Running tests\n"
       "  all     Runs all tests in specified shared libraries\n"
       "  named   Runs all named tests\n"
+      "  rerun-failed\n"
+      "          Runs tests that didn't succeed in the last run\n"
+      "  bench   Runs all benchmarks in specified shared libraries\n"
       "  debug   Prepares to run a named test but waits until\n"
       "          a debugger is attached.\n"
+      "  watch   Runs tests again when shared libraries are rebuilt\n"
+      "  serve   Keeps shared libraries loaded for other commands\n"
       "\n"
       "Other\n"
       "  list    Lists all tests in specified shared libraries\n"
+      "  affected\n"
+      "          Lists tests affected by changed source files\n"
+      "  merge   Reports results of all shards as one run\n"
+      "  compare Reports how a run differs from earlier runs\n"
+      "  index   Saves tests of shared libraries for later runs\n"
+      "  worker  Runs tests handed out by another chili\n"
       "  help    Shows help about a specified command\n");
 }
 
@@ -62,7 +284,12 @@ static void _display_all_usage()
 {
     printf(
       "chili all [--color | -c] [--cursor | -m] [--interactive | -i]\n"
-      "          <path>...\n"
+      "          [--jobs | -j <count> | auto] [--memory | -M <size>]\n"
+      "          [--time-budget | -t <duration>]\n"
+      "          [--shard | -s <index>/<count>] [--pin | -P]\n"
+      "          [--force | -f] [--cache-tests | -T]\n"
+      "          [--coverage | -C] [--plan | -p] [--resume | -R]\n"
+      "          [--server | -u <path>] <path>...\n"
       "\n"
       "DESCRIPTION\n"
       "  Runs all tests that can be found in the specified shared\n"
@@ -73,16 +300,34 @@ static void _display_all_usage()
       "%s\n" /* Color       */
       "%s\n" /* Cursor      */
       "%s\n" /* Nice        */
-      "%s",  /* Interactive */
+      "%s\n" /* Interactive */
+      "%s\n" /* Jobs        */
+      "%s\n" /* Memory      */
+      "%s\n" /* Time budget */
+      "%s\n" /* Shard       */
+      "%s\n" /* Pin         */
+      "%s\n" /* Force       */
+      "%s\n" /* Cache tests */
+      "%s\n" /* Coverage    */
+      "%s\n" /* Plan        */
+      "%s\n" /* Resume      */
+      "%s",  /* Server      */
       _option_path, _option_color, _option_cursor, _option_nice,
-      _option_interactive);
+      _option_interactive, _option_jobs, _option_memory,
+      _option_time_budget, _option_shard, _option_pin, _option_force,
+      _option_cache_tests, _option_coverage, _option_plan,
+      _option_resume, _option_server);
 }
 
 static void _display_named_usage()
 {
     printf(
       "chili named [--color | -c] [--cursor | -m] [--interactive | -i]\n"
-      "            [<path>]\n"
+      "            [--time-budget | -t <duration>]\n"
+      "            [--shard | -s <index>/<count>]\n"
+      "            [--workers | -w <count>] [--memory | -M <size>]\n"
+      "            [--pin | -P] [--coverage | -C] [--resume | -R]\n"
+      "            [--server | -u <path>] [<path>]\n"
       "\n"
       "DESCRIPTION\n"
       "  Runs all named tests in the specified order.\n"
@@ -96,9 +341,87 @@ static void _display_named_usage()
       "%s\n" /* Color       */
       "%s\n" /* Cursor      */
       "%s\n" /* Nice        */
-      "%s",  /* Interactive */
+      "%s\n" /* Interactive */
+      "%s\n" /* Time budget */
+      "%s\n" /* Shard       */
+      "%s\n" /* Workers     */
+      "%s\n" /* Memory      */
+      "%s\n" /* Pin         */
+      "%s\n" /* Coverage    */
+      "%s\n" /* Resume      */
+      "%s",  /* Server      */
       _option_named_path, _option_color, _option_cursor, _option_nice,
-      _option_interactive);
+      _option_interactive, _option_time_budget, _option_shard,
+      _option_workers, _option_memory_workers, _option_pin,
+      _option_coverage, _option_resume, _option_server);
+}
+
+static void _display_rerun_failed_usage()
+{
+    printf(
+      "chili rerun-failed [--color | -c] [--cursor | -m]\n"
+      "                   [--interactive | -i] [--workers | -w <count>]\n"
+      "                   [--pin | -P] [--coverage | -C]\n"
+      "                   [--server | -u <path>]\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Runs tests that failed, errored, crashed, timed out or went\n"
+      "  over budget in the last run, like 'named'. Every run saves\n"
+      "  them in chili_log/failed, on the form read by 'named', and\n"
+      "  so does this one: run it again until all succeed.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s\n" /* Color       */
+      "%s\n" /* Cursor      */
+      "%s\n" /* Nice        */
+      "%s\n" /* Interactive */
+      "%s\n" /* Workers     */
+      "%s\n" /* Pin         */
+      "%s\n" /* Coverage    */
+      "%s",  /* Server      */
+      _option_color, _option_cursor, _option_nice, _option_interactive,
+      _option_workers, _option_pin, _option_coverage, _option_server);
+}
+
+static void _display_bench_usage()
+{
+    printf(
+      "chili bench [--color | -c] [--interactive | -i]\n"
+      "            [--samples | -s <count>] [--iterations | -t <count>]\n"
+      "            [--ci-width | -w <percent>] [--max-time | -x <seconds>]\n"
+      "            [--cold | -C] [--fresh | -F] [--isolate | -p]\n"
+      "            [--export | -e <path>] <path>...\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Runs all benchmarks that can be found in the specified\n"
+      "  shared libraries. Benchmarks are named with the prefix\n"
+      "  bench_ and return like tests. Time per call is reported\n"
+      "  together with percentiles of latencies recorded by the\n"
+      "  benchmark through chili/latency.h.\n"
+      "  Noisy benchmarks are sampled longer than stable ones.\n"
+      "  Outliers are counted and reported but never dropped.\n"
+      "  Governor, turbo, load and steal time are reported with\n"
+      "  each benchmark, which is flagged noisy when the machine\n"
+      "  was busy or its frequency policy changed.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s\n" /* Path        */
+      "%s\n" /* Color       */
+      "%s\n" /* Cursor      */
+      "%s\n" /* Nice        */
+      "%s\n" /* Interactive */
+      "%s\n" /* Samples     */
+      "%s\n" /* CI width    */
+      "%s\n" /* Max time    */
+      "%s\n" /* Iterations  */
+      "%s\n" /* Cold        */
+      "%s\n" /* Fresh       */
+      "%s\n" /* Isolate     */
+      "%s",   /* Export      */
+      _option_path, _option_color, _option_cursor, _option_nice,
+      _option_interactive, _option_samples, _option_ci_width,
+      _option_max_time, _option_iterations, _option_cold, _option_fresh,
+      _option_isolate, _option_export);
 }
 
 static void _display_debug_usage()
@@ -123,29 +446,206 @@ static void _display_debug_usage()
 static void _display_list_usage()
 {
     printf(
-      "chili list <path>...\n"
+      "chili list [--redundant | -r] [--server | -u <path>] <path>...\n"
       "\n"
       "DESCRIPTION\n"
       "  Prints all tests that can be found in the specified shared\n"
       "  libraries.\n"
       "\n"
       "OPTIONS\n"
+      "%s\n" /* Path      */
+      "%s\n" /* Redundant */
+      "%s",  /* Server    */
+      _option_path, _option_redundant, _option_server);
+}
+
+static void _display_index_usage()
+{
+    printf(
+      "chili index <path>...\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Saves the tests, benchmarks and fixtures of the specified\n"
+      "  shared libraries to chili_log/manifests without loading\n"
+      "  them. Other commands read the tests of a library from\n"
+      "  there instead of its symbols until it is rebuilt.\n"
+      "\n"
+      "OPTIONS\n"
       "%s",  /* Path */
       _option_path);
 }
 
+static void _display_affected_usage()
+{
+    printf(
+      "chili affected [--changed-files | -F <path>]\n"
+      "               [--changed-symbols | -S <path>] [--run | -r]\n"
+      "               [--resume | -R] [--color | -c] [--nice | -n]\n"
+      "               <path>...\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Lists tests in the specified shared libraries that are\n"
+      "  affected by changed files, on the form used by 'named'.\n"
+      "  A test is affected when a source file, or a header it\n"
+      "  includes, of the compilation unit the test is in is\n"
+      "  changed, read from the line number information of\n"
+      "  libraries built with -g. All tests of a library are\n"
+      "  affected when the library or a library it needs is\n"
+      "  changed, or when it is built without -g.\n"
+      "  With changed functions, a test is affected when its\n"
+      "  recorded coverage reaches any of them.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s\n" /* Path            */
+      "%s\n" /* Changed files   */
+      "%s\n" /* Changed symbols */
+      "%s\n" /* Run             */
+      "%s\n" /* Resume          */
+      "%s\n" /* Color           */
+      "%s",  /* Nice            */
+      _option_path, _option_changed_files, _option_changed_symbols,
+      _option_run, _option_resume, _option_color, _option_nice);
+}
+
+static void _display_watch_usage()
+{
+    printf(
+      "chili watch [--color | -c] [--cursor | -m] [--interactive | -i]\n"
+      "            [--jobs | -j <count> | auto] [--force | -f]\n"
+      "            [--cache-tests | -T] <path>...\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Runs all tests in the specified shared libraries like\n"
+      "  'all', then runs the tests of each library again when\n"
+      "  it is rebuilt, until stopped with Ctrl-C. A library is\n"
+      "  rebuilt when it is complete and nothing has written to\n"
+      "  it for a moment. Libraries rebuilt together are run\n"
+      "  together and a run is cancelled when one of its\n"
+      "  libraries is rebuilt again.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s\n" /* Path        */
+      "%s\n" /* Color       */
+      "%s\n" /* Cursor      */
+      "%s\n" /* Nice        */
+      "%s\n" /* Interactive */
+      "%s\n" /* Jobs        */
+      "%s\n" /* Force       */
+      "%s",  /* Cache tests */
+      _option_path, _option_color, _option_cursor, _option_nice,
+      _option_interactive, _option_jobs, _option_force,
+      _option_cache_tests);
+}
+
+static void _display_serve_usage()
+{
+    printf(
+      "chili serve [--server | -u <path>]\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Serves 'all', 'named' and 'list' given --server, until\n"
+      "  stopped with Ctrl-C. Libraries are loaded when first\n"
+      "  asked for and kept loaded, with suite setup done when a\n"
+      "  test in them is first run, so that only the tests are\n"
+      "  run by later commands. A library whose file has changed\n"
+      "  is teared down and loaded again. Results are reported\n"
+      "  by the command that asked for them.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s",  /* Server */
+      _option_serve_socket);
+}
+
+static void _display_merge_usage()
+{
+    printf(
+      "chili merge [--color | -c] [--nice | -n] <path>...\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Reports results written by all shards of a run as if\n"
+      "  they were one run, with the same exit code. Durations\n"
+      "  are recorded in chili_log/history, copy it to the shards\n"
+      "  to balance them by duration in the next run.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s\n" /* Path  */
+      "%s\n" /* Color */
+      "%s",  /* Nice  */
+      _option_results_path, _option_color, _option_nice);
+}
+
+static void _display_compare_usage()
+{
+    printf(
+      "chili compare [--threshold | -t <percent>] <path>...\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Compares result logs that 'all' and 'named' write to\n"
+      "  chili_log/results, copy the log before the next run.\n"
+      "  Lists tests that are newly failing, newly passing,\n"
+      "  flaky or have regressed, and how long tests in both\n"
+      "  runs took in each library. Exits with failure when any\n"
+      "  test is newly failing or has regressed.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s\n" /* Path      */
+      "%s",  /* Threshold */
+      _option_compared_path, _option_threshold);
+}
+
+static void _display_worker_usage()
+{
+    printf(
+      "chili worker [--log | -l <path>]\n"
+      "\n"
+      "DESCRIPTION\n"
+      "  Runs named tests read from stdin, one per line, and\n"
+      "  writes results to stdout in a binary format read by\n"
+      "  'chili named --workers'. Libraries are set up when\n"
+      "  a test in them is first run and teared down when stdin\n"
+      "  is closed. Anything else is printed to stderr.\n"
+      "\n"
+      "OPTIONS\n"
+      "%s",  /* Log */
+      _option_log);
+}
+
+static int _parse_server(const char *path,
+                         struct chili_test_options *options)
+{
+    if (strlen(path) >= sizeof(options->server_path)){
+        printf("Path of socket is too long\n");
+        return -1;
+    }
+    strcpy(options->server_path, path);
+
+    return 1;
+}
+
 static int _handle_all_command(int argc, char *argv[])
 {
     int c;
     const char **paths;
     int num_paths = 0;
-    const char *short_options = "icmnh:";
+    const char *short_options = "icmnhj:M:t:s:pPfTCRu:";
     const struct option long_options[] = {
         { "interactive", no_argument,       0, 'i' },
         { "color",       no_argument,       0, 'c' },
         { "cursor",      no_argument,       0, 'm' },
         { "nice",        no_argument,       0, 'n' },
         { "help",        no_argument,       0, 'h' },
+        { "jobs",        required_argument, 0, 'j' },
+        { "memory",      required_argument, 0, 'M' },
+        { "time-budget", required_argument, 0, 't' },
+        { "shard",       required_argument, 0, 's' },
+        { "plan",        no_argument,       0, 'p' },
+        { "pin",         no_argument,       0, 'P' },
+        { "force",       no_argument,       0, 'f' },
+        { "cache-tests", no_argument,       0, 'T' },
+        { "coverage",    no_argument,       0, 'C' },
+        { "resume",      no_argument,       0, 'R' },
+        { "server",      required_argument, 0, 'u' },
+        { 0,             0,                 0, 0   },
     };
     int index;
     struct chili_test_options options;
@@ -155,6 +655,7 @@ static int _handle_all_command(int argc, char *argv[])
     /* Default to redirect test output to local directory */
     strcpy(options.redirect_path, "./chili_log");
     options.use_redirect = true;
+    options.jobs = 1;
 
     do {
         c = getopt_long(argc, argv, short_options,
@@ -174,6 +675,63 @@ static int _handle_all_command(int argc, char *argv[])
             case 'n':
                 options.nice_stats = true;
                 break;
+            case 'j':
+                if (strcmp(optarg, "auto") == 0){
+                    options.jobs = CHILI_JOBS_AUTO;
+                    break;
+                }
+                options.jobs = atoi(optarg);
+                if (options.jobs <= 0){
+                    printf("Jobs must be positive or auto\n");
+                    return -1;
+                }
+                break;
+            case 'M':
+                if (chili_memory_parse_size(optarg,
+                                            &options.memory_kb) < 0 ||
+                    options.memory_kb == 0){
+                    printf("Memory must be a size like 512M or 4G\n");
+                    return -1;
+                }
+                break;
+            case 't':
+                if (chili_select_parse_duration(optarg,
+                                                &options.time_budget_ns) < 0 ||
+                    options.time_budget_ns == 0){
+                    printf("Time budget must be a duration like 90s\n");
+                    return -1;
+                }
+                break;
+            case 's':
+                if (chili_shard_parse(optarg, &options.shard_index,
+                                      &options.shard_count) < 0){
+                    printf("Shard must be like 2/4\n");
+                    return -1;
+                }
+                break;
+            case 'p':
+                options.plan = true;
+                break;
+            case 'P':
+                options.pin = true;
+                break;
+            case 'f':
+                options.force = true;
+                break;
+            case 'T':
+                options.cache_tests = true;
+                break;
+            case 'C':
+                options.coverage = true;
+                break;
+            case 'R':
+                options.resume = true;
+                break;
+            case 'u':
+                if (_parse_server(optarg, &options) < 0){
+                    return -1;
+                }
+                break;
             case 'h':
                 _display_all_usage();
                 return -1;
@@ -193,6 +751,12 @@ static int _handle_all_command(int argc, char *argv[])
     /* Need to reset to be able to parse again */
     optind = 0;
 
+    /* Only concurrently run libraries are pinned */
+    if (options.pin && options.jobs == 1){
+        printf("Pinning needs more than one job, use --jobs\n");
+        return -1;
+    }
+
     return chili_command_all(paths, num_paths, &options);
 }
 
@@ -200,13 +764,22 @@ static int _handle_named_command(int argc, char *argv[])
 {
     int c;
     const char *path;
-    const char *short_options = "icmnh:";
+    const char *short_options = "icmnt:s:w:M:PCRu:h:";
     const struct option long_options[] = {
         { "interactive", no_argument,       0, 'i' },
         { "color",       no_argument,       0, 'c' },
         { "cursor",      no_argument,       0, 'm' },
         { "nice",        no_argument,       0, 'n' },
+        { "time-budget", required_argument, 0, 't' },
+        { "shard",       required_argument, 0, 's' },
+        { "workers",     required_argument, 0, 'w' },
+        { "memory",      required_argument, 0, 'M' },
+        { "pin",         no_argument,       0, 'P' },
+        { "coverage",    no_argument,       0, 'C' },
+        { "resume",      no_argument,       0, 'R' },
+        { "server",      required_argument, 0, 'u' },
         { "help",        no_argument,       0, 'h' },
+        { 0,             0,                 0, 0   },
     };
     int index;
     struct chili_test_options options;
@@ -235,6 +808,50 @@ static int _handle_named_command(int argc, char *argv[])
             case 'n':
                 options.nice_stats = true;
                 break;
+            case 't':
+                if (chili_select_parse_duration(optarg,
+                                                &options.time_budget_ns) < 0 ||
+                    options.time_budget_ns == 0){
+                    printf("Time budget must be a duration like 90s\n");
+                    return -1;
+                }
+                break;
+            case 's':
+                if (chili_shard_parse(optarg, &options.shard_index,
+                                      &options.shard_count) < 0){
+                    printf("Shard must be like 2/4\n");
+                    return -1;
+                }
+                break;
+            case 'w':
+                options.workers = atoi(optarg);
+                if (options.workers <= 0){
+                    printf("Workers must be positive\n");
+                    return -1;
+                }
+                break;
+            case 'M':
+                if (chili_memory_parse_size(optarg,
+                                            &options.memory_kb) < 0 ||
+                    options.memory_kb == 0){
+                    printf("Memory must be a size like 512M or 4G\n");
+                    return -1;
+                }
+                break;
+            case 'P':
+                options.pin = true;
+                break;
+            case 'C':
+                options.coverage = true;
+                break;
+            case 'R':
+                options.resume = true;
+                break;
+            case 'u':
+                if (_parse_server(optarg, &options) < 0){
+                    return -1;
+                }
+                break;
             case 'h':
                 _display_all_usage();
                 return -1;
@@ -251,86 +868,678 @@ static int _handle_named_command(int argc, char *argv[])
     /* Need to reset to be able to parse again */
     optind = 0;
 
+    /* Only workers are pinned */
+    if (options.pin && options.workers == 0){
+        printf("Pinning needs workers, use --workers\n");
+        return -1;
+    }
+
     return chili_command_named(path, &options);
 }
 
-static int _handle_debug_command(const char * chili_path,
-                                 int argc, char *argv[])
+static int _handle_rerun_failed_command(int argc, char *argv[])
 {
     int c;
-    char *test_name = NULL;
-    const char *short_options = "h:";
+    const char *short_options = "icmnw:PCu:h";
     const struct option long_options[] = {
-        { "help", no_argument, 0, 'h' },
+        { "interactive", no_argument,       0, 'i' },
+        { "color",       no_argument,       0, 'c' },
+        { "cursor",      no_argument,       0, 'm' },
+        { "nice",        no_argument,       0, 'n' },
+        { "workers",     required_argument, 0, 'w' },
+        { "pin",         no_argument,       0, 'P' },
+        { "coverage",    no_argument,       0, 'C' },
+        { "server",      required_argument, 0, 'u' },
+        { "help",        no_argument,       0, 'h' },
+        { 0,             0,                 0, 0   },
     };
     int index;
+    struct chili_test_options options;
+
+    memset(&options, 0, sizeof(options));
+
+    /* Default to redirect test output to local directory */
+    strcpy(options.redirect_path, "./chili_log");
+    options.use_redirect = true;
 
     do {
         c = getopt_long(argc, argv, short_options,
                         long_options, &index);
         switch (c){
+            case 'i':
+                options.use_color = true;
+                options.use_cursor = true;
+                options.nice_stats = true;
+                break;
+            case 'c':
+                options.use_color = true;
+                break;
+            case 'm':
+                options.use_cursor = true;
+                break;
+            case 'n':
+                options.nice_stats = true;
+                break;
+            case 'w':
+                options.workers = atoi(optarg);
+                if (options.workers <= 0){
+                    printf("Workers must be positive\n");
+                    return -1;
+                }
+                break;
+            case 'P':
+                options.pin = true;
+                break;
+            case 'C':
+                options.coverage = true;
+                break;
+            case 'u':
+                if (_parse_server(optarg, &options) < 0){
+                    return -1;
+                }
+                break;
             case 'h':
-                _display_debug_usage();
+                _display_rerun_failed_usage();
                 return -1;
         }
     } while (c != -1);
 
-    if (optind < argc){
-        test_name = argv[optind];
-    }
-
     /* Need to reset to be able to parse again */
     optind = 0;
 
-    return chili_command_debug(chili_path, test_name);
+    /* Only workers are pinned */
+    if (options.pin && options.workers == 0){
+        printf("Pinning needs workers, use --workers\n");
+        return -1;
+    }
+
+    return chili_command_rerun_failed(&options);
 }
-static int _handle_list_command(int argc, char *argv[])
+
+static int _handle_bench_command(int argc, char *argv[])
 {
     int c;
     const char **paths;
     int num_paths = 0;
-    const char *short_options = "h:";
+    const char *export_path = NULL;
+    const char *short_options = "icmnhs:t:e:CFpw:x:";
     const struct option long_options[] = {
-        { "help", no_argument, 0, 'h' },
+        { "interactive", no_argument,       0, 'i' },
+        { "color",       no_argument,       0, 'c' },
+        { "cursor",      no_argument,       0, 'm' },
+        { "nice",        no_argument,       0, 'n' },
+        { "help",        no_argument,       0, 'h' },
+        { "samples",     required_argument, 0, 's' },
+        { "iterations",  required_argument, 0, 't' },
+        { "export",      required_argument, 0, 'e' },
+        { "cold",        no_argument,       0, 'C' },
+        { "fresh",       no_argument,       0, 'F' },
+        { "isolate",     no_argument,       0, 'p' },
+        { "ci-width",    required_argument, 0, 'w' },
+        { "max-time",    required_argument, 0, 'x' },
+        { 0,             0,                 0, 0   },
     };
     int index;
+    double max_time = 10.0;
+    struct chili_test_options options;
+    struct chili_bench_options bench_options;
+
+    memset(&options, 0, sizeof(options));
+    memset(&bench_options, 0, sizeof(bench_options));
+
+    /* Default to redirect benchmark output to local directory */
+    strcpy(options.redirect_path, "./chili_log");
+    options.use_redirect = true;
+
+    bench_options.samples = 10;
+    bench_options.iterations = 100;
+    bench_options.ci_width = 0.05;
 
     do {
         c = getopt_long(argc, argv, short_options,
                         long_options, &index);
         switch (c){
+            case 'i':
+                options.use_color = true;
+                options.use_cursor = true;
+                options.nice_stats = true;
+                break;
+            case 'c':
+                options.use_color = true;
+                break;
+            case 'm':
+                options.use_cursor = true;
+                break;
+            case 'n':
+                options.nice_stats = true;
+                break;
+            case 's':
+                bench_options.samples = atoi(optarg);
+                break;
+            case 't':
+                bench_options.iterations = atoi(optarg);
+                break;
+            case 'e':
+                export_path = optarg;
+                break;
+            case 'C':
+                bench_options.cold = true;
+                break;
+            case 'F':
+                bench_options.cold = true;
+                bench_options.fresh = true;
+                break;
+            case 'p':
+                bench_options.isolate = true;
+                break;
+            case 'w':
+                bench_options.ci_width = atof(optarg) / 100.0;
+                break;
+            case 'x':
+                max_time = atof(optarg);
+                break;
             case 'h':
-                _display_list_usage();
+                _display_bench_usage();
                 return -1;
         }
     } while (c != -1);
 
+    if (bench_options.samples <= 0 || bench_options.iterations <= 0 ||
+        bench_options.samples > CHILI_BENCH_MAX_SAMPLES){
+        printf("Samples must be between 1 and %d and iterations "
+               "positive\n", CHILI_BENCH_MAX_SAMPLES);
+        return -1;
+    }
+    if (max_time <= 0.0 || bench_options.ci_width < 0.0){
+        printf("Max time must be positive and CI width "
+               "not negative\n");
+        return -1;
+    }
+
+    bench_options.max_time.tv_sec = (time_t)max_time;
+    bench_options.max_time.tv_nsec =
+        (long)((max_time - (time_t)max_time) * 1000000000);
+    /* Give fixtures and the last sample time to finish */
+    bench_options.times.timeout.tv_sec =
+        bench_options.max_time.tv_sec + 60;
+
     if (optind < argc){
         paths = (const char**)&argv[optind];
         num_paths = argc - optind;
     }
     else{
         printf("Specify path to shared library "
-               "containing tests\n");
+               "containing benchmarks\n");
         return -1;
     }
 
     /* Need to reset to be able to parse again */
     optind = 0;
 
-    return chili_command_list(paths, num_paths);
+    return chili_command_bench(paths, num_paths, &options,
+                               &bench_options, export_path);
 }
 
-static int _handle_help_command(int argc, char *argv[])
+static int _handle_debug_command(const char * chili_path,
+                                 int argc, char *argv[])
 {
-    const char *command;
-
-    if (argc < 2){
-        _display_usage();
-        return 1;
-    }
+    int c;
+    char *test_name = NULL;
+    const char *short_options = "h:";
+    const struct option long_options[] = {
+        { "help", no_argument, 0, 'h' },
+    };
+    int index;
 
-    command = argv[1];
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'h':
+                _display_debug_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    if (optind < argc){
+        test_name = argv[optind];
+    }
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_debug(chili_path, test_name);
+}
+static int _handle_list_command(int argc, char *argv[])
+{
+    int c;
+    const char **paths;
+    int num_paths = 0;
+    bool redundant = false;
+    const char *short_options = "ru:h";
+    const struct option long_options[] = {
+        { "redundant", no_argument,       0, 'r' },
+        { "server",    required_argument, 0, 'u' },
+        { "help",      no_argument,       0, 'h' },
+        { 0,           0,                 0, 0   },
+    };
+    int index;
+    struct chili_test_options options;
+
+    memset(&options, 0, sizeof(options));
+    strcpy(options.redirect_path, "./chili_log");
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'r':
+                redundant = true;
+                break;
+            case 'u':
+                if (_parse_server(optarg, &options) < 0){
+                    return -1;
+                }
+                break;
+            case 'h':
+                _display_list_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    if (optind < argc){
+        paths = (const char**)&argv[optind];
+        num_paths = argc - optind;
+    }
+    else{
+        printf("Specify path to shared library "
+               "containing tests\n");
+        return -1;
+    }
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_list(paths, num_paths, redundant, &options);
+}
+
+static int _handle_index_command(int argc, char *argv[])
+{
+    int c;
+    const char **paths;
+    int num_paths = 0;
+    const char *short_options = "h";
+    const struct option long_options[] = {
+        { "help", no_argument, 0, 'h' },
+        { 0,      0,           0, 0   },
+    };
+    int index;
+    struct chili_test_options options;
+
+    memset(&options, 0, sizeof(options));
+    strcpy(options.redirect_path, "./chili_log");
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'h':
+                _display_index_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    if (optind < argc){
+        paths = (const char**)&argv[optind];
+        num_paths = argc - optind;
+    }
+    else{
+        printf("Specify path to shared library "
+               "containing tests\n");
+        return -1;
+    }
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_index(paths, num_paths, &options);
+}
+
+static int _handle_affected_command(int argc, char *argv[])
+{
+    int c;
+    const char **paths;
+    int num_paths = 0;
+    const char *files_path = NULL;
+    const char *symbols_path = NULL;
+    bool run = false;
+    const char *short_options = "F:S:rRcnh";
+    const struct option long_options[] = {
+        { "changed-files",   required_argument, 0, 'F' },
+        { "changed-symbols", required_argument, 0, 'S' },
+        { "run",             no_argument,       0, 'r' },
+        { "resume",          no_argument,       0, 'R' },
+        { "color",           no_argument,       0, 'c' },
+        { "nice",            no_argument,       0, 'n' },
+        { "help",            no_argument,       0, 'h' },
+        { 0,                 0,                 0, 0   },
+    };
+    int index;
+    struct chili_test_options options;
+
+    memset(&options, 0, sizeof(options));
+
+    /* Default to redirect test output to local directory */
+    strcpy(options.redirect_path, "./chili_log");
+    options.use_redirect = true;
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'F':
+                files_path = optarg;
+                break;
+            case 'S':
+                symbols_path = optarg;
+                break;
+            case 'r':
+                run = true;
+                break;
+            case 'R':
+                options.resume = true;
+                break;
+            case 'c':
+                options.use_color = true;
+                break;
+            case 'n':
+                options.nice_stats = true;
+                break;
+            case 'h':
+                _display_affected_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    if (files_path == NULL && symbols_path == NULL){
+        printf("Specify file with changed files or functions\n");
+        return -1;
+    }
+    if (optind < argc){
+        paths = (const char**)&argv[optind];
+        num_paths = argc - optind;
+    }
+    else{
+        printf("Specify path to shared library "
+               "containing tests\n");
+        return -1;
+    }
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_affected(files_path, symbols_path, paths,
+                                  num_paths, run, &options);
+}
+
+static int _handle_watch_command(int argc, char *argv[])
+{
+    int c;
+    const char **paths;
+    int num_paths = 0;
+    const char *short_options = "icmnhj:fT";
+    const struct option long_options[] = {
+        { "interactive", no_argument,       0, 'i' },
+        { "color",       no_argument,       0, 'c' },
+        { "cursor",      no_argument,       0, 'm' },
+        { "nice",        no_argument,       0, 'n' },
+        { "help",        no_argument,       0, 'h' },
+        { "jobs",        required_argument, 0, 'j' },
+        { "force",       no_argument,       0, 'f' },
+        { "cache-tests", no_argument,       0, 'T' },
+        { 0,             0,                 0, 0   },
+    };
+    int index;
+    struct chili_test_options options;
+
+    memset(&options, 0, sizeof(options));
+
+    /* Default to redirect test output to local directory */
+    strcpy(options.redirect_path, "./chili_log");
+    options.use_redirect = true;
+    options.jobs = 1;
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'i':
+                options.use_color = true;
+                options.use_cursor = true;
+                options.nice_stats = true;
+                break;
+            case 'c':
+                options.use_color = true;
+                break;
+            case 'm':
+                options.use_cursor = true;
+                break;
+            case 'n':
+                options.nice_stats = true;
+                break;
+            case 'j':
+                if (strcmp(optarg, "auto") == 0){
+                    options.jobs = CHILI_JOBS_AUTO;
+                    break;
+                }
+                options.jobs = atoi(optarg);
+                if (options.jobs <= 0){
+                    printf("Jobs must be positive or auto\n");
+                    return -1;
+                }
+                break;
+            case 'f':
+                options.force = true;
+                break;
+            case 'T':
+                options.cache_tests = true;
+                break;
+            case 'h':
+                _display_watch_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    if (optind < argc){
+        paths = (const char**)&argv[optind];
+        num_paths = argc - optind;
+    }
+    else{
+        printf("Specify path to shared library "
+               "containing tests\n");
+        return -1;
+    }
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_watch(paths, num_paths, &options);
+}
+
+static int _handle_serve_command(int argc, char *argv[])
+{
+    int c;
+    const char *socket_path = CHILI_SERVER_DEFAULT_PATH;
+    const char *short_options = "u:h";
+    const struct option long_options[] = {
+        { "server", required_argument, 0, 'u' },
+        { "help",   no_argument,       0, 'h' },
+        { 0,        0,                 0, 0   },
+    };
+    int index;
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'u':
+                socket_path = optarg;
+                break;
+            case 'h':
+                _display_serve_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_serve(socket_path);
+}
+
+static int _handle_merge_command(int argc, char *argv[])
+{
+    int c;
+    const char **paths;
+    int num_paths = 0;
+    const char *short_options = "cnh";
+    const struct option long_options[] = {
+        { "color", no_argument, 0, 'c' },
+        { "nice",  no_argument, 0, 'n' },
+        { "help",  no_argument, 0, 'h' },
+        { 0,       0,           0, 0   },
+    };
+    int index;
+    struct chili_test_options options;
+
+    memset(&options, 0, sizeof(options));
+    strcpy(options.redirect_path, "./chili_log");
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'c':
+                options.use_color = true;
+                break;
+            case 'n':
+                options.nice_stats = true;
+                break;
+            case 'h':
+                _display_merge_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    if (optind < argc){
+        paths = (const char**)&argv[optind];
+        num_paths = argc - optind;
+    }
+    else{
+        printf("Specify path to result logs\n");
+        return -1;
+    }
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_merge(paths, num_paths, &options);
+}
+
+static int _handle_compare_command(int argc, char *argv[])
+{
+    int c;
+    const char **paths;
+    int num_paths = 0;
+    int threshold_percent = 10;
+    const char *short_options = "t:h";
+    const struct option long_options[] = {
+        { "threshold", required_argument, 0, 't' },
+        { "help",      no_argument,       0, 'h' },
+        { 0,           0,                 0, 0   },
+    };
+    int index;
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 't':
+                threshold_percent = atoi(optarg);
+                if (threshold_percent < 0){
+                    printf("Threshold must not be negative\n");
+                    return -1;
+                }
+                break;
+            case 'h':
+                _display_compare_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    if (argc - optind >= 2){
+        paths = (const char**)&argv[optind];
+        num_paths = argc - optind;
+    }
+    else{
+        printf("Specify path to result logs of at least two runs\n");
+        return -1;
+    }
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_compare(paths, num_paths, threshold_percent);
+}
+
+static int _handle_worker_command(int argc, char *argv[])
+{
+    int c;
+    const char *short_options = "l:h";
+    const struct option long_options[] = {
+        { "log",  required_argument, 0, 'l' },
+        { "help", no_argument,       0, 'h' },
+        { 0,      0,                 0, 0   },
+    };
+    int index;
+    struct chili_test_options options;
+
+    memset(&options, 0, sizeof(options));
+
+    do {
+        c = getopt_long(argc, argv, short_options,
+                        long_options, &index);
+        switch (c){
+            case 'l':
+                if (strlen(optarg) >= sizeof(options.redirect_path)){
+                    printf("Path to log is too long\n");
+                    return -1;
+                }
+                strcpy(options.redirect_path, optarg);
+                options.use_redirect = true;
+                break;
+            case 'h':
+                _display_worker_usage();
+                return -1;
+        }
+    } while (c != -1);
+
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return chili_command_worker(&options);
+}
+
+static int _handle_help_command(int argc, char *argv[])
+{
+    const char *command;
+
+    if (argc < 2){
+        _display_usage();
+        return 1;
+    }
+
+    command = argv[1];
 
     if (strcmp(command, "all") == 0){
         _display_all_usage();
@@ -340,6 +1549,14 @@ static int _handle_help_command(int argc, char *argv[])
         _display_named_usage();
         return 1;
     }
+    if (strcmp(command, "rerun-failed") == 0){
+        _display_rerun_failed_usage();
+        return 1;
+    }
+    if (strcmp(command, "bench") == 0){
+        _display_bench_usage();
+        return 1;
+    }
     if (strcmp(command, "debug") == 0){
         _display_debug_usage();
         return 1;
@@ -348,6 +1565,34 @@ static int _handle_help_command(int argc, char *argv[])
         _display_list_usage();
         return 1;
     }
+    if (strcmp(command, "affected") == 0){
+        _display_affected_usage();
+        return 1;
+    }
+    if (strcmp(command, "index") == 0){
+        _display_index_usage();
+        return 1;
+    }
+    if (strcmp(command, "watch") == 0){
+        _display_watch_usage();
+        return 1;
+    }
+    if (strcmp(command, "serve") == 0){
+        _display_serve_usage();
+        return 1;
+    }
+    if (strcmp(command, "merge") == 0){
+        _display_merge_usage();
+        return 1;
+    }
+    if (strcmp(command, "compare") == 0){
+        _display_compare_usage();
+        return 1;
+    }
+    if (strcmp(command, "worker") == 0){
+        _display_worker_usage();
+        return 1;
+    }
 
 
     printf("Unknown help topic: %s\n", command);
@@ -377,10 +1622,46 @@ int main(int argc, char *argv[])
         return _handle_named_command(argc, argv) > 0 ?
             0 : 1;
     }
+    else if (strcmp(command, "rerun-failed") == 0){
+        return _handle_rerun_failed_command(argc, argv) > 0 ?
+            0 : 1;
+    }
+    else if (strcmp(command, "bench") == 0){
+        return _handle_bench_command(argc, argv) > 0 ?
+            0 : 1;
+    }
     else if (strcmp(command, "list") == 0){
         return _handle_list_command(argc, argv) >= 0 ?
             0 : 1;
     }
+    else if (strcmp(command, "affected") == 0){
+        return _handle_affected_command(argc, argv) > 0 ?
+            0 : 1;
+    }
+    else if (strcmp(command, "index") == 0){
+        return _handle_index_command(argc, argv) > 0 ?
+            0 : 1;
+    }
+    else if (strcmp(command, "watch") == 0){
+        return _handle_watch_command(argc, argv) > 0 ?
+            0 : 1;
+    }
+    else if (strcmp(command, "serve") == 0){
+        return _handle_serve_command(argc, argv) > 0 ?
+            0 : 1;
+    }
+    else if (strcmp(command, "merge") == 0){
+        return _handle_merge_command(argc, argv) > 0 ?
+            0 : 1;
+    }
+    else if (strcmp(command, "compare") == 0){
+        return _handle_compare_command(argc, argv) > 0 ?
+            0 : 1;
+    }
+    else if (strcmp(command, "worker") == 0){
+        return _handle_worker_command(argc, argv) > 0 ?
+            0 : 1;
+    }
     else if (strcmp(command, "debug") == 0){
         /* Debugger needs path to chili */
         return _handle_debug_command(argv[0], argc, argv) >= 0 ?
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hash.h"
+#include "manifest.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+#define MAGIC "chilimf1"
+
+/* Room for directory and name of manifest */
+#define MAX_PATH 4096
+
+/* Types */
+
+/* Start of manifest, followed by offset of each name into the
+ * strings and then the strings: path of library followed by the
+ * names, each terminated. */
+struct header {
+    char     magic[8];
+    /* Identity of library when manifest was written */
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t  modified_sec;
+    int64_t  modified_nsec;
+    uint32_t num_names;
+    uint32_t strings_size;
+};
+
+struct instance {
+    char                *map;
+    size_t              size;
+    const struct header *header;
+    const uint32_t      *offsets;
+    char                *strings;
+};
+
+
+/* Locals */
+static int _path(const char *directory,
+                 const char *library,
+                 char *path,
+                 int size)
+{
+    uint64_t hash = chili_hash_fnv64(CHILI_HASH_FNV_OFFSET, library,
+                                     strlen(library));
+
+    if (snprintf(path, size, "%s/%016" PRIx64, directory, hash) >= size){
+        printf("Path to manifest of %s is too long\n", library);
+        return -1;
+    }
+    return 1;
+}
+
+static void _identify(const struct stat *library_stat,
+                      struct header *header)
+{
+    header->device = library_stat->st_dev;
+    header->inode = library_stat->st_ino;
+    header->size = library_stat->st_size;
+    header->modified_sec = library_stat->st_mtim.tv_sec;
+    header->modified_nsec = library_stat->st_mtim.tv_nsec;
+}
+
+/* Checks that manifest is whole and of library as it is now */
+static bool _is_valid(const struct instance *instance,
+                      const char *library)
+{
+    const struct header *header = instance->header;
+    struct header identity;
+    struct stat library_stat;
+    size_t size;
+
+    if (instance->size < sizeof(*header) ||
+        memcmp(header->magic, MAGIC, sizeof(header->magic)) != 0){
+        return false;
+    }
+
+    size = sizeof(*header) +
+           (size_t)header->num_names * sizeof(uint32_t) +
+           header->strings_size;
+    if (size != instance->size || header->strings_size == 0 ||
+        instance->strings[header->strings_size - 1] != '\0'){
+        return false;
+    }
+    for (uint32_t i = 0; i < header->num_names; i++){
+        if (instance->offsets[i] >= header->strings_size){
+            return false;
+        }
+    }
+
+    if (strcmp(instance->strings, library) != 0 ||
+        stat(library, &library_stat) < 0){
+        return false;
+    }
+    _identify(&library_stat, &identity);
+
+    return header->device == identity.device &&
+           header->inode == identity.inode &&
+           header->size == identity.size &&
+           header->modified_sec == identity.modified_sec &&
+           header->modified_nsec == identity.modified_nsec;
+}
+
+/* Exports */
+int chili_manifest_open(const char *directory,
+                        const char *library,
+                        chili_handle *handle)
+{
+    struct instance *instance;
+    char path[MAX_PATH];
+    struct stat manifest_stat;
+    void *map;
+    int fd;
+
+    if (_path(directory, library, path, sizeof(path)) < 0){
+        return -1;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0){
+        return 0;
+    }
+    if (fstat(fd, &manifest_stat) < 0 || manifest_stat.st_size == 0){
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(NULL, manifest_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED){
+        printf("Failed to map manifest %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    instance = malloc(sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate manifest instance\n");
+        munmap(map, manifest_stat.st_size);
+        return -1;
+    }
+    instance->map = map;
+    instance->size = manifest_stat.st_size;
+    instance->header = map;
+    instance->offsets = (const uint32_t*)(instance->map +
+                                          sizeof(struct header));
+
+    /* Header must be read before where strings are is known */
+    if (instance->size < sizeof(struct header)){
+        chili_manifest_destroy(instance);
+        return 0;
+    }
+    instance->strings = instance->map + sizeof(struct header) +
+        (size_t)instance->header->num_names * sizeof(uint32_t);
+
+    if (!_is_valid(instance, library)){
+        debug_print("Manifest of %s is stale\n", library);
+        chili_manifest_destroy(instance);
+        return 0;
+    }
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_manifest_count(chili_handle handle)
+{
+    struct instance *instance = handle;
+
+    return instance->header->num_names;
+}
+
+char *chili_manifest_name(chili_handle handle, int index)
+{
+    struct instance *instance = handle;
+
+    return instance->strings + instance->offsets[index];
+}
+
+int chili_manifest_write(const char *directory,
+                         const char *library,
+                         const struct stat *library_stat,
+                         const struct chili_suite *suite)
+{
+    char path[MAX_PATH];
+    char temporary[MAX_PATH + 8];
+    struct header header;
+    const char *fixtures[] = {
+        suite->once_before, suite->once_after,
+        suite->each_before, suite->each_after,
+    };
+    const char **names;
+    uint32_t offset;
+    int count = 0;
+    bool written;
+    int fd;
+    FILE *f;
+
+    if (_path(directory, library, path, sizeof(path)) < 0){
+        return -1;
+    }
+
+    names = malloc((4 + suite->count + suite->bench_count) *
+                   sizeof(*names));
+    if (names == NULL){
+        printf("Unable to allocate manifest\n");
+        return -1;
+    }
+    for (int i = 0; i < 4; i++){
+        if (fixtures[i]){
+            names[count++] = fixtures[i];
+        }
+    }
+    for (int i = 0; i < suite->count; i++){
+        names[count++] = suite->tests[i];
+    }
+    for (int i = 0; i < suite->bench_count; i++){
+        names[count++] = suite->benchmarks[i];
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    _identify(library_stat, &header);
+    header.num_names = count;
+    header.strings_size = strlen(library) + 1;
+    for (int i = 0; i < count; i++){
+        header.strings_size += strlen(names[i]) + 1;
+    }
+
+    if (mkdir(directory, 0777) < 0 && errno != EEXIST){
+        printf("Failed to create %s: %s\n", directory, strerror(errno));
+        free(names);
+        return -1;
+    }
+
+    /* Readers never see a manifest that is half written */
+    snprintf(temporary, sizeof(temporary), "%s.XXXXXX", path);
+    fd = mkstemp(temporary);
+    if (fd < 0 || (f = fdopen(fd, "w")) == NULL){
+        printf("Failed to create manifest %s: %s\n",
+               temporary, strerror(errno));
+        if (fd >= 0){
+            close(fd);
+            unlink(temporary);
+        }
+        free(names);
+        return -1;
+    }
+
+    written = fwrite(&header, sizeof(header), 1, f) == 1;
+    offset = strlen(library) + 1;
+    for (int i = 0; written && i < count; i++){
+        written = fwrite(&offset, sizeof(offset), 1, f) == 1;
+        offset += strlen(names[i]) + 1;
+    }
+    written = written && fwrite(library, strlen(library) + 1, 1, f) == 1;
+    for (int i = 0; written && i < count; i++){
+        written = fwrite(names[i], strlen(names[i]) + 1, 1, f) == 1;
+    }
+    free(names);
+
+    if (!written){
+        printf("Failed to write manifest %s: %s\n",
+               temporary, strerror(errno));
+        fclose(f);
+        unlink(temporary);
+        return -1;
+    }
+    if (fclose(f) != 0 || rename(temporary, path) < 0){
+        printf("Failed to write manifest %s: %s\n", path, strerror(errno));
+        unlink(temporary);
+        return -1;
+    }
+
+    return 1;
+}
+
+void chili_manifest_destroy(chili_handle handle)
+{
+    struct instance *instance = handle;
+
+    munmap(instance->map, instance->size);
+    free(instance);
+}
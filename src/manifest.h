@@ -0,0 +1,69 @@
+#pragma once
+
+#include <sys/stat.h>
+
+#include "handle.h"
+#include "suite.h"
+
+/**
+ * @brief Opens manifest of library.
+ *
+ * A manifest holds the names of the fixtures, tests and
+ * benchmarks of a library, so that its symbols don't have to
+ * be parsed again. It is only used while the library has the
+ * same path, inode, size and modification time as when the
+ * manifest was written. The manifest is mapped into memory as
+ * it is, names are read in place.
+ *
+ * @param directory Directory of manifests.
+ * @param library   Path to library.
+ * @param handle    Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Zero when there is no manifest or library has
+ *         changed since it was written.
+ *         Positive on success.
+ */
+int chili_manifest_open(const char *directory,
+                        const char *library,
+                        chili_handle *handle);
+
+/**
+ * @brief Returns number of names in manifest.
+ */
+int chili_manifest_count(chili_handle handle);
+
+/**
+ * @brief Returns name in manifest, valid until manifest is
+ *        destroyed.
+ *
+ * @param handle Valid module handle.
+ * @param index  Index of name, less than count.
+ */
+char *chili_manifest_name(chili_handle handle, int index);
+
+/**
+ * @brief Writes manifest of library, replacing any earlier.
+ *
+ * @param directory    Directory of manifests, created if missing.
+ * @param library      Path to library.
+ * @param library_stat Library as it was stat'ed before its
+ *                     symbols were parsed into suite.
+ * @param suite        Suite found in library.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_manifest_write(const char *directory,
+                         const char *library,
+                         const struct stat *library_stat,
+                         const struct chili_suite *suite);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * Names are invalid after this call.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_manifest_destroy(chili_handle handle);
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "cgroup.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+
+/* Locals */
+static void _visit_max(void *context, const char *path, const char *content)
+{
+    uint64_t *lowest = context;
+    uint64_t kb;
+
+    if (chili_memory_parse_max(content, &kb) > 0 && kb > 0 &&
+        (*lowest == 0 || kb < *lowest)){
+        debug_print("Memory limited to %llu kB by %s\n",
+                    (unsigned long long)kb, path);
+        *lowest = kb;
+    }
+}
+
+
+/* Exports */
+int chili_memory_parse_size(const char *size, uint64_t *kb)
+{
+    char *end;
+    unsigned long long value = strtoull(size, &end, 10);
+
+    if (end == size){
+        return -1;
+    }
+
+    switch (*end){
+        case '\0':
+            *kb = value / 1024;
+            return 1;
+        case 'k':
+        case 'K':
+            *kb = value;
+            break;
+        case 'm':
+        case 'M':
+            *kb = value * 1024;
+            break;
+        case 'g':
+        case 'G':
+            *kb = value * 1024 * 1024;
+            break;
+        default:
+            return -1;
+    }
+
+    return end[1] == '\0' ? 1 : -1;
+}
+
+int chili_memory_parse_max(const char *content, uint64_t *kb)
+{
+    char *end;
+    unsigned long long bytes;
+
+    if (strncmp(content, "max", 3) == 0){
+        *kb = 0;
+        return 1;
+    }
+
+    bytes = strtoull(content, &end, 10);
+    if (end == content){
+        return -1;
+    }
+
+    *kb = bytes / 1024;
+    return 1;
+}
+
+void chili_memory_limit(uint64_t *kb)
+{
+    *kb = 0;
+    chili_cgroup_walk("memory.max", _visit_max, kb);
+}
+
+uint64_t chili_memory_unknown(uint64_t budget_kb, uint64_t largest_kb)
+{
+    return largest_kb > budget_kb / 2 ? largest_kb : budget_kb / 2;
+}
+
+bool chili_memory_admit(uint64_t budget_kb,
+                        uint64_t in_use_kb,
+                        uint64_t expected_kb,
+                        int running)
+{
+    return running == 0 || in_use_kb + expected_kb <= budget_kb;
+}
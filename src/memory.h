@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * @brief Parses a size like 512M or 4G.
+ *
+ * Suffixes K, M and G are powers of 1024, without suffix size
+ * is in bytes.
+ *
+ * @param size Size to parse.
+ * @param kb   Set to size in kilobytes on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_memory_parse_size(const char *size, uint64_t *kb);
+
+/**
+ * @brief Parses content of a cgroup v2 memory.max file.
+ *
+ * @param content Content like "4294967296" or "max".
+ * @param kb      Set to limit in kilobytes, zero when there is no
+ *                limit.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_memory_parse_max(const char *content, uint64_t *kb);
+
+/**
+ * @brief Lowest memory.max of the cgroup of this process and its
+ *        parents.
+ *
+ * @param kb Set to limit in kilobytes, zero when there is no limit.
+ */
+void chili_memory_limit(uint64_t *kb);
+
+/**
+ * @brief Predicts peak memory of something not run before.
+ *
+ * Assumes it needs as much as the hungriest recorded, but at
+ * least half of the budget so that a few unknowns don't run
+ * together.
+ *
+ * @param budget_kb  Memory available for all running.
+ * @param largest_kb Largest peak recorded for anything.
+ *
+ * @return Predicted peak in kilobytes.
+ */
+uint64_t chili_memory_unknown(uint64_t budget_kb, uint64_t largest_kb);
+
+/**
+ * @brief Decides if something more can be started.
+ *
+ * Always admits when nothing else is running, even if it doesn't
+ * fit, otherwise it would never run.
+ *
+ * @param budget_kb   Memory available for all running.
+ * @param in_use_kb   Predicted peak of all running.
+ * @param expected_kb Predicted peak of the one to start.
+ * @param running     Number running.
+ */
+bool chili_memory_admit(uint64_t budget_kb,
+                        uint64_t in_use_kb,
+                        uint64_t expected_kb,
+                        int running);
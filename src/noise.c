@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "noise.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* More than this fraction of time stolen is noise */
+#define STEAL_LIMIT 0.02
+/* More than this fraction of the other cpus busy is noise */
+#define LOAD_LIMIT 0.5
+/* Niceness asked for when isolating */
+#define ISOLATED_NICENESS -20
+
+
+/* Locals */
+static int _read_line(const char *path, char *line, int size)
+{
+    FILE *f = fopen(path, "r");
+    char *newline;
+
+    if (f == NULL){
+        return -1;
+    }
+    if (fgets(line, size, f) == NULL){
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    newline = strchr(line, '\n');
+    if (newline){
+        *newline = '\0';
+    }
+
+    return 1;
+}
+
+static int _read_turbo()
+{
+    char line[16];
+
+    /* Intel pstate reports the inverse */
+    if (_read_line("/sys/devices/system/cpu/intel_pstate/no_turbo",
+                   line, sizeof(line)) > 0){
+        return atoi(line) ? 0 : 1;
+    }
+    if (_read_line("/sys/devices/system/cpu/cpufreq/boost",
+                   line, sizeof(line)) > 0){
+        return atoi(line) ? 1 : 0;
+    }
+    return -1;
+}
+
+static void _read_steal(int cpu, uint64_t *steal, uint64_t *total)
+{
+    char line[256];
+    char name[16];
+    unsigned long long ticks[8] = { 0 };
+    FILE *f;
+    int parsed;
+
+    *steal = *total = 0;
+
+    if (cpu < 0){
+        snprintf(name, sizeof(name), "cpu ");
+    }
+    else{
+        snprintf(name, sizeof(name), "cpu%d ", cpu);
+    }
+
+    f = fopen("/proc/stat", "r");
+    if (f == NULL){
+        return;
+    }
+
+    while (fgets(line, sizeof(line), f)){
+        if (strncmp(line, name, strlen(name)) != 0){
+            continue;
+        }
+
+        /* user nice system idle iowait irq softirq steal */
+        parsed = sscanf(line + strlen(name),
+                        "%llu %llu %llu %llu %llu %llu %llu %llu",
+                        &ticks[0], &ticks[1], &ticks[2], &ticks[3],
+                        &ticks[4], &ticks[5], &ticks[6], &ticks[7]);
+        for (int i = 0; i < parsed; i++){
+            *total += ticks[i];
+        }
+        *steal = parsed == 8 ? ticks[7] : 0;
+        break;
+    }
+
+    fclose(f);
+}
+
+/* Exports */
+int chili_noise_choose_cpu(const char *isolated,
+                           const bool *allowed,
+                           int num_cpus)
+{
+    const char *c = isolated;
+    char *end;
+    long first;
+    long last;
+
+    /* Isolated cpus are listed like 2-3,6 */
+    while (c && *c){
+        first = strtol(c, &end, 10);
+        if (end == c){
+            break;
+        }
+        last = first;
+        if (*end == '-'){
+            c = end + 1;
+            last = strtol(c, &end, 10);
+            if (end == c){
+                break;
+            }
+        }
+        for (long cpu = first < 0 ? 0 : first;
+             cpu <= last && cpu < num_cpus; cpu++){
+            if (allowed[cpu]){
+                debug_print("Using isolated cpu %ld\n", cpu);
+                return cpu;
+            }
+        }
+        if (*end != ','){
+            break;
+        }
+        c = end + 1;
+    }
+
+    /* Last cpu is least likely to be handling interrupts */
+    for (int cpu = num_cpus - 1; cpu >= 0; cpu--){
+        if (allowed[cpu]){
+            debug_print("Using cpu %d\n", cpu);
+            return cpu;
+        }
+    }
+
+    return -1;
+}
+
+int chili_noise_pick_cpu()
+{
+    char line[256];
+    cpu_set_t set;
+    bool allowed[CPU_SETSIZE];
+
+    if (sched_getaffinity(0, sizeof(set), &set) < 0){
+        printf("Failed to get cpu affinity: %s\n", strerror(errno));
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+        allowed[cpu] = CPU_ISSET(cpu, &set);
+    }
+
+    if (_read_line("/sys/devices/system/cpu/isolated",
+                   line, sizeof(line)) < 0){
+        line[0] = '\0';
+    }
+
+    return chili_noise_choose_cpu(line, allowed, CPU_SETSIZE);
+}
+
+int chili_noise_isolate(int cpu, bool *priority_raised)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0){
+        printf("Failed to pin to cpu %d: %s\n", cpu, strerror(errno));
+        return -1;
+    }
+
+    *priority_raised =
+        setpriority(PRIO_PROCESS, 0, ISOLATED_NICENESS) == 0;
+    debug_print("Priority %s\n", *priority_raised ?
+                "raised" : "not permitted to be raised");
+
+    return 1;
+}
+
+void chili_noise_sample(int cpu, struct chili_noise_sample *sample)
+{
+    char path[128];
+    double loads[1];
+
+    memset(sample, 0, sizeof(*sample));
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor",
+             cpu < 0 ? 0 : cpu);
+    if (_read_line(path, sample->governor,
+                   sizeof(sample->governor)) < 0){
+        sample->governor[0] = '\0';
+    }
+
+    sample->turbo = _read_turbo();
+    sample->load = getloadavg(loads, 1) == 1 ? loads[0] : 0.0;
+    _read_steal(cpu, &sample->steal, &sample->total);
+}
+
+void chili_noise_evaluate(const struct chili_noise_sample *before,
+                          const struct chili_noise_sample *after,
+                          struct chili_noise *noise)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t ticks = after->total - before->total;
+    double others;
+
+    strcpy(noise->governor, after->governor);
+    noise->governor_changed =
+        strcmp(before->governor, after->governor) != 0;
+    noise->turbo = after->turbo;
+    noise->load = before->load > after->load ?
+        before->load : after->load;
+    noise->steal = ticks > 0 ?
+        (double)(after->steal - before->steal) / ticks : 0.0;
+
+    /* Benchmark itself accounts for one of the load */
+    others = cpus > 1 ?
+        (noise->load - 1.0) / (cpus - 1) :
+        noise->load - 1.0;
+
+    noise->noisy = noise->steal > STEAL_LIMIT ||
+                   others > LOAD_LIMIT ||
+                   noise->governor_changed;
+}
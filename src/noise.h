@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define CHILI_NOISE_MAX_GOVERNOR 32
+
+/**
+ * @brief State of the machine at one point in time.
+ */
+struct chili_noise_sample {
+    /* Frequency governor of the cpu, empty if unknown */
+    char     governor[CHILI_NOISE_MAX_GOVERNOR];
+    /* 1 if turbo is enabled, 0 if disabled, -1 if unknown */
+    int      turbo;
+    /* One minute load average */
+    double   load;
+    /* Ticks stolen by the hypervisor and total ticks */
+    uint64_t steal;
+    uint64_t total;
+};
+
+/**
+ * @brief Environment a benchmark was measured in.
+ */
+struct chili_noise {
+    /* Cpu that benchmark was pinned to */
+    int    cpu;
+    /* If niceness could be raised */
+    bool   priority_raised;
+    char   governor[CHILI_NOISE_MAX_GOVERNOR];
+    bool   governor_changed;
+    int    turbo;
+    /* Highest load average before and after */
+    double load;
+    /* Fraction of time stolen while benchmark ran */
+    double steal;
+    /* Set when results shouldn't be trusted */
+    bool   noisy;
+};
+
+/**
+ * @brief Picks cpu to measure on.
+ *
+ * Prefers the first cpu isolated from the scheduler with
+ * isolcpus that this process may run on, otherwise the last
+ * cpu this process may run on.
+ *
+ * @return Negative on error, otherwise number of cpu.
+ */
+int chili_noise_pick_cpu();
+
+/**
+ * @brief Chooses cpu to measure on.
+ *
+ * @param isolated List of isolated cpus, like 2-3,6.
+ * @param allowed  Set for each cpu that may be run on.
+ * @param num_cpus Number of entries in allowed.
+ *
+ * @return Negative when no cpu is allowed, otherwise number
+ *         of cpu.
+ */
+int chili_noise_choose_cpu(const char *isolated,
+                           const bool *allowed,
+                           int num_cpus);
+
+/**
+ * @brief Pins calling process to cpu and raises its priority.
+ *
+ * Called in the benchmark process, chili itself is left as it
+ * is. Priority is only raised when permitted.
+ *
+ * @param cpu             Cpu to pin to.
+ * @param priority_raised Set to true if priority was raised.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_noise_isolate(int cpu, bool *priority_raised);
+
+/**
+ * @brief Samples state of machine from /proc and /sys.
+ *
+ * Values that can't be read are left as unknown.
+ *
+ * @param cpu    Cpu to read governor and steal time for.
+ * @param sample Set to sampled state.
+ */
+void chili_noise_sample(int cpu, struct chili_noise_sample *sample);
+
+/**
+ * @brief Evaluates samples taken before and after a benchmark.
+ *
+ * Flags as noisy when time was stolen by the hypervisor, when
+ * the other cpus were busy or when the governor changed.
+ *
+ * @param noise Cpu and priority_raised are kept, rest is set.
+ */
+void chili_noise_evaluate(const struct chili_noise_sample *before,
+                          const struct chili_noise_sample *after,
+                          struct chili_noise *noise);
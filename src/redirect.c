@@ -175,6 +175,9 @@ void chili_redirect_print(const char *name, const char* before,
         return;
     }
 
+    /* Keep order with what has been printed through stdio */
+    fflush(stdout);
+
     if (before){
         _write(1, before, strlen(before));
     }
@@ -190,6 +193,24 @@ void chili_redirect_print(const char *name, const char* before,
     }
 }
 
+int chili_redirect_adopt(const char *path, const char *name)
+{
+    if (!_enabled){
+        return 1;
+    }
+    if (_build_path(_print_name, name) < 0){
+        return -1;
+    }
+
+    if (rename(path, _print_name) < 0){
+        printf("Failed to move %s to %s due to %s\n",
+            path, _print_name, strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
 void chili_redirect_end()
 {
 }
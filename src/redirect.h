@@ -45,6 +45,18 @@ void chili_redirect_stop();
 void chili_redirect_print(const char *name, const char *before,
                           const char *after);
 
+/* @brief Moves a stdout session redirected elsewhere into
+ *        this module.
+ *
+ * If module is disabled this will do nothing. Used to take over
+ * sessions from processes redirecting to another directory.
+ *
+ * @param path Path to file containing session
+ * @param name Name to use for session from now on
+ * @return Negative on error, positive on success.
+*/
+int chili_redirect_adopt(const char *path, const char *name);
+
 /* @brief Releases allocated resources
  * @return Void
 */
@@ -0,0 +1,327 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "reorder.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Types */
+struct entry {
+    struct entry              *next;
+    /* Kept message, NULL when spilled */
+    struct chili_wire_message *message;
+    /* Position of message in spill file */
+    long                      offset;
+};
+
+struct group {
+    /* Kept messages in the order they were added */
+    struct entry *first;
+    struct entry *last;
+    bool         done;
+};
+
+struct instance {
+    struct group          *groups;
+    int                   num_groups;
+    /* Group that is released */
+    int                   head;
+    int                   capacity;
+    /* Number of messages kept in memory */
+    int                   in_memory;
+    /* Number of spilled messages not released yet */
+    int                   in_spill;
+    int                   spilled;
+    FILE                  *spill;
+    char                  spill_path[PATH_MAX];
+    chili_reorder_release release;
+    void                  *context;
+};
+
+
+/* Locals */
+static void _release(struct instance *instance,
+                     struct chili_wire_message *message)
+{
+    message->result.name = message->name;
+    instance->release(instance->context, message);
+}
+
+/* Spill file is unlinked at once, nothing is left behind
+ * whatever happens to this process */
+static int _open_spill(struct instance *instance)
+{
+    char path[PATH_MAX];
+    int fd;
+
+    if (snprintf(path, sizeof(path), "%s/.reorderXXXXXX",
+                 instance->spill_path) >= (int)sizeof(path)){
+        printf("Path to spill file is too long\n");
+        return -1;
+    }
+
+    fd = mkstemp(path);
+    if (fd < 0){
+        printf("Failed to create spill file in %s: %s\n",
+               instance->spill_path, strerror(errno));
+        return -1;
+    }
+    unlink(path);
+
+    instance->spill = fdopen(fd, "w+");
+    if (instance->spill == NULL){
+        close(fd);
+        return -1;
+    }
+
+    return 1;
+}
+
+static int _spill(struct instance *instance,
+                  struct entry *entry,
+                  const struct chili_wire_message *message)
+{
+    if (instance->spill == NULL && _open_spill(instance) < 0){
+        return -1;
+    }
+
+    if (fseek(instance->spill, 0, SEEK_END) < 0){
+        return -1;
+    }
+    entry->offset = ftell(instance->spill);
+    if (fwrite(message, sizeof(*message), 1, instance->spill) != 1){
+        printf("Failed to spill message: %s\n", strerror(errno));
+        return -1;
+    }
+
+    instance->in_spill++;
+    instance->spilled++;
+    return 1;
+}
+
+static int _unspill(struct instance *instance,
+                    const struct entry *entry,
+                    struct chili_wire_message *message)
+{
+    if (fseek(instance->spill, entry->offset, SEEK_SET) < 0 ||
+        fread(message, sizeof(*message), 1, instance->spill) != 1){
+        printf("Failed to read spilled message\n");
+        return -1;
+    }
+
+    /* Start over when everything spilled has been released */
+    instance->in_spill--;
+    if (instance->in_spill == 0){
+        fflush(instance->spill);
+        if (ftruncate(fileno(instance->spill), 0) < 0){
+            debug_print("Failed to truncate spill file\n");
+        }
+    }
+
+    return 1;
+}
+
+static int _keep(struct instance *instance,
+                 struct group *group,
+                 const struct chili_wire_message *message)
+{
+    struct entry *entry = calloc(1, sizeof(*entry));
+
+    if (entry == NULL){
+        printf("Unable to allocate reorder entry\n");
+        return -1;
+    }
+
+    if (instance->in_memory < instance->capacity){
+        entry->message = malloc(sizeof(*message));
+        if (entry->message == NULL){
+            printf("Unable to allocate reorder message\n");
+            free(entry);
+            return -1;
+        }
+        *entry->message = *message;
+        instance->in_memory++;
+    }
+    else if (_spill(instance, entry, message) < 0){
+        free(entry);
+        return -1;
+    }
+
+    if (group->last){
+        group->last->next = entry;
+    }
+    else {
+        group->first = entry;
+    }
+    group->last = entry;
+
+    return 1;
+}
+
+/* Releases all messages kept by group */
+static int _release_group(struct instance *instance, struct group *group)
+{
+    struct chili_wire_message message;
+    struct entry *entry;
+    int r = 1;
+
+    while ((entry = group->first) != NULL){
+        group->first = entry->next;
+
+        if (entry->message){
+            _release(instance, entry->message);
+            free(entry->message);
+            instance->in_memory--;
+        }
+        else if (_unspill(instance, entry, &message) > 0){
+            _release(instance, &message);
+        }
+        else {
+            r = -1;
+        }
+        free(entry);
+    }
+    group->last = NULL;
+
+    return r;
+}
+
+static void _free_group(struct group *group)
+{
+    struct entry *entry;
+
+    while ((entry = group->first) != NULL){
+        group->first = entry->next;
+        free(entry->message);
+        free(entry);
+    }
+}
+
+
+/* Exports */
+int chili_reorder_create(int num_groups,
+                         int capacity,
+                         const char *spill_path,
+                         chili_reorder_release release,
+                         void *context,
+                         chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate reorder instance\n");
+        return -1;
+    }
+
+    instance->groups = calloc(num_groups, sizeof(struct group));
+    if (instance->groups == NULL && num_groups > 0){
+        printf("Unable to allocate reorder groups\n");
+        free(instance);
+        return -1;
+    }
+
+    instance->num_groups = num_groups;
+    instance->capacity = capacity;
+    instance->release = release;
+    instance->context = context;
+    snprintf(instance->spill_path, sizeof(instance->spill_path), "%s",
+             spill_path);
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_reorder_add(chili_handle handle,
+                      int group,
+                      const struct chili_wire_message *message)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct chili_wire_message copy;
+
+    if (group < 0 || group >= instance->num_groups){
+        printf("Message of unknown group %d\n", group);
+        return -1;
+    }
+
+    /* Name is copied into message, result may point elsewhere */
+    copy = *message;
+    if (message->result.name && message->result.name != message->name){
+        snprintf(copy.name, sizeof(copy.name), "%s",
+                 message->result.name);
+    }
+
+    if (group == instance->head){
+        _release(instance, &copy);
+        return 1;
+    }
+
+    return _keep(instance, &instance->groups[group], &copy);
+}
+
+int chili_reorder_done(chili_handle handle, int group)
+{
+    struct instance *instance = (struct instance*)handle;
+    int r = 1;
+
+    if (group < 0 || group >= instance->num_groups){
+        printf("Unknown group %d is done\n", group);
+        return -1;
+    }
+    instance->groups[group].done = true;
+
+    while (instance->head < instance->num_groups &&
+           instance->groups[instance->head].done){
+        instance->head++;
+        if (instance->head < instance->num_groups &&
+            _release_group(instance,
+                           &instance->groups[instance->head]) < 0){
+            r = -1;
+        }
+    }
+
+    return r;
+}
+
+int chili_reorder_flush(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+    int r = 1;
+
+    for (; instance->head < instance->num_groups; instance->head++){
+        if (_release_group(instance,
+                           &instance->groups[instance->head]) < 0){
+            r = -1;
+        }
+    }
+
+    return r;
+}
+
+int chili_reorder_spilled(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    return instance->spilled;
+}
+
+void chili_reorder_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    for (int i = 0; i < instance->num_groups; i++){
+        _free_group(&instance->groups[i]);
+    }
+    if (instance->spill){
+        fclose(instance->spill);
+    }
+    free(instance->groups);
+    free(instance);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "handle.h"
+#include "wire.h"
+
+
+/**
+ * @brief Called for each message when it is its turn.
+ *
+ * Name of result points to name in message. Message is valid
+ * until function returns.
+ */
+typedef void (*chili_reorder_release)(void *context,
+                                      struct chili_wire_message *message);
+
+/**
+ * @brief Creates buffer that releases messages in canonical order.
+ *
+ * Messages belong to numbered groups, like libraries or tests,
+ * that are released in order: all messages of the first group,
+ * in the order they were added, then all of the second and so
+ * on. Messages of the group that is released are released at
+ * once, messages of later groups are kept until it is their
+ * turn. When more than capacity messages are kept, the rest are
+ * spilled to an unlinked file in spill_path.
+ *
+ * @param num_groups Number of groups, numbered from 0.
+ * @param capacity   Max number of messages kept in memory.
+ * @param spill_path Directory to spill messages to.
+ * @param release    Called for each message when it is released.
+ * @param context    Passed to release.
+ * @param handle     Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_reorder_create(int num_groups,
+                         int capacity,
+                         const char *spill_path,
+                         chili_reorder_release release,
+                         void *context,
+                         chili_handle *handle);
+
+/**
+ * @brief Adds message to group.
+ *
+ * Released directly if it is the turn of group.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_reorder_add(chili_handle handle,
+                      int group,
+                      const struct chili_wire_message *message);
+
+/**
+ * @brief Marks group as done, no more messages will be added.
+ *
+ * Releases kept messages of the groups that are next in turn.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_reorder_done(chili_handle handle, int group);
+
+/**
+ * @brief Releases all kept messages in order, done or not.
+ *
+ * Used when groups won't be done, like when a run is stopped.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_reorder_flush(chili_handle handle);
+
+/**
+ * @brief Returns number of messages that has been spilled.
+ */
+int chili_reorder_spilled(chili_handle handle);
+
+/**
+ * @brief Frees allocated resources and the spill file.
+ *
+ * Messages still kept are not released.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_reorder_destroy(chili_handle handle);
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <inttypes.h>
 
 #include "run.h"
 #include "redirect.h"
@@ -10,7 +11,9 @@ static struct chili_report *_report;
 
 
 const char *_stats = "%sExecuted: %d, Succeeded: %d, "
-                     "Failed: %d, Errors: %d%s\n";
+                     "Failed: %d, Errors: %d%s%s%s\n";
+const char *_stats_over_budget = ", Over budget: %d";
+const char *_stats_cached = ", Cached: %d";
 
 /* Nice stats */
 const char *_stats_nothing = "%sNo tests executed%s\n";
@@ -25,6 +28,8 @@ const char *_stats_some_failed = "%sExecuted %d tests, "
 const char *_stats_some_failed_errors = "%sExecuted %d tests, "
                                         "%d failed, %d succeeded, "
                                         "%d errors%s\n";
+const char *_stats_some_over_budget = "%sExecuted %d tests, "
+                                      "%d over budget%s\n";
 
 /* Ansi escape codes for colors and stuff */
 const char *_color_success_ansi = "\x1b[32m";
@@ -45,6 +50,7 @@ static void _print_nice_stats(struct chili_aggregated *aggregated)
 {
     int fails = aggregated->num_failed;
     int errors = aggregated->num_errors;
+    int over_budget = aggregated->num_over_budget;
     int successes = aggregated->num_succeeded;
     int total = aggregated->num_total;
 
@@ -63,6 +69,10 @@ static void _print_nice_stats(struct chili_aggregated *aggregated)
         printf(_stats_all_errors, _color_fail,
             total, _color_reset);
     }
+    else if (fails == 0 && errors == 0){
+        printf(_stats_some_over_budget, _color_fail,
+            total, over_budget, _color_reset);
+    }
     else{
         if (errors == 0){
             printf(_stats_some_failed, _color_fail,
@@ -83,13 +93,27 @@ static void _print_stats(struct chili_aggregated *aggregated)
     }
 
     const char *color = aggregated->num_errors > 0 ||
-                        aggregated->num_failed > 0 ?
+                        aggregated->num_failed > 0 ||
+                        aggregated->num_over_budget > 0 ?
         _color_fail : _color_success;
+    char over_budget[40] = "";
+    char cached[40] = "";
+
+    /* Only shown when budgets are in use */
+    if (aggregated->num_over_budget > 0){
+        snprintf(over_budget, sizeof(over_budget), _stats_over_budget,
+                 aggregated->num_over_budget);
+    }
+    /* Only shown when results are cached */
+    if (aggregated->num_cached > 0){
+        snprintf(cached, sizeof(cached), _stats_cached,
+                 aggregated->num_cached);
+    }
 
     /* Simple stats */
     printf(_stats, color, aggregated->num_total,
           aggregated->num_succeeded, aggregated->num_failed,
-          aggregated->num_errors, _color_reset);
+          aggregated->num_errors, over_budget, cached, _color_reset);
 }
 
 static void _print_captured(struct chili_result *result)
@@ -102,6 +126,30 @@ static void _print_captured(struct chili_result *result)
         "<<< Capture end\n");
 }
 
+static void _print_exceeded(const char *what, uint64_t used,
+                            uint64_t budget, const char *unit)
+{
+    if (budget > 0 && used > budget){
+        printf("    %s: %" PRIu64 " %s, budget %" PRIu64 " %s\n",
+               what, used, unit, budget, unit);
+    }
+}
+
+static void _print_over_budget(struct chili_result *result)
+{
+    const struct chili_usage *usage = &result->usage;
+    const struct chili_budget *budget = &result->budget;
+
+    printf("%s%s: %s: Over budget [%d]%s\n",
+           _color_fail,
+            result->library, result->name, result->identity,
+            _color_reset);
+    _print_exceeded("wall time", usage->wall_ns, budget->wall_ns, "ns");
+    _print_exceeded("cpu time", usage->cpu_ns, budget->cpu_ns, "ns");
+    _print_exceeded("max rss", usage->max_rss_kb, budget->max_rss_kb,
+                    "kB");
+}
+
 static void _print_test(struct chili_result *result)
 {
     bool print_captured_output = true;
@@ -139,10 +187,15 @@ static void _print_test(struct chili_result *result)
                         _color_reset);
                 break;
             case test_success:
-                printf("%s%s: %s: Success [%d]%s\n",
+                if (result->over_budget){
+                    _print_over_budget(result);
+                    break;
+                }
+                printf("%s%s: %s: Success%s [%d]%s\n",
                        _color_success,
-                        result->library, result->name, result->identity,
-                        _color_reset);
+                        result->library, result->name,
+                        result->cached ? " (cached)" : "",
+                        result->identity, _color_reset);
                 print_captured_output = false;
                 break;
         }
@@ -193,6 +246,99 @@ static void _print_result(struct chili_result *result)
     }
 }
 
+static void _print_latency(const char *intro,
+                           const struct chili_latency *latency)
+{
+    if (latency == NULL){
+        return;
+    }
+
+    printf("    %s: p50 %" PRIu64 " ns, p90 %" PRIu64 " ns, "
+           "p99 %" PRIu64 " ns, p99.9 %" PRIu64 " ns, "
+           "max %" PRIu64 " ns (%" PRIu64 " recorded)\n",
+           intro,
+           chili_latency_percentile(latency, 50),
+           chili_latency_percentile(latency, 90),
+           chili_latency_percentile(latency, 99),
+           chili_latency_percentile(latency, 99.9),
+           latency->max, latency->count);
+}
+
+static void _print_spread(const char *intro,
+                          const struct chili_bench_timing *timing)
+{
+    double width = timing->median_ns > 0 ?
+        100.0 * (timing->ci_high_ns - timing->ci_low_ns) /
+            timing->median_ns :
+        0.0;
+
+    printf("    %s: 95%% CI of median %" PRIu64 "..%" PRIu64 " ns "
+           "(%.1f%%)%s, %d low and %d high outliers\n",
+           intro, timing->ci_low_ns, timing->ci_high_ns, width,
+           timing->converged ? "" : ", did not converge",
+           timing->low_outliers, timing->high_outliers);
+}
+
+static void _print_noise(const struct chili_noise *noise)
+{
+    const char *turbo = noise->turbo < 0 ? "unknown" :
+                        noise->turbo ? "on" : "off";
+    char cpu[16] = "any";
+
+    if (noise->cpu >= 0){
+        snprintf(cpu, sizeof(cpu), "%d", noise->cpu);
+    }
+
+    printf("    environment: cpu %s, governor %s, turbo %s, "
+           "load %.2f, steal %.1f%%%s",
+           cpu, noise->governor[0] ? noise->governor : "unknown",
+           turbo, noise->load, 100.0 * noise->steal,
+           noise->priority_raised ? ", priority raised" : "");
+    if (noise->noisy){
+        printf(", %snoisy%s", _color_fail, _color_reset);
+    }
+    printf("\n");
+}
+
+static void _print_bench(const struct chili_bench_result *bench)
+{
+    const struct chili_result *result = &bench->result;
+    const struct chili_bench_timing *warm = &bench->warm;
+    const struct chili_bench_timing *cold = &bench->cold;
+
+    if (!bench->has_cold){
+        printf("%s%s: %s: median %" PRIu64 " ns, mean %" PRIu64 " ns, "
+               "min %" PRIu64 " ns over %d samples [%d]%s\n",
+               _color_success,
+               result->library, result->name,
+               warm->median_ns, warm->mean_ns, warm->min_ns,
+               warm->samples, result->identity,
+               _color_reset);
+        _print_spread("spread", warm);
+        _print_latency("latency", warm->latency);
+        _print_noise(&bench->noise);
+        return;
+    }
+
+    /* Warm and cold side by side */
+    printf("%s%s: %s: median warm %" PRIu64 " ns / cold %" PRIu64 " ns"
+           " (%.1fx), min warm %" PRIu64 " ns / cold %" PRIu64 " ns"
+           " over %d/%d samples [%d]%s\n",
+           _color_success,
+           result->library, result->name,
+           warm->median_ns, cold->median_ns,
+           warm->median_ns > 0 ?
+               (double)cold->median_ns / warm->median_ns : 0.0,
+           warm->min_ns, cold->min_ns,
+           warm->samples, cold->samples, result->identity,
+           _color_reset);
+    _print_spread("warm spread", warm);
+    _print_spread("cold spread", cold);
+    _print_latency("warm latency", warm->latency);
+    _print_latency("cold latency", cold->latency);
+    _print_noise(&bench->noise);
+}
+
 
 /* Exports */
 int chili_report_begin(struct chili_report *report)
@@ -268,6 +414,36 @@ void chili_report_test(struct chili_result *result,
     }
 }
 
+void chili_report_bench(struct chili_bench_result *bench,
+                        struct chili_aggregated *aggregated)
+{
+    struct chili_result *result = &bench->result;
+    bool succeeded = result->execution == execution_done &&
+                     result->before != fixture_error &&
+                     result->after != fixture_error &&
+                     result->test == test_success;
+
+    if (_report->use_cursor){
+        /* Remove text shown while running benchmark */
+        printf("%s%s", _cursor_up, _clear_to_end);
+        /* Remove previous stats */
+        if (aggregated->num_total > 1){
+            printf("%s%s", _cursor_up, _clear_to_end);
+        }
+    }
+
+    if (succeeded){
+        _print_bench(bench);
+    }
+    else{
+        _print_result(result);
+    }
+
+    if (_report->use_cursor){
+        _print_stats(aggregated);
+    }
+}
+
 void chili_report_suite_end_fail(int r)
 {
     printf("%sError in suite teardown%s\n", _color_fail, _color_reset);
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 
 #include "run.h"
+#include "bench.h"
 
 struct chili_report {
     bool use_color;
@@ -16,5 +17,7 @@ void chili_report_test_begin(const char *library,
 void chili_report_suite_begin_fail(int r);
 void chili_report_test(struct chili_result *result,
                        struct chili_aggregated *aggregated);
+void chili_report_bench(struct chili_bench_result *bench,
+                        struct chili_aggregated *aggregated);
 void chili_report_suite_end_fail(int r);
 void chili_report_end(struct chili_aggregated *aggregated);
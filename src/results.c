@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include "results.h"
+#include "named.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+#define HEADER "chili results"
+#define MAX_LINE 1024
+
+/* Flags of result, logs from before cached was kept only have
+ * over budget */
+#define FLAG_OVER_BUDGET 1
+#define FLAG_CACHED      2
+
+/* Types */
+struct instance {
+    FILE *f;
+};
+
+
+/* Exports */
+int chili_results_create(const char *path,
+                         int shard,
+                         int num_shards,
+                         chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = malloc(sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate results instance\n");
+        return -1;
+    }
+
+    instance->f = fopen(path, "w");
+    if (instance->f == NULL){
+        printf("Failed to create result log %s: %s\n",
+               path, strerror(errno));
+        free(instance);
+        return -1;
+    }
+    fprintf(instance->f, HEADER " %d/%d\n", shard, num_shards);
+    fflush(instance->f);
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_results_format(char *line,
+                         int size,
+                         const struct chili_result *result)
+{
+    return snprintf(line, size,
+                    "result %d %d %d %d %d %d "
+                    "%" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " "
+                    "%" PRIu64 " %" PRIu64 " %" PRIu64 " %d %s:%s\n",
+                    result->identity, result->execution, result->before,
+                    result->test, result->after,
+                    (result->over_budget ? FLAG_OVER_BUDGET : 0) |
+                    (result->cached ? FLAG_CACHED : 0),
+                    result->usage.wall_ns, result->usage.cpu_ns,
+                    result->usage.max_rss_kb, result->usage.elapsed_ns,
+                    result->budget.wall_ns, result->budget.cpu_ns,
+                    result->budget.max_rss_kb, result->cpu,
+                    result->library, result->name);
+}
+
+int chili_results_parse(char *line,
+                        struct chili_result *result,
+                        bool *skipped)
+{
+    int execution, before, test, after, flags;
+    char *library;
+    char *name;
+    int consumed;
+
+    memset(result, 0, sizeof(*result));
+    *skipped = strncmp(line, "skipped ", 8) == 0;
+    if (*skipped){
+        consumed = 8;
+    }
+    else if (sscanf(line, "result %d %d %d %d %d %d "
+                    "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " "
+                    "%" SCNu64 " %" SCNu64 " %" SCNu64 " %d %n",
+                    &result->identity, &execution, &before, &test,
+                    &after, &flags,
+                    &result->usage.wall_ns, &result->usage.cpu_ns,
+                    &result->usage.max_rss_kb,
+                    &result->usage.elapsed_ns,
+                    &result->budget.wall_ns, &result->budget.cpu_ns,
+                    &result->budget.max_rss_kb, &result->cpu,
+                    &consumed) < 14){
+        debug_print("Skipping malformed line: %s", line);
+        return -1;
+    }
+    if (chili_named_parse(line + consumed, &library, &name) < 0){
+        return -1;
+    }
+
+    result->library = library;
+    result->name = name;
+    if (!*skipped){
+        result->execution = execution;
+        result->before = before;
+        result->test = test;
+        result->after = after;
+        result->over_budget = (flags & FLAG_OVER_BUDGET) != 0;
+        result->cached = (flags & FLAG_CACHED) != 0;
+    }
+
+    return 1;
+}
+
+int chili_results_add(chili_handle handle,
+                      const struct chili_result *result)
+{
+    struct instance *instance = (struct instance*)handle;
+    char line[MAX_LINE];
+
+    if (chili_results_format(line, sizeof(line), result) >=
+        (int)sizeof(line)){
+        printf("Too long name to log result of %s:%s\n",
+               result->library, result->name);
+        return -1;
+    }
+
+    /* Flushed so that a shard that is killed leaves results of
+     * completed tests behind */
+    fputs(line, instance->f);
+
+    return fflush(instance->f) == 0 ? 1 : -1;
+}
+
+int chili_results_skip(chili_handle handle,
+                       const char *library,
+                       const char *name)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    fprintf(instance->f, "skipped %s:%s\n", library, name);
+
+    return fflush(instance->f) == 0 ? 1 : -1;
+}
+
+int chili_results_read(const char *path,
+                       int *shard,
+                       int *num_shards,
+                       chili_results_visit visit,
+                       void *context)
+{
+    char line[MAX_LINE];
+    struct chili_result result;
+    bool skipped;
+    FILE *f;
+    int r = 1;
+
+    f = fopen(path, "r");
+    if (f == NULL){
+        printf("Failed to open result log %s: %s\n",
+               path, strerror(errno));
+        return -1;
+    }
+
+    if (fgets(line, sizeof(line), f) == NULL ||
+        sscanf(line, HEADER " %d/%d", shard, num_shards) != 2){
+        printf("%s is not a result log\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    while (r >= 0 && fgets(line, sizeof(line), f)){
+        if (chili_results_parse(line, &result, &skipped) < 0){
+            continue;
+        }
+        r = visit(context, &result, skipped);
+    }
+
+    fclose(f);
+    return r < 0 ? r : 1;
+}
+
+void chili_results_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    fclose(instance->f);
+    free(instance);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "handle.h"
+#include "run.h"
+
+
+/**
+ * @brief Called for each test read from result log.
+ *
+ * Result is only valid during the call.
+ *
+ * @param context Context given when reading.
+ * @param result  Result of test, only name and library are set
+ *                when test was skipped.
+ * @param skipped Test was skipped and not run.
+ *
+ * @return Negative to stop reading.
+ */
+typedef int (*chili_results_visit)(void *context,
+                                   const struct chili_result *result,
+                                   bool skipped);
+
+/**
+ * @brief Creates machine readable log of test results.
+ *
+ * @param path       Path to log, replaced if it exists.
+ * @param shard      Shard that is run, numbered from 1.
+ * @param num_shards Number of shards.
+ * @param handle     Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_results_create(const char *path,
+                         int shard,
+                         int num_shards,
+                         chili_handle *handle);
+
+/**
+ * @brief Adds result of a test to log.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_results_add(chili_handle handle,
+                      const struct chili_result *result);
+
+/**
+ * @brief Formats result of a test as a line of the log.
+ *
+ * Used by other logs of results, like the run journal.
+ *
+ * @param line   Buffer that line is written to.
+ * @param size   Size of buffer.
+ * @param result Result to format.
+ *
+ * @return Length of line, size or more if it didn't fit.
+ */
+int chili_results_format(char *line,
+                         int size,
+                         const struct chili_result *result);
+
+/**
+ * @brief Parses line of log.
+ *
+ * Library and name of result point into line.
+ *
+ * @param line    Line of log, modified.
+ * @param result  Set to parsed result, only name and library
+ *                are set when test was skipped.
+ * @param skipped Set when test was skipped and not run.
+ *
+ * @return Negative when line is not a result.
+ *         Positive on success.
+ */
+int chili_results_parse(char *line,
+                        struct chili_result *result,
+                        bool *skipped);
+
+/**
+ * @brief Adds test that was not run to log.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_results_skip(chili_handle handle,
+                       const char *library,
+                       const char *name);
+
+/**
+ * @brief Reads result log.
+ *
+ * @param path       Path to log.
+ * @param shard      Set to shard that log is of.
+ * @param num_shards Set to number of shards.
+ * @param visit      Called for each test in log.
+ * @param context    Passed to visit.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_results_read(const char *path,
+                       int *shard,
+                       int *num_shards,
+                       chili_results_visit visit,
+                       void *context);
+
+/**
+ * @brief Closes log.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_results_destroy(chili_handle handle);
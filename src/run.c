@@ -1,15 +1,19 @@
 #include <stdio.h>
 #include <dlfcn.h>
 #include <errno.h>
+#include <signal.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 
 #include "redirect.h"
 #include "run.h"
 #include "debugger.h"
+#include "coverage.h"
 
 /* Debugging */
 #define DEBUG_PRINTS 0
@@ -20,10 +24,21 @@ struct child_result {
     enum fixture_result  before;
     enum test_result     test;
     enum fixture_result  after;
+    uint64_t             wall_ns;
+    uint64_t             cpu_ns;
+};
+
+struct test_context {
+    const struct chili_bind_test    *test;
+    const struct chili_bind_fixture *fixture;
 };
 
 /* Globals */
 static int _next_identity = 0;
+/* Cpu that tests are pinned to, -1 when not pinned */
+static int _cpu = -1;
+/* Process of test being run, 0 when none */
+static volatile pid_t _running;
 
 /* Locals */
 static void _sigchld_handler(int sig, siginfo_t *info, void* context)
@@ -68,40 +83,67 @@ static enum test_result evaluate_test(chili_func test)
         test_failure : test_success;
 }
 
-static void _aggregate(const struct chili_result *result,
-                       struct chili_aggregated *aggregated)
+static uint64_t _now_ns(clockid_t clock)
 {
-    bool executed = result->execution != execution_not_started;
-    bool error = result->before == fixture_error ||
-                 result->after == fixture_error ||
-                 result->test == test_error ||
-                 result->execution == execution_unknown_error ||
-                 result->execution == execution_crashed ||
-                 result->execution == execution_timed_out;
-    bool failed = executed && !error &&
-                  result->test == test_failure;
-    bool succeeded = executed && !error && !failed &&
-                     result->test == test_success;
+    struct timespec now;
 
-    aggregated->num_total += executed ? 1 : 0;
-    aggregated->num_errors += error ? 1 : 0;
-    aggregated->num_failed += failed ? 1 : 0;
-    aggregated->num_succeeded += succeeded ? 1 : 0;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void _test_body(void *context, struct chili_result *result)
+{
+    const struct test_context *test = context;
+    const struct chili_bind_fixture *fixture = test->fixture;
+    uint64_t wall;
+    uint64_t cpu;
+
+    result->before = evaluate_fixture(fixture->each_before);
+    if (result->before != fixture_error){
+        wall = _now_ns(CLOCK_MONOTONIC);
+        cpu = _now_ns(CLOCK_PROCESS_CPUTIME_ID);
+        result->test = evaluate_test(test->test->func);
+        result->usage.cpu_ns = _now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+        result->usage.wall_ns = _now_ns(CLOCK_MONOTONIC) - wall;
+        result->after = evaluate_fixture(fixture->each_after);
+    }
+}
+
+static bool _exceeds(uint64_t used, uint64_t budget)
+{
+    return budget > 0 && used > budget;
+}
+
+static bool _is_over_budget(const struct chili_result *result)
+{
+    const struct chili_usage *usage = &result->usage;
+    const struct chili_budget *budget = &result->budget;
+
+    /* Only a working test can be judged on performance */
+    if (result->execution != execution_done ||
+        result->test != test_success ||
+        result->before == fixture_error ||
+        result->after == fixture_error){
+        return false;
+    }
+
+    return _exceeds(usage->wall_ns, budget->wall_ns) ||
+           _exceeds(usage->cpu_ns, budget->cpu_ns) ||
+           _exceeds(usage->max_rss_kb, budget->max_rss_kb);
 }
 
-static int _child_write_result(chili_func each_before,
-                               chili_func test,
-                               chili_func each_after,
-                               const char *name,
+static int _child_write_result(chili_run_body body,
+                               void *context,
                                const char *redirect_name,
                                int result_pipe)
 {
     int written;
-    struct child_result result = {
+    struct chili_result evaluated = {
         .before = fixture_uncertain,
         .test   = test_uncertain,
         .after  = fixture_uncertain,
     };
+    struct child_result result;
 
     debug_print("In child preparing to execute test\n");
 
@@ -109,14 +151,16 @@ static int _child_write_result(chili_func each_before,
      * redirected somewhere else */
     chili_redirect_start(redirect_name);
 
-    result.before = evaluate_fixture(each_before);
-    if (result.before != fixture_error){
-        result.test = evaluate_test(test);
-        result.after = evaluate_fixture(each_after);
-    }
+    body(context, &evaluated);
 
     chili_redirect_stop();
 
+    result.before = evaluated.before;
+    result.test = evaluated.test;
+    result.after = evaluated.after;
+    result.wall_ns = evaluated.usage.wall_ns;
+    result.cpu_ns = evaluated.usage.cpu_ns;
+
     written = write(result_pipe, &result, sizeof(result));
     if (written != sizeof(result)){
         printf("Wrong number of bytes written\n");
@@ -156,6 +200,8 @@ static void _me_read_result(struct chili_result *result,
             result->before = from_child.before;
             result->test = from_child.test;
             result->after = from_child.after;
+            result->usage.wall_ns = from_child.wall_ns;
+            result->usage.cpu_ns = from_child.cpu_ns;
         }
     }
     else if (selected == 0){
@@ -182,9 +228,8 @@ static void _me_read_result(struct chili_result *result,
     }
 }
 
-static int _fork_and_run(chili_func each_before,
-                         chili_func test,
-                         chili_func each_after,
+static int _fork_and_run(chili_run_body body,
+                         void *context,
                          struct chili_result *result,
                          const struct chili_times *times)
 {
@@ -192,6 +237,7 @@ static int _fork_and_run(chili_func each_before,
     int pipes[2];
     sigset_t blocked_signals;
     int status;
+    struct rusage usage;
     char identity[25];
 
     if (pipe(pipes) < 0){
@@ -206,6 +252,9 @@ static int _fork_and_run(chili_func each_before,
     sigaddset(&blocked_signals, SIGCHLD);
     sigprocmask(SIG_BLOCK, &blocked_signals, NULL);
 
+    /* Child would otherwise print what is still buffered */
+    fflush(stdout);
+
     child = fork();
     if (child < 0){
         printf("Failed to fork: %s\n", strerror(errno));
@@ -214,8 +263,7 @@ static int _fork_and_run(chili_func each_before,
 
     snprintf(identity, 25, "%d", result->identity);
     if (child == 0){
-        _child_write_result(each_before, test, each_after,
-                            result->name, identity, pipes[1]);
+        _child_write_result(body, context, identity, pipes[1]);
         /* Exit child here ! */
         debug_print("Exiting process %d\n", getpid());
         _exit(0);
@@ -223,6 +271,7 @@ static int _fork_and_run(chili_func each_before,
 
 
     /* Continue in parent process */
+    _running = child;
     debug_print("Waiting for child process %d to execute test\n", child);
     _me_read_result(result, times, pipes[0]);
     close(pipes[0]);
@@ -242,7 +291,11 @@ static int _fork_and_run(chili_func each_before,
     }
 
     /* Child either exited normally or killed by code above */
-    wait(&status);
+    if (wait4(child, &status, 0, &usage) == child){
+        /* Kilobytes on Linux */
+        result->usage.max_rss_kb = usage.ru_maxrss;
+    }
+    _running = 0;
 
     /* Restore signals, there is probably a SIGCHLD
      * pending at this moment from this test and we
@@ -292,6 +345,64 @@ static int _fork_and_debug(chili_handle debugger,
 }
 
 /* Exports */
+void chili_run_aggregate(const struct chili_result *result,
+                         struct chili_aggregated *aggregated)
+{
+    bool executed = result->execution != execution_not_started;
+    bool error = result->before == fixture_error ||
+                 result->after == fixture_error ||
+                 result->test == test_error ||
+                 result->execution == execution_unknown_error ||
+                 result->execution == execution_crashed ||
+                 result->execution == execution_timed_out;
+    bool failed = executed && !error &&
+                  result->test == test_failure;
+    bool over_budget = executed && !error && !failed &&
+                       result->over_budget;
+    bool succeeded = executed && !error && !failed && !over_budget &&
+                     result->test == test_success;
+
+    aggregated->num_total += executed ? 1 : 0;
+    aggregated->num_errors += error ? 1 : 0;
+    aggregated->num_failed += failed ? 1 : 0;
+    aggregated->num_over_budget += over_budget ? 1 : 0;
+    aggregated->num_succeeded += succeeded ? 1 : 0;
+    aggregated->num_cached += executed && result->cached ? 1 : 0;
+}
+
+int chili_run_identity(void)
+{
+    return _next_identity++;
+}
+
+void chili_run_set_cpu(int cpu)
+{
+    _cpu = cpu;
+}
+
+void chili_run_kill(void)
+{
+    if (_running > 0){
+        kill(_running, SIGKILL);
+    }
+}
+
+void chili_run_cached(struct chili_result *result,
+                      const char *library,
+                      const char *name)
+{
+    memset(result, 0, sizeof(*result));
+    result->name      = name;
+    result->library   = library;
+    result->identity  = -1;
+    result->execution = execution_done;
+    result->before    = fixture_success;
+    result->test      = test_success;
+    result->after     = fixture_success;
+    result->cpu       = -1;
+    result->cached    = true;
+}
+
 int chili_run_before(const struct chili_bind_fixture *fixture)
 {
     int r;
@@ -315,12 +426,39 @@ int chili_run_test(struct chili_result *result,
                    const struct chili_times *times,
                    chili_progress test_progress)
 {
+    struct test_context context = {
+        .test    = test,
+        .fixture = fixture,
+    };
+
+    return chili_run_custom(result, aggregated, test, times,
+                            test_progress, _test_body, &context);
+}
+
+int chili_run_custom(struct chili_result *result,
+                     struct chili_aggregated *aggregated,
+                     const struct chili_bind_test *test,
+                     const struct chili_times *times,
+                     chili_progress test_progress,
+                     chili_run_body body,
+                     void *context)
+{
+    uint64_t started;
+
     result->execution = execution_not_started;
     result->before    = result->after = fixture_uncertain;
     result->test      = test_uncertain;
     result->name      = test->name;
     result->library   = test->library;
     result->identity  = _next_identity++;
+    memset(&result->usage, 0, sizeof(result->usage));
+    memset(&result->budget, 0, sizeof(result->budget));
+    if (test->budget){
+        result->budget = *test->budget;
+    }
+    result->over_budget = false;
+    result->cpu         = _cpu;
+    result->cached      = false;
 
     debug_print("Preparing to run %s\n", result->name);
 
@@ -330,12 +468,18 @@ int chili_run_test(struct chili_result *result,
         test_progress(NULL, result->name);
     }
 
-    if (_fork_and_run(fixture->each_before, test->func,
-                      fixture->each_after, result, times) < 0){
+    /* Edges reached by fixtures and earlier tests aren't this
+     * test's coverage */
+    chili_coverage_reset();
+
+    started = _now_ns(CLOCK_MONOTONIC);
+    if (_fork_and_run(body, context, result, times) < 0){
         return -1;
     };
+    result->usage.elapsed_ns = _now_ns(CLOCK_MONOTONIC) - started;
+    result->over_budget = _is_over_budget(result);
 
-    _aggregate(result, aggregated);
+    chili_run_aggregate(result, aggregated);
 
     return 1;
 }
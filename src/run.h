@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/time.h>
 
 #include "bind.h"
@@ -47,6 +48,20 @@ enum execution_result {
     execution_done,
 };
 
+/**
+ * @brief Resources used by a test.
+ *
+ * Wall and cpu time are of the test function only, peak memory
+ * is of the whole test process including fixtures.
+ */
+struct chili_usage {
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    uint64_t max_rss_kb;
+    /* Whole execution including fixtures and process handling */
+    uint64_t elapsed_ns;
+};
+
 /**
  * @brief Represents execution of a single test case
  *
@@ -64,6 +79,15 @@ struct chili_result {
     enum fixture_result   before;
     enum test_result      test;
     enum fixture_result   after;
+    struct chili_usage    usage;
+    /* Declared budget, zero when test has none */
+    struct chili_budget   budget;
+    /* Test succeeded but used more than budget */
+    bool                  over_budget;
+    /* Cpu test was pinned to, negative when not pinned */
+    int                   cpu;
+    /* Result of an earlier run, test wasn't run */
+    bool                  cached;
 };
 
 /**
@@ -74,6 +98,9 @@ struct chili_aggregated {
     int num_succeeded;
     int num_failed;
     int num_errors;
+    int num_over_budget;
+    /* Reported from an earlier run, included in the above */
+    int num_cached;
     int num_total;
 };
 
@@ -85,6 +112,11 @@ struct chili_times {
 typedef void (*chili_progress)(const char *library_path,
                                const char *test_name);
 
+/* Executed in the forked child process. Sets outcome of
+ * fixtures and test in result. */
+typedef void (*chili_run_body)(void *context,
+                               struct chili_result *result);
+
 /**
  * @brief Runs before fixture.
  *
@@ -111,6 +143,66 @@ int chili_run_test(struct chili_result *result,
                    const struct chili_times *times,
                    chili_progress test_progress);
 
+/**
+ * @brief Invokes custom body in place of a test.
+ *
+ * Body is executed in a child process with the same output
+ * redirection, timeout and crash handling as an ordinary test.
+ *
+ * @param test          Name and library of what is executed.
+ * @param body          Executed in child process.
+ * @param context       Passed to body.
+ * @return Negative on error, positive on success.
+ */
+int chili_run_custom(struct chili_result *result,
+                     struct chili_aggregated *aggregated,
+                     const struct chili_bind_test *test,
+                     const struct chili_times *times,
+                     chili_progress test_progress,
+                     chili_run_body body,
+                     void *context);
+
+/**
+ * @brief Adds result to aggregated results.
+ *
+ * Done by chili_run_test and chili_run_custom, only needed when
+ * several executions are combined into one result.
+ */
+void chili_run_aggregate(const struct chili_result *result,
+                         struct chili_aggregated *aggregated);
+
+/**
+ * @brief Gives identity to a result that wasn't run.
+ *
+ * Like a cached result reported along with results of tests
+ * that are run.
+ */
+int chili_run_identity(void);
+
+/**
+ * @brief Sets cpu that tests run by this process are pinned to.
+ *
+ * Recorded in each result, -1 until set.
+ */
+void chili_run_set_cpu(int cpu);
+
+/**
+ * @brief Kills test that is being run by this process.
+ *
+ * Safe to call from a signal handler.
+ */
+void chili_run_kill(void);
+
+/**
+ * @brief Sets result of a test that succeeded earlier and
+ *        isn't run.
+ *
+ * Test is reported as cached, without usage or identity.
+ */
+void chili_run_cached(struct chili_result *result,
+                      const char *library,
+                      const char *name);
+
 /**
  * @brief Debugs test.
  *
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "history.h"
+#include "schedule.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+
+/* Constants */
+static const char *_reasons[] = {
+    [chili_schedule_failed]  = " (failed last run)",
+    [chili_schedule_changed] = " (changed)",
+    [chili_schedule_normal]  = "",
+};
+
+
+/* Locals */
+static int _in_given_order(const void *a, const void *b)
+{
+    const struct chili_schedule_entry *x = a;
+    const struct chili_schedule_entry *y = b;
+
+    if (x->reason != y->reason){
+        return x->reason - y->reason;
+    }
+    return x->position - y->position;
+}
+
+static int _longest_first(const void *a, const void *b)
+{
+    const struct chili_schedule_entry *x = a;
+    const struct chili_schedule_entry *y = b;
+
+    if (x->reason != y->reason){
+        return x->reason - y->reason;
+    }
+    if (x->predicted_ns != y->predicted_ns){
+        return x->predicted_ns < y->predicted_ns ? 1 : -1;
+    }
+    /* Keep given order among equals */
+    return x->position - y->position;
+}
+
+static int _by_start(const void *a, const void *b)
+{
+    const struct chili_schedule_entry *x = a;
+    const struct chili_schedule_entry *y = b;
+
+    if (x->start_ns != y->start_ns){
+        return x->start_ns < y->start_ns ? -1 : 1;
+    }
+    return x->job < y->job ? -1 : 1;
+}
+
+static double _seconds(uint64_t ns)
+{
+    return ns / 1000000000.0;
+}
+
+/* Exports */
+int chili_schedule_plan(chili_handle history,
+                        const char **libraries,
+                        int count,
+                        int jobs,
+                        struct chili_schedule_entry *entries,
+                        uint64_t *makespan_ns)
+{
+    uint64_t *busy_until;
+    uint64_t known_total = 0;
+    int known_count = 0;
+    int job;
+
+    for (int i = 0; i < count; i++){
+        entries[i].library = libraries[i];
+        entries[i].position = i;
+        entries[i].reason =
+            chili_history_library_failed(history, libraries[i]) ?
+                chili_schedule_failed :
+            chili_history_changed(history, libraries[i]) ?
+                chili_schedule_changed :
+                chili_schedule_normal;
+        entries[i].known = chili_history_library(
+            history, libraries[i], &entries[i].predicted_ns) > 0;
+        if (entries[i].known){
+            known_total += entries[i].predicted_ns;
+            known_count++;
+        }
+    }
+
+    for (int i = 0; i < count; i++){
+        if (!entries[i].known){
+            entries[i].predicted_ns = known_count ?
+                known_total / known_count : 0;
+        }
+    }
+
+    qsort(entries, count, sizeof(*entries),
+          jobs > 1 ? _longest_first : _in_given_order);
+
+    busy_until = calloc(jobs, sizeof(uint64_t));
+    if (busy_until == NULL){
+        printf("Unable to allocate plan\n");
+        return -1;
+    }
+
+    /* Each library goes to the job that is free first */
+    *makespan_ns = 0;
+    for (int i = 0; i < count; i++){
+        job = 0;
+        for (int j = 1; j < jobs; j++){
+            if (busy_until[j] < busy_until[job]){
+                job = j;
+            }
+        }
+        entries[i].job = job;
+        entries[i].start_ns = busy_until[job];
+        busy_until[job] += entries[i].predicted_ns;
+        if (busy_until[job] > *makespan_ns){
+            *makespan_ns = busy_until[job];
+        }
+    }
+
+    free(busy_until);
+    return 1;
+}
+
+void chili_schedule_print(const struct chili_schedule_entry *entries,
+                          int count,
+                          int jobs,
+                          uint64_t makespan_ns)
+{
+    struct chili_schedule_entry *sorted;
+    const struct chili_schedule_entry *entry;
+
+    sorted = malloc(count * sizeof(*sorted));
+    if (sorted == NULL){
+        printf("Unable to allocate plan\n");
+        return;
+    }
+    memcpy(sorted, entries, count * sizeof(*sorted));
+    qsort(sorted, count, sizeof(*sorted), _by_start);
+
+    printf("Plan for %d libraries in %d jobs:\n", count, jobs);
+    for (int i = 0; i < count; i++){
+        entry = &sorted[i];
+        printf("  job %d: %8.3fs .. %8.3fs %s%s%s\n",
+               entry->job,
+               _seconds(entry->start_ns),
+               _seconds(entry->start_ns + entry->predicted_ns),
+               entry->library,
+               entry->known ? "" : " (no history)",
+               _reasons[entry->reason]);
+    }
+    printf("Predicted makespan: %.3fs\n", _seconds(makespan_ns));
+
+    free(sorted);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "handle.h"
+
+/* Why a library is run where it is, in order of priority */
+enum chili_schedule_reason {
+    chili_schedule_failed,
+    chili_schedule_changed,
+    chili_schedule_normal,
+};
+
+/**
+ * @brief When and where a library is predicted to run.
+ */
+struct chili_schedule_entry {
+    const char *library;
+    /* Position in given order */
+    int        position;
+    /* Predicted time to run suite setup and all tests */
+    uint64_t   predicted_ns;
+    /* False when nothing is known about library */
+    bool       known;
+    enum chili_schedule_reason reason;
+    /* Predicted start relative to start of run */
+    uint64_t   start_ns;
+    /* Job slot that library is predicted to run in */
+    int        job;
+};
+
+/**
+ * @brief Plans in which order libraries are run.
+ *
+ * Libraries with tests that failed last run go first, then
+ * libraries that changed since last run and then the rest.
+ * Within each group libraries are ordered longest first when
+ * several jobs are used, so that long libraries, including slow
+ * suite setups, start early and don't finish last. With a single
+ * job given order is kept within each group. Libraries without
+ * history are predicted to take as long as the average known
+ * library.
+ *
+ * @param history   History handle to predict durations from.
+ * @param libraries Paths of libraries to plan.
+ * @param count     Number of libraries.
+ * @param jobs      Number of libraries run at the same time.
+ * @param entries   Array of count entries, set in planned order.
+ * @param makespan  Set to predicted duration of whole run.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_schedule_plan(chili_handle history,
+                        const char **libraries,
+                        int count,
+                        int jobs,
+                        struct chili_schedule_entry *entries,
+                        uint64_t *makespan_ns);
+
+/**
+ * @brief Prints planned schedule.
+ */
+void chili_schedule_print(const struct chili_schedule_entry *entries,
+                          int count,
+                          int jobs,
+                          uint64_t makespan_ns);
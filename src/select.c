@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "select.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Predicted probabilities of failing */
+#define FAILURE_FAILED  0.5
+#define FAILURE_CHANGED 0.2
+#define FAILURE_STABLE  0.01
+
+
+/* Locals */
+static double _value(const struct chili_select_candidate *candidate)
+{
+    /* Failures found per nanosecond */
+    return candidate->failure /
+           (candidate->duration_ns ? candidate->duration_ns : 1);
+}
+
+static int _by_value(const void *a, const void *b)
+{
+    const struct chili_select_candidate *x = a;
+    const struct chili_select_candidate *y = b;
+    double value_x = _value(x);
+    double value_y = _value(y);
+
+    if (value_x != value_y){
+        return value_x > value_y ? -1 : 1;
+    }
+    return x->index - y->index;
+}
+
+static int _selected_first(const void *a, const void *b)
+{
+    const struct chili_select_candidate *x = a;
+    const struct chili_select_candidate *y = b;
+
+    if (x->selected != y->selected){
+        return x->selected ? -1 : 1;
+    }
+    return _by_value(a, b);
+}
+
+
+/* Exports */
+double chili_select_failure(bool failed, bool changed, bool known)
+{
+    if (failed){
+        return FAILURE_FAILED;
+    }
+    return changed || !known ? FAILURE_CHANGED : FAILURE_STABLE;
+}
+
+int chili_select_within(struct chili_select_candidate *candidates,
+                        int count,
+                        const uint64_t *setup_ns,
+                        int num_libraries,
+                        uint64_t budget_ns,
+                        uint64_t *predicted_ns)
+{
+    bool *setup_paid = calloc(num_libraries, sizeof(bool));
+    struct chili_select_candidate *candidate;
+    uint64_t cost;
+    int selected = 0;
+
+    if (setup_paid == NULL){
+        printf("Unable to allocate selection\n");
+        return -1;
+    }
+
+    qsort(candidates, count, sizeof(*candidates), _by_value);
+
+    /* Greedy, a cheaper test further down might still fit when
+     * an expensive one doesn't */
+    *predicted_ns = 0;
+    for (int i = 0; i < count; i++){
+        candidate = &candidates[i];
+        cost = candidate->duration_ns;
+        if (!setup_paid[candidate->library]){
+            cost += setup_ns[candidate->library];
+        }
+
+        candidate->selected = *predicted_ns + cost <= budget_ns;
+        if (candidate->selected){
+            setup_paid[candidate->library] = true;
+            *predicted_ns += cost;
+            selected++;
+        }
+    }
+    free(setup_paid);
+
+    qsort(candidates, count, sizeof(*candidates), _selected_first);
+    debug_print("Selected %d of %d tests\n", selected, count);
+
+    return selected;
+}
+
+int chili_select_parse_duration(const char *duration, uint64_t *ns)
+{
+    char *unit;
+    double value = strtod(duration, &unit);
+    double scale;
+
+    if (unit == duration || value < 0){
+        return -1;
+    }
+
+    if (strcmp(unit, "") == 0 || strcmp(unit, "s") == 0){
+        scale = 1e9;
+    }
+    else if (strcmp(unit, "ms") == 0){
+        scale = 1e6;
+    }
+    else if (strcmp(unit, "m") == 0){
+        scale = 60e9;
+    }
+    else if (strcmp(unit, "h") == 0){
+        scale = 3600e9;
+    }
+    else {
+        return -1;
+    }
+
+    *ns = (uint64_t)(value * scale);
+    return 1;
+}
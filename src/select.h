@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * @brief Test that might be selected to run.
+ */
+struct chili_select_candidate {
+    /* Index of test in callers array */
+    int      index;
+    /* Index of library test is in */
+    int      library;
+    /* Predicted probability of test failing */
+    double   failure;
+    /* Predicted duration of test */
+    uint64_t duration_ns;
+    /* Set when selected to run */
+    bool     selected;
+};
+
+/**
+ * @brief Predicts probability of a test failing.
+ *
+ * @param failed  Test didn't succeed last run.
+ * @param changed Library has changed since last run.
+ * @param known   Test has been run before.
+ */
+double chili_select_failure(bool failed, bool changed, bool known);
+
+/**
+ * @brief Selects tests to run within a time budget.
+ *
+ * Picks tests that find most failures per second first, until
+ * the budget is spent. Suite setup of a library is paid by the
+ * first test selected in it. Candidates are sorted with selected
+ * tests first, in the order they should run, followed by the
+ * skipped tests.
+ *
+ * @param candidates    Tests to select among.
+ * @param count         Number of candidates.
+ * @param setup_ns      Predicted suite setup of each library.
+ * @param num_libraries Number of libraries.
+ * @param budget_ns     Time to spend.
+ * @param predicted_ns  Set to predicted duration of selected tests.
+ *
+ * @return Negative on error.
+ *         Otherwise number of selected tests.
+ */
+int chili_select_within(struct chili_select_candidate *candidates,
+                        int count,
+                        const uint64_t *setup_ns,
+                        int num_libraries,
+                        uint64_t budget_ns,
+                        uint64_t *predicted_ns);
+
+/**
+ * @brief Parses a duration like 90s, 2m, 500ms or 1h.
+ *
+ * Duration without unit is in seconds.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_select_parse_duration(const char *duration, uint64_t *ns);
@@ -0,0 +1,578 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "library.h"
+#include "registry.h"
+#include "named.h"
+#include "redirect.h"
+#include "server.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Longest line of a request */
+#define MAX_LINE (PATH_MAX + CHILI_WIRE_MAX_NAME + 2)
+
+/* Clients waiting to be served */
+#define BACKLOG 16
+
+/* Commands as sent in requests */
+static const char *_commands[] = {
+    [chili_server_all]   = "all",
+    [chili_server_named] = "named",
+    [chili_server_list]  = "list",
+};
+
+/* Types */
+
+/* Library kept loaded between requests */
+struct served {
+    char         *path;
+    /* NULL when it failed to load */
+    chili_handle lib;
+    bool         set_up;
+    /* File as it was when loaded */
+    struct stat  loaded;
+};
+
+/* Request read from client, arguments are libraries or, when
+ * named, library:name */
+struct request {
+    enum chili_server_command command;
+    char                      redirect_path[CHILI_REDIRECT_MAX_PATH];
+    char                      **arguments;
+    int                       count;
+};
+
+/* Globals */
+
+/* Set by SIGINT or SIGTERM */
+static volatile sig_atomic_t _stopped;
+
+
+/* Locals */
+static void _stop(int signal)
+{
+    _stopped = 1;
+}
+
+static int _send(int fd, enum chili_wire_type type, int r)
+{
+    struct chili_wire_message message;
+
+    memset(&message, 0, sizeof(message));
+    message.type = type;
+    message.r = r;
+
+    return chili_wire_send(fd, &message);
+}
+
+static bool _same_file(const struct stat *a, const struct stat *b)
+{
+    return a->st_dev == b->st_dev &&
+           a->st_ino == b->st_ino &&
+           a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec &&
+           a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+static int _unload(struct served *served)
+{
+    int r = 1;
+
+    if (served->lib == NULL){
+        return 1;
+    }
+    if (served->set_up){
+        r = chili_lib_after_fixture(served->lib);
+        if (r < 0){
+            printf("Teardown failed for library: %s\n", served->path);
+        }
+    }
+    chili_lib_destroy(served->lib);
+    served->lib = NULL;
+    served->set_up = false;
+
+    return r;
+}
+
+/* Loads library the first time it is asked for and again when
+ * its file has changed, sets it up when asked for */
+static int _serve_library(chili_handle registry,
+                          const char *path,
+                          bool set_up,
+                          struct served **served_library)
+{
+    struct served *served = chili_reg_find(registry, path);
+    struct stat path_stat;
+    int r;
+
+    if (stat(path, &path_stat) < 0){
+        printf("Failed to stat library %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (served == NULL){
+        served = calloc(1, sizeof(*served));
+        if (served == NULL){
+            printf("Failed to allocate served library\n");
+            return -1;
+        }
+        served->path = strdup(path);
+        if (served->path == NULL ||
+            chili_reg_add(registry, served->path, served) < 0){
+            printf("Failed to register library: %s\n", path);
+            free(served->path);
+            free(served);
+            return -1;
+        }
+    }
+    else if (served->lib && !_same_file(&served->loaded, &path_stat)){
+        printf("Library %s has changed, loading it again\n", path);
+        _unload(served);
+    }
+
+    if (served->lib == NULL){
+        r = chili_lib_create(served->path, NULL, &served->lib);
+        if (r < 0){
+            printf("Failed to load library: %s\n", path);
+            served->lib = NULL;
+            return r;
+        }
+        served->loaded = path_stat;
+    }
+
+    if (set_up && !served->set_up){
+        r = chili_lib_before_fixture(served->lib);
+        if (r < 0){
+            printf("Fixture failed for library: %s\n", path);
+            return r;
+        }
+        served->set_up = true;
+    }
+
+    *served_library = served;
+    return 1;
+}
+
+static int _serve_test(struct served *served,
+                       const char *name,
+                       int fd)
+{
+    struct chili_result result;
+    struct chili_aggregated scratch = { 0 };
+    struct chili_times times;
+    struct chili_wire_message message;
+    int r;
+
+    times.timeout.tv_nsec = 0;
+    times.timeout.tv_sec = 10;
+
+    r = chili_lib_named_test(served->lib, name, &times, &result, &scratch);
+    if (r < 0){
+        return r;
+    }
+
+    memset(&message, 0, sizeof(message));
+    message.type = chili_wire_result;
+    message.result = result;
+
+    return chili_wire_send(fd, &message);
+}
+
+static int _serve_argument(chili_handle registry,
+                           enum chili_server_command command,
+                           char *argument,
+                           int fd)
+{
+    struct served *served;
+    struct chili_wire_message message;
+    char *library = argument;
+    char *name;
+    char **names;
+    int count;
+    int r;
+
+    if (command == chili_server_named &&
+        chili_named_parse(argument, &library, &name) < 0){
+        printf("Received bad test: %s\n", argument);
+        return -1;
+    }
+
+    r = _serve_library(registry, library, command != chili_server_list,
+                       &served);
+    if (r < 0){
+        return _send(fd, chili_wire_begin_fail, r) < 0 ? -1 : r;
+    }
+
+    if (command == chili_server_named){
+        return _serve_test(served, name, fd);
+    }
+
+    names = chili_lib_tests(served->lib, &count);
+    for (int i = 0; i < count; i++){
+        if (command == chili_server_all){
+            r = _serve_test(served, names[i], fd);
+        }
+        else {
+            memset(&message, 0, sizeof(message));
+            message.type = chili_wire_test;
+            snprintf(message.name, sizeof(message.name), "%s", names[i]);
+            r = chili_wire_send(fd, &message);
+        }
+        if (r < 0){
+            return r;
+        }
+    }
+
+    return 1;
+}
+
+static void _free_request(struct request *request)
+{
+    for (int i = 0; i < request->count; i++){
+        free(request->arguments[i]);
+    }
+    free(request->arguments);
+}
+
+/* Reads whole request before serving it, client doesn't read
+ * what is streamed back until it has sent everything */
+static int _read_request(int fd, struct request *request)
+{
+    char line[MAX_LINE];
+    int capacity = 0;
+    char **grown;
+    FILE *f;
+    int r = -1;
+
+    memset(request, 0, sizeof(*request));
+
+    f = fdopen(dup(fd), "r");
+    if (f == NULL){
+        printf("Failed to read request: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* Command */
+    if (fgets(line, sizeof(line), f) == NULL){
+        goto on_exit;
+    }
+    line[strcspn(line, "\n")] = '\0';
+    for (int i = 0; i <= chili_server_list; i++){
+        if (strcmp(line, _commands[i]) == 0){
+            request->command = i;
+            r = 1;
+        }
+    }
+    if (r < 0){
+        printf("Received bad command: %s\n", line);
+        goto on_exit;
+    }
+
+    /* Where to redirect to, empty to not redirect */
+    if (fgets(line, sizeof(line), f) == NULL){
+        r = -1;
+        goto on_exit;
+    }
+    line[strcspn(line, "\n")] = '\0';
+    if (strlen(line) >= sizeof(request->redirect_path)){
+        printf("Received too long redirect path: %s\n", line);
+        r = -1;
+        goto on_exit;
+    }
+    strcpy(request->redirect_path, line);
+
+    /* Arguments until empty line */
+    while (fgets(line, sizeof(line), f) != NULL){
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '\0'){
+            goto on_exit;
+        }
+        if (request->count == capacity){
+            capacity = capacity ? capacity * 2 : 16;
+            grown = realloc(request->arguments,
+                            capacity * sizeof(*grown));
+            if (grown == NULL){
+                printf("Failed to allocate request\n");
+                r = -1;
+                goto on_exit;
+            }
+            request->arguments = grown;
+        }
+        request->arguments[request->count] = strdup(line);
+        if (request->arguments[request->count] == NULL){
+            printf("Failed to allocate request\n");
+            r = -1;
+            goto on_exit;
+        }
+        request->count++;
+    }
+
+    /* Client went away before ending request */
+    r = -1;
+
+on_exit:
+    fclose(f);
+    if (r < 0){
+        _free_request(request);
+    }
+    return r;
+}
+
+static void _serve_request(chili_handle registry, int fd)
+{
+    struct request request;
+    int r;
+
+    if (_read_request(fd, &request) < 0){
+        return;
+    }
+    debug_print("Serving %s of %d\n", _commands[request.command],
+                request.count);
+
+    r = chili_redirect_begin(request.redirect_path[0] != '\0',
+                             request.redirect_path);
+    /* A library that fails doesn't stop the others, client is
+     * gone when done can't be sent */
+    for (int i = 0; r >= 0 && i < request.count; i++){
+        r = _serve_argument(registry, request.command,
+                            request.arguments[i], fd);
+        r = _send(fd, chili_wire_done, r);
+    }
+    chili_redirect_end();
+
+    _free_request(&request);
+}
+
+/* Tears down all libraries */
+static int _serve_end(chili_handle registry)
+{
+    int token = 0;
+    int r = 1;
+    struct served *served;
+
+    served = chili_reg_next(registry, &token);
+    while (served != NULL){
+        if (_unload(served) < 0){
+            r = -1;
+        }
+        free(served->path);
+        free(served);
+
+        served = chili_reg_next(registry, &token);
+    }
+
+    return r;
+}
+
+static int _connect(const char *socket_path)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    int fd;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)){
+        printf("Path of socket %s is too long\n", socket_path);
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0){
+        printf("Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0){
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int _listen(const char *socket_path)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    int fd;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)){
+        printf("Path of socket %s is too long\n", socket_path);
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    /* Left behind by a server that didn't stop cleanly */
+    fd = _connect(socket_path);
+    if (fd >= 0){
+        printf("Chili is already served at %s\n", socket_path);
+        close(fd);
+        return -1;
+    }
+    unlink(socket_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0){
+        printf("Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(fd, BACKLOG) < 0){
+        printf("Failed to listen at %s: %s\n", socket_path,
+               strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Exports */
+int chili_server_serve(const char *socket_path)
+{
+    struct sigaction action = { .sa_handler = _stop };
+    struct sigaction old_int;
+    struct sigaction old_term;
+    struct sigaction old_pipe;
+    struct sigaction ignore = { .sa_handler = SIG_IGN };
+    chili_handle registry;
+    int listening;
+    int fd;
+    int r;
+
+    r = chili_reg_create(10, &registry);
+    if (r < 0){
+        return r;
+    }
+
+    listening = _listen(socket_path);
+    if (listening < 0){
+        chili_reg_destroy(registry);
+        return -1;
+    }
+
+    /* Not restarted, accept is interrupted to stop at once */
+    _stopped = 0;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+    /* Clients that go away are noticed when sending to them */
+    sigemptyset(&ignore.sa_mask);
+    sigaction(SIGPIPE, &ignore, &old_pipe);
+
+    printf("Serving at %s, stop with Ctrl-C\n", socket_path);
+    fflush(stdout);
+
+    while (!_stopped){
+        fd = accept4(listening, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0){
+            /* Also when tests exit */
+            if (errno == EINTR){
+                continue;
+            }
+            printf("Failed to accept client: %s\n", strerror(errno));
+            r = -1;
+            break;
+        }
+
+        _serve_request(registry, fd);
+        close(fd);
+        fflush(stdout);
+    }
+
+    close(listening);
+    unlink(socket_path);
+    if (_serve_end(registry) < 0 && r >= 0){
+        r = -1;
+    }
+    chili_reg_destroy(registry);
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    sigaction(SIGPIPE, &old_pipe, NULL);
+
+    return r < 0 ? r : 1;
+}
+
+int chili_server_request(const char *socket_path,
+                         enum chili_server_command command,
+                         const char *redirect_path,
+                         const char **libraries,
+                         const char **names,
+                         int count,
+                         chili_server_report report,
+                         void *context)
+{
+    struct chili_wire_message message;
+    char resolved[PATH_MAX];
+    char redirect[PATH_MAX] = "";
+    int index = 0;
+    int fd;
+    int r = 1;
+
+    if (redirect_path && realpath(redirect_path, redirect) == NULL){
+        printf("Failed to resolve %s: %s\n", redirect_path,
+               strerror(errno));
+        return -1;
+    }
+
+    fd = _connect(socket_path);
+    if (fd < 0){
+        printf("Failed to connect to chili served at %s: %s\n",
+               socket_path, strerror(errno));
+        return -1;
+    }
+
+    dprintf(fd, "%s\n%s\n", _commands[command], redirect);
+    for (int i = 0; r >= 0 && i < count; i++){
+        if (realpath(libraries[i], resolved) == NULL){
+            printf("Failed to resolve %s: %s\n", libraries[i],
+                   strerror(errno));
+            r = -1;
+        }
+        else if (names){
+            dprintf(fd, "%s:%s\n", resolved, names[i]);
+        }
+        else {
+            dprintf(fd, "%s\n", resolved);
+        }
+    }
+    if (r < 0){
+        close(fd);
+        return r;
+    }
+    dprintf(fd, "\n");
+    shutdown(fd, SHUT_WR);
+
+    while (index < count){
+        r = chili_wire_receive(fd, &message);
+        if (r <= 0){
+            break;
+        }
+        report(context, index, &message);
+        if (message.type == chili_wire_done){
+            index++;
+        }
+    }
+    close(fd);
+
+    if (index < count){
+        printf("Chili served at %s stopped before request was done\n",
+               socket_path);
+        return -1;
+    }
+
+    return 1;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "wire.h"
+
+/* Longest path of socket, size of sun_path */
+#define CHILI_SERVER_MAX_PATH 108
+
+/* Socket used when no other is given */
+#define CHILI_SERVER_DEFAULT_PATH "./chili.sock"
+
+/* What a request asks the server to do with its libraries.
+ *
+ * all   - Run all tests in each library.
+ * named - Run each named test.
+ * list  - List tests in each library.
+ */
+enum chili_server_command {
+    chili_server_all,
+    chili_server_named,
+    chili_server_list,
+};
+
+/**
+ * @brief Called for each message streamed back by server.
+ *
+ * Messages are results and suite failures when running and
+ * found tests when listing. Done is sent when server is done
+ * with a library, or a test when named.
+ *
+ * @param index Index of library, or test when named, that
+ *              message is about.
+ */
+typedef void (*chili_server_report)(void *context,
+                                    int index,
+                                    struct chili_wire_message *message);
+
+/**
+ * @brief Serves requests on a Unix socket until SIGINT or
+ *        SIGTERM.
+ *
+ * Libraries are loaded when first asked for and kept loaded,
+ * with suite setup done when a test in them is first run.
+ * Each test is forked from the served process, so no test
+ * pays for loading or setting up its library again. A library
+ * whose file has changed since it was loaded is teared down and
+ * loaded again. All libraries are teared down when stopped.
+ * Requests are served one at a time.
+ *
+ * @param socket_path Path to create socket at.
+ *
+ * @return Negative on error.
+ *         Positive when stopped.
+ */
+int chili_server_serve(const char *socket_path);
+
+/**
+ * @brief Sends request to server and reports what it streams
+ *        back until it is done.
+ *
+ * Paths of libraries are resolved before being sent, the
+ * server may run in another directory.
+ *
+ * @param socket_path   Path to socket of server.
+ * @param command       What to do.
+ * @param redirect_path Directory that server redirects test
+ *                      output to, NULL to not redirect.
+ * @param libraries     Library of each test, or libraries when
+ *                      not named.
+ * @param names         Name of each test, NULL when not named.
+ * @param count         Number of entries in arrays.
+ * @param report        Called for each message.
+ * @param context       Passed to report.
+ *
+ * @return Negative on error or when server stopped before it
+ *         was done.
+ *         Positive on success.
+ */
+int chili_server_request(const char *socket_path,
+                         enum chili_server_command command,
+                         const char *redirect_path,
+                         const char **libraries,
+                         const char **names,
+                         int count,
+                         chili_server_report report,
+                         void *context);
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "shard.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+
+/* Locals */
+static int _by_name(const struct chili_shard_test *x,
+                    const struct chili_shard_test *y)
+{
+    int r = strcmp(x->library, y->library);
+
+    return r != 0 ? r : strcmp(x->name, y->name);
+}
+
+/* Longest first, ties broken by name to not depend on order */
+static int _longest_first(const void *a, const void *b)
+{
+    const struct chili_shard_test *x = *(const struct chili_shard_test**)a;
+    const struct chili_shard_test *y = *(const struct chili_shard_test**)b;
+
+    if (x->duration_ns != y->duration_ns){
+        return x->duration_ns > y->duration_ns ? -1 : 1;
+    }
+    return _by_name(x, y);
+}
+
+
+/* Exports */
+int chili_shard_parse(const char *shard, int *index, int *count)
+{
+    char rest;
+
+    if (sscanf(shard, "%d/%d%c", index, count, &rest) != 2 ||
+        *count < 1 || *index < 1 || *index > *count){
+        return -1;
+    }
+
+    return 1;
+}
+
+int chili_shard_assign(struct chili_shard_test *tests,
+                       int count,
+                       int num_shards)
+{
+    struct chili_shard_test **known;
+    uint64_t *load;
+    uint64_t known_ns = 0;
+    int num_known = 0;
+    int lightest;
+
+    known = malloc(count * sizeof(*known));
+    load = calloc(num_shards, sizeof(*load));
+    if (known == NULL || load == NULL){
+        printf("Unable to allocate shards\n");
+        free(known);
+        free(load);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++){
+        if (tests[i].duration_ns > 0){
+            known[num_known++] = &tests[i];
+            known_ns += tests[i].duration_ns;
+        }
+    }
+
+    /* Unknown tests are assumed to take as long as the average */
+    for (int i = 0; i < count; i++){
+        if (tests[i].duration_ns == 0){
+            tests[i].shard = chili_hash_test(tests[i].library,
+                                             tests[i].name) %
+                             num_shards + 1;
+            load[tests[i].shard - 1] += num_known ?
+                                        known_ns / num_known : 0;
+        }
+    }
+
+    qsort(known, num_known, sizeof(*known), _longest_first);
+    for (int i = 0; i < num_known; i++){
+        lightest = 0;
+        for (int j = 1; j < num_shards; j++){
+            if (load[j] < load[lightest]){
+                lightest = j;
+            }
+        }
+        known[i]->shard = lightest + 1;
+        load[lightest] += known[i]->duration_ns;
+    }
+
+    for (int i = 0; i < num_shards; i++){
+        debug_print("Shard %d predicted to take %llu ns\n",
+                    i + 1, (unsigned long long)load[i]);
+    }
+
+    free(known);
+    free(load);
+
+    return 1;
+}
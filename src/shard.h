@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * @brief Test to assign to a shard.
+ */
+struct chili_shard_test {
+    const char *library;
+    const char *name;
+    /* Recorded duration, zero if unknown */
+    uint64_t   duration_ns;
+    /* Set to shard test belongs to, numbered from 1 */
+    int        shard;
+};
+
+/**
+ * @brief Parses a shard like 2/4.
+ *
+ * @param shard Shard to parse.
+ * @param index Set to shard, numbered from 1.
+ * @param count Set to number of shards.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_shard_parse(const char *shard, int *index, int *count);
+
+/**
+ * @brief Assigns tests to shards.
+ *
+ * Tests without recorded duration are assigned by hash of
+ * library and name. Tests with recorded duration are balanced
+ * over the shards, longest first. Given the same tests and
+ * durations every shard gets the same assignment, regardless
+ * of order of tests.
+ *
+ * @param tests      Tests to assign.
+ * @param count      Number of tests.
+ * @param num_shards Number of shards.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_shard_assign(struct chili_shard_test *tests,
+                       int count,
+                       int num_shards);
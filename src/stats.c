@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "stats.h"
+
+
+/* Locals */
+static int _compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/* Value at fraction of sorted samples, interpolated between
+ * the closest ranks */
+static double _quantile(const uint64_t *sorted, int count, double q)
+{
+    double rank = q * (count - 1);
+    int below = (int)rank;
+    double fraction = rank - below;
+
+    if (below + 1 >= count){
+        return sorted[count - 1];
+    }
+    return sorted[below] +
+           fraction * ((double)sorted[below + 1] - sorted[below]);
+}
+
+/* Exports */
+void chili_stats_sort(uint64_t *samples, int count)
+{
+    qsort(samples, count, sizeof(uint64_t), _compare);
+}
+
+void chili_stats_compute(const uint64_t *sorted, int count,
+                         struct chili_stats *stats)
+{
+    /* Ranks of the interval, 1.96 standard deviations of the
+     * binomial distribution of ranks around the median */
+    double spread = 0.98 * sqrt(count);
+    int low = (int)floor(count / 2.0 - spread);
+    int high = (int)ceil(count / 2.0 + spread);
+    double q1 = _quantile(sorted, count, 0.25);
+    double q3 = _quantile(sorted, count, 0.75);
+    double fence = 1.5 * (q3 - q1);
+
+    stats->median = count % 2 ?
+        sorted[count / 2] :
+        (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+
+    stats->ci_low = sorted[low < 0 ? 0 : low];
+    stats->ci_high = sorted[high >= count ? count - 1 : high];
+
+    stats->low_outliers = 0;
+    stats->high_outliers = 0;
+    for (int i = 0; i < count; i++){
+        if (sorted[i] < q1 - fence){
+            stats->low_outliers++;
+        }
+        else if (sorted[i] > q3 + fence){
+            stats->high_outliers++;
+        }
+    }
+}
+
+double chili_stats_relative_width(const struct chili_stats *stats)
+{
+    if (stats->median == 0){
+        return stats->ci_high == stats->ci_low ? 0.0 : INFINITY;
+    }
+
+    return (double)(stats->ci_high - stats->ci_low) / stats->median;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+
+/**
+ * @brief Spread of a set of samples.
+ */
+struct chili_stats {
+    uint64_t median;
+    /* 95% confidence interval of the median */
+    uint64_t ci_low;
+    uint64_t ci_high;
+    /* Samples outside of the inner fences, 1.5 times the
+     * interquartile range below first or above third quartile. */
+    int      low_outliers;
+    int      high_outliers;
+};
+
+/**
+ * @brief Sorts samples in ascending order.
+ */
+void chili_stats_sort(uint64_t *samples, int count);
+
+/**
+ * @brief Computes median, its confidence interval and outliers.
+ *
+ * The confidence interval is distribution free, taken from
+ * the order statistics around the median. With few samples
+ * the interval spans all samples.
+ *
+ * @param sorted Samples sorted in ascending order.
+ * @param count  Number of samples, at least one.
+ * @param stats  Set to the result.
+ */
+void chili_stats_compute(const uint64_t *sorted, int count,
+                         struct chili_stats *stats);
+
+/**
+ * @brief Returns relative width of the confidence interval.
+ *
+ * @return Width of interval divided by the median.
+ */
+double chili_stats_relative_width(const struct chili_stats *stats);
@@ -42,6 +42,24 @@ static int _add(struct instance *instance, char *symbol)
     return 1;
 }
 
+static int _add_bench(struct instance *instance, char *symbol)
+{
+    struct chili_suite *suite = &instance->suite;
+    char **bench = suite->benchmarks + suite->bench_count;
+
+    if (suite->bench_count >= instance->max){
+        printf("Benchmarks full, cannot add: %s\n", symbol);
+        return -1;
+    }
+
+    *bench = symbol;
+    suite->bench_count++;
+
+    debug_print("Found benchmark: %s\n", symbol);
+
+    return 1;
+}
+
 
 /* Eval functions */
 static int _eval_fixture(char *symbol, struct chili_suite *suite)
@@ -78,6 +96,14 @@ static int _eval_test(const char *symbol)
     return strncmp(test_, symbol, len) == 0 ? 1 : 0;
 }
 
+static int _eval_bench(const char *symbol)
+{
+    const char *bench_ = "bench_";
+    const int len = 6; /* length of bench_ */
+
+    return strncmp(bench_, symbol, len) == 0 ? 1 : 0;
+}
+
 /* Externals */
 int chili_suite_create(int max, chili_handle *handle)
 {
@@ -95,9 +121,13 @@ int chili_suite_create(int max, chili_handle *handle)
     instance->max = max;
     memset(&instance->suite, 0, sizeof(struct chili_suite));
     instance->suite.tests = malloc(size);
+    instance->suite.benchmarks = malloc(size);
 
-    if (instance->suite.tests == NULL){
+    if (instance->suite.tests == NULL ||
+        instance->suite.benchmarks == NULL){
         printf("Unable to allocate: %s\n", strerror(errno));
+        free(instance->suite.tests);
+        free(instance->suite.benchmarks);
         free(instance);
         return -1;
     }
@@ -123,6 +153,11 @@ int chili_suite_eval(chili_handle handle, char *symbol)
         return _add(instance, symbol);
     }
 
+    found = _eval_bench(symbol);
+    if (found){
+        return _add_bench(instance, symbol);
+    }
+
     return 0;
 }
 
@@ -142,5 +177,6 @@ void chili_suite_destroy(chili_handle handle)
     debug_print("Destroying suite\n");
 
     free(instance->suite.tests);
+    free(instance->suite.benchmarks);
     free(instance);
 }
@@ -10,6 +10,8 @@ struct chili_suite {
     const char *each_after;
     char **tests;
     int count;
+    char **benchmarks;
+    int bench_count;
 };
 
 /* @brief Creates skeleton for a suite.
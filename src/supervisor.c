@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "library.h"
+#include "latency.h"
+#include "redirect.h"
+#include "supervisor.h"
+#include "cpus.h"
+#include "run.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Types */
+struct supervisor {
+    /* Process group of supervisor and its tests, 0 if slot
+     * is free */
+    pid_t      pid;
+    /* Read end of pipe that supervisor writes messages to */
+    int        pipe;
+    const char *library;
+    /* Directory that supervisor redirects test output to */
+    char       redirect_path[CHILI_REDIRECT_MAX_PATH + 32];
+};
+
+struct instance {
+    struct chili_supervisor_options options;
+    struct supervisor               *supervisors;
+    struct pollfd                   *polls;
+    int                             capacity;
+    int                             running;
+    /* Number of started supervisors */
+    int                             started;
+    /* Slot to check first, rotated to be fair */
+    int                             first;
+    int                             next_identity;
+};
+
+/* Globals */
+
+/* Instance of this process, there is one at a time */
+static struct instance *_instance;
+
+
+/* Locals */
+
+/* Same rule as when libraries are run one by one */
+static bool _continue_testing(const struct chili_result *result)
+{
+    return !(result->before == fixture_error ||
+             result->after == fixture_error ||
+             result->test == test_error ||
+             result->execution == execution_unknown_error);
+}
+
+static int _send(int fd, enum chili_wire_type type, int r,
+                 uint64_t setup_ns)
+{
+    struct chili_wire_message message;
+
+    memset(&message, 0, sizeof(message));
+    message.type = type;
+    message.r = r;
+    message.setup_ns = setup_ns;
+
+    return chili_wire_write(fd, &message);
+}
+
+static int _send_result(int fd, const struct chili_result *result)
+{
+    struct chili_wire_message message;
+
+    memset(&message, 0, sizeof(message));
+    message.type = chili_wire_result;
+    message.result = *result;
+
+    return chili_wire_write(fd, &message);
+}
+
+/* Tests left out as cached are reported at once */
+struct skipping {
+    const struct chili_supervisor_options *options;
+    int                                   fd;
+};
+
+static bool _skip_cached(void *context,
+                         const char *library_path,
+                         const char *test_name)
+{
+    struct skipping *skipping = context;
+    struct chili_result result;
+
+    if (!skipping->options->cached(skipping->options->cached_context,
+                                   library_path, test_name)){
+        return false;
+    }
+
+    chili_run_cached(&result, library_path, test_name);
+    return _send_result(skipping->fd, &result) > 0;
+}
+
+/* Executed in supervisor process, tests inherit the cpu */
+static int _pin(const struct instance *instance,
+                const struct supervisor *supervisor)
+{
+    int slot = supervisor - instance->supervisors;
+    int cpu;
+
+    if (instance->options.cpus == NULL){
+        return 1;
+    }
+
+    cpu = instance->options.cpus[slot % instance->options.num_cpus];
+    if (chili_cpus_pin(cpu) < 0){
+        return -1;
+    }
+    chili_run_set_cpu(cpu);
+
+    return 1;
+}
+
+/* Executed in supervisor process */
+static int _supervise(const struct instance *instance,
+                      const struct supervisor *supervisor,
+                      int fd,
+                      uint64_t *setup_ns)
+{
+    int r;
+    chili_handle lib_handle;
+    struct chili_result result;
+    struct chili_aggregated scratch = { 0 };
+    struct chili_times times = instance->options.times;
+    struct skipping skipping = { &instance->options, fd };
+    int index = 0;
+
+    r = chili_redirect_begin(instance->options.use_redirect,
+                             supervisor->redirect_path);
+    if (r < 0){
+        return r;
+    }
+
+    r = chili_lib_create(supervisor->library, NULL, &lib_handle);
+    if (r < 0){
+        return r;
+    }
+
+    if (instance->options.run_first){
+        r = chili_lib_run_first(lib_handle, instance->options.run_first,
+                                instance->options.run_first_context);
+        if (r < 0){
+            chili_lib_destroy(lib_handle);
+            return r;
+        }
+    }
+
+    if (instance->options.cached){
+        r = chili_lib_skip(lib_handle, _skip_cached, &skipping);
+        if (r < 0){
+            chili_lib_destroy(lib_handle);
+            return r;
+        }
+    }
+
+    *setup_ns = chili_latency_now();
+    r = chili_lib_before_fixture(lib_handle);
+    *setup_ns = chili_latency_now() - *setup_ns;
+    if (r < 0){
+        _send(fd, chili_wire_begin_fail, r, 0);
+        chili_lib_destroy(lib_handle);
+        return r;
+    }
+
+    do {
+        r = chili_lib_next_test(lib_handle, &index, &times,
+                                &result, &scratch);
+        if (r == 0){
+            break;
+        }
+        if (_send_result(fd, &result) < 0){
+            r = -1;
+            break;
+        }
+    } while (_continue_testing(&result));
+
+    /* Preserve error from above */
+    if (r < 0){
+        chili_lib_after_fixture(lib_handle);
+    }
+    else {
+        r = chili_lib_after_fixture(lib_handle);
+        if (r < 0){
+            _send(fd, chili_wire_end_fail, r, 0);
+        }
+    }
+
+    chili_lib_destroy(lib_handle);
+    chili_redirect_end();
+
+    return r;
+}
+
+static void _release(struct instance *instance,
+                     struct supervisor *supervisor)
+{
+    int status;
+
+    close(supervisor->pipe);
+    waitpid(supervisor->pid, &status, 0);
+    if (instance->options.use_redirect){
+        /* Output of all reported tests has been moved */
+        rmdir(supervisor->redirect_path);
+    }
+
+    supervisor->pid = 0;
+    instance->running--;
+}
+
+static void _adopt_output(struct supervisor *supervisor,
+                          struct chili_result *result,
+                          int identity)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 64];
+    char name[25];
+
+    snprintf(path, sizeof(path), "%s/%d",
+             supervisor->redirect_path, result->identity);
+    snprintf(name, sizeof(name), "%d", identity);
+    chili_redirect_adopt(path, name);
+}
+
+static int _receive(struct instance *instance,
+                    struct supervisor *supervisor,
+                    struct chili_wire_message *message)
+{
+    int r = chili_wire_read(supervisor->pipe, message);
+
+    if (r <= 0){
+        printf("Supervisor of %s exited unexpectedly\n",
+               supervisor->library);
+        memset(message, 0, sizeof(*message));
+        message->type = chili_wire_done;
+        message->r = -1;
+    }
+
+    message->result.library = supervisor->library;
+
+    switch (message->type){
+        case chili_wire_result:
+            /* Cached results have no output */
+            if (!message->result.cached){
+                _adopt_output(supervisor, &message->result,
+                              instance->next_identity);
+            }
+            message->result.identity = instance->next_identity++;
+            break;
+        case chili_wire_done:
+            debug_print("Supervisor of %s done: %d\n",
+                        supervisor->library, message->r);
+            _release(instance, supervisor);
+            break;
+        default:
+            break;
+    }
+
+    return 1;
+}
+
+/* Exports */
+int chili_supervisor_create(int capacity,
+                            const struct chili_supervisor_options *options,
+                            chili_handle *handle)
+{
+    struct instance *instance;
+
+    instance = malloc(sizeof(*instance));
+    if (instance == NULL){
+        printf("Unable to allocate supervisor instance\n");
+        return -1;
+    }
+
+    instance->supervisors = calloc(capacity, sizeof(struct supervisor));
+    instance->polls = calloc(capacity, sizeof(struct pollfd));
+    if (instance->supervisors == NULL || instance->polls == NULL){
+        printf("Unable to allocate supervisors\n");
+        free(instance->supervisors);
+        free(instance->polls);
+        free(instance);
+        return -1;
+    }
+
+    instance->options = *options;
+    instance->capacity = capacity;
+    instance->running = 0;
+    instance->started = 0;
+    instance->first = 0;
+    instance->next_identity = 0;
+    _instance = instance;
+
+    *handle = instance;
+    return 1;
+}
+
+int chili_supervisor_start(chili_handle handle, const char *library)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct supervisor *supervisor = NULL;
+    int pipes[2];
+    pid_t child;
+    uint64_t setup_ns = 0;
+    int r;
+
+    for (int i = 0; i < instance->capacity; i++){
+        if (instance->supervisors[i].pid == 0){
+            supervisor = &instance->supervisors[i];
+            break;
+        }
+    }
+    if (supervisor == NULL){
+        printf("No room for another supervisor\n");
+        return -1;
+    }
+
+    supervisor->library = library;
+    snprintf(supervisor->redirect_path,
+             sizeof(supervisor->redirect_path), "%s/.supervisor%d",
+             instance->options.redirect_path, instance->started);
+
+    if (pipe(pipes) < 0){
+        printf("Failed to create pipe: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* Child would otherwise print what is still buffered */
+    fflush(stdout);
+
+    child = fork();
+    if (child < 0){
+        printf("Failed to fork: %s\n", strerror(errno));
+        close(pipes[0]);
+        close(pipes[1]);
+        return -1;
+    }
+
+    if (child == 0){
+        /* Own group to be able to stop supervisor and tests */
+        setpgid(0, 0);
+        close(pipes[0]);
+        r = _pin(instance, supervisor);
+        if (r > 0){
+            r = _supervise(instance, supervisor, pipes[1], &setup_ns);
+        }
+        _send(pipes[1], chili_wire_done, r, setup_ns);
+        close(pipes[1]);
+        _exit(r < 0 ? 1 : 0);
+    }
+
+    /* Also from here to not race with kill in stop */
+    setpgid(child, child);
+    close(pipes[1]);
+
+    debug_print("Started supervisor %d of %s\n", child, library);
+    supervisor->pid = child;
+    supervisor->pipe = pipes[0];
+    instance->running++;
+    instance->started++;
+
+    return 1;
+}
+
+int chili_supervisor_running(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    return instance->running;
+}
+
+int chili_supervisor_next(chili_handle handle,
+                          struct chili_wire_message *message)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct supervisor *supervisor;
+    int slot;
+    int r;
+
+    if (instance->running == 0){
+        return 0;
+    }
+
+    for (int i = 0; i < instance->capacity; i++){
+        supervisor = &instance->supervisors[i];
+        instance->polls[i].fd = supervisor->pid ? supervisor->pipe : -1;
+        instance->polls[i].events = POLLIN;
+        instance->polls[i].revents = 0;
+    }
+
+    do {
+        r = poll(instance->polls, instance->capacity, -1);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0){
+        printf("Failed to wait for supervisors: %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < instance->capacity; i++){
+        slot = (instance->first + i) % instance->capacity;
+        if (instance->polls[slot].revents){
+            instance->first = (slot + 1) % instance->capacity;
+            return _receive(instance, &instance->supervisors[slot],
+                            message);
+        }
+    }
+
+    return -1;
+}
+
+void chili_supervisor_stop(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct supervisor *supervisor;
+
+    for (int i = 0; i < instance->capacity; i++){
+        supervisor = &instance->supervisors[i];
+        if (supervisor->pid){
+            kill(-supervisor->pid, SIGKILL);
+            _release(instance, supervisor);
+        }
+    }
+}
+
+void chili_supervisor_kill(void)
+{
+    struct instance *instance = _instance;
+
+    for (int i = 0; instance && i < instance->capacity; i++){
+        if (instance->supervisors[i].pid){
+            kill(-instance->supervisors[i].pid, SIGKILL);
+        }
+    }
+}
+
+void chili_supervisor_destroy(chili_handle handle)
+{
+    struct instance *instance = (struct instance*)handle;
+
+    _instance = NULL;
+    chili_supervisor_stop(handle);
+    free(instance->supervisors);
+    free(instance->polls);
+    free(instance);
+}
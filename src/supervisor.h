@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "handle.h"
+#include "run.h"
+#include "wire.h"
+#include "redirect.h"
+#include "library.h"
+
+struct chili_supervisor_options {
+    /* Redirect test output to files in redirect_path */
+    bool               use_redirect;
+    char               redirect_path[CHILI_REDIRECT_MAX_PATH];
+    /* Timing used for each test */
+    struct chili_times times;
+    /* Selects tests in each library to run before the others,
+     * NULL to run in suite order */
+    chili_lib_select   run_first;
+    void               *run_first_context;
+    /* Selects tests that succeeded earlier, they are reported
+     * as cached without being run. NULL to run all tests. */
+    chili_lib_select   cached;
+    void               *cached_context;
+    /* Cpus to pin supervisors to, one per slot and wrapping
+     * around, NULL to not pin */
+    const int          *cpus;
+    int                num_cpus;
+};
+
+/**
+ * @brief Creates module that runs libraries concurrently.
+ *
+ * Each library is run by a supervisor process of its own that
+ * loads the library, runs suite setup, all tests and suite
+ * teardown and sends results back to this process.
+ *
+ * @param capacity Max number of supervisors running at once.
+ * @param options  Options used by all supervisors.
+ * @param handle   Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_supervisor_create(int capacity,
+                            const struct chili_supervisor_options *options,
+                            chili_handle *handle);
+
+/**
+ * @brief Starts supervisor for a library.
+ *
+ * Library path must be valid until supervisor is done.
+ *
+ * @return Negative on error or when capacity is exceeded.
+ *         Positive on success.
+ */
+int chili_supervisor_start(chili_handle handle, const char *library);
+
+/**
+ * @brief Returns number of supervisors that are not done.
+ */
+int chili_supervisor_running(chili_handle handle);
+
+/**
+ * @brief Waits for next message from any running supervisor.
+ *
+ * Results get an identity that is unique among all supervisors
+ * and their redirected output is moved to the redirect path
+ * under that identity, so they can be reported as if run here.
+ * A supervisor that dies before it is done is reported as done
+ * with an error. Message is valid until next call.
+ *
+ * @return Negative on error.
+ *         Zero when no supervisor is running.
+ *         Positive on success.
+ */
+int chili_supervisor_next(chili_handle handle,
+                          struct chili_wire_message *message);
+
+/**
+ * @brief Kills all running supervisors and their tests.
+ */
+void chili_supervisor_stop(chili_handle handle);
+
+/**
+ * @brief Kills all supervisors of this process and their tests,
+ *        without waiting for them.
+ *
+ * Safe to call from a signal handler.
+ */
+void chili_supervisor_kill(void);
+
+/**
+ * @brief Stops all supervisors and frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_supervisor_destroy(chili_handle handle);
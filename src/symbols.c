@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <sys/mman.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <errno.h>
 
 #include "symbols.h"
@@ -28,11 +29,15 @@ struct header {
     uint64_t        sections_offset;
     uint16_t        section_size;
     uint16_t        section_count;
+    /* Index of section with section names */
+    uint16_t        names_index;
 };
 
 struct section {
     uint64_t name;
     uint64_t type;
+    uint64_t flags;
+    uint64_t address;
     uint64_t offset;
     uint64_t size;
     uint64_t entsize;
@@ -41,6 +46,11 @@ struct section {
 
 struct symbol {
     uint64_t name;
+    uint64_t value;
+    uint64_t size;
+    uint16_t section;
+    /* Type and binding */
+    uint8_t  info;
 };
 
 struct instance {
@@ -50,6 +60,12 @@ struct instance {
     struct header  header;
     struct section dynsym;
     struct section dynstr;
+    /* Dynamic section, size is zero when there is none */
+    struct section dynamic;
+    /* All symbols, including static functions, .dynsym when
+     * library is stripped */
+    struct section symtab;
+    struct section symstr;
     int            count;
     int            next;
 };
@@ -141,6 +157,13 @@ static uint16_t _get_section_size(char *map, char b, enum endianness e)
         _get_16(e, map + 0x3a);
 }
 
+static uint16_t _get_names_index(char *map, char b, enum endianness e)
+{
+    return b == 32 ?
+        _get_16(e, map + 0x32) :
+        _get_16(e, map + 0x3e);
+}
+
 static int _get_header(char *map, struct header *header)
 {
     int b = _get_bitness(map);
@@ -163,6 +186,8 @@ static int _get_header(char *map, struct header *header)
         _get_section_count(map, b, e);
     header->section_size =
         _get_section_size(map, b, e);
+    header->names_index =
+        _get_names_index(map, b, e);
 
     return 1;
 }
@@ -179,6 +204,8 @@ static int _get_section(char *map, struct header *header,
     if (b == 32){
         section->name    = _get_32(e, map);
         section->type    = _get_32(e, map + 0x04);
+        section->flags   = _get_32(e, map + 0x08);
+        section->address = _get_32(e, map + 0x0c);
         section->offset  = _get_32(e, map + 0x10);
         section->size    = _get_32(e, map + 0x14);
         section->link    = _get_32(e, map + 0x18);
@@ -187,8 +214,8 @@ static int _get_section(char *map, struct header *header,
     else{
         section->name    = _get_32(e, map);
         section->type    = _get_32(e, map + 0x04);
-        /* Flags         = _get_64(e, map + 0x08)*/
-        /* Address       = _get_64(e, map + 0x10)*/
+        section->flags   = _get_64(e, map + 0x08);
+        section->address = _get_64(e, map + 0x10);
         section->offset  = _get_64(e, map + 0x18);
         section->size    = _get_64(e, map + 0x20);
         section->link    = _get_32(e, map + 0x28);
@@ -208,9 +235,37 @@ static uint64_t _get_symbol(char *map, struct header *header,
         (index * table->entsize);
 
     symbol->name = _get_32(header->e, map);
+    if (header->b == 32){
+        symbol->value   = _get_32(header->e, map + 0x04);
+        symbol->size    = _get_32(header->e, map + 0x08);
+        symbol->info    = map[0x0c];
+        symbol->section = _get_16(header->e, map + 0x0e);
+    }
+    else{
+        symbol->info    = map[0x04];
+        symbol->section = _get_16(header->e, map + 0x06);
+        symbol->value   = _get_64(header->e, map + 0x08);
+        symbol->size    = _get_64(header->e, map + 0x10);
+    }
     return 1;
 }
 
+static void _get_dynamic(char *map, struct header *header,
+                         struct section *dynamic, int index,
+                         uint64_t *tag, uint64_t *value)
+{
+    map += dynamic->offset + (index * dynamic->entsize);
+
+    if (header->b == 32){
+        *tag   = _get_32(header->e, map);
+        *value = _get_32(header->e, map + 0x04);
+    }
+    else{
+        *tag   = _get_64(header->e, map);
+        *value = _get_64(header->e, map + 0x08);
+    }
+}
+
 static char* _get_string(char *map, struct section *table,
                          uint64_t offset)
 {
@@ -252,6 +307,31 @@ static void debug_print_symbol(struct symbol *s, int i)
                 "\tname: %lu\n", i, s->name);
 }
 
+/* Finds symbol defined in library, by name */
+static bool _find_symbol(struct instance *instance,
+                         const char *name,
+                         struct symbol *symbol)
+{
+    for (int i = 0; i < instance->count; i++){
+        _get_symbol(instance->map, &instance->header,
+                    &instance->dynsym, i, symbol);
+        if (strcmp(_get_string(instance->map, &instance->dynstr,
+                               symbol->name), name) != 0){
+            continue;
+        }
+
+        /* Undefined, defined elsewhere */
+        if (symbol->section == 0 ||
+            symbol->section >= instance->header.section_count){
+            continue;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
 /* External functions */
 int chili_sym_create(const char *path, int *count, chili_handle *handle)
 {
@@ -338,6 +418,35 @@ int chili_sym_create(const char *path, int *count, chili_handle *handle)
     }
     debug_print_section(&instance->dynstr, "dynstr");
 
+    /* Dynamic section is optional, strings are in .dynstr */
+    memset(&instance->dynamic, 0, sizeof(instance->dynamic));
+    for (i = 0; i < instance->header.section_count; i++){
+        struct section section;
+
+        _get_section(map, &instance->header, i, &section);
+        if (section.type == 6 /*SHT_DYNAMIC*/ && section.entsize > 0){
+            instance->dynamic = section;
+            debug_print_section(&instance->dynamic, "dynamic");
+            break;
+        }
+    }
+
+    instance->symtab = instance->dynsym;
+    instance->symstr = instance->dynstr;
+    for (i = 0; i < instance->header.section_count; i++){
+        struct section section;
+
+        _get_section(map, &instance->header, i, &section);
+        if (section.type == 2 /*SHT_SYMTAB*/ && section.entsize > 0 &&
+            section.link < instance->header.section_count){
+            instance->symtab = section;
+            _get_section(map, &instance->header, section.link,
+                         &instance->symstr);
+            debug_print_section(&instance->symtab, "symtab");
+            break;
+        }
+    }
+
     instance->count = instance->dynsym.size / instance->dynsym.entsize;
     instance->fd = fd;
     instance->fdsize = fdsize;
@@ -390,6 +499,165 @@ int chili_sym_next(chili_handle handle, char **name)
     return 1;
 }
 
+int chili_sym_next_dynamic(chili_handle handle,
+                           int tag,
+                           int *index,
+                           char **value)
+{
+    struct instance *instance = (struct instance*)handle;
+    uint64_t count = 0;
+    uint64_t entry_tag;
+    uint64_t entry_value;
+
+    if (instance->dynamic.entsize > 0){
+        count = instance->dynamic.size / instance->dynamic.entsize;
+    }
+
+    while (*index >= 0 && (uint64_t)*index < count){
+        _get_dynamic(instance->map, &instance->header,
+                     &instance->dynamic, *index,
+                     &entry_tag, &entry_value);
+        (*index)++;
+
+        /* DT_NULL ends the table */
+        if (entry_tag == 0){
+            break;
+        }
+        if (entry_tag == (uint64_t)tag){
+            *value = _get_string(instance->map, &instance->dynstr,
+                                 entry_value);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int chili_sym_code(chili_handle handle,
+                   const char *name,
+                   const char **code,
+                   uint64_t *size)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct symbol symbol;
+    struct section section;
+    uint64_t offset;
+
+    if (!_find_symbol(instance, name, &symbol)){
+        return 0;
+    }
+
+    _get_section(instance->map, &instance->header, symbol.section,
+                 &section);
+    /* Like .bss, takes no space in file */
+    if (section.type == 8 /*SHT_NOBITS*/){
+        *code = NULL;
+        *size = 0;
+        return 1;
+    }
+
+    offset = section.offset + (symbol.value - section.address);
+    if (symbol.value < section.address ||
+        offset + symbol.size > (uint64_t)instance->fdsize){
+        printf("Symbol %s is outside of file\n", name);
+        return -1;
+    }
+
+    *code = instance->map + offset;
+    *size = symbol.size;
+    return 1;
+}
+
+int chili_sym_address(chili_handle handle,
+                      const char *name,
+                      uint64_t *address,
+                      uint64_t *size)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct symbol symbol;
+
+    if (!_find_symbol(instance, name, &symbol)){
+        return 0;
+    }
+
+    *address = symbol.value;
+    *size = symbol.size;
+    return 1;
+}
+
+int chili_sym_next_function(chili_handle handle,
+                            int *index,
+                            char **name,
+                            uint64_t *address,
+                            uint64_t *size)
+{
+    struct instance *instance = (struct instance*)handle;
+    uint64_t count = instance->symtab.size / instance->symtab.entsize;
+    struct symbol symbol;
+
+    while (*index >= 0 && (uint64_t)*index < count){
+        _get_symbol(instance->map, &instance->header,
+                    &instance->symtab, *index, &symbol);
+        (*index)++;
+
+        if ((symbol.info & 0xf) != 2 /*STT_FUNC*/ ||
+            symbol.section == 0 ||
+            symbol.section >= instance->header.section_count){
+            continue;
+        }
+
+        *name = _get_string(instance->map, &instance->symstr,
+                            symbol.name);
+        *address = symbol.value;
+        *size = symbol.size;
+        return 1;
+    }
+
+    return 0;
+}
+
+int chili_sym_section(chili_handle handle,
+                      const char *name,
+                      const char **contents,
+                      uint64_t *size)
+{
+    struct instance *instance = (struct instance*)handle;
+    struct section names;
+    struct section section;
+
+    if (instance->header.names_index == 0 ||
+        instance->header.names_index >= instance->header.section_count){
+        return 0;
+    }
+    _get_section(instance->map, &instance->header,
+                 instance->header.names_index, &names);
+
+    for (int i = 1; i < instance->header.section_count; i++){
+        _get_section(instance->map, &instance->header, i, &section);
+        if (section.name >= names.size ||
+            strcmp(_get_string(instance->map, &names, section.name),
+                   name) != 0){
+            continue;
+        }
+
+        if (section.flags & 0x800 /*SHF_COMPRESSED*/){
+            printf("Section %s is compressed\n", name);
+            return -1;
+        }
+        if (section.type == 8 /*SHT_NOBITS*/ ||
+            section.offset + section.size > (uint64_t)instance->fdsize){
+            printf("Section %s is outside of file\n", name);
+            return -1;
+        }
+
+        *contents = instance->map + section.offset;
+        *size = section.size;
+        return 1;
+    }
+
+    return 0;
+}
+
 void chili_sym_destroy(chili_handle handle)
 {
     struct instance *instance = (struct instance*)handle;
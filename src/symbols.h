@@ -1,7 +1,14 @@
 #pragma once
 
+#include <stdint.h>
+
 #include "handle.h"
 
+/* Tags of dynamic entries with string values */
+#define CHILI_SYM_NEEDED  1  /* DT_NEEDED, library needed */
+#define CHILI_SYM_RPATH   15 /* DT_RPATH, search path */
+#define CHILI_SYM_RUNPATH 29 /* DT_RUNPATH, search path */
+
 
 /**
  * @brief Creates a symbol parser for specified
@@ -32,6 +39,103 @@ int chili_sym_create(const char *path, int *count, chili_handle *handle);
  */
 int chili_sym_next(chili_handle handle, char **name);
 
+/**
+ * @brief Retrieves contents of symbol defined in shared
+ *        library, like machine code of a function.
+ *
+ * @param handle Valid module handle.
+ * @param name   Name of symbol.
+ * @param code   Set to contents of symbol, valid until
+ *               parser is destroyed. NULL when symbol takes
+ *               no space in file, like zeroed data.
+ * @param size   Set to size of contents.
+ *
+ * @return Negative on error.
+ *         Zero if symbol isn't defined in library.
+ *         Positive on success.
+ */
+int chili_sym_code(chili_handle handle,
+                   const char *name,
+                   const char **code,
+                   uint64_t *size);
+
+/**
+ * @brief Retrieves address and size of symbol defined in
+ *        shared library, as linked, not as loaded.
+ *
+ * @param handle  Valid module handle.
+ * @param name    Name of symbol.
+ * @param address Set to address of symbol.
+ * @param size    Set to size of symbol.
+ *
+ * @return Zero if symbol isn't defined in library.
+ *         Positive on success.
+ */
+int chili_sym_address(chili_handle handle,
+                      const char *name,
+                      uint64_t *address,
+                      uint64_t *size);
+
+/**
+ * @brief Retrieves next function defined in shared library,
+ *        including static functions unless library is
+ *        stripped.
+ *
+ * @param handle  Valid module handle.
+ * @param index   Symbol to start looking from, zero for the
+ *                first. Set to where to continue looking.
+ * @param name    Set to name of function.
+ * @param address Set to address of function, as linked.
+ * @param size    Set to size of function.
+ *
+ * @return Zero on end of functions.
+ *         Positive on success.
+ */
+int chili_sym_next_function(chili_handle handle,
+                            int *index,
+                            char **name,
+                            uint64_t *address,
+                            uint64_t *size);
+
+/**
+ * @brief Retrieves contents of section in shared library
+ *        by name, like .debug_line.
+ *
+ * @param handle   Valid module handle.
+ * @param name     Name of section.
+ * @param contents Set to contents of section, valid until
+ *                 parser is destroyed.
+ * @param size     Set to size of contents.
+ *
+ * @return Negative on error, like when section is compressed.
+ *         Zero if there is no such section.
+ *         Positive on success.
+ */
+int chili_sym_section(chili_handle handle,
+                      const char *name,
+                      const char **contents,
+                      uint64_t *size);
+
+/**
+ * @brief Retrieves string value of next dynamic entry with
+ *        tag, like names of needed libraries.
+ *
+ * @param handle Valid module handle.
+ * @param tag    One of CHILI_SYM_NEEDED, CHILI_SYM_RPATH or
+ *               CHILI_SYM_RUNPATH.
+ * @param index  Entry to start looking from, zero for the
+ *               first. Set to where to continue looking.
+ * @param value  Set to value of retrieved entry.
+ *
+ * @return Negative on error.
+ *         Zero on end of entries
+ *         Positive on success.
+ */
+int chili_sym_next_dynamic(chili_handle handle,
+                           int tag,
+                           int *index,
+                           char **value);
+
 /**
  * @brief Frees allocated resources.
  *
@@ -0,0 +1,353 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "watch.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Time without writes before a library is considered settled,
+ * linkers write the library in many small pieces */
+#define SETTLE_NS 300000000ULL
+
+/* Events that are seen when a library is written or replaced */
+#define EVENTS (IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | \
+                IN_MOVED_TO | IN_DELETE | IN_ATTRIB)
+
+/* Enough for a number of events with long names */
+#define EVENTS_SIZE (16 * (sizeof(struct inotify_event) + NAME_MAX + 1))
+
+/* Size of ELF header of 64 bit library */
+#define HEADER_SIZE 64
+
+/* Types */
+struct library {
+    /* Name of library within directory */
+    char     *name;
+    const char *path;
+    /* Watch of directory */
+    int      wd;
+    bool     changing;
+    /* Time of last write */
+    uint64_t written_ns;
+};
+
+struct instance {
+    int            fd;
+    struct library *libraries;
+    int            num_libraries;
+};
+
+/* Locals */
+static uint64_t _now_ns()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/* Linkers write section headers last, a library whose section
+ * headers are all within the file is complete. */
+static bool _is_complete(const char *path)
+{
+    int fd;
+    unsigned char header[HEADER_SIZE];
+    struct stat path_stat;
+    uint64_t offset = 0;
+    uint16_t entry_size = 0;
+    uint16_t count = 0;
+    bool complete = false;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+    if (fstat(fd, &path_stat) < 0 ||
+        read(fd, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, "\177ELF", 4) != 0){
+        goto on_exit;
+    }
+
+    /* Little endian, like the machines chili runs on */
+    if (header[4] == 2){
+        memcpy(&offset, header + 0x28, 8);
+        memcpy(&entry_size, header + 0x3a, 2);
+        memcpy(&count, header + 0x3c, 2);
+    }
+    else {
+        memcpy(&offset, header + 0x20, 4);
+        memcpy(&entry_size, header + 0x2e, 2);
+        memcpy(&count, header + 0x30, 2);
+    }
+    complete = offset > 0 &&
+        offset + (uint64_t)entry_size * count <= (uint64_t)path_stat.st_size;
+
+on_exit:
+    close(fd);
+    return complete;
+}
+
+static void _written(struct instance *instance,
+                     const struct inotify_event *event,
+                     uint64_t now_ns,
+                     enum chili_watch_state *states,
+                     int *num_started)
+{
+    struct library *library;
+
+    for (int i = 0; i < instance->num_libraries; i++){
+        library = &instance->libraries[i];
+        if (library->wd != event->wd || event->len == 0 ||
+            strcmp(library->name, event->name) != 0){
+            continue;
+        }
+
+        debug_print("Library %s written, mask %x\n",
+                    library->path, event->mask);
+        if (!library->changing){
+            library->changing = true;
+            *num_started += 1;
+        }
+        library->written_ns = now_ns;
+        states[i] = chili_watch_changing;
+    }
+}
+
+static int _read_events(struct instance *instance,
+                        enum chili_watch_state *states,
+                        int *num_started)
+{
+    char buffer[EVENTS_SIZE]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event;
+    uint64_t now_ns = _now_ns();
+    ssize_t size;
+
+    while (true){
+        size = read(instance->fd, buffer, sizeof(buffer));
+        if (size < 0){
+            if (errno == EAGAIN || errno == EINTR){
+                return 1;
+            }
+            printf("Failed to read watch events: %s\n", strerror(errno));
+            return -1;
+        }
+
+        for (char *at = buffer; at < buffer + size;
+             at += sizeof(*event) + event->len){
+            event = (const struct inotify_event*)at;
+            _written(instance, event, now_ns, states, num_started);
+        }
+    }
+}
+
+/* Time until next changing library may have settled,
+ * negative when no library is changing */
+static int _settle_timeout_ms(struct instance *instance, uint64_t now_ns)
+{
+    uint64_t remaining;
+    uint64_t first = UINT64_MAX;
+
+    for (int i = 0; i < instance->num_libraries; i++){
+        if (!instance->libraries[i].changing){
+            continue;
+        }
+        remaining = instance->libraries[i].written_ns + SETTLE_NS;
+        remaining = remaining > now_ns ? remaining - now_ns : 0;
+        if (remaining < first){
+            first = remaining;
+        }
+    }
+
+    if (first == UINT64_MAX){
+        return -1;
+    }
+    /* Round up to not wake before it has settled */
+    return (int)((first + 999999) / 1000000);
+}
+
+static int _settle(struct instance *instance,
+                   enum chili_watch_state *states)
+{
+    struct library *library;
+    uint64_t now_ns = _now_ns();
+    int num_settled = 0;
+
+    for (int i = 0; i < instance->num_libraries; i++){
+        library = &instance->libraries[i];
+        if (!library->changing ||
+            library->written_ns + SETTLE_NS > now_ns){
+            continue;
+        }
+
+        /* Removed or still incomplete, wait for more writes or
+         * another period without them */
+        if (!_is_complete(library->path)){
+            library->written_ns = now_ns;
+            continue;
+        }
+
+        library->changing = false;
+        states[i] = chili_watch_changed;
+        num_settled++;
+    }
+
+    return num_settled;
+}
+
+/* Exports */
+int chili_watch_create(const char **library_paths,
+                       int num_libraries,
+                       chili_handle *handle)
+{
+    struct instance *instance;
+    struct library *library;
+    char directory[PATH_MAX];
+    char name[PATH_MAX];
+
+    instance = calloc(1, sizeof(*instance));
+    if (instance == NULL){
+        printf("Failed to allocate instance\n");
+        return -1;
+    }
+    instance->libraries = calloc(num_libraries,
+                                 sizeof(*instance->libraries));
+    if (instance->libraries == NULL){
+        printf("Failed to allocate libraries\n");
+        free(instance);
+        return -1;
+    }
+    instance->num_libraries = num_libraries;
+
+    instance->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (instance->fd < 0){
+        printf("Failed to create watch: %s\n", strerror(errno));
+        goto on_error;
+    }
+
+    for (int i = 0; i < num_libraries; i++){
+        library = &instance->libraries[i];
+        library->path = library_paths[i];
+
+        if (strlen(library_paths[i]) >= PATH_MAX){
+            printf("Path %s is too long\n", library_paths[i]);
+            goto on_error;
+        }
+        /* Both may modify their argument */
+        strcpy(directory, library_paths[i]);
+        strcpy(name, library_paths[i]);
+
+        library->name = strdup(basename(name));
+        if (library->name == NULL){
+            printf("Failed to allocate name\n");
+            goto on_error;
+        }
+
+        /* Same directory gives same watch */
+        library->wd = inotify_add_watch(instance->fd, dirname(directory),
+                                        EVENTS);
+        if (library->wd < 0){
+            printf("Failed to watch directory of %s: %s\n",
+                   library_paths[i], strerror(errno));
+            goto on_error;
+        }
+    }
+
+    *handle = instance;
+    return 1;
+
+on_error:
+    chili_watch_destroy(instance);
+    return -1;
+}
+
+int chili_watch_wait(chili_handle handle,
+                     int timeout_ms,
+                     enum chili_watch_state *states)
+{
+    struct instance *instance = handle;
+    struct pollfd poll_fd = { .fd = instance->fd, .events = POLLIN };
+    uint64_t deadline_ns = 0;
+    uint64_t now_ns;
+    int wait_ms;
+    int num_started = 0;
+    int num_settled;
+    int r;
+
+    for (int i = 0; i < instance->num_libraries; i++){
+        states[i] = instance->libraries[i].changing ?
+            chili_watch_changing : chili_watch_unchanged;
+    }
+
+    if (timeout_ms >= 0){
+        deadline_ns = _now_ns() + timeout_ms * 1000000ULL;
+    }
+
+    while (true){
+        now_ns = _now_ns();
+        wait_ms = _settle_timeout_ms(instance, now_ns);
+        if (timeout_ms >= 0){
+            int left_ms = deadline_ns > now_ns ?
+                (int)((deadline_ns - now_ns) / 1000000) : 0;
+
+            if (wait_ms < 0 || left_ms < wait_ms){
+                wait_ms = left_ms;
+            }
+        }
+
+        r = poll(&poll_fd, 1, wait_ms);
+        if (r < 0){
+            if (errno == EINTR){
+                return 0;
+            }
+            printf("Failed to wait for watch events: %s\n",
+                   strerror(errno));
+            return -1;
+        }
+        if (r > 0){
+            r = _read_events(instance, states, &num_started);
+            if (r < 0){
+                return r;
+            }
+        }
+
+        num_settled = _settle(instance, states);
+        if (num_started > 0 || num_settled > 0){
+            return 1;
+        }
+        if (timeout_ms >= 0 && _now_ns() >= deadline_ns){
+            return 0;
+        }
+    }
+}
+
+void chili_watch_destroy(chili_handle handle)
+{
+    struct instance *instance = handle;
+
+    for (int i = 0; i < instance->num_libraries; i++){
+        free(instance->libraries[i].name);
+    }
+    if (instance->fd > 0){
+        close(instance->fd);
+    }
+    free(instance->libraries);
+    free(instance);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "handle.h"
+
+/* State of a watched library */
+enum chili_watch_state {
+    /* Not touched since it was last reported as changed */
+    chili_watch_unchanged,
+    /* Being written, waiting for writes to settle */
+    chili_watch_changing,
+    /* Written and settled, reported once */
+    chili_watch_changed,
+};
+
+/**
+ * @brief Creates watcher of shared libraries.
+ *
+ * Directories of libraries are watched, linkers either rewrite
+ * the library in place or replace it with a new file. A library
+ * is changed when no writes have been seen for a while and it
+ * is a complete library again.
+ *
+ * @param library_paths Array of paths to shared libraries.
+ * @param num_libraries Number of entries in array.
+ * @param handle        Instance handle set on success.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_watch_create(const char **library_paths,
+                       int num_libraries,
+                       chili_handle *handle);
+
+/**
+ * @brief Waits for libraries to start or finish changing.
+ *
+ * States are set for all libraries, in the order given when
+ * created. Changed is only set in the call where the library
+ * settled, later calls set unchanged until it is written to
+ * again.
+ *
+ * @param handle     Valid module handle.
+ * @param timeout_ms Longest time to wait, negative to wait
+ *                   until something happens.
+ * @param states     Array with a state per library.
+ *
+ * @return Negative on error.
+ *         Zero when nothing happened before timeout or when
+ *         interrupted by a signal.
+ *         Positive when a library started or finished changing.
+ */
+int chili_watch_wait(chili_handle handle,
+                     int timeout_ms,
+                     enum chili_watch_state *states);
+
+/**
+ * @brief Frees allocated resources.
+ *
+ * @param handle Valid module handle.
+ */
+void chili_watch_destroy(chili_handle handle);
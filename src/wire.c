@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "wire.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Starts each framed message, "chil" */
+#define FRAME_MAGIC 0x6c696863u
+
+/* Types */
+struct frame {
+    uint32_t magic;
+    uint32_t length;
+};
+
+/* Writes to pipes up to this size are atomic */
+_Static_assert(sizeof(struct chili_wire_message) <= PIPE_BUF,
+               "Wire message must fit in one pipe write");
+
+
+/* Locals */
+static void _prepare(struct chili_wire_message *message)
+{
+    if (message->type == chili_wire_result){
+        snprintf(message->name, CHILI_WIRE_MAX_NAME, "%s",
+                 message->result.name ? message->result.name : "");
+    }
+}
+
+static void _received(struct chili_wire_message *message)
+{
+    message->name[CHILI_WIRE_MAX_NAME - 1] = '\0';
+    message->result.name = message->name;
+    message->result.library = NULL;
+}
+
+static int _write_all(int fd, const void *buffer, size_t size)
+{
+    const char *data = buffer;
+    ssize_t written;
+
+    while (size > 0){
+        written = write(fd, data, size);
+        if (written < 0 && errno == EINTR){
+            continue;
+        }
+        if (written <= 0){
+            return -1;
+        }
+        data += written;
+        size -= written;
+    }
+
+    return 1;
+}
+
+/* Returns zero if stream is closed before anything is read */
+static int _read_all(int fd, void *buffer, size_t size)
+{
+    char *data = buffer;
+    size_t total = 0;
+    ssize_t received;
+
+    while (total < size){
+        received = read(fd, data + total, size - total);
+        if (received < 0 && errno == EINTR){
+            continue;
+        }
+        if (received < 0){
+            return -1;
+        }
+        if (received == 0){
+            return total == 0 ? 0 : -1;
+        }
+        total += received;
+    }
+
+    return 1;
+}
+
+
+/* Exports */
+int chili_wire_write(int fd, struct chili_wire_message *message)
+{
+    ssize_t written;
+
+    _prepare(message);
+
+    do {
+        written = write(fd, message, sizeof(*message));
+    } while (written < 0 && errno == EINTR);
+
+    if (written != sizeof(*message)){
+        printf("Failed to write message: %s\n",
+               written < 0 ? strerror(errno) : "partial write");
+        return -1;
+    }
+
+    return 1;
+}
+
+int chili_wire_read(int fd, struct chili_wire_message *message)
+{
+    ssize_t received;
+
+    do {
+        received = read(fd, message, sizeof(*message));
+    } while (received < 0 && errno == EINTR);
+
+    if (received == 0){
+        debug_print("Writer closed pipe %d\n", fd);
+        return 0;
+    }
+    if (received != sizeof(*message)){
+        printf("Failed to read message: %s\n",
+               received < 0 ? strerror(errno) : "partial read");
+        return -1;
+    }
+
+    _received(message);
+
+    return 1;
+}
+
+int chili_wire_send(int fd, struct chili_wire_message *message)
+{
+    struct frame frame = { FRAME_MAGIC, sizeof(*message) };
+
+    _prepare(message);
+
+    if (_write_all(fd, &frame, sizeof(frame)) < 0 ||
+        _write_all(fd, message, sizeof(*message)) < 0){
+        debug_print("Failed to send message: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 1;
+}
+
+int chili_wire_receive(int fd, struct chili_wire_message *message)
+{
+    struct frame frame;
+    int r;
+
+    r = _read_all(fd, &frame, sizeof(frame));
+    if (r <= 0){
+        return r;
+    }
+    if (frame.magic != FRAME_MAGIC || frame.length != sizeof(*message)){
+        printf("Received message is not framed by chili\n");
+        return -1;
+    }
+
+    r = _read_all(fd, message, sizeof(*message));
+    if (r <= 0){
+        printf("Stream closed in the middle of a message\n");
+        return -1;
+    }
+
+    _received(message);
+
+    return 1;
+}
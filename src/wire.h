@@ -0,0 +1,86 @@
+#pragma once
+
+#include "run.h"
+
+/* Longest test name that can be sent, including terminator */
+#define CHILI_WIRE_MAX_NAME 256
+
+/* What a message reports.
+ *
+ * result     - Test executed, result is set.
+ * begin_fail - Suite setup failed with r.
+ * end_fail   - Suite teardown failed with r.
+ * done       - All done, r is outcome of library.
+ * test       - Test found in library, only name is set.
+ */
+enum chili_wire_type {
+    chili_wire_result,
+    chili_wire_begin_fail,
+    chili_wire_end_fail,
+    chili_wire_done,
+    chili_wire_test,
+};
+
+/**
+ * @brief Message sent from a process running tests to the
+ *        process reporting them.
+ *
+ * Pointers in result are not sent, name of test is sent in name
+ * and library is known by the receiver.
+ */
+struct chili_wire_message {
+    enum chili_wire_type type;
+    int                  r;
+    struct chili_result  result;
+    char                 name[CHILI_WIRE_MAX_NAME];
+    /* Time spent in suite setup, set when done */
+    uint64_t             setup_ns;
+};
+
+/**
+ * @brief Writes message to pipe.
+ *
+ * Message is written in one piece, several processes can write
+ * to the same pipe.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_wire_write(int fd, struct chili_wire_message *message);
+
+/**
+ * @brief Reads message from pipe.
+ *
+ * Blocks until a message is available. Name of result points
+ * to name in message.
+ *
+ * @return Negative on error.
+ *         Zero when writer has closed the pipe.
+ *         Positive on success.
+ */
+int chili_wire_read(int fd, struct chili_wire_message *message);
+
+/**
+ * @brief Writes message to a byte stream.
+ *
+ * Message is framed so that it can be sent over anything that
+ * carries bytes, like a pipe to a process on another machine.
+ * Unlike chili_wire_write, several writers can't share the
+ * stream.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_wire_send(int fd, struct chili_wire_message *message);
+
+/**
+ * @brief Reads message from a byte stream.
+ *
+ * Blocks until a whole message has been received.
+ *
+ * @return Negative on error or when the stream isn't framed
+ *         by chili_wire_send.
+ *         Zero when writer has closed the stream.
+ *         Positive on success.
+ */
+int chili_wire_receive(int fd, struct chili_wire_message *message);
@@ -0,0 +1,663 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "library.h"
+#include "registry.h"
+#include "named.h"
+#include "worker.h"
+#include "cpus.h"
+#include "run.h"
+#include "memory.h"
+
+/* Debugging */
+#define DEBUG_PRINTS 0
+#include "debug.h"
+
+/* Constants */
+
+/* Longest line naming a test that is read by worker */
+#define MAX_LINE 1024
+
+/* Types */
+struct worker {
+    /* Process group of worker and its tests, 0 if slot is free */
+    pid_t pid;
+    /* Write end of pipe to stdin of worker, -1 when closed */
+    int   input;
+    /* Read end of pipe from stdout of worker */
+    int   output;
+    /* Test handed out to worker, -1 when idle */
+    int   test;
+    /* Directory that worker redirects test output to */
+    char  redirect_path[CHILI_REDIRECT_MAX_PATH + 32];
+};
+
+struct coordinator {
+    const struct chili_worker_options *options;
+    const char                        **libraries;
+    const char                        **names;
+    int                               count;
+    chili_worker_report               report;
+    void                              *context;
+    struct worker                     *workers;
+    struct pollfd                     *polls;
+    int                               num_workers;
+    int                               running;
+    /* Number of started workers */
+    int                               started;
+    /* Tests not handed out yet, in order */
+    int                               *pending;
+    int                               first_pending;
+    int                               num_pending;
+    /* Number of times each test has been handed out */
+    int                               *attempts;
+    /* Predicted peak memory of tests handed out */
+    uint64_t                          in_use_kb;
+    int                               num_handed_out;
+    int                               next_identity;
+    /* First error, stops handing out tests */
+    int                               error;
+};
+
+/* Globals */
+
+/* Coordinator of this process, there is one at a time */
+static struct coordinator *_coordinator;
+
+
+/* Locals */
+static int _send(int fd, enum chili_wire_type type, int r)
+{
+    struct chili_wire_message message;
+
+    memset(&message, 0, sizeof(message));
+    message.type = type;
+    message.r = r;
+
+    return chili_wire_send(fd, &message);
+}
+
+static int _send_result(int fd, const struct chili_result *result)
+{
+    struct chili_wire_message message;
+
+    memset(&message, 0, sizeof(message));
+    message.type = chili_wire_result;
+    message.result = *result;
+
+    return chili_wire_send(fd, &message);
+}
+
+/* Loads and sets up library the first time a test in it is run */
+static int _serve_library(chili_handle registry,
+                          const char *library,
+                          chili_handle *lib_handle)
+{
+    int r;
+    chili_handle lib = chili_reg_find(registry, library);
+
+    if (lib != NULL){
+        *lib_handle = lib;
+        return 1;
+    }
+
+    r = chili_lib_create(library, NULL, &lib);
+    if (r < 0){
+        return r;
+    }
+
+    r = chili_lib_before_fixture(lib);
+    if (r < 0){
+        chili_lib_destroy(lib);
+        return r;
+    }
+
+    r = chili_reg_add(registry, library, lib);
+    if (r < 0){
+        chili_lib_after_fixture(lib);
+        chili_lib_destroy(lib);
+        return r;
+    }
+
+    *lib_handle = lib;
+    return 1;
+}
+
+/* Tears down all libraries, reporting those that fail */
+static int _serve_end(chili_handle registry, int out)
+{
+    int token = 0;
+    int r = 1;
+    int r_after;
+    chili_handle lib;
+
+    lib = chili_reg_next(registry, &token);
+    while (lib != NULL){
+        r_after = chili_lib_after_fixture(lib);
+        if (r_after < 0){
+            _send(out, chili_wire_end_fail, r_after);
+            r = r_after;
+        }
+        chili_lib_destroy(lib);
+
+        lib = chili_reg_next(registry, &token);
+    }
+
+    return r;
+}
+
+static int _serve(chili_handle registry, int out)
+{
+    char line[MAX_LINE];
+    char *library;
+    char *name;
+    chili_handle lib_handle;
+    struct chili_result result;
+    struct chili_aggregated scratch = { 0 };
+    struct chili_times times;
+    int r;
+
+    times.timeout.tv_nsec = 0;
+    times.timeout.tv_sec = 10;
+
+    while (fgets(line, sizeof(line), stdin) != NULL){
+        line[strcspn(line, "\n")] = '\0';
+        if (chili_named_parse(line, &library, &name) < 0){
+            printf("Worker received bad test: %s\n", line);
+            return -1;
+        }
+
+        r = _serve_library(registry, library, &lib_handle);
+        if (r < 0){
+            _send(out, chili_wire_begin_fail, r);
+            return r;
+        }
+
+        r = chili_lib_named_test(lib_handle, name, &times,
+                                 &result, &scratch);
+        if (r < 0){
+            return r;
+        }
+        if (_send_result(out, &result) < 0){
+            return -1;
+        }
+    }
+
+    return 1;
+}
+
+static void _release(struct coordinator *coordinator,
+                     struct worker *worker)
+{
+    int status;
+
+    if (worker->input >= 0){
+        close(worker->input);
+    }
+    close(worker->output);
+    waitpid(worker->pid, &status, 0);
+    if (coordinator->options->use_redirect){
+        /* Output of all reported tests has been moved */
+        rmdir(worker->redirect_path);
+    }
+
+    worker->pid = 0;
+    coordinator->running--;
+}
+
+static void _stop(struct coordinator *coordinator)
+{
+    struct worker *worker;
+
+    for (int i = 0; i < coordinator->num_workers; i++){
+        worker = &coordinator->workers[i];
+        if (worker->pid){
+            kill(-worker->pid, SIGKILL);
+            _release(coordinator, worker);
+        }
+    }
+}
+
+static int _start(struct coordinator *coordinator, struct worker *worker)
+{
+    const struct chili_worker_options *options = coordinator->options;
+    int input[2];
+    int output[2];
+    pid_t child;
+
+    snprintf(worker->redirect_path, sizeof(worker->redirect_path),
+             "%s/.worker%d", options->redirect_path,
+             coordinator->started);
+
+    /* Pipes of other workers must not be inherited, a worker
+     * would never see its stdin closed */
+    if (pipe2(input, O_CLOEXEC) < 0){
+        printf("Failed to create pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pipe2(output, O_CLOEXEC) < 0){
+        printf("Failed to create pipe: %s\n", strerror(errno));
+        close(input[0]);
+        close(input[1]);
+        return -1;
+    }
+
+    /* Child would otherwise print what is still buffered */
+    fflush(stdout);
+
+    child = fork();
+    if (child < 0){
+        printf("Failed to fork: %s\n", strerror(errno));
+        close(input[0]);
+        close(input[1]);
+        close(output[0]);
+        close(output[1]);
+        return -1;
+    }
+
+    if (child == 0){
+        /* Own group to be able to stop worker and tests */
+        setpgid(0, 0);
+        dup2(input[0], 0);
+        dup2(output[1], 1);
+        /* Pinned across exec, tests inherit the cpu */
+        if (options->cpus &&
+            chili_cpus_pin(options->cpus[(worker - coordinator->workers) %
+                                         options->num_cpus]) < 0){
+            _exit(1);
+        }
+        if (options->use_redirect){
+            execl(CHILI_WORKER_EXECUTABLE, "chili", "worker",
+                  "--log", worker->redirect_path, (char*)NULL);
+        }
+        else {
+            execl(CHILI_WORKER_EXECUTABLE, "chili", "worker",
+                  (char*)NULL);
+        }
+        fprintf(stderr, "Failed to start worker: %s\n", strerror(errno));
+        _exit(1);
+    }
+
+    /* Also from here to not race with kill in stop */
+    setpgid(child, child);
+    close(input[0]);
+    close(output[1]);
+
+    debug_print("Started worker %d\n", child);
+    worker->pid = child;
+    worker->input = input[1];
+    worker->output = output[0];
+    worker->test = -1;
+    coordinator->running++;
+    coordinator->started++;
+
+    return 1;
+}
+
+static void _requeue(struct coordinator *coordinator, int test)
+{
+    /* Run again before the others, it has waited long enough */
+    coordinator->first_pending =
+        (coordinator->first_pending + coordinator->count - 1) %
+        coordinator->count;
+    coordinator->pending[coordinator->first_pending] = test;
+    coordinator->num_pending++;
+}
+
+static void _take(struct coordinator *coordinator,
+                  struct worker *worker,
+                  int test)
+{
+    if (coordinator->options->budget_kb > 0){
+        coordinator->in_use_kb += coordinator->options->expected_kb[test];
+    }
+    coordinator->num_handed_out++;
+    worker->test = test;
+}
+
+/* Worker is done with its test, memory it needed is free */
+static void _give_back(struct coordinator *coordinator,
+                       struct worker *worker)
+{
+    if (worker->test < 0){
+        return;
+    }
+    if (coordinator->options->budget_kb > 0){
+        coordinator->in_use_kb -=
+            coordinator->options->expected_kb[worker->test];
+    }
+    coordinator->num_handed_out--;
+    worker->test = -1;
+}
+
+/* Hands out next test to idle worker, or tells it that there is
+ * nothing more to do. Returns zero when next test has to wait
+ * for memory. */
+static int _hand_out(struct coordinator *coordinator,
+                     struct worker *worker)
+{
+    char line[MAX_LINE];
+    int test;
+    int length;
+
+    if (coordinator->num_pending == 0 || coordinator->error < 0){
+        close(worker->input);
+        worker->input = -1;
+        return 1;
+    }
+
+    test = coordinator->pending[coordinator->first_pending];
+    /* Waits for a running test when it doesn't fit */
+    if (coordinator->options->budget_kb > 0 &&
+        !chili_memory_admit(coordinator->options->budget_kb,
+                            coordinator->in_use_kb,
+                            coordinator->options->expected_kb[test],
+                            coordinator->num_handed_out)){
+        return 0;
+    }
+
+    length = snprintf(line, sizeof(line), "%s:%s\n",
+                      coordinator->libraries[test],
+                      coordinator->names[test]);
+    if (length >= (int)sizeof(line)){
+        printf("Name of test %s:%s is too long\n",
+               coordinator->libraries[test], coordinator->names[test]);
+        return -1;
+    }
+
+    coordinator->first_pending =
+        (coordinator->first_pending + 1) % coordinator->count;
+    coordinator->num_pending--;
+    coordinator->attempts[test]++;
+    _take(coordinator, worker, test);
+
+    /* A worker that died is noticed when reading from it */
+    if (write(worker->input, line, length) != length){
+        debug_print("Failed to hand out %s to worker %d\n", line,
+                    worker->pid);
+    }
+
+    return 1;
+}
+
+static void _adopt_output(struct worker *worker,
+                          struct chili_result *result,
+                          int identity)
+{
+    char path[CHILI_REDIRECT_MAX_PATH + 64];
+    char name[25];
+
+    snprintf(path, sizeof(path), "%s/%d",
+             worker->redirect_path, result->identity);
+    snprintf(name, sizeof(name), "%d", identity);
+    chili_redirect_adopt(path, name);
+}
+
+/* Test of worker that died is run again or, when it has killed
+ * too many workers, reported as crashed. A worker that died
+ * between tests, like in suite teardown, is left out. */
+static void _worker_died(struct coordinator *coordinator,
+                         struct worker *worker)
+{
+    struct chili_wire_message message;
+    int test = worker->test;
+
+    _give_back(coordinator, worker);
+    _release(coordinator, worker);
+
+    if (test < 0){
+        printf("Worker died between tests, continuing without it\n");
+    }
+    else if (coordinator->attempts[test] <= coordinator->options->retries){
+        printf("Worker died running %s:%s, running it again\n",
+               coordinator->libraries[test], coordinator->names[test]);
+        _requeue(coordinator, test);
+    }
+    else {
+        memset(&message, 0, sizeof(message));
+        message.type = chili_wire_result;
+        message.result.library = coordinator->libraries[test];
+        message.result.name = coordinator->names[test];
+        message.result.identity = coordinator->next_identity++;
+        message.result.execution = execution_crashed;
+        coordinator->report(coordinator->context, test, &message);
+    }
+
+    if (coordinator->num_pending > 0 && coordinator->error == 0 &&
+        _start(coordinator, worker) < 0){
+        coordinator->error = -1;
+    }
+}
+
+static void _receive(struct coordinator *coordinator,
+                     struct worker *worker)
+{
+    struct chili_wire_message message;
+    int test = worker->test;
+
+    if (chili_wire_receive(worker->output, &message) <= 0){
+        _worker_died(coordinator, worker);
+        return;
+    }
+
+    /* Results and setup failures are of the test handed out */
+    if (test < 0 && (message.type == chili_wire_result ||
+                     message.type == chili_wire_begin_fail)){
+        printf("Worker %d reported on a test it wasn't given\n",
+               worker->pid);
+        return;
+    }
+    if (test >= 0){
+        message.result.library = coordinator->libraries[test];
+    }
+
+    switch (message.type){
+        case chili_wire_result:
+            _adopt_output(worker, &message.result,
+                          coordinator->next_identity);
+            message.result.identity = coordinator->next_identity++;
+            /* Name of test as handed out, worker may truncate */
+            message.result.name = coordinator->names[test];
+            _give_back(coordinator, worker);
+            coordinator->report(coordinator->context, test, &message);
+            break;
+        case chili_wire_begin_fail:
+            coordinator->report(coordinator->context, test, &message);
+            coordinator->error = message.r;
+            break;
+        case chili_wire_end_fail:
+            coordinator->report(coordinator->context, -1, &message);
+            break;
+        case chili_wire_done:
+            debug_print("Worker %d done: %d\n", worker->pid, message.r);
+            _release(coordinator, worker);
+            if (message.r < 0 && coordinator->error == 0){
+                coordinator->error = message.r;
+            }
+            break;
+        default:
+            break;
+    }
+
+    /* Errors triumphs, stop everything */
+    if (coordinator->error < 0){
+        _stop(coordinator);
+    }
+}
+
+static int _coordinate(struct coordinator *coordinator)
+{
+    struct worker *worker;
+    int r;
+
+    while (coordinator->running > 0){
+        for (int i = 0; i < coordinator->num_workers; i++){
+            worker = &coordinator->workers[i];
+            if (worker->pid && worker->input >= 0 && worker->test < 0 &&
+                _hand_out(coordinator, worker) < 0){
+                _stop(coordinator);
+                return -1;
+            }
+            coordinator->polls[i].fd = worker->pid ? worker->output : -1;
+            coordinator->polls[i].events = POLLIN;
+            coordinator->polls[i].revents = 0;
+        }
+
+        do {
+            r = poll(coordinator->polls, coordinator->num_workers, -1);
+        } while (r < 0 && errno == EINTR);
+        if (r < 0){
+            printf("Failed to wait for workers: %s\n", strerror(errno));
+            _stop(coordinator);
+            return -1;
+        }
+
+        for (int i = 0; i < coordinator->num_workers; i++){
+            worker = &coordinator->workers[i];
+            if (worker->pid && coordinator->polls[i].revents){
+                _receive(coordinator, worker);
+            }
+        }
+    }
+
+    return coordinator->error < 0 ? coordinator->error : 1;
+}
+
+
+/* Exports */
+int chili_worker_serve(const char *redirect_path)
+{
+    chili_handle registry;
+    int out;
+    int r;
+
+    /* Results are the only thing written to stdout, anything
+     * else printed by chili or tests goes to stderr */
+    fflush(stdout);
+    out = dup(1);
+    if (out < 0 || dup2(2, 1) < 0){
+        fprintf(stderr, "Failed to set up worker output: %s\n",
+                strerror(errno));
+        return -1;
+    }
+
+    r = chili_redirect_begin(redirect_path != NULL, redirect_path);
+    if (r < 0){
+        close(out);
+        return r;
+    }
+
+    /* Pinned by coordinator before exec, if at all */
+    chili_run_set_cpu(chili_cpus_pinned());
+
+    r = chili_reg_create(10, &registry);
+    if (r < 0){
+        chili_redirect_end();
+        close(out);
+        return r;
+    }
+
+    r = _serve(registry, out);
+
+    /* Preserve error from above */
+    if (r < 0){
+        _serve_end(registry, out);
+    }
+    else {
+        r = _serve_end(registry, out);
+    }
+
+    _send(out, chili_wire_done, r);
+    close(out);
+    chili_reg_destroy(registry);
+    chili_redirect_end();
+
+    return r;
+}
+
+int chili_worker_coordinate(int num_workers,
+                            const struct chili_worker_options *options,
+                            const char **libraries,
+                            const char **names,
+                            int count,
+                            chili_worker_report report,
+                            void *context)
+{
+    struct coordinator coordinator;
+    int r = 1;
+
+    if (count == 0){
+        return 1;
+    }
+    if (num_workers > count){
+        num_workers = count;
+    }
+
+    memset(&coordinator, 0, sizeof(coordinator));
+    coordinator.options = options;
+    coordinator.libraries = libraries;
+    coordinator.names = names;
+    coordinator.count = count;
+    coordinator.report = report;
+    coordinator.context = context;
+    coordinator.num_workers = num_workers;
+    coordinator.num_pending = count;
+    coordinator.workers = calloc(num_workers, sizeof(struct worker));
+    coordinator.polls = calloc(num_workers, sizeof(struct pollfd));
+    coordinator.pending = malloc(count * sizeof(int));
+    coordinator.attempts = calloc(count, sizeof(int));
+    if (coordinator.workers == NULL || coordinator.polls == NULL ||
+        coordinator.pending == NULL || coordinator.attempts == NULL){
+        printf("Unable to allocate workers\n");
+        r = -1;
+        goto on_exit;
+    }
+
+    for (int i = 0; i < count; i++){
+        coordinator.pending[i] = i;
+    }
+
+    /* Writing to a worker that died must not kill us */
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int i = 0; r > 0 && i < num_workers; i++){
+        r = _start(&coordinator, &coordinator.workers[i]);
+    }
+    if (r < 0){
+        _stop(&coordinator);
+        goto on_exit;
+    }
+
+    _coordinator = &coordinator;
+    r = _coordinate(&coordinator);
+    _coordinator = NULL;
+
+on_exit:
+    free(coordinator.workers);
+    free(coordinator.polls);
+    free(coordinator.pending);
+    free(coordinator.attempts);
+
+    return r;
+}
+
+void chili_worker_kill(void)
+{
+    struct coordinator *coordinator = _coordinator;
+
+    for (int i = 0; coordinator && i < coordinator->num_workers; i++){
+        if (coordinator->workers[i].pid){
+            kill(-coordinator->workers[i].pid, SIGKILL);
+        }
+    }
+}
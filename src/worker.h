@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "redirect.h"
+#include "wire.h"
+
+
+/* Executable started as worker by the coordinator */
+#define CHILI_WORKER_EXECUTABLE "/proc/self/exe"
+
+struct chili_worker_options {
+    /* Redirect test output, each worker to a directory of its
+     * own that output is moved from when reported */
+    bool use_redirect;
+    char redirect_path[CHILI_REDIRECT_MAX_PATH];
+    /* Times a test is run again when its worker dies */
+    int  retries;
+    /* Cpus to pin workers to, one per worker and wrapping
+     * around, NULL to not pin */
+    const int *cpus;
+    int  num_cpus;
+    /* Memory that tests running at the same time may use, zero
+     * for no limit */
+    uint64_t budget_kb;
+    /* Predicted peak memory of each test, when there is a limit */
+    const uint64_t *expected_kb;
+};
+
+/**
+ * @brief Called for each message from any worker.
+ *
+ * Library of result is set and identity of result is unique
+ * among all workers. A test that killed its worker more times
+ * than allowed is reported as crashed.
+ *
+ * @param test Index of test that message is about, negative
+ *             when it is about suite teardown.
+ */
+typedef void (*chili_worker_report)(void *context,
+                                    int test,
+                                    struct chili_wire_message *message);
+
+/**
+ * @brief Serves as worker.
+ *
+ * Reads tests to run from stdin, one per line on the form
+ * library:name, and writes framed results to stdout until
+ * stdin is closed. Libraries are loaded and set up when a test
+ * in them is first run and teared down at the end. Test output
+ * and anything else printed goes to stderr unless redirected.
+ *
+ * @param redirect_path Directory to redirect test output to,
+ *                      NULL to not redirect.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_worker_serve(const char *redirect_path);
+
+/**
+ * @brief Runs tests in worker processes.
+ *
+ * Starts workers and hands out tests one at a time to the
+ * worker that is free. A test is only handed out when it fits
+ * in the memory budget with the tests already running, or when
+ * nothing else runs. Tests of a worker that dies are handed
+ * out again to another worker, a worker that dies between tests
+ * is left out. Stops everything when setup or teardown of a
+ * suite fails.
+ *
+ * @param num_workers Number of workers to run at the same time.
+ * @param options     Options for workers.
+ * @param libraries   Library of each test.
+ * @param names       Name of each test.
+ * @param count       Number of tests.
+ * @param report      Called for each message.
+ * @param context     Passed to report.
+ *
+ * @return Negative on error.
+ *         Positive on success.
+ */
+int chili_worker_coordinate(int num_workers,
+                            const struct chili_worker_options *options,
+                            const char **libraries,
+                            const char **names,
+                            int count,
+                            chili_worker_report report,
+                            void *context);
+
+/**
+ * @brief Kills all workers of this process and their tests,
+ *        without waiting for them.
+ *
+ * Safe to call from a signal handler.
+ */
+void chili_worker_kill(void);
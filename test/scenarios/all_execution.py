@@ -51,6 +51,39 @@ def test_all_executes_all_tests_even_when_test_crashes():
     all_errors = report.num_executed == report.num_errors
     return all_executed and all_errors
 
+def test_all_reports_tests_over_budget():
+    report = chili_all(['./chili_over_budget.so'])
+
+    all_executed = report.num_executed == 3
+    two_succeeded = report.num_succeeded == 2
+    none_failed = report.num_failed == 0 and report.num_errors == 0
+    return all_executed and two_succeeded and none_failed
+
+def test_all_concurrent_libraries_reports_all_tests():
+    report = chili_all(['-j', '3', './chili_success.so',
+                        './chili_failure.so', './chili_crash.so'])
+
+    all_executed = report.num_executed == 6
+    one_succeeded = report.num_succeeded == 1
+    three_failed = report.num_failed == 3
+    two_errors = report.num_errors == 2
+    return all_executed and one_succeeded and three_failed and two_errors
+
+def test_all_concurrent_stops_execution_on_suite_setup_error():
+    report = chili_all(['-j', '2', './chili_suite_setup_error.so',
+                        './chili_success.so'])
+
+    return report.process_return != 0
+
+def test_all_shards_execute_each_test_once():
+    libraries = ['./chili_success.so', './chili_failure.so']
+    first = chili_all(['-s', '1/2'] + libraries)
+    second = chili_all(['-s', '2/2'] + libraries)
+
+    all_executed = first.num_executed + second.num_executed == 4
+    one_succeeded = first.num_succeeded + second.num_succeeded == 1
+    return all_executed and one_succeeded
+
 if __name__ == "__main__":
     sys.exit(run(globals().values(), __file__))
 
@@ -19,6 +19,14 @@ def test_all_process_returns_non_0_on_test_failure():
     report = chili_all(['./chili_failure.so'])
     return report.process_return != 0 and report.num_failed > 0
 
+def test_all_process_returns_non_0_on_test_crash():
+    report = chili_all(['./chili_crash.so'])
+    return report.process_return != 0 and report.num_errors > 0
+
+def test_all_process_returns_non_0_on_sharded_test_crash():
+    report = chili_all(['-s', '1/1', './chili_crash.so'])
+    return report.process_return != 0 and report.num_errors > 0
+
 def test_all_process_returns_non_0_on_suite_setup_error():
     report = chili_all(['./chili_suite_setup_error.so'])
     return report.process_return != 0 and report.num_executed == 0
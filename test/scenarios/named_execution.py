@@ -52,6 +52,20 @@ def test_named_executes_all_tests_even_when_test_crashes():
     all_errors = report.num_executed == report.num_errors
     return all_executed and all_errors
 
+def test_named_workers_execute_all_tests():
+    named_tests = [
+        './chili_failure.so:test_failure1',
+        './chili_success.so:test_success',
+        './chili_failure.so:test_failure2',
+        './chili_crash.so:test_crash_one',
+    ]
+    report = chili_named(named_tests, options=['-w', '2'])
+
+    all_executed = report.num_executed == 4
+    two_failed = report.num_failed == 2
+    one_error = report.num_errors == 1
+    return all_executed and two_failed and one_error
+
 if __name__ == "__main__":
     sys.exit(run(globals().values(), __file__))
 
@@ -0,0 +1,21 @@
+#include <unistd.h>
+#include <chili/budget.h>
+
+CHILI_BUDGET(test_within, .wall_ns = 10000000000);
+CHILI_BUDGET(test_over, .wall_ns = 1000);
+
+int test_within()
+{
+    return 1;
+}
+
+int test_over()
+{
+    usleep(10000);
+    return 1;
+}
+
+int test_without()
+{
+    return 1;
+}
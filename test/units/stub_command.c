@@ -18,8 +18,77 @@ int chili_command_named(const char *names_path,
 }
 
 int chili_command_list(const char **library_paths,
-                       int num_library_paths)
+                       int num_library_paths,
+                       bool redundant,
+                       const struct chili_test_options *options)
 {
-    return stub_command_list(library_paths, num_library_paths);
+    return stub_command_list(library_paths, num_library_paths,
+                             redundant, options);
 }
 
+
+int chili_command_bench(const char **library_paths,
+                        int num_library_paths,
+                        const struct chili_test_options *options,
+                        const struct chili_bench_options *bench_options,
+                        const char *export_path)
+{
+    return stub_command_bench(library_paths, num_library_paths,
+                              options, bench_options, export_path);
+}
+
+int chili_command_merge(const char **results_paths,
+                        int num_results,
+                        const struct chili_test_options *options)
+{
+    return stub_command_merge(results_paths, num_results, options);
+}
+
+int chili_command_affected(const char *files_path,
+                           const char *symbols_path,
+                           const char **library_paths,
+                           int num_library_paths,
+                           bool run,
+                           const struct chili_test_options *options)
+{
+    return stub_command_affected(files_path, symbols_path,
+                                 library_paths, num_library_paths,
+                                 run, options);
+}
+
+int chili_command_rerun_failed(const struct chili_test_options *options)
+{
+    return stub_command_rerun_failed(options);
+}
+
+int chili_command_serve(const char *socket_path)
+{
+    return stub_command_serve(socket_path);
+}
+
+int chili_command_watch(const char **library_paths,
+                        int num_library_paths,
+                        const struct chili_test_options *options)
+{
+    return stub_command_watch(library_paths, num_library_paths, options);
+}
+
+int chili_command_worker(const struct chili_test_options *options)
+{
+    return stub_command_worker(options);
+}
+
+int chili_command_index(const char **library_paths,
+                        int num_library_paths,
+                        const struct chili_test_options *options)
+{
+    return stub_command_index(library_paths, num_library_paths, options);
+}
+
+int chili_command_compare(const char **results_paths,
+                          int num_results,
+                          int threshold_percent)
+{
+    return stub_command_compare(results_paths, num_results,
+                                threshold_percent);
+}
@@ -9,5 +9,32 @@ int (*stub_command_all)(const char **library_path,
 int (*stub_command_named)(const char *names_path,
                           const struct chili_test_options *options);
 int (*stub_command_list)(const char **library_paths,
-                         int num_library_paths);
-
+                         int num_library_paths,
+                         bool redundant,
+                         const struct chili_test_options *options);
+int (*stub_command_bench)(const char **library_paths,
+                          int num_library_paths,
+                          const struct chili_test_options *options,
+                          const struct chili_bench_options *bench_options,
+                          const char *export_path);
+int (*stub_command_merge)(const char **results_paths,
+                          int num_results,
+                          const struct chili_test_options *options);
+int (*stub_command_affected)(const char *files_path,
+                             const char *symbols_path,
+                             const char **library_paths,
+                             int num_library_paths,
+                             bool run,
+                             const struct chili_test_options *options);
+int (*stub_command_watch)(const char **library_paths,
+                          int num_library_paths,
+                          const struct chili_test_options *options);
+int (*stub_command_serve)(const char *socket_path);
+int (*stub_command_rerun_failed)(const struct chili_test_options *options);
+int (*stub_command_worker)(const struct chili_test_options *options);
+int (*stub_command_index)(const char **library_paths,
+                          int num_library_paths,
+                          const struct chili_test_options *options);
+int (*stub_command_compare)(const char **results_paths,
+                            int num_results,
+                            int threshold_percent);
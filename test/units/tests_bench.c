@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "bench.h"
+#include "assert.h"
+
+
+/* Processes benchmark was called in, shared with them */
+struct calls {
+    pid_t last_pid;
+    int   num_processes;
+};
+
+struct calls *_calls;
+chili_handle _bench;
+struct chili_bench_options _options;
+struct chili_bench_result _result;
+struct chili_aggregated _aggregated;
+struct chili_bind_fixture _fixture;
+struct chili_bind_test _test;
+
+static int _counting_bench()
+{
+    if (_calls->last_pid != getpid()){
+        _calls->last_pid = getpid();
+        _calls->num_processes++;
+    }
+    return 1;
+}
+
+int once_before()
+{
+    _calls = mmap(NULL, sizeof(*_calls), PROT_READ|PROT_WRITE,
+                  MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+
+    return _calls != MAP_FAILED ? 1 : -1;
+}
+
+int once_after()
+{
+    munmap(_calls, sizeof(*_calls));
+    return 1;
+}
+
+int each_before()
+{
+    memset(_calls, 0, sizeof(*_calls));
+    memset(&_options, 0, sizeof(_options));
+    memset(&_result, 0, sizeof(_result));
+    memset(&_aggregated, 0, sizeof(_aggregated));
+    memset(&_fixture, 0, sizeof(_fixture));
+    memset(&_test, 0, sizeof(_test));
+    _test.func = _counting_bench;
+    _test.name = "bench_counting";
+    _options.samples = 5;
+    _options.ci_width = 1.0;
+    _options.max_time.tv_sec = 5;
+    _options.iterations = 1;
+    _options.times.timeout.tv_sec = 10;
+
+    return chili_bench_create(&_bench);
+}
+
+int each_after()
+{
+    chili_bench_destroy(_bench);
+    return 1;
+}
+
+/* Verifies that all samples of a warm pass are taken in one
+ * process. */
+int test_bench_warm()
+{
+    int r = chili_bench_run(_bench, &_result, &_aggregated, &_test,
+                            &_fixture, NULL, &_options, NULL);
+
+    return assert_int(1, r) &&
+           assert_int(test_success, _result.result.test) &&
+           assert_int(1, _result.warm.samples >= _options.samples) &&
+           assert_int(0, _result.has_cold) &&
+           assert_int(1, _calls->num_processes);
+}
+
+/* Verifies that the cold pass takes its samples in a process of
+ * its own. */
+int test_bench_cold()
+{
+    int r;
+
+    _options.cold = true;
+    r = chili_bench_run(_bench, &_result, &_aggregated, &_test,
+                        &_fixture, NULL, &_options, NULL);
+
+    return assert_int(1, r) &&
+           assert_int(1, _result.has_cold) &&
+           assert_int(1, _result.cold.samples >= _options.samples) &&
+           assert_int(2, _calls->num_processes);
+}
+
+/* Verifies that a fresh cold pass takes each sample in a new
+ * process. */
+int test_bench_cold_fresh()
+{
+    int r;
+
+    _options.cold = true;
+    _options.fresh = true;
+    r = chili_bench_run(_bench, &_result, &_aggregated, &_test,
+                        &_fixture, NULL, &_options, NULL);
+
+    return assert_int(1, r) &&
+           assert_int(1, _result.has_cold) &&
+           assert_int(1, _result.cold.samples >= _options.samples) &&
+           assert_int(1 + _result.cold.samples, _calls->num_processes);
+}
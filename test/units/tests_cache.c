@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "cache.h"
+#include "assert.h"
+
+
+const char *_path = "./cache_test";
+/* Any ELF library will do, this suite is one */
+const char *_library = "./chili_cache.so";
+const char *_not_elf = "./cache_not_elf";
+chili_handle _handle;
+char _names[64];
+int _count;
+
+static int _visit(void *context,
+                  const struct chili_result *result,
+                  bool skipped)
+{
+    snprintf(_names, sizeof(_names), "%s", result->name);
+    _count++;
+    return 1;
+}
+
+static void _remove_cache()
+{
+    char path[300];
+    struct dirent *entry;
+    DIR *dir = opendir(_path);
+
+    if (dir == NULL){
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL){
+        snprintf(path, sizeof(path), "%s/%s", _path, entry->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+    rmdir(_path);
+}
+
+static void _result(struct chili_result *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->name = "test_a";
+    result->library = _library;
+    result->execution = execution_done;
+    result->test = test_success;
+}
+
+static int _store(bool succeeded, bool suite_succeeded)
+{
+    struct chili_result result;
+
+    _result(&result);
+    chili_cache_lookup(_handle, _library);
+    chili_cache_add(_handle, &result, succeeded);
+    return chili_cache_done(_handle, _library, suite_succeeded);
+}
+
+int each_before()
+{
+    _remove_cache();
+    _names[0] = '\0';
+    _count = 0;
+    return chili_cache_create(_path, &_handle);
+}
+
+int each_after()
+{
+    chili_cache_destroy(_handle);
+    _remove_cache();
+    unlink(_not_elf);
+    return 1;
+}
+
+/* Verifies that results of a library where everything
+ * succeeded are cached and read back.
+ */
+int test_cache_store()
+{
+    if (!assert_int(0, chili_cache_lookup(_handle, _library))){
+        return 0;
+    }
+    if (!assert_int(1, _store(true, true))){
+        return 0;
+    }
+    if (!assert_int(1, chili_cache_lookup(_handle, _library))){
+        return 0;
+    }
+    if (!assert_ret_success(chili_cache_read(_handle, _library,
+                                             _visit, NULL))){
+        return 0;
+    }
+
+    return assert_int(1, _count) &&
+           assert_str("test_a", _names);
+}
+
+/* Verifies that nothing is cached when a test fails.
+ */
+int test_cache_failed_test()
+{
+    if (!assert_int(0, _store(false, true))){
+        return 0;
+    }
+
+    return assert_int(0, chili_cache_lookup(_handle, _library));
+}
+
+/* Verifies that nothing is cached when suite setup or
+ * teardown fails.
+ */
+int test_cache_failed_suite()
+{
+    if (!assert_int(0, _store(true, false))){
+        return 0;
+    }
+
+    return assert_int(0, chili_cache_lookup(_handle, _library));
+}
+
+/* Verifies that cached results don't apply when the
+ * environment that libraries are loaded in changes.
+ */
+int test_cache_environment()
+{
+    chili_handle changed;
+    int r;
+
+    if (!assert_int(1, _store(true, true))){
+        return 0;
+    }
+
+    setenv("LD_BIND_NOW", "1", 1);
+    r = chili_cache_create(_path, &changed);
+    unsetenv("LD_BIND_NOW");
+    if (!assert_ret_success(r)){
+        return 0;
+    }
+    r = chili_cache_lookup(changed, _library);
+    chili_cache_destroy(changed);
+
+    return assert_int(0, r);
+}
+
+/* Verifies that only ELF libraries can be looked up.
+ */
+int test_cache_not_elf()
+{
+    FILE *f = fopen(_not_elf, "w");
+
+    fprintf(f, "not a library\n");
+    fclose(f);
+
+    return assert_ret_fail(chili_cache_lookup(_handle, _not_elf));
+}
+
+/* Verifies that a test that passed is cached with its code
+ * and a test that failed isn't.
+ */
+int test_cache_test_passed()
+{
+    const char *name = "test_cache_store";
+
+    if (!assert_int(0, chili_cache_test_passed(_handle, _library,
+                                               name))){
+        return 0;
+    }
+    chili_cache_test_set(_handle, _library, name, true);
+    if (!assert_int(1, chili_cache_test_passed(_handle, _library,
+                                               name))){
+        return 0;
+    }
+    chili_cache_test_set(_handle, _library, name, false);
+
+    return assert_int(0, chili_cache_test_passed(_handle, _library,
+                                                 name));
+}
+
+/* Verifies that passed tests are kept until next run.
+ */
+int test_cache_test_saved()
+{
+    const char *name = "test_cache_store";
+    chili_handle next;
+    bool passed;
+
+    chili_cache_test_set(_handle, _library, name, true);
+    chili_cache_destroy(_handle);
+
+    chili_cache_create(_path, &next);
+    passed = chili_cache_test_passed(next, _library, name);
+    _handle = next;
+
+    return assert_int(1, passed);
+}
+
+/* Verifies that a test without code in library is never cached.
+ */
+int test_cache_test_missing()
+{
+    chili_cache_test_set(_handle, _library, "test_missing", true);
+
+    return assert_int(0, chili_cache_test_passed(_handle, _library,
+                                                 "test_missing"));
+}
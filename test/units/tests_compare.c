@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "compare.h"
+#include "results.h"
+#include "assert.h"
+
+
+const char *_paths[] = {
+    "./compare_test_0", "./compare_test_1", "./compare_test_2"
+};
+const char *_library = "./compare_test_lib.so";
+chili_handle _compare;
+
+static struct chili_result _result(const char *name,
+                                   bool failed,
+                                   uint64_t wall_ns,
+                                   uint64_t max_rss_kb)
+{
+    struct chili_result result = {
+        .name = name,
+        .library = _library,
+        .execution = execution_done,
+        .before = fixture_success,
+        .test = failed ? test_failure : test_success,
+        .after = fixture_success,
+        .usage = { wall_ns, wall_ns, max_rss_kb, wall_ns },
+        .cpu = -1,
+    };
+
+    return result;
+}
+
+/* Writes result log of a run and adds it to comparison */
+static int _run(int run, const struct chili_result *results, int count)
+{
+    chili_handle log;
+
+    if (chili_results_create(_paths[run], 1, 1, &log) < 0){
+        return -1;
+    }
+    for (int i = 0; i < count; i++){
+        chili_results_add(log, &results[i]);
+    }
+    chili_results_destroy(log);
+
+    return chili_compare_add(_compare, _paths[run]);
+}
+
+int each_before()
+{
+    return chili_compare_create(10, &_compare);
+}
+
+int each_after()
+{
+    chili_compare_destroy(_compare);
+    for (int i = 0; i < 3; i++){
+        unlink(_paths[i]);
+    }
+    return 1;
+}
+
+/* Verifies that tests whose outcome changed between the two
+ * runs are found. */
+int test_compare_outcomes()
+{
+    struct chili_compare_counts counts;
+    struct chili_result older[] = {
+        _result("test_a", false, 1000, 100),
+        _result("test_b", true, 1000, 100),
+        _result("test_c", false, 1000, 100),
+    };
+    struct chili_result newer[] = {
+        _result("test_a", true, 1000, 100),
+        _result("test_b", false, 1000, 100),
+        _result("test_c", false, 1000, 100),
+    };
+
+    if (_run(0, older, 3) < 0 || _run(1, newer, 3) < 0){
+        return 0;
+    }
+
+    return assert_int(1, chili_compare_print(_compare, &counts)) &&
+           assert_int(1, counts.newly_failing) &&
+           assert_int(1, counts.newly_passing) &&
+           assert_int(0, counts.flaky) &&
+           assert_int(0, counts.regressed);
+}
+
+/* Verifies that a test that failed once and then passed again
+ * is flaky rather than newly passing. */
+int test_compare_flaky()
+{
+    struct chili_compare_counts counts;
+    struct chili_result passed = _result("test_a", false, 1000, 100);
+    struct chili_result failed = _result("test_a", true, 1000, 100);
+
+    if (_run(0, &passed, 1) < 0 || _run(1, &failed, 1) < 0 ||
+        _run(2, &passed, 1) < 0){
+        return 0;
+    }
+
+    return assert_int(1, chili_compare_print(_compare, &counts)) &&
+           assert_int(1, counts.flaky) &&
+           assert_int(0, counts.newly_passing);
+}
+
+/* Verifies that tests using more than threshold and more than
+ * noise have regressed. */
+int test_compare_regressed()
+{
+    struct chili_compare_counts counts;
+    struct chili_result older[] = {
+        _result("test_slower", false, 10000000, 100),
+        _result("test_noise", false, 1000, 100),
+        _result("test_memory", false, 1000, 1000),
+        _result("test_within", false, 10000000, 100),
+    };
+    struct chili_result newer[] = {
+        _result("test_slower", false, 20000000, 100),
+        _result("test_noise", false, 900000, 100),
+        _result("test_memory", false, 1000, 5000),
+        _result("test_within", false, 10500000, 100),
+    };
+
+    if (_run(0, older, 4) < 0 || _run(1, newer, 4) < 0){
+        return 0;
+    }
+
+    return assert_int(1, chili_compare_print(_compare, &counts)) &&
+           assert_int(2, counts.regressed) &&
+           assert_int(0, counts.newly_failing);
+}
+
+/* Verifies that one run is not enough to compare. */
+int test_compare_one_run()
+{
+    struct chili_compare_counts counts;
+    struct chili_result passed = _result("test_a", false, 1000, 100);
+
+    if (_run(0, &passed, 1) < 0){
+        return 0;
+    }
+
+    return assert_int(-1, chili_compare_print(_compare, &counts));
+}
+
+/* Verifies that a cached result, without usage, is not compared
+ * with a test that was run. */
+int test_compare_cached()
+{
+    struct chili_compare_counts counts;
+    struct chili_result older = _result("test_a", false, 0, 0);
+    struct chili_result newer = _result("test_a", false, 20000000, 5000);
+
+    older.cached = true;
+    if (_run(0, &older, 1) < 0 || _run(1, &newer, 1) < 0){
+        return 0;
+    }
+
+    return assert_int(1, chili_compare_print(_compare, &counts)) &&
+           assert_int(0, counts.regressed);
+}
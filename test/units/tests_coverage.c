@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "coverage.h"
+#include "assert.h"
+
+
+const char *_path = "./coverage_test";
+chili_handle _handle;
+char _visited[256];
+
+static int _visit(void *context, const char *library, const char *name)
+{
+    strncat(_visited, name, sizeof(_visited) - strlen(_visited) - 2);
+    strcat(_visited, " ");
+    return 1;
+}
+
+int each_before()
+{
+    unlink(_path);
+    _visited[0] = '\0';
+    if (chili_coverage_begin() < 0){
+        return -1;
+    }
+    chili_coverage_reset();
+    return chili_coverage_create(_path, &_handle);
+}
+
+int each_after()
+{
+    chili_coverage_destroy(_handle);
+    unlink(_path);
+    return 1;
+}
+
+/* Verifies that recorded edges are stored by the function
+ * they are in.
+ */
+int test_coverage_record()
+{
+    chili_coverage_hit((uintptr_t)test_coverage_record + 1);
+    chili_coverage_hit((uintptr_t)test_coverage_record + 1);
+    chili_coverage_record(_handle, "a.so", "test_a");
+
+    return assert_int(1, chili_coverage_recorded(_handle, "a.so",
+                                                 "test_a")) &&
+           assert_int(1, chili_coverage_reaches(_handle, "a.so", "test_a",
+                                                "test_coverage_record")) &&
+           assert_int(0, chili_coverage_reaches(_handle, "a.so", "test_a",
+                                                "test_coverage"));
+}
+
+/* Verifies that edges recorded before a reset aren't stored.
+ */
+int test_coverage_reset()
+{
+    chili_coverage_hit((uintptr_t)test_coverage_reset + 1);
+    chili_coverage_reset();
+    chili_coverage_record(_handle, "a.so", "test_a");
+
+    return assert_int(0, chili_coverage_recorded(_handle, "a.so",
+                                                 "test_a"));
+}
+
+/* Verifies that coverage is kept until next run.
+ */
+int test_coverage_saved()
+{
+    chili_handle next;
+    bool reaches;
+
+    chili_coverage_hit((uintptr_t)test_coverage_saved + 1);
+    chili_coverage_record(_handle, "a.so", "test_a");
+    chili_coverage_destroy(_handle);
+
+    chili_coverage_create(_path, &next);
+    reaches = chili_coverage_reaches(next, "a.so", "test_a",
+                                     "test_coverage_saved");
+    _handle = next;
+
+    return assert_int(1, reaches);
+}
+
+/* Verifies that tests covered by other tests are redundant,
+ * and that a test covering all of them is kept.
+ */
+int test_coverage_redundant()
+{
+    const char *libraries[] = { "a.so" };
+
+    chili_coverage_hit((uintptr_t)each_before + 1);
+    chili_coverage_record(_handle, "a.so", "test_a");
+    chili_coverage_hit((uintptr_t)each_before + 1);
+    chili_coverage_hit((uintptr_t)each_after + 1);
+    chili_coverage_record(_handle, "a.so", "test_b");
+    chili_coverage_hit((uintptr_t)each_after + 1);
+    chili_coverage_record(_handle, "a.so", "test_c");
+    chili_coverage_hit((uintptr_t)each_after + 1);
+    chili_coverage_record(_handle, "b.so", "test_d");
+
+    if (!assert_ret_success(chili_coverage_redundant(_handle, libraries, 1,
+                                                     _visit, NULL))){
+        return 0;
+    }
+
+    return assert_str("test_a test_c ", _visited);
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "cpus.h"
+#include "assert.h"
+
+
+/* Verifies that quota is turned into cpus, rounded up.
+ */
+int test_cpus_parse_max_quota()
+{
+    return assert_int(4, chili_cpus_parse_max("400000 100000\n")) &&
+           assert_int(2, chili_cpus_parse_max("150000 100000\n")) &&
+           assert_int(1, chili_cpus_parse_max("50000 100000\n"));
+}
+
+/* Verifies that no quota is reported as zero cpus.
+ */
+int test_cpus_parse_max_unlimited()
+{
+    return assert_int(0, chili_cpus_parse_max("max 100000\n"));
+}
+
+/* Verifies that garbage isn't mistaken for a quota.
+ */
+int test_cpus_parse_max_invalid()
+{
+    return chili_cpus_parse_max("") < 0 &&
+           chili_cpus_parse_max("100000 0") < 0;
+}
+
+/* Verifies that throttling counters are found among
+ * other statistics.
+ */
+int test_cpus_parse_stat()
+{
+    const char *content = "usage_usec 123\n"
+                          "user_usec 100\n"
+                          "system_usec 23\n"
+                          "nr_periods 50\n"
+                          "nr_throttled 7\n"
+                          "throttled_usec 900\n";
+    struct chili_cpus_throttling throttling;
+
+    return assert_int(1, chili_cpus_parse_stat(content, &throttling)) &&
+           assert_int(50, (int)throttling.periods) &&
+           assert_int(7, (int)throttling.throttled) &&
+           chili_cpus_parse_stat("usage_usec 123\n", &throttling) < 0;
+}
+
+/* Verifies that fewer jobs are used when throttled and
+ * more when not, within limits.
+ */
+int test_cpus_adapt()
+{
+    struct chili_cpus_throttling before = { 100, 10 };
+    struct chili_cpus_throttling throttled = { 200, 60 };
+    struct chili_cpus_throttling some = { 200, 11 };
+    struct chili_cpus_throttling none = { 200, 10 };
+
+    return assert_int(3, chili_cpus_adapt(&before, &throttled, 4, 4)) &&
+           assert_int(1, chili_cpus_adapt(&before, &throttled, 1, 4)) &&
+           assert_int(3, chili_cpus_adapt(&before, &some, 3, 4)) &&
+           assert_int(4, chili_cpus_adapt(&before, &none, 3, 4)) &&
+           assert_int(4, chili_cpus_adapt(&before, &none, 4, 4));
+}
+
+/* Verifies that there is always at least one cpu.
+ */
+int test_cpus_available()
+{
+    return chili_cpus_available() >= 1;
+}
+
+/* Verifies that one cpu of each core is used first, socket by
+ * socket, and SMT siblings last.
+ */
+int test_cpus_place()
+{
+    /* Two sockets of two cores with two threads each, siblings
+     * numbered like AMD does */
+    struct chili_cpus_topology cpus[] = {
+        { 7, 1, 1 }, { 6, 1, 1 }, { 5, 1, 0 }, { 4, 1, 0 },
+        { 3, 0, 1 }, { 2, 0, 1 }, { 1, 0, 0 }, { 0, 0, 0 },
+    };
+    int expected[] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+    int count = sizeof(cpus) / sizeof(cpus[0]);
+    int r = 1;
+
+    chili_cpus_place(cpus, count);
+    for (int i = 0; i < count; i++){
+        r = r && assert_int(expected[i], cpus[i].cpu);
+    }
+
+    return r &&
+           assert_int(0, cpus[3].thread) &&
+           assert_int(1, cpus[4].thread);
+}
+
+/* Verifies that cpus without known topology are used, none of
+ * them taken for SMT siblings of each other.
+ */
+int test_cpus_place_unknown()
+{
+    struct chili_cpus_topology cpus[] = {
+        { 0, 0, 0 }, { 1, 0, 0 }, { 3, -1, -1 }, { 2, -1, -1 },
+    };
+
+    chili_cpus_place(cpus, 4);
+
+    return assert_int(2, cpus[0].cpu) &&
+           assert_int(3, cpus[1].cpu) &&
+           assert_int(0, cpus[2].cpu) &&
+           assert_int(1, cpus[3].cpu) &&
+           assert_int(0, cpus[1].thread) &&
+           assert_int(1, cpus[3].thread);
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "dwarf.h"
+#include "assert.h"
+
+
+/* This suite is built with -g, the modules it tests aren't */
+const char *_library = "./chili_dwarf.so";
+chili_handle _handle;
+bool _found_source;
+bool _found_header;
+int _count;
+
+static bool _ends_with(const char *path, const char *end)
+{
+    size_t length = strlen(path);
+
+    return length >= strlen(end) &&
+           strcmp(path + length - strlen(end), end) == 0;
+}
+
+static int _visit(void *context, const char *path)
+{
+    _found_source = _found_source || _ends_with(path, "/tests_dwarf.c");
+    _found_header = _found_header || _ends_with(path, "/dwarf.h");
+    _count++;
+    return *(int*)context;
+}
+
+int each_before()
+{
+    _found_source = false;
+    _found_header = false;
+    _count = 0;
+    return chili_dwarf_create(_library, &_handle);
+}
+
+int each_after()
+{
+    chili_dwarf_destroy(_handle);
+    return 1;
+}
+
+/* Verifies that source file and included headers of the
+ * unit a test is in are visited.
+ */
+int test_dwarf_files()
+{
+    int next = 1;
+
+    if (!assert_int(1, chili_dwarf_files(_handle, "test_dwarf_files",
+                                         _visit, &next))){
+        return 0;
+    }
+
+    return assert_int(1, _found_source) &&
+           assert_int(1, _found_header);
+}
+
+/* Verifies that visiting stops when asked to.
+ */
+int test_dwarf_stop()
+{
+    int stop = 0;
+
+    if (!assert_int(1, chili_dwarf_files(_handle, "test_dwarf_stop",
+                                         _visit, &stop))){
+        return 0;
+    }
+
+    return assert_int(1, _count);
+}
+
+/* Verifies that functions built without -g aren't in any unit.
+ */
+int test_dwarf_no_unit()
+{
+    int next = 1;
+
+    return assert_int(0, chili_dwarf_files(_handle, "chili_dwarf_create",
+                                           _visit, &next)) &&
+           assert_int(0, _count);
+}
+
+/* Verifies that functions not in library aren't in any unit.
+ */
+int test_dwarf_missing()
+{
+    int next = 1;
+
+    return assert_int(0, chili_dwarf_files(_handle, "test_missing",
+                                           _visit, &next));
+}
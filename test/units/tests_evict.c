@@ -0,0 +1,40 @@
+#include <stdio.h>
+
+#include "evict.h"
+#include "assert.h"
+
+
+chili_handle _evict;
+
+int each_before()
+{
+    return chili_evict_create(&_evict);
+}
+
+int each_after()
+{
+    chili_evict_destroy(_evict);
+    return 1;
+}
+
+/* Verifies that the buffer is at least twice the size of a
+ * cache, whole cache lines are touched. */
+int test_evict_size()
+{
+    long size = chili_evict_size(_evict);
+
+    return assert_int(1, size >= 2 * 1024) &&
+           assert_int(0, size % 64);
+}
+
+/* Verifies that caches can be evicted again and again, the
+ * buffer is kept. */
+int test_evict_repeated()
+{
+    long size = chili_evict_size(_evict);
+
+    chili_evict(_evict);
+    chili_evict(_evict);
+
+    return assert_int(1, size == chili_evict_size(_evict));
+}
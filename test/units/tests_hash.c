@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "hash.h"
+#include "assert.h"
+
+
+chili_handle _table;
+
+int each_before()
+{
+    return chili_hash_create(&_table);
+}
+
+int each_after()
+{
+    chili_hash_destroy(_table);
+    return 1;
+}
+
+/* Verifies that hash is 64 bit FNV-1a, hashes are stored in
+ * names of files.
+ */
+int test_hash_fnv64()
+{
+    return assert_int(1, chili_hash_fnv64(CHILI_HASH_FNV_OFFSET, "", 0) ==
+                         CHILI_HASH_FNV_OFFSET) &&
+           assert_int(1, chili_hash_fnv64(CHILI_HASH_FNV_OFFSET, "a", 1) ==
+                         0xaf63dc4c8601ec8cULL);
+}
+
+/* Verifies that library and name are kept apart when hashed.
+ */
+int test_hash_test_separated()
+{
+    return assert_int(1, chili_hash_test("a.so", "btest") !=
+                         chili_hash_test("a.sob", "test"));
+}
+
+/* Verifies that tests are found by library and name, also after
+ * the table has grown.
+ */
+int test_hash_find()
+{
+    char libraries[200][16];
+    int r = 1;
+
+    for (int i = 0; i < 200; i++){
+        snprintf(libraries[i], sizeof(libraries[i]), "lib%d.so", i);
+        if (chili_hash_add(_table, libraries[i], "test", i) < 0){
+            return 0;
+        }
+    }
+
+    for (int i = 0; r && i < 200; i++){
+        r = assert_int(i, chili_hash_find(_table, libraries[i], "test"));
+    }
+
+    return r &&
+           assert_int(-1, chili_hash_find(_table, "lib0.so", "other")) &&
+           assert_int(-1, chili_hash_find(_table, "lib200.so", "test"));
+}
+
+/* Verifies that adding a test again replaces its index.
+ */
+int test_hash_add_again()
+{
+    return assert_int(1, chili_hash_add(_table, "a.so", "test_a", 0)) &&
+           assert_int(1, chili_hash_add(_table, "a.so", "test_a", 3)) &&
+           assert_int(3, chili_hash_find(_table, "a.so", "test_a"));
+}
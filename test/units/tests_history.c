@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "history.h"
+#include "assert.h"
+
+
+const char *_path = "./history_test";
+const char *_failed_path = "./history_test_failed";
+chili_handle _history;
+
+int each_before()
+{
+    unlink(_path);
+    return chili_history_create(_path, &_history);
+}
+
+int each_after()
+{
+    chili_history_destroy(_history);
+    unlink(_path);
+    unlink(_failed_path);
+    return 1;
+}
+
+/* Verifies that unknown tests have no duration.
+ */
+int test_history_unknown()
+{
+    uint64_t duration = 7;
+
+    return assert_int(0, chili_history_get(_history, "a.so", "test_a",
+                                           &duration)) &&
+           assert_int(0, chili_history_library(_history, "a.so",
+                                               &duration));
+}
+
+/* Verifies that recorded durations are kept per library and
+ * test and summed per library.
+ */
+int test_history_set_get()
+{
+    uint64_t duration;
+
+    chili_history_set(_history, "a.so", "test_a", 10, false);
+    chili_history_set(_history, "a.so", "test_b", 20, false);
+    chili_history_set(_history, "b.so", "test_a", 5, false);
+    chili_history_set(_history, "a.so", "test_a", 15, false);
+
+    return assert_int(1, chili_history_get(_history, "a.so", "test_a",
+                                           &duration)) &&
+           assert_int(15, duration) &&
+           assert_int(1, chili_history_library(_history, "a.so",
+                                               &duration)) &&
+           assert_int(35, duration);
+}
+
+/* Verifies that many tests can be recorded.
+ */
+int test_history_grows()
+{
+    char name[32];
+    uint64_t duration;
+
+    for (int i = 0; i < 1000; i++){
+        snprintf(name, sizeof(name), "test_%d", i);
+        chili_history_set(_history, "a.so", name, i, false);
+    }
+
+    chili_history_library(_history, "a.so", &duration);
+    return assert_int(999 * 1000 / 2, duration) &&
+           assert_int(1, chili_history_get(_history, "a.so", "test_500",
+                                           &duration)) &&
+           assert_int(500, duration);
+}
+
+/* Verifies that saved history is loaded and that forgotten
+ * tests that weren't recorded again are not saved.
+ */
+int test_history_save_load()
+{
+    uint64_t duration;
+    chili_handle loaded;
+    int r;
+
+    chili_history_set(_history, "./a.so", "test_a", 10, false);
+    chili_history_set(_history, "./a.so", "test_gone", 20, false);
+    chili_history_set(_history, "./b.so", "test_b", 30, false);
+    chili_history_forget(_history, "./a.so");
+    chili_history_set(_history, "./a.so", "test_a", 12, false);
+    chili_history_save(_history);
+
+    if (chili_history_create(_path, &loaded) < 0){
+        return 0;
+    }
+    r = assert_int(1, chili_history_get(loaded, "./a.so", "test_a",
+                                        &duration)) &&
+        assert_int(12, duration) &&
+        assert_int(0, chili_history_get(loaded, "./a.so", "test_gone",
+                                        &duration)) &&
+        assert_int(1, chili_history_get(loaded, "./b.so", "test_b",
+                                        &duration)) &&
+        assert_int(30, duration);
+
+    chili_history_destroy(loaded);
+    return r;
+}
+
+/* Verifies that a run where cached tests aren't run again
+ * leaves what was recorded about them unchanged.
+ */
+int test_history_keep_cached()
+{
+    uint64_t duration;
+    uint64_t kb;
+    chili_handle loaded;
+    int r;
+
+    chili_history_set(_history, "./a.so", "test_cached", 10, false);
+    chili_history_set_rss(_history, "./a.so", "test_cached", 2048);
+    chili_history_set(_history, "./a.so", "test_run", 20, true);
+    chili_history_save(_history);
+
+    /* Run of library where one test is cached */
+    chili_history_forget(_history, "./a.so");
+    chili_history_set(_history, "./a.so", "test_run", 30, false);
+    r = assert_int(1, chili_history_keep(_history, "./a.so",
+                                         "test_cached")) &&
+        assert_int(0, chili_history_keep(_history, "./a.so",
+                                         "test_new"));
+    chili_history_save(_history);
+
+    if (!r || chili_history_create(_path, &loaded) < 0){
+        return 0;
+    }
+    r = assert_int(1, chili_history_get(loaded, "./a.so", "test_cached",
+                                        &duration)) &&
+        assert_int(10, duration) &&
+        assert_int(0, chili_history_failed(loaded, "./a.so",
+                                           "test_cached")) &&
+        assert_int(1, chili_history_library_rss(loaded, "./a.so", &kb)) &&
+        assert_int(2048, kb) &&
+        assert_int(1, chili_history_get(loaded, "./a.so", "test_run",
+                                        &duration)) &&
+        assert_int(30, duration);
+
+    chili_history_destroy(loaded);
+    return r;
+}
+
+/* Verifies that failures are kept per test and library
+ * and survive save and load.
+ */
+int test_history_failed()
+{
+    chili_handle loaded;
+    int r;
+
+    chili_history_set(_history, "./a.so", "test_a", 10, true);
+    chili_history_set(_history, "./a.so", "test_b", 10, false);
+    chili_history_set(_history, "./b.so", "test_b", 10, false);
+    chili_history_save(_history);
+
+    if (chili_history_create(_path, &loaded) < 0){
+        return 0;
+    }
+    r = assert_int(1, chili_history_failed(loaded, "./a.so", "test_a")) &&
+        assert_int(0, chili_history_failed(loaded, "./a.so", "test_b")) &&
+        assert_int(0, chili_history_failed(loaded, "./a.so", "test_c")) &&
+        assert_int(1, chili_history_library_failed(loaded, "./a.so")) &&
+        assert_int(0, chili_history_library_failed(loaded, "./b.so"));
+
+    chili_history_destroy(loaded);
+    return r;
+}
+
+/* Verifies that nothing is changed without history.
+ */
+int test_history_changed_without_history()
+{
+    return assert_int(0, chili_history_changed(_history, _path));
+}
+
+/* Verifies that peak memory of a library is the peak of its
+ * hungriest test and that it survives save and load.
+ */
+int test_history_rss()
+{
+    chili_handle loaded;
+    uint64_t kb;
+    int r;
+
+    chili_history_set(_history, "./a.so", "test_a", 10, false);
+    chili_history_set_rss(_history, "./a.so", "test_a", 2048);
+    chili_history_set(_history, "./a.so", "test_b", 10, false);
+    chili_history_set_rss(_history, "./a.so", "test_b", 4096);
+    chili_history_set(_history, "./b.so", "test_b", 10, false);
+    chili_history_save(_history);
+
+    if (chili_history_create(_path, &loaded) < 0){
+        return 0;
+    }
+    r = assert_int(1, chili_history_library_rss(loaded, "./a.so", &kb)) &&
+        assert_int(4096, kb) &&
+        assert_int(0, chili_history_library_rss(loaded, "./b.so", &kb)) &&
+        assert_int(0, chili_history_set_rss(loaded, "./c.so", "test_c",
+                                            1));
+
+    chili_history_destroy(loaded);
+    return r;
+}
+
+/* Verifies that history saved without peak memory is loaded.
+ */
+int test_history_load_without_rss()
+{
+    FILE *f = fopen(_path, "w");
+    chili_handle loaded;
+    uint64_t duration;
+    uint64_t kb;
+    int r;
+
+    fprintf(f, "10 1 ./a.so:test_a\n");
+    fclose(f);
+
+    if (chili_history_create(_path, &loaded) < 0){
+        return 0;
+    }
+    r = assert_int(1, chili_history_get(loaded, "./a.so", "test_a",
+                                        &duration)) &&
+        assert_int(10, duration) &&
+        assert_int(1, chili_history_failed(loaded, "./a.so", "test_a")) &&
+        assert_int(0, chili_history_library_rss(loaded, "./a.so", &kb));
+
+    chili_history_destroy(loaded);
+    return r;
+}
+
+/* Verifies that tests that failed in this run are saved in the
+ * order they were run, with failed suite setup but without
+ * failures loaded from earlier runs.
+ */
+int test_history_save_failed()
+{
+    chili_handle loaded;
+    char line[64];
+    char lines[256] = "";
+    FILE *f;
+
+    chili_history_set(_history, "./a.so", "test_earlier", 10, true);
+    chili_history_save(_history);
+    if (chili_history_create(_path, &loaded) < 0){
+        return 0;
+    }
+    chili_history_set(loaded, "./b.so", "test_b", 10, true);
+    chili_history_set(loaded, "./a.so", "test_a", 10, false);
+    chili_history_set(loaded, "./a.so", CHILI_HISTORY_SETUP, 10, true);
+    chili_history_set(loaded, "./a.so", "test_c", 10, true);
+    chili_history_save_failed(loaded, _failed_path);
+    chili_history_destroy(loaded);
+
+    f = fopen(_failed_path, "r");
+    if (f == NULL){
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)){
+        strcat(lines, line);
+    }
+    fclose(f);
+
+    return assert_str("./b.so:test_b\n./a.so:once_before\n"
+                      "./a.so:test_c\n", lines);
+}
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "journal.h"
+#include "assert.h"
+
+
+const char *_path = "./journal_test";
+const char *_library = "./journal_test_lib.so";
+const char *_inputs[] = { "all jobs 1", "./journal_test_lib.so" };
+char _names[4][64];
+int _count;
+
+static struct chili_result _result(const char *name, int identity)
+{
+    struct chili_result result = {
+        .name = name,
+        .library = _library,
+        .identity = identity,
+        .execution = execution_done,
+        .before = fixture_success,
+        .test = test_success,
+        .after = fixture_success,
+        .usage = { 10, 20, 30, 40 },
+        .cpu = -1,
+    };
+
+    return result;
+}
+
+static void _write_library(const char *content)
+{
+    FILE *f = fopen(_library, "w");
+
+    fputs(content, f);
+    fclose(f);
+}
+
+static int _visit(void *context, const struct chili_result *result)
+{
+    if (_count == 4){
+        return -1;
+    }
+    snprintf(_names[_count], sizeof(_names[0]), "%s:%d",
+             result->name, result->identity);
+    _count++;
+
+    return 1;
+}
+
+/* Journal of interrupted run with two completed tests in a
+ * completed library */
+static int _interrupt()
+{
+    chili_handle journal;
+    struct chili_result b = _result("test_b", 0);
+    struct chili_result a = _result("test_a", 1);
+
+    a.test = test_failure;
+    if (chili_journal_create(_path, _inputs, 2, false, &journal) < 0){
+        return -1;
+    }
+    chili_journal_add(journal, &b);
+    chili_journal_add(journal, &a);
+    /* Already journaled, like results that are replayed */
+    chili_journal_add(journal, &b);
+    chili_journal_done(journal, _library);
+    chili_journal_destroy(journal, false);
+
+    return 1;
+}
+
+int each_before()
+{
+    unlink(_path);
+    _write_library("library");
+    memset(_names, 0, sizeof(_names));
+    _count = 0;
+    return 1;
+}
+
+int each_after()
+{
+    unlink(_path);
+    unlink(_library);
+    return 1;
+}
+
+/* Verifies that completed tests of an interrupted run are read
+ * back in the order they completed. */
+int test_journal_resume()
+{
+    chili_handle journal;
+    struct chili_result result;
+    int r;
+
+    if (_interrupt() < 0 ||
+        chili_journal_create(_path, _inputs, 2, true, &journal) < 0){
+        return 0;
+    }
+
+    r = assert_int(2, chili_journal_resumed(journal)) &&
+        assert_int(1, chili_journal_is_done(journal, _library)) &&
+        assert_int(1, chili_journal_find(journal, _library, "test_a",
+                                         &result)) &&
+        assert_int(test_failure, result.test) &&
+        assert_int(40, (int)result.usage.elapsed_ns) &&
+        assert_str(_library, result.library) &&
+        assert_int(0, chili_journal_find(journal, _library, "test_c",
+                                         &result)) &&
+        assert_int(1, chili_journal_replay(journal, _library,
+                                           _visit, NULL)) &&
+        assert_int(2, _count) &&
+        assert_str("test_b:0", _names[0]) &&
+        assert_str("test_a:1", _names[1]);
+    chili_journal_destroy(journal, false);
+
+    return r;
+}
+
+/* Verifies that a journal isn't resumed when not asked to, or
+ * when a library has been rebuilt since. */
+int test_journal_other_inputs()
+{
+    chili_handle journal;
+    int resumed;
+
+    if (_interrupt() < 0 ||
+        chili_journal_create(_path, _inputs, 2, false, &journal) < 0){
+        return 0;
+    }
+    resumed = chili_journal_resumed(journal);
+    chili_journal_destroy(journal, false);
+    if (!assert_int(0, resumed)){
+        return 0;
+    }
+
+    _write_library("rebuilt library");
+    if (_interrupt() < 0){
+        return 0;
+    }
+    _write_library("library rebuilt again");
+    if (chili_journal_create(_path, _inputs, 2, true, &journal) < 0){
+        return 0;
+    }
+    resumed = chili_journal_resumed(journal);
+    chili_journal_destroy(journal, false);
+
+    return assert_int(0, resumed);
+}
+
+/* Verifies that journal of a run that finished is removed. */
+int test_journal_finished()
+{
+    chili_handle journal;
+
+    if (chili_journal_create(_path, _inputs, 2, false, &journal) < 0){
+        return 0;
+    }
+    chili_journal_destroy(journal, true);
+
+    return assert_int(-1, access(_path, F_OK));
+}
+
+/* Verifies that a line cut short by a crash is dropped and that
+ * results added after it are read back. */
+int test_journal_incomplete_line()
+{
+    chili_handle journal;
+    struct chili_result c = _result("test_c", 2);
+    struct chili_result result;
+    FILE *f;
+    int r;
+
+    if (_interrupt() < 0){
+        return 0;
+    }
+    f = fopen(_path, "a");
+    fputs("result 2 4 1", f);
+    fclose(f);
+
+    if (chili_journal_create(_path, _inputs, 2, true, &journal) < 0){
+        return 0;
+    }
+    chili_journal_add(journal, &c);
+    chili_journal_destroy(journal, false);
+
+    if (chili_journal_create(_path, _inputs, 2, true, &journal) < 0){
+        return 0;
+    }
+    r = assert_int(3, chili_journal_resumed(journal)) &&
+        assert_int(1, chili_journal_find(journal, _library, "test_c",
+                                         &result)) &&
+        assert_int(2, result.identity);
+    chili_journal_destroy(journal, false);
+
+    return r;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "latency.h"
+#include "assert.h"
+
+
+struct chili_latency _latency;
+struct chili_latency _other;
+
+int each_before()
+{
+    chili_latency_reset(&_latency);
+    chili_latency_reset(&_other);
+    chili_latency = &_latency;
+
+    return 1;
+}
+
+int each_after()
+{
+    chili_latency = NULL;
+
+    return 1;
+}
+
+/* Verifies that small values are recorded exactly.
+ */
+int test_latency_index_exact_below_sub_count()
+{
+    for (int i = 0; i < CHILI_LATENCY_SUB_COUNT * 2; i++){
+        if (chili_latency_bucket_value(chili_latency_index(i)) != i){
+            printf("Value %d not exact\n", i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Verifies that bucket of a value never starts above
+ * the value and that relative error is bounded.
+ */
+int test_latency_index_relative_error()
+{
+    uint64_t values[] = { 100, 1000, 12345, 999999, 1ULL << 40,
+                          (1ULL << 40) + 12345678, UINT64_MAX };
+    uint64_t value;
+    uint64_t lowest;
+
+    for (int i = 0; i < sizeof(values) / sizeof(values[0]); i++){
+        value = values[i];
+        lowest = chili_latency_bucket_value(chili_latency_index(value));
+        if (lowest > value ||
+            (value - lowest) > value / CHILI_LATENCY_SUB_COUNT){
+            printf("Value %llu in bucket starting at %llu\n",
+                   (unsigned long long)value,
+                   (unsigned long long)lowest);
+            return 0;
+        }
+    }
+    return chili_latency_index(UINT64_MAX) < CHILI_LATENCY_BUCKETS;
+}
+
+/* Verifies that recording does nothing when chili hasn't
+ * set the histogram pointer.
+ */
+int test_latency_record_without_histogram()
+{
+    chili_latency = NULL;
+
+    chili_latency_record(100);
+
+    return assert_int(0, _latency.count);
+}
+
+/* Verifies percentiles of uniformly recorded values.
+ */
+int test_latency_percentiles()
+{
+    for (int i = 1; i <= 1000; i++){
+        chili_latency_record(i);
+    }
+
+    return assert_int(1000, _latency.count) &&
+           assert_int(1000, _latency.max) &&
+           assert_int(1, chili_latency_percentile(&_latency, 0.01) <= 1) &&
+           assert_int(1, chili_latency_percentile(&_latency, 50) >= 500) &&
+           assert_int(1, chili_latency_percentile(&_latency, 50) <= 516) &&
+           assert_int(1, chili_latency_percentile(&_latency, 99) >= 990) &&
+           assert_int(1000, chili_latency_percentile(&_latency, 100));
+}
+
+/* Verifies that percentile is zero when nothing recorded.
+ */
+int test_latency_percentile_empty()
+{
+    return assert_int(0, chili_latency_percentile(&_latency, 99));
+}
+
+/* Verifies that merge adds counts and keeps max.
+ */
+int test_latency_merge()
+{
+    chili_latency_record(10);
+    chili_latency_record(20);
+    chili_latency = &_other;
+    chili_latency_record(5000);
+
+    chili_latency_merge(&_latency, &_other);
+
+    return assert_int(3, _latency.count) &&
+           assert_int(5000, _latency.max) &&
+           assert_int(5000, chili_latency_percentile(&_latency, 99.9));
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <getopt.h>
 
 #include "command.h"
 #include "stub_command.h"
@@ -13,6 +14,13 @@ char *_latest_command;
 char _path[100];
 char _path2[100];
 struct chili_test_options _options;
+struct chili_bench_options _bench_options;
+const char *_export_path;
+bool _run;
+bool _redundant;
+const char *_symbols_path;
+int _num_paths;
+int _threshold;
 
 static int _stub_command_all(const char **library_paths,
                              int num_library_paths,
@@ -36,14 +44,18 @@ static int _stub_command_all(const char **library_paths,
 static int _stub_command_named(const char *names_path,
                                const struct chili_test_options *options)
 {
+    _options = *options;
     _latest_command = "named";
 
     return 0;
 }
 
 static int _stub_command_list(const char **library_paths,
-                             int num_library_paths)
+                             int num_library_paths,
+                             bool redundant,
+                             const struct chili_test_options *options)
 {
+    _redundant = redundant;
     if (num_library_paths > 0){
         strncpy(_path, library_paths[0], sizeof(_path));
     }
@@ -54,11 +66,132 @@ static int _stub_command_list(const char **library_paths,
         printf("Too many paths\n");
         return -1;
     }
+    _options = *options;
     _latest_command = "list";
 
     return 0;
 }
 
+static int _stub_command_bench(const char **library_paths,
+                               int num_library_paths,
+                               const struct chili_test_options *options,
+                               const struct chili_bench_options *bench_options,
+                               const char *export_path)
+{
+    if (num_library_paths > 0){
+        strncpy(_path, library_paths[0], sizeof(_path));
+    }
+    _options = *options;
+    _bench_options = *bench_options;
+    _export_path = export_path;
+    _latest_command = "bench";
+
+    return 0;
+}
+
+static int _stub_command_merge(const char **results_paths,
+                               int num_results,
+                               const struct chili_test_options *options)
+{
+    if (num_results > 1){
+        strncpy(_path2, results_paths[1], sizeof(_path2));
+    }
+    if (num_results > 0){
+        strncpy(_path, results_paths[0], sizeof(_path));
+    }
+    _options = *options;
+    _latest_command = "merge";
+
+    return 0;
+}
+
+static int _stub_command_affected(const char *files_path,
+                                  const char *symbols_path,
+                                  const char **library_paths,
+                                  int num_library_paths,
+                                  bool run,
+                                  const struct chili_test_options *options)
+{
+    if (files_path){
+        strncpy(_path, files_path, sizeof(_path));
+    }
+    _symbols_path = symbols_path;
+    if (num_library_paths > 0){
+        strncpy(_path2, library_paths[0], sizeof(_path2));
+    }
+    _run = run;
+    _options = *options;
+    _latest_command = "affected";
+
+    return 0;
+}
+
+static int _stub_command_rerun_failed(const struct chili_test_options *options)
+{
+    _options = *options;
+    _latest_command = "rerun-failed";
+
+    return 0;
+}
+
+static int _stub_command_index(const char **library_paths,
+                               int num_library_paths,
+                               const struct chili_test_options *options)
+{
+    if (num_library_paths > 0){
+        strncpy(_path, library_paths[0], sizeof(_path));
+    }
+    _options = *options;
+    _latest_command = "index";
+
+    return 1;
+}
+
+static int _stub_command_compare(const char **results_paths,
+                                 int num_results,
+                                 int threshold_percent)
+{
+    strncpy(_path, results_paths[0], sizeof(_path));
+    strncpy(_path2, results_paths[num_results - 1], sizeof(_path2));
+    _num_paths = num_results;
+    _threshold = threshold_percent;
+    _latest_command = "compare";
+
+    return 1;
+}
+
+static int _stub_command_serve(const char *socket_path)
+{
+    strncpy(_path, socket_path, sizeof(_path));
+    _latest_command = "serve";
+
+    return 0;
+}
+
+static int _stub_command_watch(const char **library_paths,
+                               int num_library_paths,
+                               const struct chili_test_options *options)
+{
+    if (num_library_paths > 0){
+        strncpy(_path, library_paths[0], sizeof(_path));
+    }
+    if (num_library_paths > 1){
+        strncpy(_path2, library_paths[1], sizeof(_path2));
+    }
+    _options = *options;
+    _latest_command = "watch";
+
+    return 0;
+}
+
+static int _stub_command_worker(const struct chili_test_options *options)
+{
+    _options = *options;
+    _latest_command = "worker";
+
+    return 0;
+}
+
 static const char* _str_bool(bool b)
 {
     return b ? "true" : "false";
@@ -84,6 +217,10 @@ static bool _check_options(const struct chili_test_options *a,
         printf("nice_stats should be %s\n", _str_bool(a->nice_stats));
         ok = false;
     }
+    if (a->jobs != b->jobs){
+        printf("jobs should be %d\n", a->jobs);
+        ok = false;
+    }
     return ok;
 }
 
@@ -91,10 +228,26 @@ int each_before()
 {
     memset(_path, 0, sizeof(_path));
     memset(&_options, 0, sizeof(_options));
+    memset(&_bench_options, 0, sizeof(_bench_options));
+    _export_path = NULL;
     _latest_command = NULL;
     stub_command_all = _stub_command_all;
     stub_command_list = _stub_command_list;
     stub_command_named = _stub_command_named;
+    stub_command_bench = _stub_command_bench;
+    stub_command_merge = _stub_command_merge;
+    stub_command_worker = _stub_command_worker;
+    stub_command_affected = _stub_command_affected;
+    stub_command_watch = _stub_command_watch;
+    stub_command_serve = _stub_command_serve;
+    stub_command_rerun_failed = _stub_command_rerun_failed;
+    stub_command_index = _stub_command_index;
+    stub_command_compare = _stub_command_compare;
+    _num_paths = 0;
+    _threshold = 0;
+    _run = false;
+    _redundant = false;
+    _symbols_path = NULL;
 
     return 1;
 }
@@ -152,7 +305,8 @@ int test_all_options_defaults()
         .use_color = false,
         .use_cursor = false,
         .use_redirect = true,
-        .nice_stats = false
+        .nice_stats = false,
+        .jobs = 1
     };
 
     main(argc, argv);
@@ -171,7 +325,8 @@ int test_all_options_interactive()
         .use_color = true,
         .use_cursor = true,
         .use_redirect = true,
-        .nice_stats = true
+        .nice_stats = true,
+        .jobs = 1
     };
 
     main(argc, argv);
@@ -179,6 +334,258 @@ int test_all_options_interactive()
     return _check_options(&options, &_options) ? 1 : 0;
 }
 
+/* Verifies that number of concurrent libraries is parsed.
+ */
+int test_all_options_jobs()
+{
+    char *argv[] = {"executable", "all", "--jobs", "4", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    main(argc, argv);
+
+    return assert_int(4, _options.jobs) &&
+           assert_str_e("a.so", _path, "Path to suite is wrong.\n");
+}
+
+/* Verifies that number of concurrent libraries can be left
+ * to chili.
+ */
+int test_all_options_jobs_auto()
+{
+    char *argv[] = {"executable", "all", "-j", "auto", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    _options.jobs = 1;
+    main(argc, argv);
+
+    return assert_int(CHILI_JOBS_AUTO, _options.jobs) &&
+           assert_str_e("a.so", _path, "Path to suite is wrong.\n");
+}
+
+/* Verifies that memory for concurrent libraries is parsed.
+ */
+int test_all_options_memory()
+{
+    char *argv[] = {"executable", "all", "-j", "4", "--memory", "2G",
+                    "a.so" };
+    char *argv_invalid[] = {"executable", "all", "-M", "lots", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+    int r;
+
+    main(argc, argv);
+    r = assert_int(2 * 1024 * 1024, (int)_options.memory_kb);
+    _latest_command = NULL;
+    main(sizeof(argv_invalid) / sizeof(char*), argv_invalid);
+    /* Need to reset to be able to parse again */
+    optind = 0;
+
+    return r && assert_int(0, _latest_command != NULL);
+}
+
+/* Verifies that time budget is parsed for both 'all' and
+ * 'named'.
+ */
+int test_options_time_budget()
+{
+    char *argv_all[] = {"executable", "all", "--time-budget", "90s",
+                        "a.so" };
+    char *argv_named[] = {"executable", "named", "-t", "2m" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_int(1, _options.time_budget_ns == 90000000000ULL);
+    main(sizeof(argv_named) / sizeof(char*), argv_named);
+
+    return r &&
+           assert_str("named", _latest_command) &&
+           assert_int(1, _options.time_budget_ns == 120000000000ULL);
+}
+
+/* Verifies that shard is parsed for both 'all' and 'named'.
+ */
+int test_options_shard()
+{
+    char *argv_all[] = {"executable", "all", "--shard", "2/4", "a.so" };
+    char *argv_named[] = {"executable", "named", "-s", "3/3" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_int(2, _options.shard_index) &&
+        assert_int(4, _options.shard_count);
+    main(sizeof(argv_named) / sizeof(char*), argv_named);
+
+    return r &&
+           assert_str("named", _latest_command) &&
+           assert_int(3, _options.shard_index) &&
+           assert_int(3, _options.shard_count);
+}
+
+/* Verifies that 'merge' command is invoked with all logs.
+ */
+int test_merge_command()
+{
+    char *argv[] = {"executable", "merge", "-c", "1.log", "2.log" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    main(argc, argv);
+
+    return assert_str("merge", _latest_command) &&
+           assert_str("1.log", _path) &&
+           assert_str("2.log", _path2) &&
+           assert_int(1, _options.use_color);
+}
+
+/* Verifies that 'affected' command is invoked with changed
+ * files and libraries and that changed files must be given.
+ */
+int test_affected_command()
+{
+    char *argv[] = {"executable", "affected", "--changed-files",
+                    "changed", "-r", "a.so" };
+    char *argv_missing[] = {"executable", "affected", "a.so" };
+    int r;
+
+    main(sizeof(argv) / sizeof(char*), argv);
+    r = assert_str("affected", _latest_command) &&
+        assert_str("changed", _path) &&
+        assert_str("a.so", _path2) &&
+        assert_int(1, _run);
+    _latest_command = NULL;
+
+    return r &&
+           assert_int(1, main(sizeof(argv_missing) / sizeof(char*),
+                              argv_missing)) &&
+           assert_int(1, _latest_command == NULL);
+}
+
+/* Verifies that changed functions can be given instead of
+ * changed files.
+ */
+int test_affected_changed_symbols()
+{
+    char *argv[] = {"executable", "affected", "-S", "symbols", "a.so" };
+
+    main(sizeof(argv) / sizeof(char*), argv);
+
+    return assert_str("affected", _latest_command) &&
+           assert_str("symbols", _symbols_path) &&
+           assert_str("a.so", _path2);
+}
+
+/* Verifies that affected tests that are run can be resumed.
+ */
+int test_affected_resume()
+{
+    char *argv[] = {"executable", "affected", "-F", "changed", "-r",
+                    "-R", "a.so" };
+
+    main(sizeof(argv) / sizeof(char*), argv);
+
+    return assert_str("affected", _latest_command) &&
+           assert_int(1, _run) &&
+           assert_int(1, _options.resume);
+}
+
+/* Verifies that coverage is recorded on request in 'all' and
+ * 'named'.
+ */
+int test_options_coverage()
+{
+    char *argv_all[] = {"executable", "all", "--coverage", "a.so" };
+    char *argv_named[] = {"executable", "named", "-C" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_int(1, _options.coverage);
+    memset(&_options, 0, sizeof(_options));
+    main(sizeof(argv_named) / sizeof(char*), argv_named);
+
+    return r &&
+           assert_str("named", _latest_command) &&
+           assert_int(1, _options.coverage);
+}
+
+/* Verifies that 'list' only lists redundant tests on request.
+ */
+int test_list_redundant()
+{
+    char *argv[] = {"executable", "list", "--redundant", "a.so" };
+
+    main(sizeof(argv) / sizeof(char*), argv);
+
+    return assert_str("list", _latest_command) &&
+           assert_str("a.so", _path) &&
+           assert_int(1, _redundant);
+}
+
+/* Verifies that number of workers is parsed for 'named' and
+ * that it must be positive.
+ */
+int test_named_options_workers()
+{
+    char *argv[] = {"executable", "named", "--workers", "3" };
+    char *argv_zero[] = {"executable", "named", "-w", "0" };
+    int r;
+
+    main(sizeof(argv) / sizeof(char*), argv);
+    r = assert_str("named", _latest_command) &&
+        assert_int(3, _options.workers);
+
+    _latest_command = NULL;
+    main(sizeof(argv_zero) / sizeof(char*), argv_zero);
+    optind = 0;
+
+    return r && assert_int(1, _latest_command == NULL);
+}
+
+/* Verifies that memory for tests run by workers is parsed.
+ */
+int test_named_options_memory()
+{
+    char *argv[] = {"executable", "named", "-w", "2", "-M", "512M" };
+
+    main(sizeof(argv) / sizeof(char*), argv);
+
+    return assert_str("named", _latest_command) &&
+           assert_int(512 * 1024, (int)_options.memory_kb);
+}
+
+/* Verifies that 'worker' command only redirects when given
+ * a log directory.
+ */
+int test_worker_command()
+{
+    char *argv[] = {"executable", "worker" };
+    char *argv_log[] = {"executable", "worker", "--log", "logs/.worker1" };
+    int r;
+
+    main(sizeof(argv) / sizeof(char*), argv);
+    r = assert_str("worker", _latest_command) &&
+        assert_int(0, _options.use_redirect);
+    main(sizeof(argv_log) / sizeof(char*), argv_log);
+
+    return r &&
+           assert_int(1, _options.use_redirect) &&
+           assert_str("logs/.worker1", _options.redirect_path);
+}
+
+/* Verifies that plan is only printed when asked for.
+ */
+int test_all_options_plan()
+{
+    char *argv[] = {"executable", "all", "a.so" };
+    char *argv_plan[] = {"executable", "all", "-j", "2", "--plan", "a.so" };
+    bool plan_by_default;
+
+    main(sizeof(argv) / sizeof(char*), argv);
+    plan_by_default = _options.plan;
+    main(sizeof(argv_plan) / sizeof(char*), argv_plan);
+
+    return assert_int(0, plan_by_default) &&
+           assert_int(1, _options.plan) &&
+           assert_int(2, _options.jobs);
+}
+
 /* Verifies that 'list' command is invoked.
  */
 int test_list_command()
@@ -231,3 +638,282 @@ int test_named_command()
 
     return assert_str("named", _latest_command);
 }
+
+/* Verifies that 'bench' command is invoked with
+ * default benchmark options.
+ */
+int test_bench_command_defaults()
+{
+    char *argv[] = {"executable", "bench", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    main(argc, argv);
+
+    return assert_str("bench", _latest_command) &&
+           assert_str_e(argv[2], _path, "Path to suite is wrong.\n") &&
+           assert_int(10, _bench_options.samples) &&
+           assert_int(100, _bench_options.iterations) &&
+           assert_int(10, _bench_options.max_time.tv_sec) &&
+           assert_int(1, _bench_options.ci_width == 0.05) &&
+           assert_ptr_null((void*)_export_path);
+}
+
+/* Verifies that benchmark options are parsed.
+ */
+int test_bench_command_options()
+{
+    char *argv[] = {"executable", "bench", "--samples", "5",
+                    "-t", "7", "--export", "out.txt", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    main(argc, argv);
+
+    return assert_int(5, _bench_options.samples) &&
+           assert_int(7, _bench_options.iterations) &&
+           assert_str("out.txt", _export_path) &&
+           assert_str_e("a.so", _path, "Path to suite is wrong.\n");
+}
+
+/* Verifies that fresh processes implies cold caches.
+ */
+int test_bench_command_fresh_implies_cold()
+{
+    char *argv[] = {"executable", "bench", "--fresh", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    main(argc, argv);
+
+    return _bench_options.cold && _bench_options.fresh;
+}
+
+/* Verifies that convergence options are parsed.
+ */
+int test_bench_command_convergence_options()
+{
+    char *argv[] = {"executable", "bench", "--ci-width", "2",
+                    "-x", "1.5", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    main(argc, argv);
+
+    return assert_int(1, _bench_options.ci_width == 0.02) &&
+           assert_int(1, _bench_options.max_time.tv_sec) &&
+           assert_int(500000000, _bench_options.max_time.tv_nsec);
+}
+
+/* Verifies that isolation is off unless asked for.
+ */
+int test_bench_command_isolate()
+{
+    char *argv[] = {"executable", "bench", "a.so" };
+    char *argv_isolate[] = {"executable", "bench", "-p", "a.so" };
+    bool isolated_by_default;
+
+    main(sizeof(argv) / sizeof(char*), argv);
+    isolated_by_default = _bench_options.isolate;
+    main(sizeof(argv_isolate) / sizeof(char*), argv_isolate);
+
+    return assert_int(0, isolated_by_default) &&
+           assert_int(1, _bench_options.isolate);
+}
+
+/* Verifies that pinning is off unless asked for, for both
+ * 'all' and 'named'.
+ */
+int test_options_pin()
+{
+    char *argv_all[] = {"executable", "all", "-j", "2", "a.so" };
+    char *argv_all_pin[] = {"executable", "all", "-j", "2", "--pin", "a.so" };
+    char *argv_named_pin[] = {"executable", "named", "-w", "2", "-P" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_int(0, _options.pin);
+    main(sizeof(argv_all_pin) / sizeof(char*), argv_all_pin);
+    r = r && assert_int(1, _options.pin);
+    main(sizeof(argv_named_pin) / sizeof(char*), argv_named_pin);
+
+    return r &&
+           assert_str("named", _latest_command) &&
+           assert_int(1, _options.pin);
+}
+
+/* Verifies that pinning is refused when nothing is run
+ * concurrently.
+ */
+int test_options_pin_alone()
+{
+    char *argv_all[] = {"executable", "all", "--pin", "a.so" };
+    char *argv_named[] = {"executable", "named", "-P" };
+    char *argv_rerun[] = {"executable", "rerun-failed", "-P" };
+
+    return assert_int(1, main(sizeof(argv_all) / sizeof(char*),
+                              argv_all) != 0) &&
+           assert_int(1, main(sizeof(argv_named) / sizeof(char*),
+                              argv_named) != 0) &&
+           assert_int(1, main(sizeof(argv_rerun) / sizeof(char*),
+                              argv_rerun) != 0) &&
+           assert_int(1, _latest_command == NULL);
+}
+
+/* Verifies that cached libraries are only run when forced.
+ */
+int test_all_options_force()
+{
+    char *argv_all[] = {"executable", "all", "a.so" };
+    char *argv_all_force[] = {"executable", "all", "--force", "a.so" };
+    char *argv_all_f[] = {"executable", "all", "-f", "a.so" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_int(0, _options.force);
+    main(sizeof(argv_all_force) / sizeof(char*), argv_all_force);
+    r = r && assert_int(1, _options.force);
+    main(sizeof(argv_all_f) / sizeof(char*), argv_all_f);
+
+    return r && assert_int(1, _options.force);
+}
+
+/* Verifies that tests are only cached one by one when asked for.
+ */
+int test_all_options_cache_tests()
+{
+    char *argv_all[] = {"executable", "all", "a.so" };
+    char *argv_all_cache[] = {"executable", "all", "-T", "a.so" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_int(0, _options.cache_tests);
+    main(sizeof(argv_all_cache) / sizeof(char*), argv_all_cache);
+
+    return r && assert_int(1, _options.cache_tests);
+}
+
+/* Verifies that 'watch' command is invoked with libraries and
+ * options. */
+int test_watch_command()
+{
+    char *argv[] = {"executable", "watch", "-c", "-j", "2", "a.so", "b.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+    struct chili_test_options expected = {
+        .use_color = true,
+        .use_redirect = true,
+        .jobs = 2,
+    };
+
+    main(argc, argv);
+
+    return assert_str("watch", _latest_command) &&
+           assert_str("a.so", _path) &&
+           assert_str("b.so", _path2) &&
+           _check_options(&expected, &_options);
+}
+
+/* Verifies that 'serve' command is invoked with default socket
+ * unless another is given. */
+int test_serve_command()
+{
+    char *argv[] = {"executable", "serve" };
+    char *argv_socket[] = {"executable", "serve", "-u", "/tmp/s.sock" };
+    int r;
+
+    main(sizeof(argv) / sizeof(char*), argv);
+    r = assert_str("serve", _latest_command) &&
+        assert_str("./chili.sock", _path);
+    main(sizeof(argv_socket) / sizeof(char*), argv_socket);
+
+    return r && assert_str("/tmp/s.sock", _path);
+}
+
+/* Verifies that commands are run by server when asked for. */
+int test_options_server()
+{
+    char *argv_all[] = {"executable", "all", "a.so" };
+    char *argv_server[] = {"executable", "all", "--server", "s.sock",
+                           "a.so" };
+    char *argv_list[] = {"executable", "list", "-u", "s.sock", "a.so" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_str("", _options.server_path);
+    main(sizeof(argv_server) / sizeof(char*), argv_server);
+    r = r && assert_str("s.sock", _options.server_path);
+    main(sizeof(argv_list) / sizeof(char*), argv_list);
+
+    return r && assert_str("list", _latest_command) &&
+           assert_str("s.sock", _options.server_path);
+}
+
+/* Verifies that 'all' and 'named' resume interrupted run only
+ * when asked to. */
+int test_options_resume()
+{
+    char *argv_all[] = {"executable", "all", "a.so" };
+    char *argv_resume[] = {"executable", "all", "--resume", "a.so" };
+    char *argv_named[] = {"executable", "named", "-R", "names.txt" };
+    int r;
+
+    main(sizeof(argv_all) / sizeof(char*), argv_all);
+    r = assert_int(0, _options.resume);
+    main(sizeof(argv_resume) / sizeof(char*), argv_resume);
+    r = r && assert_int(1, _options.resume);
+    main(sizeof(argv_named) / sizeof(char*), argv_named);
+
+    return r && assert_str("named", _latest_command) &&
+           assert_int(1, _options.resume);
+}
+
+/* Verifies that 'rerun-failed' command is invoked with options
+ * like 'named'. */
+int test_rerun_failed_command()
+{
+    char *argv[] = {"executable", "rerun-failed", "-c", "-w", "3" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    main(argc, argv);
+
+    return assert_str("rerun-failed", _latest_command) &&
+           assert_int(1, _options.use_color) &&
+           assert_int(1, _options.use_redirect) &&
+           assert_int(3, _options.workers);
+}
+
+/* Verifies that 'index' command is invoked with libraries and
+ * where manifests are kept. */
+int test_index_command()
+{
+    char *argv[] = {"executable", "index", "a.so" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    return assert_int(0, main(argc, argv)) &&
+           assert_str("index", _latest_command) &&
+           assert_str("a.so", _path) &&
+           assert_str("./chili_log", _options.redirect_path);
+}
+
+/* Verifies that 'compare' command is invoked with result logs
+ * oldest first and the default threshold. */
+int test_compare_command()
+{
+    char *argv[] = {"executable", "compare", "old", "middle", "new" };
+    int argc = sizeof(argv) / sizeof(char*);
+
+    return assert_int(0, main(argc, argv)) &&
+           assert_str("compare", _latest_command) &&
+           assert_str("old", _path) &&
+           assert_str("new", _path2) &&
+           assert_int(3, _num_paths) &&
+           assert_int(10, _threshold);
+}
+
+/* Verifies that 'compare' needs two runs and takes a threshold. */
+int test_compare_threshold()
+{
+    char *one[] = {"executable", "compare", "old" };
+    char *argv[] = {"executable", "compare", "-t", "25", "old", "new" };
+
+    return assert_int(1, main(sizeof(one) / sizeof(char*), one)) &&
+           assert_int(0, _num_paths) &&
+           assert_int(0, main(sizeof(argv) / sizeof(char*), argv)) &&
+           assert_int(25, _threshold);
+}
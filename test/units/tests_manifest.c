@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "manifest.h"
+#include "assert.h"
+
+
+const char *_directory = "./manifest_test";
+const char *_library = "./manifest_test_lib.so";
+char *_tests[] = { "test_a", "test_b" };
+char *_benchmarks[] = { "bench_a" };
+
+static struct chili_suite _suite()
+{
+    struct chili_suite suite = {
+        .once_before = "once_before",
+        .each_after = "each_after",
+        .tests = _tests,
+        .count = 2,
+        .benchmarks = _benchmarks,
+        .bench_count = 1,
+    };
+
+    return suite;
+}
+
+static void _write_library(const char *content)
+{
+    FILE *f = fopen(_library, "w");
+
+    fputs(content, f);
+    fclose(f);
+}
+
+/* Writes manifest of library as it is now */
+static int _write(const struct chili_suite *suite)
+{
+    struct stat library_stat;
+
+    if (stat(_library, &library_stat) < 0){
+        return -1;
+    }
+
+    return chili_manifest_write(_directory, _library, &library_stat,
+                                suite);
+}
+
+static void _remove_manifests()
+{
+    char command[128];
+
+    snprintf(command, sizeof(command), "rm -rf %s", _directory);
+    system(command);
+}
+
+int each_before()
+{
+    _remove_manifests();
+    _write_library("library");
+    return 1;
+}
+
+int each_after()
+{
+    _remove_manifests();
+    unlink(_library);
+    return 1;
+}
+
+/* Verifies that names written to a manifest are read back
+ * with fixtures first, then tests and benchmarks. */
+int test_manifest_round_trip()
+{
+    struct chili_suite suite = _suite();
+    chili_handle manifest;
+    int r;
+
+    if (!assert_int(1, _write(&suite)) ||
+        !assert_int(1, chili_manifest_open(_directory, _library,
+                                           &manifest))){
+        return 0;
+    }
+
+    r = assert_int(5, chili_manifest_count(manifest)) &&
+        assert_str("once_before", chili_manifest_name(manifest, 0)) &&
+        assert_str("each_after", chili_manifest_name(manifest, 1)) &&
+        assert_str("test_a", chili_manifest_name(manifest, 2)) &&
+        assert_str("test_b", chili_manifest_name(manifest, 3)) &&
+        assert_str("bench_a", chili_manifest_name(manifest, 4));
+    chili_manifest_destroy(manifest);
+
+    return r;
+}
+
+/* Verifies that a manifest isn't used after library has been
+ * rebuilt. */
+int test_manifest_stale()
+{
+    struct chili_suite suite = _suite();
+    chili_handle manifest;
+
+    if (_write(&suite) < 0){
+        return 0;
+    }
+    _write_library("rebuilt library");
+
+    return assert_int(0, chili_manifest_open(_directory, _library,
+                                             &manifest));
+}
+
+/* Verifies that a library without manifest is reported as
+ * such and not as an error. */
+int test_manifest_missing()
+{
+    chili_handle manifest;
+
+    return assert_int(0, chili_manifest_open(_directory, _library,
+                                             &manifest));
+}
+
+/* Verifies that a library rebuilt after it was stat'ed, while its
+ * symbols were parsed, gets a manifest that is already stale. */
+int test_manifest_rebuilt_while_parsed()
+{
+    struct chili_suite suite = _suite();
+    struct stat library_stat;
+    chili_handle manifest;
+
+    if (stat(_library, &library_stat) < 0){
+        return 0;
+    }
+    _write_library("rebuilt library");
+
+    return assert_int(1, chili_manifest_write(_directory, _library,
+                                              &library_stat, &suite)) &&
+           assert_int(0, chili_manifest_open(_directory, _library,
+                                             &manifest));
+}
+
+/* Verifies that failing to create the directory of manifests is
+ * an error. */
+int test_manifest_no_directory()
+{
+    struct chili_suite suite = _suite();
+    struct stat library_stat;
+
+    if (stat(_library, &library_stat) < 0){
+        return 0;
+    }
+
+    return assert_int(-1, chili_manifest_write("./manifest_test_lib.so/sub",
+                                               _library, &library_stat,
+                                               &suite));
+}
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "memory.h"
+#include "assert.h"
+
+
+/* Verifies that sizes are parsed into kilobytes.
+ */
+int test_memory_parse_size()
+{
+    uint64_t kb;
+
+    return assert_int(1, chili_memory_parse_size("512M", &kb)) &&
+           assert_int(512 * 1024, (int)kb) &&
+           assert_int(1, chili_memory_parse_size("4G", &kb)) &&
+           assert_int(4 * 1024 * 1024, (int)kb) &&
+           assert_int(1, chili_memory_parse_size("100k", &kb)) &&
+           assert_int(100, (int)kb) &&
+           assert_int(1, chili_memory_parse_size("2048", &kb)) &&
+           assert_int(2, (int)kb);
+}
+
+/* Verifies that garbage isn't mistaken for a size.
+ */
+int test_memory_parse_size_invalid()
+{
+    uint64_t kb;
+
+    return chili_memory_parse_size("", &kb) < 0 &&
+           chili_memory_parse_size("G", &kb) < 0 &&
+           chili_memory_parse_size("4GB", &kb) < 0 &&
+           chili_memory_parse_size("4T", &kb) < 0;
+}
+
+/* Verifies that cgroup limits are parsed.
+ */
+int test_memory_parse_max()
+{
+    uint64_t kb = 7;
+
+    return assert_int(1, chili_memory_parse_max("max\n", &kb)) &&
+           assert_int(0, (int)kb) &&
+           assert_int(1, chili_memory_parse_max("4294967296\n", &kb)) &&
+           assert_int(4 * 1024 * 1024, (int)kb) &&
+           chili_memory_parse_max("", &kb) < 0;
+}
+
+/* Verifies that unknown peaks are assumed to be large.
+ */
+int test_memory_unknown()
+{
+    return assert_int(500, (int)chili_memory_unknown(1000, 0)) &&
+           assert_int(500, (int)chili_memory_unknown(1000, 200)) &&
+           assert_int(800, (int)chili_memory_unknown(1000, 800));
+}
+
+/* Verifies that only what fits is admitted, unless nothing
+ * else runs.
+ */
+int test_memory_admit()
+{
+    return assert_int(1, chili_memory_admit(1000, 400, 600, 1)) &&
+           assert_int(0, chili_memory_admit(1000, 401, 600, 1)) &&
+           assert_int(1, chili_memory_admit(1000, 0, 2000, 0));
+}
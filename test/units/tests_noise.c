@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "noise.h"
+#include "assert.h"
+
+
+#define NUM_CPUS 8
+
+bool _allowed[NUM_CPUS];
+
+static void _allow(int first, int last)
+{
+    for (int cpu = first; cpu <= last; cpu++){
+        _allowed[cpu] = true;
+    }
+}
+
+int each_before()
+{
+    memset(_allowed, 0, sizeof(_allowed));
+    return 1;
+}
+
+/* Verifies that the first isolated cpu is used when allowed. */
+int test_noise_isolated()
+{
+    _allow(0, NUM_CPUS - 1);
+
+    return assert_int(2, chili_noise_choose_cpu("2-3,6", _allowed,
+                                                NUM_CPUS));
+}
+
+/* Verifies that isolated cpus outside of the affinity mask, as
+ * set by a cpuset or taskset, are passed over. */
+int test_noise_isolated_not_allowed()
+{
+    _allow(3, 4);
+    _allow(6, 6);
+
+    return assert_int(3, chili_noise_choose_cpu("2-3,6", _allowed,
+                                                NUM_CPUS)) &&
+           assert_int(6, chili_noise_choose_cpu("1,6-7", _allowed,
+                                                NUM_CPUS));
+}
+
+/* Verifies that the last allowed cpu is used when no isolated
+ * cpu is allowed, or there are none. */
+int test_noise_last_allowed()
+{
+    _allow(0, 5);
+
+    return assert_int(5, chili_noise_choose_cpu("6-7", _allowed,
+                                                NUM_CPUS)) &&
+           assert_int(5, chili_noise_choose_cpu("", _allowed,
+                                                NUM_CPUS)) &&
+           assert_int(5, chili_noise_choose_cpu("garbage", _allowed,
+                                                NUM_CPUS));
+}
+
+/* Verifies that no cpu is chosen when none is allowed. */
+int test_noise_none_allowed()
+{
+    return assert_int(-1, chili_noise_choose_cpu("2", _allowed,
+                                                 NUM_CPUS));
+}
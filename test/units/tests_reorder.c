@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "reorder.h"
+#include "assert.h"
+
+
+chili_handle _handle;
+/* Names of released results, separated by space */
+char _released[256];
+
+static void _release(void *context, struct chili_wire_message *message)
+{
+    strcat(_released, message->result.name);
+    strcat(_released, " ");
+}
+
+static void _add(int group, const char *name)
+{
+    struct chili_wire_message message;
+
+    memset(&message, 0, sizeof(message));
+    message.type = chili_wire_result;
+    message.result.name = name;
+    chili_reorder_add(_handle, group, &message);
+}
+
+static int _create(int num_groups, int capacity)
+{
+    return chili_reorder_create(num_groups, capacity, ".", _release,
+                                NULL, &_handle);
+}
+
+int each_before()
+{
+    _handle = NULL;
+    _released[0] = '\0';
+
+    return 1;
+}
+
+int each_after()
+{
+    if (_handle){
+        chili_reorder_destroy(_handle);
+    }
+
+    return 1;
+}
+
+/* Verifies that results of first group are released at once
+ * and results of later groups when it is their turn.
+ */
+int test_reorder_in_turn()
+{
+    int r = _create(3, 10);
+
+    _add(1, "b1");
+    _add(0, "a1");
+    _add(2, "c1");
+    _add(1, "b2");
+    r = r && assert_str("a1 ", _released);
+
+    chili_reorder_done(_handle, 0);
+    r = r && assert_str("a1 b1 b2 ", _released);
+    _add(1, "b3");
+
+    return r && assert_str("a1 b1 b2 b3 ", _released);
+}
+
+/* Verifies that groups done out of order are released
+ * together when the group before them is done.
+ */
+int test_reorder_done_out_of_order()
+{
+    int r = _create(3, 10);
+
+    _add(2, "c1");
+    chili_reorder_done(_handle, 2);
+    _add(1, "b1");
+    chili_reorder_done(_handle, 1);
+    r = r && assert_str("", _released);
+
+    chili_reorder_done(_handle, 0);
+
+    return r && assert_str("b1 c1 ", _released);
+}
+
+/* Verifies that results beyond capacity are spilled and
+ * released in order with their names.
+ */
+int test_reorder_spill()
+{
+    int r = _create(2, 1);
+
+    _add(1, "b1");
+    _add(1, "b2");
+    _add(1, "b3");
+    r = r && assert_int(2, chili_reorder_spilled(_handle));
+
+    chili_reorder_done(_handle, 0);
+
+    return r && assert_str("b1 b2 b3 ", _released);
+}
+
+/* Verifies that flush releases kept results of groups that
+ * are not done.
+ */
+int test_reorder_flush()
+{
+    int r = _create(3, 10);
+
+    _add(2, "c1");
+    _add(1, "b1");
+    chili_reorder_flush(_handle);
+    r = r && assert_str("b1 c1 ", _released);
+    _add(2, "c2");
+
+    return r && assert_str("b1 c1 ", _released);
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "results.h"
+#include "assert.h"
+
+
+const char *_path = "./results_test";
+struct chili_result _read[4];
+bool _skipped[4];
+char _names[4][64];
+int _count;
+
+static int _visit(void *context,
+                  const struct chili_result *result,
+                  bool skipped)
+{
+    if (_count == 4){
+        return -1;
+    }
+    _read[_count] = *result;
+    _skipped[_count] = skipped;
+    snprintf(_names[_count], sizeof(_names[0]), "%s:%s",
+             result->library, result->name);
+    _count++;
+
+    return 1;
+}
+
+int each_before()
+{
+    unlink(_path);
+    memset(_read, 0, sizeof(_read));
+    _count = 0;
+    return 1;
+}
+
+int each_after()
+{
+    unlink(_path);
+    return 1;
+}
+
+/* Verifies that results and skipped tests are read back as
+ * written.
+ */
+int test_results_write_read()
+{
+    chili_handle results;
+    struct chili_result result = {
+        .name = "test_a",
+        .library = "./a.so",
+        .identity = 7,
+        .execution = execution_done,
+        .before = fixture_success,
+        .test = test_failure,
+        .after = fixture_success,
+        .usage = { 10, 20, 30, 40 },
+        .budget = { 0, 0, 25 },
+        .over_budget = true,
+        .cpu = 3,
+    };
+    int shard = 0;
+    int num_shards = 0;
+
+    if (chili_results_create(_path, 2, 3, &results) < 0){
+        return 0;
+    }
+    chili_results_add(results, &result);
+    chili_results_skip(results, "./b.so", "test_b");
+    chili_results_destroy(results);
+
+    return assert_int(1, chili_results_read(_path, &shard, &num_shards,
+                                            _visit, NULL)) &&
+           assert_int(2, shard) &&
+           assert_int(3, num_shards) &&
+           assert_int(2, _count) &&
+           assert_str("./a.so:test_a", _names[0]) &&
+           assert_int(0, _skipped[0]) &&
+           assert_int(7, _read[0].identity) &&
+           assert_int(execution_done, _read[0].execution) &&
+           assert_int(test_failure, _read[0].test) &&
+           assert_int(1, _read[0].over_budget) &&
+           assert_int(0, _read[0].cached) &&
+           assert_int(40, (int)_read[0].usage.elapsed_ns) &&
+           assert_int(25, (int)_read[0].budget.max_rss_kb) &&
+           assert_int(3, _read[0].cpu) &&
+           assert_str("./b.so:test_b", _names[1]) &&
+           assert_int(1, _skipped[1]);
+}
+
+/* Verifies that a cached result is read back as cached, so
+ * that its zero usage isn't taken for a measurement.
+ */
+int test_results_cached()
+{
+    chili_handle results;
+    struct chili_result result = {
+        .name = "test_a",
+        .library = "./a.so",
+        .execution = execution_done,
+        .test = test_success,
+        .cached = true,
+        .cpu = -1,
+    };
+    int shard;
+    int num_shards;
+
+    if (chili_results_create(_path, 1, 1, &results) < 0){
+        return 0;
+    }
+    chili_results_add(results, &result);
+    chili_results_destroy(results);
+
+    return assert_int(1, chili_results_read(_path, &shard, &num_shards,
+                                            _visit, NULL)) &&
+           assert_int(1, _count) &&
+           assert_int(1, _read[0].cached) &&
+           assert_int(0, _read[0].over_budget);
+}
+
+/* Verifies that other files aren't taken for result logs.
+ */
+int test_results_not_a_log()
+{
+    FILE *f = fopen(_path, "w");
+    int shard;
+    int num_shards;
+
+    fprintf(f, "10 0 ./a.so:test_a\n");
+    fclose(f);
+
+    return chili_results_read(_path, &shard, &num_shards,
+                              _visit, NULL) < 0;
+}
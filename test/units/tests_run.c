@@ -628,3 +628,47 @@ int test_run_test_assigns_identity()
 
     return identity1 < identity2;
 }
+
+/* Verifies that a succeeding test that takes longer
+ * than its budget is counted as over budget.
+ */
+int test_run_test_over_budget()
+{
+    struct chili_budget budget = { .wall_ns = 1000000 };
+
+    chili_run_before(&_fixture);
+    _test.func = _long_test;
+    _test.budget = &budget;
+
+    chili_run_test(&_result, &_aggregated, &_test, &_fixture,
+                   &_times, _progress);
+
+    chili_run_after(&_fixture);
+    _print_aggregated(&_aggregated);
+    return _result.over_budget &&
+           _result.usage.wall_ns >= 1000000000 &&
+           _aggregated.num_over_budget == 1 &&
+           _aggregated.num_succeeded == 0 &&
+           _aggregated.num_total == 1;
+}
+
+/* Verifies that limits not exceeded doesn't affect
+ * the result, sleeping uses no cpu time.
+ */
+int test_run_test_within_budget()
+{
+    struct chili_budget budget = { .cpu_ns = 100000000 };
+
+    chili_run_before(&_fixture);
+    _test.func = _long_test;
+    _test.budget = &budget;
+
+    chili_run_test(&_result, &_aggregated, &_test, &_fixture,
+                   &_times, _progress);
+
+    chili_run_after(&_fixture);
+    return !_result.over_budget &&
+           _result.usage.max_rss_kb > 0 &&
+           _aggregated.num_over_budget == 0 &&
+           _aggregated.num_succeeded == 1;
+}
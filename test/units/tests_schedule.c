@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "history.h"
+#include "schedule.h"
+#include "assert.h"
+
+
+const char *_path = "./schedule_test";
+chili_handle _history;
+const char *_libraries[] = { "a.so", "b.so", "c.so", "d.so" };
+struct chili_schedule_entry _plan[4];
+uint64_t _makespan;
+
+int each_before()
+{
+    unlink(_path);
+    if (chili_history_create(_path, &_history) < 0){
+        return -1;
+    }
+    chili_history_set(_history, "a.so", "test_a", 10, false);
+    chili_history_set(_history, "b.so", "test_b", 40, false);
+    chili_history_set(_history, "b.so", CHILI_HISTORY_SETUP, 10, false);
+    chili_history_set(_history, "c.so", "test_c", 20, false);
+
+    return 1;
+}
+
+int each_after()
+{
+    chili_history_destroy(_history);
+    return 1;
+}
+
+/* Verifies that given order is kept when running one
+ * library at a time.
+ */
+int test_schedule_single_job()
+{
+    chili_schedule_plan(_history, _libraries, 4, 1, _plan, &_makespan);
+
+    return assert_str("a.so", _plan[0].library) &&
+           assert_str("d.so", _plan[3].library) &&
+           assert_int(60, _plan[2].start_ns) &&
+           /* Unknown library is predicted as the average */
+           assert_int(0, _plan[3].known) &&
+           assert_int(26, _plan[3].predicted_ns) &&
+           assert_int(106, _makespan);
+}
+
+/* Verifies that longest libraries are started first and
+ * put in the job that is free first.
+ */
+int test_schedule_longest_first()
+{
+    chili_schedule_plan(_history, _libraries, 4, 2, _plan, &_makespan);
+
+    return assert_str("b.so", _plan[0].library) &&
+           assert_str("d.so", _plan[1].library) &&
+           assert_str("c.so", _plan[2].library) &&
+           assert_str("a.so", _plan[3].library) &&
+           assert_int(0, _plan[1].start_ns) &&
+           assert_int(1, _plan[1].job) &&
+           assert_int(26, _plan[2].start_ns) &&
+           assert_int(46, _plan[3].start_ns) &&
+           assert_int(56, _makespan);
+}
+
+/* Verifies that libraries that failed go first regardless
+ * of duration.
+ */
+int test_schedule_failed_first()
+{
+    chili_history_set(_history, "c.so", "test_c", 20, true);
+
+    chili_schedule_plan(_history, _libraries, 4, 1, _plan, &_makespan);
+    if (!assert_str("c.so", _plan[0].library) ||
+        !assert_int(chili_schedule_failed, _plan[0].reason) ||
+        !assert_str("a.so", _plan[1].library)){
+        return 0;
+    }
+
+    chili_schedule_plan(_history, _libraries, 4, 2, _plan, &_makespan);
+    return assert_str("c.so", _plan[0].library) &&
+           assert_str("b.so", _plan[1].library);
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "select.h"
+#include "assert.h"
+
+
+struct chili_select_candidate _candidates[4];
+uint64_t _setup_ns[2];
+
+int each_before()
+{
+    /* Cheap stable, expensive stable, cheap failing and
+     * expensive failing test */
+    struct chili_select_candidate candidates[] = {
+        { 0, 0, 0.01, 10, false },
+        { 1, 0, 0.01, 100, false },
+        { 2, 1, 0.5, 10, false },
+        { 3, 1, 0.5, 100, false },
+    };
+
+    for (int i = 0; i < 4; i++){
+        _candidates[i] = candidates[i];
+    }
+    _setup_ns[0] = 0;
+    _setup_ns[1] = 0;
+
+    return 1;
+}
+
+/* Verifies that recently failing tests are predicted to fail
+ * more often than changed and new tests, and those more often
+ * than the rest.
+ */
+int test_select_failure()
+{
+    double failed = chili_select_failure(true, false, true);
+    double changed = chili_select_failure(false, true, true);
+    double unknown = chili_select_failure(false, false, false);
+    double stable = chili_select_failure(false, false, true);
+
+    return assert_int(1, failed > changed) &&
+           assert_int(1, changed == unknown) &&
+           assert_int(1, changed > stable);
+}
+
+/* Verifies that everything is selected when budget allows,
+ * most failures per time first.
+ */
+int test_select_everything()
+{
+    uint64_t predicted;
+
+    return assert_int(4, chili_select_within(_candidates, 4, _setup_ns,
+                                             2, 1000, &predicted)) &&
+           assert_int(220, (int)predicted) &&
+           assert_int(2, _candidates[0].index) &&
+           assert_int(3, _candidates[1].index) &&
+           assert_int(0, _candidates[2].index) &&
+           assert_int(1, _candidates[3].index);
+}
+
+/* Verifies that cheaper tests are picked when expensive
+ * ones doesn't fit and that skipped tests are last.
+ */
+int test_select_within_budget()
+{
+    uint64_t predicted;
+
+    return assert_int(2, chili_select_within(_candidates, 4, _setup_ns,
+                                             2, 50, &predicted)) &&
+           assert_int(20, (int)predicted) &&
+           assert_int(2, _candidates[0].index) &&
+           assert_int(0, _candidates[1].index) &&
+           assert_int(0, _candidates[2].selected) &&
+           assert_int(0, _candidates[3].selected);
+}
+
+/* Verifies that suite setup is paid by first test in library.
+ */
+int test_select_setup()
+{
+    uint64_t predicted;
+
+    _setup_ns[1] = 100;
+
+    return assert_int(2, chili_select_within(_candidates, 4, _setup_ns,
+                                             2, 150, &predicted)) &&
+           assert_int(120, (int)predicted) &&
+           assert_int(2, _candidates[0].index) &&
+           assert_int(0, _candidates[1].index);
+}
+
+/* Verifies that durations are parsed.
+ */
+int test_select_parse_duration()
+{
+    uint64_t ns;
+
+    return assert_int(1, chili_select_parse_duration("90s", &ns)) &&
+           assert_int(1, ns == 90000000000ULL) &&
+           assert_int(1, chili_select_parse_duration("2", &ns)) &&
+           assert_int(1, ns == 2000000000ULL) &&
+           assert_int(1, chili_select_parse_duration("500ms", &ns)) &&
+           assert_int(1, ns == 500000000ULL) &&
+           assert_int(1, chili_select_parse_duration("1.5m", &ns)) &&
+           assert_int(1, ns == 90000000000ULL) &&
+           chili_select_parse_duration("soon", &ns) < 0 &&
+           chili_select_parse_duration("5d", &ns) < 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "server.h"
+#include "assert.h"
+
+
+const char *_socket = "./server_test.sock";
+/* Any library with tests will do, this suite is one */
+const char *_library = "./chili_server.so";
+pid_t _server;
+int _num_tests;
+int _num_done;
+bool _found;
+
+static void _report(void *context,
+                    int index,
+                    struct chili_wire_message *message)
+{
+    switch (message->type){
+        case chili_wire_test:
+            _num_tests++;
+            _found = _found || strcmp(message->name, "test_list") == 0;
+            break;
+        case chili_wire_done:
+            _num_done++;
+            break;
+        default:
+            break;
+    }
+}
+
+int each_before()
+{
+    _num_tests = 0;
+    _num_done = 0;
+    _found = false;
+
+    fflush(stdout);
+    _server = fork();
+    if (_server == 0){
+        _exit(chili_server_serve(_socket) > 0 ? 0 : 1);
+    }
+
+    /* Ready when socket is created */
+    for (int i = 0; i < 100 && access(_socket, F_OK) < 0; i++){
+        usleep(10000);
+    }
+    return _server > 0 && access(_socket, F_OK) == 0;
+}
+
+int each_after()
+{
+    int status;
+
+    kill(_server, SIGTERM);
+    waitpid(_server, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* Verifies that tests of library are streamed back when
+ * listed. */
+int test_list()
+{
+    const char *libraries[] = { _library, _library };
+
+    return assert_int(1, chili_server_request(_socket, chili_server_list,
+                                              NULL, libraries, NULL, 2,
+                                              _report, NULL)) &&
+           assert_int(2, _num_done) &&
+           assert_int(8, _num_tests) &&
+           assert_int(true, _found);
+}
+
+/* Verifies that a second server is not started at the same
+ * socket and that the first is left alone. */
+int test_already_served()
+{
+    const char *libraries[] = { _library };
+
+    return assert_int(-1, chili_server_serve(_socket)) &&
+           assert_int(1, chili_server_request(_socket, chili_server_list,
+                                              NULL, libraries, NULL, 1,
+                                              _report, NULL));
+}
+
+/* Verifies that requests fail when nothing is served. */
+int test_not_served()
+{
+    const char *libraries[] = { _library };
+
+    return assert_int(-1, chili_server_request("./not_served.sock",
+                                               chili_server_list, NULL,
+                                               libraries, NULL, 1,
+                                               _report, NULL));
+}
+
+/* Verifies that a library that can't be loaded is reported as
+ * failed without stopping the request. */
+int test_bad_library()
+{
+    const char *libraries[] = { "./server_test.sock", _library };
+
+    return assert_int(1, chili_server_request(_socket, chili_server_list,
+                                              NULL, libraries, NULL, 2,
+                                              _report, NULL)) &&
+           assert_int(2, _num_done) &&
+           assert_int(4, _num_tests);
+}
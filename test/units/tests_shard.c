@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "shard.h"
+#include "assert.h"
+
+
+/* Verifies that shards are parsed and validated.
+ */
+int test_shard_parse()
+{
+    int index;
+    int count;
+
+    return assert_int(1, chili_shard_parse("2/4", &index, &count)) &&
+           assert_int(2, index) &&
+           assert_int(4, count) &&
+           chili_shard_parse("0/4", &index, &count) < 0 &&
+           chili_shard_parse("5/4", &index, &count) < 0 &&
+           chili_shard_parse("2", &index, &count) < 0 &&
+           chili_shard_parse("2/4x", &index, &count) < 0;
+}
+
+/* Verifies that every test gets exactly one shard and that
+ * assignment doesn't depend on order of tests.
+ */
+int test_shard_by_hash()
+{
+    struct chili_shard_test forward[] = {
+        { "a.so", "test_a", 0, 0 },
+        { "a.so", "test_b", 0, 0 },
+        { "b.so", "test_a", 0, 0 },
+        { "b.so", "test_c", 0, 0 },
+    };
+    struct chili_shard_test backward[] = {
+        { "b.so", "test_c", 0, 0 },
+        { "b.so", "test_a", 0, 0 },
+        { "a.so", "test_b", 0, 0 },
+        { "a.so", "test_a", 0, 0 },
+    };
+    int ok = 1;
+
+    chili_shard_assign(forward, 4, 3);
+    chili_shard_assign(backward, 4, 3);
+
+    for (int i = 0; i < 4; i++){
+        ok = ok &&
+             assert_int(1, forward[i].shard >= 1 &&
+                           forward[i].shard <= 3) &&
+             assert_int(forward[i].shard, backward[3 - i].shard);
+    }
+    return ok;
+}
+
+/* Verifies that tests with recorded durations are balanced,
+ * longest first.
+ */
+int test_shard_by_duration()
+{
+    struct chili_shard_test tests[] = {
+        { "a.so", "test_a", 50, 0 },
+        { "a.so", "test_b", 30, 0 },
+        { "b.so", "test_a", 20, 0 },
+        { "b.so", "test_b", 10, 0 },
+        { "b.so", "test_c", 10, 0 },
+    };
+
+    chili_shard_assign(tests, 5, 2);
+
+    /* 50 goes to 1, 30 and 20 to 2, then 10 to each */
+    return assert_int(1, tests[0].shard) &&
+           assert_int(2, tests[1].shard) &&
+           assert_int(2, tests[2].shard) &&
+           assert_int(1, tests[3].shard) &&
+           assert_int(2, tests[4].shard);
+}
+
+/* Verifies that everything ends up in the only shard.
+ */
+int test_shard_single()
+{
+    struct chili_shard_test tests[] = {
+        { "a.so", "test_a", 50, 0 },
+        { "a.so", "test_b", 0, 0 },
+    };
+
+    chili_shard_assign(tests, 2, 1);
+
+    return assert_int(1, tests[0].shard) &&
+           assert_int(1, tests[1].shard);
+}
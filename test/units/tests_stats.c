@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "stats.h"
+#include "assert.h"
+
+
+struct chili_stats _stats;
+
+/* Verifies median of odd and even number of samples.
+ */
+int test_stats_median()
+{
+    uint64_t odd[] = { 1, 2, 3 };
+    uint64_t even[] = { 1, 2, 4, 10 };
+
+    chili_stats_compute(odd, 3, &_stats);
+    if (!assert_int(2, _stats.median)){
+        return 0;
+    }
+
+    chili_stats_compute(even, 4, &_stats);
+    return assert_int(3, _stats.median);
+}
+
+/* Verifies that samples are sorted ascending.
+ */
+int test_stats_sort()
+{
+    uint64_t samples[] = { 5, 1, 4, 2, 3 };
+
+    chili_stats_sort(samples, 5);
+
+    for (int i = 0; i < 5; i++){
+        if (!assert_int(i + 1, samples[i])){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Verifies that few samples gives an interval over
+ * all samples.
+ */
+int test_stats_interval_few_samples()
+{
+    uint64_t samples[] = { 10, 20, 30 };
+
+    chili_stats_compute(samples, 3, &_stats);
+
+    return assert_int(10, _stats.ci_low) &&
+           assert_int(30, _stats.ci_high);
+}
+
+/* Verifies that interval narrows around the median when
+ * there are many samples.
+ */
+int test_stats_interval_many_samples()
+{
+    uint64_t samples[100];
+
+    for (int i = 0; i < 100; i++){
+        samples[i] = 1000 + i;
+    }
+
+    chili_stats_compute(samples, 100, &_stats);
+
+    return assert_int(1, _stats.ci_low > 1030) &&
+           assert_int(1, _stats.ci_high < 1070) &&
+           assert_int(1, chili_stats_relative_width(&_stats) < 0.05);
+}
+
+/* Verifies that outliers are counted on both sides.
+ */
+int test_stats_outliers()
+{
+    uint64_t samples[] = { 1, 100, 100, 101, 102, 103, 104, 1000, 5000 };
+
+    chili_stats_compute(samples, 9, &_stats);
+
+    return assert_int(1, _stats.low_outliers) &&
+           assert_int(2, _stats.high_outliers);
+}
+
+/* Verifies that identical samples has no width
+ * and no outliers.
+ */
+int test_stats_identical_samples()
+{
+    uint64_t samples[] = { 7, 7, 7, 7, 7, 7, 7, 7, 7, 7 };
+
+    chili_stats_compute(samples, 10, &_stats);
+
+    return assert_int(0, _stats.low_outliers + _stats.high_outliers) &&
+           assert_int(1, chili_stats_relative_width(&_stats) == 0.0);
+}
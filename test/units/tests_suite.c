@@ -121,6 +121,21 @@ int test_suite_eval_test()
            strcmp(suite->tests[0], "test_whatever") == 0;
 }
 
+/* Verifies that benchmark is added to suite and
+ * that it is not mistaken for a test.
+ */
+int test_suite_eval_bench()
+{
+    const struct chili_suite *suite;
+
+    chili_suite_eval(_handle, "bench_whatever");
+
+    chili_suite_get(_handle, &suite);
+    return suite->count == 0 &&
+           suite->bench_count == 1 &&
+           strcmp(suite->benchmarks[0], "bench_whatever") == 0;
+}
+
 /* Verifies return value from succesful eval
  */
 int test_suite_eval_success()
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "watch.h"
+#include "assert.h"
+
+
+const char *_path = "./watch_test";
+const char *_library = "./watch_test/lib.so";
+const char *_other = "./watch_test/other.so";
+const char *_temporary = "./watch_test/lib.so.tmp";
+chili_handle _handle;
+enum chili_watch_state _state;
+
+/* Longer than it takes for writes to settle */
+#define WAIT_MS 2000
+
+/* ELF header without sections, section headers at offset */
+static void _write(const char *path, uint64_t section_offset)
+{
+    unsigned char header[64] = { 0x7f, 'E', 'L', 'F', 2, 1, 1 };
+    FILE *f = fopen(path, "w");
+
+    memcpy(header + 0x28, &section_offset, sizeof(section_offset));
+    fwrite(header, sizeof(header), 1, f);
+    fclose(f);
+}
+
+/* Waits until library is reported in state, or timeout */
+static bool _wait_for(enum chili_watch_state state, int timeout_ms)
+{
+    while (chili_watch_wait(_handle, timeout_ms, &_state) > 0){
+        if (_state == state){
+            return true;
+        }
+    }
+    return false;
+}
+
+int each_before()
+{
+    const char *paths[] = { _library };
+
+    mkdir(_path, 0755);
+    _write(_library, 64);
+    return chili_watch_create(paths, 1, &_handle);
+}
+
+int each_after()
+{
+    chili_watch_destroy(_handle);
+    unlink(_library);
+    unlink(_other);
+    unlink(_temporary);
+    rmdir(_path);
+    return 1;
+}
+
+/* Verifies that a library written in place is reported as
+ * changing and then as changed once. */
+int test_written()
+{
+    _write(_library, 64);
+
+    return assert_int(true, _wait_for(chili_watch_changing, WAIT_MS)) &&
+           assert_int(true, _wait_for(chili_watch_changed, WAIT_MS)) &&
+           assert_int(0, chili_watch_wait(_handle, 400, &_state)) &&
+           assert_int(chili_watch_unchanged, _state);
+}
+
+/* Verifies that a library replaced by another file is
+ * reported as changed. */
+int test_replaced()
+{
+    _write(_temporary, 64);
+    rename(_temporary, _library);
+
+    return assert_int(true, _wait_for(chili_watch_changed, WAIT_MS));
+}
+
+/* Verifies that a library whose section headers are not
+ * written yet is not reported as changed. */
+int test_incomplete()
+{
+    _write(_library, 4096);
+
+    return assert_int(false, _wait_for(chili_watch_changed, 800)) &&
+           assert_int(chili_watch_changing, _state);
+}
+
+/* Verifies that other files in the same directory are not
+ * reported. */
+int test_other()
+{
+    _write(_other, 64);
+
+    return assert_int(0, chili_watch_wait(_handle, 400, &_state)) &&
+           assert_int(chili_watch_unchanged, _state);
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wire.h"
+#include "assert.h"
+
+
+int _pipes[2];
+struct chili_wire_message _sent;
+struct chili_wire_message _received;
+
+int each_before()
+{
+    memset(&_sent, 0, sizeof(_sent));
+    memset(&_received, 0, sizeof(_received));
+
+    return pipe(_pipes) == 0 ? 1 : -1;
+}
+
+int each_after()
+{
+    close(_pipes[0]);
+    if (_pipes[1] >= 0){
+        close(_pipes[1]);
+    }
+
+    return 1;
+}
+
+/* Verifies that a result is received as it was sent
+ * with name pointing into the received message.
+ */
+int test_wire_result()
+{
+    _sent.type = chili_wire_result;
+    _sent.result.name = "test_something";
+    _sent.result.library = "a.so";
+    _sent.result.identity = 7;
+    _sent.result.execution = execution_done;
+    _sent.result.test = test_failure;
+    _sent.result.usage.wall_ns = 1234;
+
+    chili_wire_write(_pipes[1], &_sent);
+
+    return assert_int(1, chili_wire_read(_pipes[0], &_received)) &&
+           assert_int(chili_wire_result, _received.type) &&
+           assert_str("test_something", _received.result.name) &&
+           assert_int(1, _received.result.name == _received.name) &&
+           assert_int(1, _received.result.library == NULL) &&
+           assert_int(7, _received.result.identity) &&
+           assert_int(execution_done, _received.result.execution) &&
+           assert_int(test_failure, _received.result.test) &&
+           assert_int(1234, _received.result.usage.wall_ns);
+}
+
+/* Verifies that too long names are truncated.
+ */
+int test_wire_long_name()
+{
+    char name[CHILI_WIRE_MAX_NAME * 2];
+
+    memset(name, 'a', sizeof(name));
+    name[sizeof(name) - 1] = '\0';
+    _sent.type = chili_wire_result;
+    _sent.result.name = name;
+
+    chili_wire_write(_pipes[1], &_sent);
+    chili_wire_read(_pipes[0], &_received);
+
+    return assert_int(CHILI_WIRE_MAX_NAME - 1, strlen(_received.name));
+}
+
+/* Verifies that end of pipe is detected.
+ */
+int test_wire_closed()
+{
+    _sent.type = chili_wire_done;
+    _sent.r = -3;
+
+    chili_wire_write(_pipes[1], &_sent);
+    close(_pipes[1]);
+    _pipes[1] = -1;
+
+    return assert_int(1, chili_wire_read(_pipes[0], &_received)) &&
+           assert_int(chili_wire_done, _received.type) &&
+           assert_int(-3, _received.r) &&
+           assert_int(0, chili_wire_read(_pipes[0], &_received));
+}
+
+/* Verifies that messages sent over a stream are received
+ * one by one until the stream is closed.
+ */
+int test_wire_stream()
+{
+    struct chili_wire_message done;
+
+    memset(&done, 0, sizeof(done));
+    done.type = chili_wire_done;
+    done.r = 1;
+    _sent.type = chili_wire_result;
+    _sent.result.name = "test_streamed";
+    _sent.result.identity = 3;
+
+    chili_wire_send(_pipes[1], &_sent);
+    chili_wire_send(_pipes[1], &done);
+    close(_pipes[1]);
+    _pipes[1] = -1;
+
+    return assert_int(1, chili_wire_receive(_pipes[0], &_received)) &&
+           assert_str("test_streamed", _received.result.name) &&
+           assert_int(3, _received.result.identity) &&
+           assert_int(1, chili_wire_receive(_pipes[0], &_received)) &&
+           assert_int(chili_wire_done, _received.type) &&
+           assert_int(1, _received.r) &&
+           assert_int(0, chili_wire_receive(_pipes[0], &_received));
+}
+
+/* Verifies that a stream not sent by chili is an error.
+ */
+int test_wire_stream_garbage()
+{
+    const char *garbage = "Hello from .bashrc\n";
+
+    write(_pipes[1], garbage, strlen(garbage));
+
+    return assert_int(-1, chili_wire_receive(_pipes[0], &_received));
+}
+
+/* Verifies that a stream cut in the middle of a message is
+ * an error.
+ */
+int test_wire_stream_cut()
+{
+    int sent[2];
+    char buffer[2 * sizeof(_sent)];
+    ssize_t size;
+
+    if (pipe(sent) < 0){
+        return 0;
+    }
+    chili_wire_send(sent[1], &_sent);
+    size = read(sent[0], buffer, sizeof(buffer));
+    close(sent[0]);
+    close(sent[1]);
+
+    write(_pipes[1], buffer, size - 1);
+    close(_pipes[1]);
+    _pipes[1] = -1;
+
+    return assert_int(-1, chili_wire_receive(_pipes[0], &_received));
+}